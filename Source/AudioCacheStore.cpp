@@ -1,17 +1,18 @@
 #include "AudioCacheStore.h"
 #include "AppProperties.h"
+#include "JobScheduler.h"
 #include <map>
+#include <algorithm>
 #include <cmath>
+#include <numeric>
 #include <cstdint>
-#include <condition_variable>
-#include <deque>
 #include <mutex>
-#include <thread>
 #include <unordered_map>
 
 namespace
 {
     const juce::StringArray kSupportedExtensions { "mp3", "wav", "m4a", "aiff", "aif", "flac" };
+    constexpr size_t kFilesPerScanJob = 64;
 
     bool isSupportedExtension (const juce::String& extension)
     {
@@ -19,8 +20,7 @@ namespace
     }
 
     AudioCacheStore::CacheEntry makeEntry (const juce::File& file,
-                                           const juce::AudioFormatReader& reader,
-                                           double minDurationSeconds)
+                                           const juce::AudioFormatReader& reader)
     {
         AudioCacheStore::CacheEntry entry;
         entry.path = file.getFullPathName();
@@ -30,20 +30,17 @@ namespace
 
         entry.fileSizeBytes = file.getSize();
         entry.lastModifiedMs = file.getLastModificationTime().toMilliseconds();
-        entry.isCandidate = entry.durationSeconds >= minDurationSeconds;
         return entry;
     }
 
     AudioCacheStore::CacheEntry makeEntryFromMetadata (const juce::File& file,
-                                                       double durationSeconds,
-                                                       double minDurationSeconds)
+                                                       double durationSeconds)
     {
         AudioCacheStore::CacheEntry entry;
         entry.path = file.getFullPathName();
         entry.durationSeconds = durationSeconds;
         entry.fileSizeBytes = file.getSize();
         entry.lastModifiedMs = file.getLastModificationTime().toMilliseconds();
-        entry.isCandidate = durationSeconds >= minDurationSeconds;
         return entry;
     }
 
@@ -122,7 +119,6 @@ namespace
     }
 
     bool tryReadMetadata (const juce::File& file,
-                          double minDurationSeconds,
                           AudioCacheStore::CacheEntry& entry);
 
     struct CacheBuildSharedState
@@ -130,12 +126,10 @@ namespace
         CacheBuildSharedState (AudioCacheStore::CacheData& targetDataIn,
                                std::atomic<bool>* shouldCancelIn,
                                std::function<void (int current, int total)> progressCallbackIn,
-                               double minDurationSecondsIn,
                                std::unordered_map<std::string, AudioCacheStore::CacheEntry> cachedEntriesIn)
             : targetData (targetDataIn),
               shouldCancel (shouldCancelIn),
               progressCallback (std::move (progressCallbackIn)),
-              minDurationSeconds (minDurationSecondsIn),
               cachedEntries (std::move (cachedEntriesIn))
         {
         }
@@ -143,7 +137,6 @@ namespace
         AudioCacheStore::CacheData& targetData;
         std::atomic<bool>* shouldCancel = nullptr;
         std::function<void (int current, int total)> progressCallback;
-        double minDurationSeconds = 0.0;
         std::atomic<int> totalFiles { 0 };
         std::atomic<int> processed { 0 };
         std::atomic<int> lastReported { 0 };
@@ -151,10 +144,6 @@ namespace
         std::atomic<int> supportedFiles { 0 };
         std::map<juce::String, int> extensionCounts;
         std::unordered_map<std::string, AudioCacheStore::CacheEntry> cachedEntries;
-        std::deque<juce::File> pendingFiles;
-        std::mutex queueMutex;
-        std::condition_variable queueCondition;
-        std::atomic<bool> producerDone { false };
         std::mutex entriesMutex;
         std::mutex extensionsMutex;
     };
@@ -216,7 +205,7 @@ namespace
                 && cachedEntry.lastModifiedMs == currentModified
                 && cachedEntry.durationSeconds > 0.0)
             {
-                entry = makeEntryFromMetadata (file, cachedEntry.durationSeconds, state.minDurationSeconds);
+                entry = makeEntryFromMetadata (file, cachedEntry.durationSeconds);
                 state.supportedFiles.fetch_add (1);
                 {
                     const std::lock_guard<std::mutex> lock (state.entriesMutex);
@@ -227,7 +216,7 @@ namespace
             }
         }
 
-        if (tryReadMetadata (file, state.minDurationSeconds, entry))
+        if (tryReadMetadata (file, entry))
         {
             state.supportedFiles.fetch_add (1);
             {
@@ -248,57 +237,25 @@ namespace
         state.supportedFiles.fetch_add (1);
         {
             const std::lock_guard<std::mutex> lock (state.entriesMutex);
-            state.targetData.entries.add (makeEntry (file, *reader, state.minDurationSeconds));
+            state.targetData.entries.add (makeEntry (file, *reader));
         }
         reportProgress (state);
     }
 
-    class CacheWorkerJob : public juce::ThreadPoolJob
+    // one scan job: a batch of files from the directory walk
+    void scanFiles (CacheBuildSharedState& state, const std::vector<juce::File>& files)
     {
-    public:
-        CacheWorkerJob (CacheBuildSharedState& stateIn)
-            : juce::ThreadPoolJob ("CacheWorkerJob"),
-              state (stateIn)
-        {
-            formatManager.registerBasicFormats();
-        }
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
 
-        JobStatus runJob() override
+        for (const auto& file : files)
         {
-            while (true)
-            {
-                if (state.shouldCancel != nullptr && state.shouldCancel->load())
-                    return jobHasFinished;
-
-                juce::File fileToHandle;
-                {
-                    std::unique_lock<std::mutex> lock (state.queueMutex);
-                    state.queueCondition.wait (lock, [this]()
-                    {
-                        return state.producerDone.load() || ! state.pendingFiles.empty();
-                    });
-
-                    if (state.pendingFiles.empty())
-                    {
-                        if (state.producerDone.load())
-                            break;
-                        continue;
-                    }
-
-                    fileToHandle = state.pendingFiles.front();
-                    state.pendingFiles.pop_front();
-                }
-
-                handleFile (fileToHandle, formatManager, state);
-            }
+            if (state.shouldCancel != nullptr && state.shouldCancel->load())
+                return;
 
-            return jobHasFinished;
+            handleFile (file, formatManager, state);
         }
-
-    private:
-        CacheBuildSharedState& state;
-        juce::AudioFormatManager formatManager;
-    };
+    }
 
     double readExtended80 (juce::InputStream& stream, bool& ok)
     {
@@ -333,7 +290,6 @@ namespace
     }
 
     bool tryReadWavMetadata (const juce::File& file,
-                             double minDurationSeconds,
                              AudioCacheStore::CacheEntry& entry)
     {
         const auto extension = file.getFileExtension().toLowerCase();
@@ -431,12 +387,11 @@ namespace
             return false;
 
         const double durationSeconds = static_cast<double> (dataSize) / bytesPerFrame / static_cast<double> (sampleRate);
-        entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+        entry = makeEntryFromMetadata (file, durationSeconds);
         return true;
     }
 
     bool tryReadAiffMetadata (const juce::File& file,
-                              double minDurationSeconds,
                               AudioCacheStore::CacheEntry& entry)
     {
         const auto extension = file.getFileExtension().toLowerCase();
@@ -519,12 +474,11 @@ namespace
             return false;
 
         const double durationSeconds = static_cast<double> (numFrames) / sampleRate;
-        entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+        entry = makeEntryFromMetadata (file, durationSeconds);
         return true;
     }
 
     bool tryReadFlacMetadata (const juce::File& file,
-                              double minDurationSeconds,
                               AudioCacheStore::CacheEntry& entry)
     {
         const auto extension = file.getFileExtension().toLowerCase();
@@ -579,7 +533,7 @@ namespace
                     return false;
 
                 const double durationSeconds = static_cast<double> (totalSamples) / static_cast<double> (sampleRate);
-                entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+                entry = makeEntryFromMetadata (file, durationSeconds);
                 return true;
             }
             else
@@ -592,7 +546,6 @@ namespace
     }
 
     bool tryReadMp3Metadata (const juce::File& file,
-                             double minDurationSeconds,
                              AudioCacheStore::CacheEntry& entry)
     {
         const auto extension = file.getFileExtension().toLowerCase();
@@ -665,12 +618,11 @@ namespace
             return false;
 
         const double durationSeconds = (static_cast<double> (audioBytes) * 8.0) / (static_cast<double> (bitrate) * 1000.0);
-        entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+        entry = makeEntryFromMetadata (file, durationSeconds);
         return true;
     }
 
     bool tryReadM4aMetadata (const juce::File& file,
-                             double minDurationSeconds,
                              AudioCacheStore::CacheEntry& entry)
     {
         const auto extension = file.getFileExtension().toLowerCase();
@@ -751,7 +703,7 @@ namespace
                             return false;
 
                         const double durationSeconds = static_cast<double> (duration) / static_cast<double> (timescale);
-                        entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+                        entry = makeEntryFromMetadata (file, durationSeconds);
                         return true;
                     }
                     else if (version == 1)
@@ -768,7 +720,7 @@ namespace
                             return false;
 
                         const double durationSeconds = static_cast<double> (duration) / static_cast<double> (timescale);
-                        entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+                        entry = makeEntryFromMetadata (file, durationSeconds);
                         return true;
                     }
 
@@ -864,7 +816,7 @@ namespace
                                 return false;
 
                             const double durationSeconds = static_cast<double> (duration) / static_cast<double> (timescale);
-                            entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+                            entry = makeEntryFromMetadata (file, durationSeconds);
                             return true;
                         }
                         else if (version == 1)
@@ -881,7 +833,7 @@ namespace
                                 return false;
 
                             const double durationSeconds = static_cast<double> (duration) / static_cast<double> (timescale);
-                            entry = makeEntryFromMetadata (file, durationSeconds, minDurationSeconds);
+                            entry = makeEntryFromMetadata (file, durationSeconds);
                             return true;
                         }
                     }
@@ -905,14 +857,13 @@ namespace
     }
 
     bool tryReadMetadata (const juce::File& file,
-                          double minDurationSeconds,
                           AudioCacheStore::CacheEntry& entry)
     {
-        return tryReadWavMetadata (file, minDurationSeconds, entry)
-               || tryReadAiffMetadata (file, minDurationSeconds, entry)
-               || tryReadFlacMetadata (file, minDurationSeconds, entry)
-               || tryReadMp3Metadata (file, minDurationSeconds, entry)
-               || tryReadM4aMetadata (file, minDurationSeconds, entry);
+        return tryReadWavMetadata (file, entry)
+               || tryReadAiffMetadata (file, entry)
+               || tryReadFlacMetadata (file, entry)
+               || tryReadMp3Metadata (file, entry)
+               || tryReadM4aMetadata (file, entry);
     }
 
     juce::File getAppSupportDirectory()
@@ -961,10 +912,6 @@ namespace
             if (object->hasProperty ("lastModifiedMs"))
                 entry.lastModifiedMs = static_cast<int64_t> (object->getProperty ("lastModifiedMs"));
 
-            entry.isCandidate = true;
-            if (object->hasProperty ("isCandidate"))
-                entry.isCandidate = static_cast<bool> (object->getProperty ("isCandidate"));
-
             return ! entry.path.isEmpty();
         }
 
@@ -972,6 +919,120 @@ namespace
     }
 }
 
+int AudioCacheStore::CacheEntries::size() const
+{
+    return static_cast<int> (durations.size());
+}
+
+bool AudioCacheStore::CacheEntries::isEmpty() const
+{
+    return durations.empty();
+}
+
+void AudioCacheStore::CacheEntries::reserve (int numEntries)
+{
+    const auto count = static_cast<size_t> (juce::jmax (0, numEntries));
+    nameOffsets.reserve (count + 1);
+    directoryIndices.reserve (count);
+    durations.reserve (count);
+    fileSizes.reserve (count);
+    lastModified.reserve (count);
+}
+
+void AudioCacheStore::CacheEntries::add (const CacheEntry& entry)
+{
+    // the directory keeps its trailing separator so the path rebuilds exactly
+    const int split = entry.path.lastIndexOfChar (juce::File::getSeparatorChar()) + 1;
+    const auto directory = entry.path.substring (0, split);
+    const auto name = entry.path.substring (split);
+
+    const auto [found, inserted] = directoryLookup.try_emplace (directory, static_cast<int> (directories.size()));
+    if (inserted)
+        directories.push_back (directory);
+
+    const char* nameBytes = name.toRawUTF8();
+    namePool.insert (namePool.end(), nameBytes, nameBytes + name.getNumBytesAsUTF8());
+    nameOffsets.push_back (static_cast<uint32_t> (namePool.size()));
+
+    directoryIndices.push_back (found->second);
+    durations.push_back (static_cast<float> (entry.durationSeconds));
+    fileSizes.push_back (entry.fileSizeBytes);
+    lastModified.push_back (entry.lastModifiedMs);
+
+    durationOrder.clear();
+    sortedDurations.clear();
+}
+
+void AudioCacheStore::CacheEntries::sortDurationIndex()
+{
+    durationOrder.resize (durations.size());
+    std::iota (durationOrder.begin(), durationOrder.end(), 0);
+    std::stable_sort (durationOrder.begin(), durationOrder.end(),
+                      [this] (int a, int b) { return durations[static_cast<size_t> (a)] < durations[static_cast<size_t> (b)]; });
+
+    sortedDurations.resize (durationOrder.size());
+    for (size_t rank = 0; rank < durationOrder.size(); ++rank)
+        sortedDurations[rank] = durations[static_cast<size_t> (durationOrder[rank])];
+}
+
+juce::String AudioCacheStore::CacheEntries::getPath (int index) const
+{
+    const auto i = static_cast<size_t> (index);
+    const auto start = nameOffsets[i];
+    const auto name = juce::String::fromUTF8 (namePool.data() + start, static_cast<int> (nameOffsets[i + 1] - start));
+    return directories[static_cast<size_t> (directoryIndices[i])] + name;
+}
+
+double AudioCacheStore::CacheEntries::getDurationSeconds (int index) const
+{
+    return durations[static_cast<size_t> (index)];
+}
+
+int64_t AudioCacheStore::CacheEntries::getFileSizeBytes (int index) const
+{
+    return fileSizes[static_cast<size_t> (index)];
+}
+
+int64_t AudioCacheStore::CacheEntries::getLastModifiedMs (int index) const
+{
+    return lastModified[static_cast<size_t> (index)];
+}
+
+AudioCacheStore::CacheEntry AudioCacheStore::CacheEntries::getEntry (int index) const
+{
+    CacheEntry entry;
+    entry.path = getPath (index);
+    entry.durationSeconds = getDurationSeconds (index);
+    entry.fileSizeBytes = getFileSizeBytes (index);
+    entry.lastModifiedMs = getLastModifiedMs (index);
+    return entry;
+}
+
+int AudioCacheStore::CacheEntries::countShorterThan (double seconds) const
+{
+    jassert (sortedDurations.size() == durations.size());
+    const auto cutoff = std::lower_bound (sortedDurations.begin(), sortedDurations.end(), static_cast<float> (seconds));
+    return static_cast<int> (cutoff - sortedDurations.begin());
+}
+
+int AudioCacheStore::CacheEntries::entryAtDurationRank (int rank) const
+{
+    jassert (durationOrder.size() == durations.size());
+    return durationOrder[static_cast<size_t> (rank)];
+}
+
+double AudioCacheStore::minCandidateDurationSeconds (double bpm)
+{
+    const double resolvedBpm = bpm > 0.0 ? bpm : 128.0;
+    return (60.0 / resolvedBpm) * 32.0;
+}
+
+double AudioCacheStore::noGoZoneSeconds (double bpm)
+{
+    const double resolvedBpm = bpm > 0.0 ? bpm : 128.0;
+    return std::ceil ((60.0 / resolvedBpm) * 8.0);
+}
+
 juce::File AudioCacheStore::getCacheFile()
 {
     const auto appSupportDir = getAppSupportFolder();
@@ -981,9 +1042,17 @@ juce::File AudioCacheStore::getCacheFile()
     return appSupportDir.getChildFile ("AudioCache.json");
 }
 
+juce::File AudioCacheStore::getEnergyMapFolder()
+{
+    const auto appSupportDir = getAppSupportFolder();
+    if (appSupportDir == juce::File())
+        return juce::File();
+
+    return appSupportDir.getChildFile ("EnergyMaps");
+}
+
 AudioCacheStore::CacheData AudioCacheStore::buildFromSource (const juce::File& source,
                                                              bool isDirectory,
-                                                             double bpm,
                                                              std::atomic<bool>* shouldCancel,
                                                              std::function<void (int current, int total)> progressCallback,
                                                              bool* wasCancelled)
@@ -996,16 +1065,13 @@ AudioCacheStore::CacheData AudioCacheStore::buildFromSource (const juce::File& s
     if (wasCancelled != nullptr)
         *wasCancelled = false;
 
-    const double resolvedBpm = bpm > 0.0 ? bpm : 128.0;
-    const double minDurationSeconds = (60.0 / resolvedBpm) * 32.0;
-
     std::unordered_map<std::string, AudioCacheStore::CacheEntry> cachedEntries;
     if (const auto existingCache = load();
         existingCache.sourcePath == data.sourcePath
         && existingCache.isDirectorySource == data.isDirectorySource)
     {
-        for (const auto& entry : existingCache.entries)
-            cachedEntries.emplace (entry.path.toStdString(), entry);
+        for (int i = 0; i < existingCache.entries.size(); ++i)
+            cachedEntries.emplace (existingCache.entries.getPath (i).toStdString(), existingCache.entries.getEntry (i));
     }
 
     if (shouldCancel != nullptr && shouldCancel->load())
@@ -1018,13 +1084,33 @@ AudioCacheStore::CacheData AudioCacheStore::buildFromSource (const juce::File& s
     CacheBuildSharedState sharedState (data,
                                        shouldCancel,
                                        progressCallback,
-                                       minDurationSeconds,
                                        std::move (cachedEntries));
 
     if (progressCallback)
         progressCallback (0, 0);
 
-    auto enqueueFile = [&sharedState] (const juce::File& file)
+    // the walk only hands out batches, so it does not hold an analysis slot
+    // the scan jobs could use; each batch is a job on the shared scheduler,
+    // so however many are queued, a recache never takes every worker
+    auto& scheduler = JobScheduler::get();
+    scheduler.releaseAnalysisSlot();
+
+    std::vector<JobScheduler::JobHandle> scanJobs;
+    std::vector<juce::File> batch;
+
+    auto submitBatch = [&]
+    {
+        if (batch.empty())
+            return;
+
+        scanJobs.push_back (scheduler.submit (JobScheduler::Priority::analysis, [&sharedState, files = std::move (batch)]
+        {
+            scanFiles (sharedState, files);
+        }));
+        batch.clear();
+    };
+
+    auto enqueueFile = [&] (const juce::File& file)
     {
         auto extension = file.getFileExtension().toLowerCase();
         if (extension.startsWithChar ('.'))
@@ -1032,13 +1118,10 @@ AudioCacheStore::CacheData AudioCacheStore::buildFromSource (const juce::File& s
         if (! isSupportedExtension (extension))
             return;
 
-        int total = 0;
-        {
-            const std::lock_guard<std::mutex> lock (sharedState.queueMutex);
-            sharedState.pendingFiles.push_back (file);
-            total = sharedState.totalFiles.fetch_add (1) + 1;
-        }
-        sharedState.queueCondition.notify_one();
+        batch.push_back (file);
+        const int total = sharedState.totalFiles.fetch_add (1) + 1;
+        if (batch.size() >= kFilesPerScanJob)
+            submitBatch();
 
         if (sharedState.progressCallback)
         {
@@ -1054,46 +1137,31 @@ AudioCacheStore::CacheData AudioCacheStore::buildFromSource (const juce::File& s
         }
     };
 
-    std::thread producer ([&]()
+    if (isDirectory && source.isDirectory())
     {
-        if (isDirectory && source.isDirectory())
+        for (const auto& entry : juce::RangedDirectoryIterator (source, true, "*", juce::File::findFiles))
         {
-            for (const auto& entry : juce::RangedDirectoryIterator (source, true, "*", juce::File::findFiles))
+            if (shouldCancel != nullptr && shouldCancel->load())
             {
-                if (shouldCancel != nullptr && shouldCancel->load())
-                {
-                    if (wasCancelled != nullptr)
-                        *wasCancelled = true;
-                    break;
-                }
-
-                enqueueFile (entry.getFile());
+                if (wasCancelled != nullptr)
+                    *wasCancelled = true;
+                break;
             }
-        }
-        else if (source.existsAsFile())
-        {
-            enqueueFile (source);
-        }
 
-        sharedState.producerDone.store (true);
-        sharedState.queueCondition.notify_all();
-        if (sharedState.progressCallback)
-            sharedState.progressCallback (sharedState.processed.load(), sharedState.totalFiles.load());
-    });
-
-    const int cpuCount = juce::jmax (1, juce::SystemStats::getNumCpus());
-    const int workerCount = juce::jmax (1, juce::jmin (cpuCount, 8));
-    juce::ThreadPool pool (workerCount);
-    juce::OwnedArray<CacheWorkerJob> jobs;
-    for (int i = 0; i < workerCount; ++i)
+            enqueueFile (entry.getFile());
+        }
+    }
+    else if (source.existsAsFile())
     {
-        auto* job = jobs.add (new CacheWorkerJob (sharedState));
-        pool.addJob (job, false);
+        enqueueFile (source);
     }
 
-    pool.removeAllJobs (true, -1);
-    if (producer.joinable())
-        producer.join();
+    submitBatch();
+    if (sharedState.progressCallback)
+        sharedState.progressCallback (sharedState.processed.load(), sharedState.totalFiles.load());
+
+    for (const auto& scanJob : scanJobs)
+        scheduler.wait (scanJob);
 
     if (shouldCancel != nullptr && shouldCancel->load())
     {
@@ -1101,6 +1169,8 @@ AudioCacheStore::CacheData AudioCacheStore::buildFromSource (const juce::File& s
             *wasCancelled = true;
     }
 
+    data.entries.sortDurationIndex();
+
     juce::StringArray extensionSummary;
     for (const auto& entry : sharedState.extensionCounts)
         extensionSummary.add (entry.first + "=" + juce::String (entry.second));
@@ -1162,6 +1232,8 @@ AudioCacheStore::CacheData AudioCacheStore::load()
         }
     }
 
+    data.entries.sortDurationIndex();
+
     return data;
 }
 
@@ -1172,8 +1244,8 @@ bool AudioCacheStore::save (const CacheData& data)
         return false;
 
     juce::StringArray entryJson;
-    for (const auto& entry : data.entries)
-        entryJson.add (juce::JSON::toString (entryToVar (entry), true));
+    for (int i = 0; i < data.entries.size(); ++i)
+        entryJson.add (juce::JSON::toString (entryToVar (data.entries.getEntry (i)), true));
 
     const auto sourcePathJson = juce::JSON::toString (juce::var (data.sourcePath));
     const auto entriesJson = entryJson.joinIntoString (",\n");
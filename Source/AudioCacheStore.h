@@ -3,6 +3,8 @@
 #include <JuceHeader.h>
 #include <atomic>
 #include <functional>
+#include <map>
+#include <vector>
 
 class AudioCacheStore
 {
@@ -13,20 +15,69 @@ public:
         double durationSeconds = 0.0;
         int64_t fileSizeBytes = 0;
         int64_t lastModifiedMs = 0;
-        bool isCandidate = true;
+    };
+
+    // Entries stored column by column. Paths are split into a shared
+    // directory table and a pool of UTF-8 file names, so a library keeps one
+    // copy of each folder path however many files it holds, and a scan over
+    // one field walks a single packed array.
+    //
+    // Durations do not depend on the BPM. A rank index sorted by duration
+    // turns "long enough at this BPM" into one binary search.
+    class CacheEntries
+    {
+    public:
+        int size() const;
+        bool isEmpty() const;
+        void reserve (int numEntries);
+        void add (const CacheEntry& entry);
+
+        // must run after the last add and before the rank accessors are used
+        void sortDurationIndex();
+
+        juce::String getPath (int index) const;
+        double getDurationSeconds (int index) const;
+        int64_t getFileSizeBytes (int index) const;
+        int64_t getLastModifiedMs (int index) const;
+        CacheEntry getEntry (int index) const;
+
+        // ranks [countShorterThan (s), size()) are the entries of at least s
+        // seconds; entryAtDurationRank maps a rank back to an entry index
+        int countShorterThan (double seconds) const;
+        int entryAtDurationRank (int rank) const;
+
+    private:
+        std::vector<juce::String> directories;
+        std::map<juce::String, int> directoryLookup;
+        std::vector<char> namePool;
+        std::vector<uint32_t> nameOffsets { 0 }; // entry i is [nameOffsets[i], nameOffsets[i + 1])
+
+        std::vector<int> directoryIndices;
+        std::vector<float> durations;
+        std::vector<int64_t> fileSizes;
+        std::vector<int64_t> lastModified;
+
+        std::vector<int> durationOrder;        // entry indices, shortest first
+        std::vector<float> sortedDurations;    // durations in durationOrder
     };
 
     struct CacheData
     {
         juce::String sourcePath;
         bool isDirectorySource = false;
-        juce::Array<CacheEntry> entries;
+        CacheEntries entries;
     };
 
+    // a file is sliceable when it lasts at least 32 beats at the given BPM
+    static double minCandidateDurationSeconds (double bpm);
+
+    // the tail of a file no slice may start in
+    static double noGoZoneSeconds (double bpm);
+
     static juce::File getCacheFile();
+    static juce::File getEnergyMapFolder();
     static CacheData buildFromSource (const juce::File& source,
                                       bool isDirectory,
-                                      double bpm,
                                       std::atomic<bool>* shouldCancel,
                                       std::function<void (int current, int total)> progressCallback = {},
                                       bool* wasCancelled = nullptr);
@@ -1,5 +1,6 @@
 #include "AudioEngine.h"
 #include "AppProperties.h"
+#include "AudioFileIO.h"
 
 namespace
 {
@@ -9,7 +10,11 @@ namespace
     constexpr const char* kVirtualOutName = "SliceBot Sync Out";
     constexpr double kMinMidiBpm = 20.0;
     constexpr double kMaxMidiBpm = 300.0;
-    constexpr double kPreferredSampleRate = 44100.0;
+    constexpr int kMidiClockDispatchIntervalMs = 1;
+    constexpr double kBeatsPerBar = 4.0;
+    constexpr double kLateLatchToleranceBeats = 0.125;
+    constexpr int kPadBaseNote = 36; // C1, the first pad on most controllers
+    constexpr int kVoiceBusChannels = 2;
     enum ExternalTransportCommand
     {
         kExternalTransportNone = 0,
@@ -17,6 +22,15 @@ namespace
         kExternalTransportStop = 2
     };
 
+    int loadRecorderCount()
+    {
+        int count = RecordingBus::kDefaultNumRecorders;
+        if (auto* settings = AppProperties::get().properties().getUserSettings())
+            count = settings->getIntValue ("recorderCount", count);
+
+        return juce::jlimit (1, RecordingBus::kMaxRecorders, count);
+    }
+
     juce::File findSoundFile (const juce::String& name)
     {
         auto cwd = juce::File::getCurrentWorkingDirectory();
@@ -61,11 +75,32 @@ namespace
 // =====================================================
 
 AudioEngine::AudioEngine()
-{
+    : recordingBus (loadRecorderCount())
+{
+    const auto numRecorders = static_cast<size_t> (recordingBus.getNumRecorders());
+    configuredRecorderCount = recordingBus.getNumRecorders();
+    recorderPhysicalChannels.assign (numRecorders, -1);
+    recorderMonitoringEnabled.assign (numRecorders, false);
+    recorderLatchEnabled.assign (numRecorders, false);
+    recorderIncludeInGeneration.assign (numRecorders, true);
+    recorderMidiInEnabled.assign (numRecorders, false);
+    recorderMidiOutEnabled.assign (numRecorders, false);
+    recorderRecordArmEnabled.assign (numRecorders, true);
+    recorderLocked.assign (numRecorders, false);
+    recorderInputGainDb.assign (numRecorders, 0.0f);
+
     auto& props = AppProperties::get().properties();
 
+    // channel counts decide the take layout, so they are set before the
+    // device prepares the recorders and loads their takes from disk
     if (auto* settings = props.getUserSettings())
     {
+        for (int index = 0; index < recordingBus.getNumRecorders(); ++index)
+        {
+            const int numChannels = settings->getIntValue ("recorder_" + juce::String (index) + "_numChannels", 1);
+            recordingBus.setRecorderNumChannels (index, numChannels, deviceManager.getAudioCallbackLock());
+        }
+
         if (auto xml = settings->getXmlValue ("audioDeviceState"))
             deviceManager.initialise (0, 0, xml.get(), true);
         else
@@ -76,13 +111,26 @@ AudioEngine::AudioEngine()
         deviceManager.initialiseWithDefaultDevices (2, 2);
     }
 
-    enforceSampleRate (kPreferredSampleRate);
     deviceManager.addAudioCallback (this);
+
+    bufferSizeTuner.onSettled = [this] (int bufferSize)
+    {
+        tunedBufferSize = bufferSize;
+        if (auto* device = deviceManager.getCurrentAudioDevice())
+            tunedBufferDevice = device->getName();
+        saveState();
+    };
 }
 
 AudioEngine::~AudioEngine()
 {
     stopTimer();
+    bufferSizeTuner.cancel();
+
+    // no callback is left to schedule it
+    if (midiClockRunning || midiClockStopping.load())
+        sendMidiStop();
+
     closeMidiInputDevice();
     closeMidiOutputDevice();
 
@@ -120,12 +168,21 @@ void AudioEngine::restoreState()
         midiSyncOutputDeviceIdentifier = settings->getValue ("midiSyncOutputDevice", "");
         midiVirtualPortsEnabled = settings->getBoolValue ("midiVirtualPortsEnabled", defaultVirtualPorts);
         midiSyncBpm = settings->getDoubleValue ("midiSyncBpm", midiSyncBpm);
+        recordQuantize.store (static_cast<RecordQuantize> (juce::jlimit (
+            0, 2, settings->getIntValue ("recordQuantize", static_cast<int> (RecordQuantize::bar)))));
+        padModeEnabled.store (settings->getBoolValue ("padModeEnabled", false));
+        padChokeMode = static_cast<PadChokeMode> (juce::jlimit (
+            0, 2, settings->getIntValue ("padChokeMode", static_cast<int> (PadChokeMode::perPad))));
+        bufferAutoTuneEnabled = settings->getBoolValue ("bufferAutoTuneEnabled", false);
+        tunedBufferSize = settings->getIntValue ("tunedBufferSize", 0);
+        tunedBufferDevice = settings->getValue ("tunedBufferDevice", "");
+        recordingBus.setMaxTakeSeconds (settings->getDoubleValue ("maxTakeSeconds", RecordingModule::kMaxTakeSeconds));
         transportMasterRecorderIndex = -1;
         externalTransportPlaying.store (false);
         lastExternalClockMs.store (0.0);
         pendingExternalTransportCommand.store (kExternalTransportNone);
 
-        for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+        for (int index = 0; index < getNumRecorders(); ++index)
         {
             const juce::String prefix = "recorder_" + juce::String (index) + "_";
             const int inputChannel = settings->getIntValue (prefix + "inputChannel", -1);
@@ -163,9 +220,15 @@ void AudioEngine::restoreState()
             recordingBus.setRecorderLatchEnabled (index, false);
             recordingBus.setRecorderRecordArmEnabled (index, recordArmEnabled);
             recordingBus.setRecorderInputGainDb (index, gainDb);
+            recordingBus.setRecorderCaptureEnabled (index,
+                                                    settings->getBoolValue (prefix + "captureEnabled", false),
+                                                    deviceManager.getAudioCallbackLock());
         }
     }
 
+    applyPadChokeGroups();
+    applyTunedBufferSize();
+    updateRecorderRouting (deviceManager.getCurrentAudioDevice());
     updateMidiClockState();
     updateMidiInputState();
 }
@@ -180,11 +243,20 @@ void AudioEngine::saveState()
         settings->setValue ("midiSyncOutputDevice", midiSyncOutputDeviceIdentifier);
         settings->setValue ("midiVirtualPortsEnabled", midiVirtualPortsEnabled);
         settings->setValue ("midiSyncBpm", midiSyncBpm);
-
-        for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+        settings->setValue ("recordQuantize", static_cast<int> (recordQuantize.load()));
+        settings->setValue ("padModeEnabled", padModeEnabled.load());
+        settings->setValue ("padChokeMode", static_cast<int> (padChokeMode));
+        settings->setValue ("recorderCount", configuredRecorderCount);
+        settings->setValue ("bufferAutoTuneEnabled", bufferAutoTuneEnabled);
+        settings->setValue ("tunedBufferSize", tunedBufferSize);
+        settings->setValue ("tunedBufferDevice", tunedBufferDevice);
+        settings->setValue ("maxTakeSeconds", recordingBus.getMaxTakeSeconds());
+
+        for (int index = 0; index < getNumRecorders(); ++index)
         {
             const juce::String prefix = "recorder_" + juce::String (index) + "_";
             settings->setValue (prefix + "inputChannel", recorderPhysicalChannels[index]);
+            settings->setValue (prefix + "numChannels", recordingBus.getRecorderNumChannels (index));
             settings->setValue (prefix + "includeInGeneration", recorderIncludeInGeneration[index]);
             settings->setValue (prefix + "monitoringEnabled", false);
             settings->setValue (prefix + "latchEnabled", false);
@@ -193,36 +265,37 @@ void AudioEngine::saveState()
             settings->setValue (prefix + "recordArmEnabled", recorderRecordArmEnabled[index]);
             settings->setValue (prefix + "locked", recorderLocked[index]);
             settings->setValue (prefix + "inputGainDb", recorderInputGainDb[index]);
+            settings->setValue (prefix + "captureEnabled", recordingBus.isRecorderCaptureEnabled (index));
         }
     }
 }
 
 // =====================================================
-// DEVICE ACCESS
+// RECORDER BANK
 // =====================================================
 
-juce::AudioDeviceManager& AudioEngine::getDeviceManager()
+int AudioEngine::getNumRecorders() const
 {
-    return deviceManager;
+    return recordingBus.getNumRecorders();
 }
 
-void AudioEngine::enforceSampleRate (double targetSampleRate)
+void AudioEngine::setConfiguredRecorderCount (int count)
 {
-    auto* device = deviceManager.getCurrentAudioDevice();
-    if (! device)
-        return;
+    configuredRecorderCount = juce::jlimit (1, RecordingBus::kMaxRecorders, count);
+}
 
-    const auto availableRates = device->getAvailableSampleRates();
-    if (! availableRates.contains (targetSampleRate))
-        return;
+int AudioEngine::getConfiguredRecorderCount() const
+{
+    return configuredRecorderCount;
+}
 
-    juce::AudioDeviceManager::AudioDeviceSetup setup;
-    deviceManager.getAudioDeviceSetup (setup);
-    if (juce::approximatelyEqual (setup.sampleRate, targetSampleRate))
-        return;
+// =====================================================
+// DEVICE ACCESS
+// =====================================================
 
-    setup.sampleRate = targetSampleRate;
-    deviceManager.setAudioDeviceSetup (setup, true);
+juce::AudioDeviceManager& AudioEngine::getDeviceManager()
+{
+    return deviceManager;
 }
 
 // =====================================================
@@ -319,9 +392,22 @@ double AudioEngine::getMidiSyncBpm() const
     return midiSyncBpm;
 }
 
+MidiClockScheduler::JitterStats AudioEngine::getMidiClockJitterStats() const
+{
+    return midiClockScheduler.getJitterStats();
+}
+
+MidiClockFollower::Estimate AudioEngine::getExternalClockEstimate() const
+{
+    if (midiSyncMode != MidiSyncMode::receive)
+        return {};
+
+    return midiClockFollower.getEstimate (juce::Time::getMillisecondCounterHiRes());
+}
+
 void AudioEngine::setRecorderMidiInEnabled (int index, bool enabled)
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return;
 
     recorderMidiInEnabled[index] = enabled;
@@ -329,12 +415,12 @@ void AudioEngine::setRecorderMidiInEnabled (int index, bool enabled)
 
 void AudioEngine::setRecorderMidiOutEnabled (int index, bool enabled)
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return;
 
     if (enabled)
     {
-        for (int i = 0; i < RecordingBus::kNumRecorders; ++i)
+        for (int i = 0; i < getNumRecorders(); ++i)
             recorderMidiOutEnabled[i] = (i == index);
         transportMasterRecorderIndex = index;
         updateMidiClockState();
@@ -349,7 +435,7 @@ void AudioEngine::setRecorderMidiOutEnabled (int index, bool enabled)
 
 bool AudioEngine::isRecorderMidiInEnabled (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return false;
 
     return recorderMidiInEnabled[index];
@@ -357,7 +443,7 @@ bool AudioEngine::isRecorderMidiInEnabled (int index) const
 
 bool AudioEngine::isRecorderMidiOutEnabled (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return false;
 
     return recorderMidiOutEnabled[index];
@@ -370,27 +456,49 @@ int AudioEngine::getTransportMasterRecorderIndex() const
 
 void AudioEngine::hiResTimerCallback()
 {
-    if (! midiClockRunning)
-        return;
-
+    // clock timing comes from the audio callback; this only releases due events
     if (auto* output = getActiveMidiOutput())
-        output->sendMessageNow (juce::MidiMessage::midiClock());
+        midiClockScheduler.dispatchDue (*output, juce::Time::getMillisecondCounterHiRes());
+
+    // the output is closed on the message thread once the Stop is out
+    if (midiClockStopping.load() && midiClockScheduler.isStopFinished())
+        triggerAsyncUpdate();
 }
 
 void AudioEngine::handleIncomingMidiMessage (juce::MidiInput*,
                                              const juce::MidiMessage& message)
 {
+    // driver timestamps are in seconds on the hi-res millisecond counter
+    const double timestampMs = message.getTimeStamp() > 0.0
+                                   ? message.getTimeStamp() * 1000.0
+                                   : juce::Time::getMillisecondCounterHiRes();
+
+    if (message.isNoteOn())
+    {
+        const int pad = message.getNoteNumber() - kPadBaseNote;
+        if (padModeEnabled.load() && pad >= 0 && pad < SliceVoicePool::kNumPads)
+        {
+            const float velocity = message.getFloatVelocity();
+            sliceVoicePool.triggerPad (pad, velocity * velocity, timestampMs);
+        }
+        return;
+    }
+
     if (midiSyncMode != MidiSyncMode::receive)
         return;
 
     if (message.isMidiClock())
     {
-        lastExternalClockMs.store (juce::Time::getMillisecondCounterHiRes());
+        lastExternalClockMs.store (timestampMs);
+        midiClockFollower.handleClock (timestampMs);
         return;
     }
 
     if (message.isMidiStart() || message.isMidiContinue())
     {
+        if (message.isMidiStart())
+            midiClockFollower.handleStart();
+
         externalTransportPlaying.store (true);
         pendingExternalTransportCommand.store (kExternalTransportStart);
         triggerAsyncUpdate();
@@ -399,6 +507,7 @@ void AudioEngine::handleIncomingMidiMessage (juce::MidiInput*,
 
     if (message.isMidiStop())
     {
+        midiClockFollower.handleStop();
         externalTransportPlaying.store (false);
         pendingExternalTransportCommand.store (kExternalTransportStop);
         triggerAsyncUpdate();
@@ -408,6 +517,28 @@ void AudioEngine::handleIncomingMidiMessage (juce::MidiInput*,
 
 void AudioEngine::handleAsyncUpdate()
 {
+    if (midiClockStopping.load())
+    {
+        // a device that stopped first never schedules the Stop; it goes out now
+        const auto* device = deviceManager.getCurrentAudioDevice();
+        const bool deviceRunning = device != nullptr && device->isPlaying();
+        if (midiClockScheduler.isStopFinished() || ! deviceRunning)
+        {
+            if (! midiClockScheduler.isStopFinished())
+                sendMidiStop();
+
+            midiClockStopping.store (false);
+            logMidiClockStats();
+            updateMidiClockState();
+        }
+    }
+
+    if (latchedStopFinalisePending.exchange (false))
+    {
+        recordingBus.finaliseLatchedStop();
+        recordingBus.releaseIdleTakes (deviceManager.getAudioCallbackLock());
+    }
+
     const int command = pendingExternalTransportCommand.exchange (kExternalTransportNone);
     if (command == kExternalTransportStart)
     {
@@ -429,9 +560,27 @@ void AudioEngine::updateMidiClockState()
     {
         if (midiClockRunning)
         {
-            sendMidiStop();
             midiClockRunning = false;
+
+            // the callback queues Stop behind the ticks it already scheduled;
+            // the timer and the output keep going until it has been sent
+            const auto* device = deviceManager.getCurrentAudioDevice();
+            if (device != nullptr && device->isPlaying() && getActiveMidiOutput() != nullptr)
+            {
+                midiClockStopping.store (true);
+                midiClockScheduler.requestStop (true);
+                return;
+            }
+
+            // with no callback running, nothing would ever schedule it
+            midiClockScheduler.requestStop (false);
+            sendMidiStop();
+            logMidiClockStats();
         }
+
+        if (midiClockStopping.load())
+            return;
+
         stopTimer();
         closeMidiOutputDevice();
         return;
@@ -441,25 +590,40 @@ void AudioEngine::updateMidiClockState()
     if (getActiveMidiOutput() == nullptr)
         return;
 
-    const double bpm = juce::jlimit (kMinMidiBpm, kMaxMidiBpm, midiSyncBpm);
-    const double ticksPerSecond = (bpm / 60.0) * 24.0;
-    const int intervalUs = ticksPerSecond > 0.0
-                               ? static_cast<int> (std::round (1.0e6 / ticksPerSecond))
-                               : 0;
-
-    if (intervalUs > 0)
-        startTimer (intervalUs);
+    midiClockScheduler.setBpm (juce::jlimit (kMinMidiBpm, kMaxMidiBpm, midiSyncBpm));
 
     if (! midiClockRunning)
     {
-        sendMidiStart();
+        // a restart drops a Stop still waiting to go out
+        if (midiClockStopping.exchange (false))
+            logMidiClockStats();
+
+        midiClockScheduler.resetJitterStats();
+        midiClockScheduler.requestStart();
+        startTimer (kMidiClockDispatchIntervalMs);
         midiClockRunning = true;
     }
 }
 
+void AudioEngine::logMidiClockStats()
+{
+    const auto stats = midiClockScheduler.getJitterStats();
+    juce::Logger::writeToLog ("MIDI clock: " + juce::String (stats.ticksSent)
+                              + " ticks, mean error " + juce::String (stats.meanAbsErrorMs, 3)
+                              + " ms, max " + juce::String (stats.maxAbsErrorMs, 3)
+                              + " ms, interval jitter " + juce::String (stats.intervalStdDevMs, 3)
+                              + " ms, grid jitter " + juce::String (stats.gridStdDevMs, 3)
+                              + " ms (max " + juce::String (stats.gridMaxErrorMs, 3) + " ms)");
+
+    if (stats.ticksSent > 0 && ! stats.isGridWithinTolerance())
+        juce::Logger::writeToLog ("MIDI clock: tick grid strayed beyond "
+                                  + juce::String (MidiClockScheduler::kGridToleranceMs, 3)
+                                  + " ms; the device clock is not tracking its callbacks");
+}
+
 void AudioEngine::updateMidiInputState()
 {
-    const bool shouldReceive = midiSyncMode == MidiSyncMode::receive
+    const bool shouldReceive = (midiSyncMode == MidiSyncMode::receive || padModeEnabled.load())
                                && ! midiSyncInputDeviceIdentifier.isEmpty();
     const bool virtualInputSelected =
         midiSyncInputDeviceIdentifier == kVirtualInIdentifier;
@@ -467,6 +631,7 @@ void AudioEngine::updateMidiInputState()
     if (! shouldReceive || (virtualInputSelected && ! midiVirtualPortsEnabled))
     {
         closeMidiInputDevice();
+        midiClockFollower.reset();
         return;
     }
 
@@ -482,6 +647,7 @@ void AudioEngine::openMidiInputDevice()
     }
 
     closeMidiInputDevice();
+    midiClockFollower.reset();
     activeMidiInputIdentifier = midiSyncInputDeviceIdentifier;
 
     if (activeMidiInputIdentifier.isEmpty())
@@ -550,12 +716,7 @@ juce::MidiOutput* AudioEngine::getActiveMidiOutput() const
     return midiOutput.get();
 }
 
-void AudioEngine::sendMidiStart()
-{
-    if (auto* output = getActiveMidiOutput())
-        output->sendMessageNow (juce::MidiMessage::midiStart());
-}
-
+// only for when no audio callback is left to schedule the Stop
 void AudioEngine::sendMidiStop()
 {
     if (auto* output = getActiveMidiOutput())
@@ -573,7 +734,7 @@ void AudioEngine::applyExternalTransportStart()
     bool shouldUseLatchGroup = false;
     bool anyRecordArmEnabled = false;
 
-    for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+    for (int index = 0; index < getNumRecorders(); ++index)
     {
         if (! recorderMidiInEnabled[index])
             continue;
@@ -593,7 +754,7 @@ void AudioEngine::applyExternalTransportStart()
             return;
         }
 
-        for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+        for (int index = 0; index < getNumRecorders(); ++index)
         {
             if (! recorderMidiInEnabled[index])
                 continue;
@@ -610,7 +771,7 @@ void AudioEngine::applyExternalTransportStart()
         return;
     }
 
-    for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+    for (int index = 0; index < getNumRecorders(); ++index)
     {
         if (! recorderMidiInEnabled[index])
             continue;
@@ -631,7 +792,7 @@ void AudioEngine::applyExternalTransportStop()
     bool anyRecording = false;
     bool anyPlaying = false;
 
-    for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+    for (int index = 0; index < getNumRecorders(); ++index)
     {
         if (! recorderMidiInEnabled[index])
             continue;
@@ -654,7 +815,7 @@ void AudioEngine::applyExternalTransportStop()
             return;
         }
 
-        for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+        for (int index = 0; index < getNumRecorders(); ++index)
         {
             if (! recorderMidiInEnabled[index])
                 continue;
@@ -673,7 +834,7 @@ void AudioEngine::applyExternalTransportStop()
         return;
     }
 
-    for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+    for (int index = 0; index < getNumRecorders(); ++index)
     {
         if (! recorderMidiInEnabled[index])
             continue;
@@ -701,10 +862,11 @@ void AudioEngine::armRecorder (int index)
     recordingBus.armRecorder (index);
 }
 
-RecordingModule::StopResult
-AudioEngine::confirmStopRecorder (int index)
+// a latched stop gives its room back once handleAsyncUpdate finalises it
+void AudioEngine::confirmStopRecorder (int index, RecordingBus::StopHandler onStopped)
 {
-    return recordingBus.confirmStopRecorder (index);
+    recordingBus.confirmStopRecorder (index, std::move (onStopped));
+    recordingBus.releaseIdleTakes (deviceManager.getAudioCallbackLock());
 }
 
 void AudioEngine::cancelStopRecorder (int index)
@@ -714,7 +876,12 @@ void AudioEngine::cancelStopRecorder (int index)
 
 void AudioEngine::clearRecorder (int index)
 {
+    // a capture still writing into the take finishes first
+    if (index < 0 || index >= getNumRecorders() || recordingBus.isCaptureCommitInProgress (index))
+        return;
+
     recordingBus.clearRecorder (index);
+    recordingBus.releaseIdleTakes (deviceManager.getAudioCallbackLock());
     const auto file = RecordingModule::getRecorderFile (index);
     if (file.existsAsFile())
         file.deleteFile();
@@ -739,6 +906,9 @@ void AudioEngine::clearRecorder (int index)
     recordingBus.setRecorderLatchEnabled (index, false);
     recordingBus.setRecorderRecordArmEnabled (index, true);
     recordingBus.setRecorderInputGainDb (index, 0.0f);
+    recordingBus.setRecorderNumChannels (index, 1, deviceManager.getAudioCallbackLock());
+    recordingBus.setRecorderCaptureEnabled (index, false, deviceManager.getAudioCallbackLock());
+    updateRecorderRouting (deviceManager.getCurrentAudioDevice());
 
     saveState();
 }
@@ -756,28 +926,85 @@ void AudioEngine::stopPlayback (int index)
 void AudioEngine::setRecorderMonitoringEnabled (int index, bool enabled)
 {
     recordingBus.setRecorderMonitoringEnabled (index, enabled);
-    if (index >= 0 && index < RecordingBus::kNumRecorders)
+    if (index >= 0 && index < getNumRecorders())
         recorderMonitoringEnabled[index] = enabled;
 }
 
 void AudioEngine::setRecorderInputChannel (int index, int physicalChannel)
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return;
 
     recorderPhysicalChannels[index] = physicalChannel;
+    updateRecorderRouting (deviceManager.getCurrentAudioDevice());
+}
+
+// Maps each recorder's physical input to its index in the callback's packed
+// input array. Only changes with the device or a recorder's input selection.
+void AudioEngine::updateRecorderRouting (juce::AudioIODevice* device)
+{
+    const auto activeMask = device != nullptr ? device->getActiveInputChannels() : juce::BigInteger();
+
+    // active channels are packed, so the index is the count of active ones below
+    const auto bufferIndexFor = [&activeMask] (int phys)
+    {
+        if (phys < 0 || ! activeMask[phys])
+            return -1;
+
+        int buf = 0;
+        for (int i = 0; i < phys; ++i)
+            if (activeMask[i])
+                ++buf;
+
+        return buf;
+    };
+
+    for (int r = 0; r < getNumRecorders(); ++r)
+    {
+        // a multichannel recorder takes consecutive physical inputs
+        const int phys = recorderPhysicalChannels[r];
+        juce::Array<int> bufferIndices;
+        for (int ch = 0; ch < recordingBus.getRecorderNumChannels (r); ++ch)
+            bufferIndices.add (phys >= 0 ? bufferIndexFor (phys + ch) : -1);
+
+        recordingBus.setRecorderInputBufferIndices (r, bufferIndices);
+    }
+}
+
+bool AudioEngine::setRecorderChannelCount (int index, int numChannels)
+{
+    if (index < 0 || index >= getNumRecorders())
+        return false;
+
+    if (numChannels == recordingBus.getRecorderNumChannels (index))
+        return true;
+
+    // an existing take keeps the layout it was recorded with
+    if (recordingBus.getRecorderTotalSamples (index) > 0)
+        return false;
+
+    if (! recordingBus.setRecorderNumChannels (index, numChannels, deviceManager.getAudioCallbackLock()))
+        return false;
+
+    updateRecorderRouting (deviceManager.getCurrentAudioDevice());
+    return true;
+}
+
+int AudioEngine::getRecorderChannelCount (int index) const
+{
+    return recordingBus.getRecorderNumChannels (index);
 }
 
 void AudioEngine::setRecorderLatchEnabled (int index, bool enabled)
 {
     recordingBus.setRecorderLatchEnabled (index, enabled);
-    if (index >= 0 && index < RecordingBus::kNumRecorders)
+    if (index >= 0 && index < getNumRecorders())
         recorderLatchEnabled[index] = enabled;
 }
 
 void AudioEngine::setRecorderIncludeInGenerationEnabled (int index, bool enabled)
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return;
 
     recorderIncludeInGeneration[index] = enabled;
@@ -785,7 +1012,7 @@ void AudioEngine::setRecorderIncludeInGenerationEnabled (int index, bool enabled
 
 void AudioEngine::setRecorderRecordArmEnabled (int index, bool enabled)
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return;
 
     recorderRecordArmEnabled[index] = enabled;
@@ -794,7 +1021,7 @@ void AudioEngine::setRecorderRecordArmEnabled (int index, bool enabled)
 
 void AudioEngine::setRecorderLocked (int index, bool locked)
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return;
 
     recorderLocked[index] = locked;
@@ -802,7 +1029,7 @@ void AudioEngine::setRecorderLocked (int index, bool locked)
 
 void AudioEngine::setRecorderInputGainDb (int index, float gainDb)
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return;
 
     const float clamped = juce::jlimit (kRecorderMinGainDb,
@@ -812,6 +1039,93 @@ void AudioEngine::setRecorderInputGainDb (int index, float gainDb)
     recordingBus.setRecorderInputGainDb (index, clamped);
 }
 
+void AudioEngine::setRecordQuantize (RecordQuantize quantize)
+{
+    recordQuantize.store (quantize);
+}
+
+AudioEngine::RecordQuantize AudioEngine::getRecordQuantize() const
+{
+    return recordQuantize.load();
+}
+
+juce::int64 AudioEngine::getQuantizedLatchSample (double blockStartMs) const
+{
+    const auto blockStart = recordingBus.getSamplePosition();
+    const auto quantize = recordQuantize.load();
+    if (quantize == RecordQuantize::off || deviceSampleRate <= 0.0)
+        return blockStart;
+
+    double beatPosition = 0.0;
+    double samplesPerBeat = 0.0;
+
+    const auto external = midiClockFollower.getEstimate (blockStartMs);
+    if (external.locked && external.transportRunning && external.bpm > 0.0)
+    {
+        // the first input sample of this block was captured this long ago
+        const double captureOffsetMs =
+            (deviceInputLatencySamples + deviceBufferSize) * 1000.0 / deviceSampleRate;
+        beatPosition = external.getBeatPositionAt (blockStartMs - captureOffsetMs);
+        samplesPerBeat = deviceSampleRate * 60.0 / external.bpm;
+    }
+    else if (! midiClockScheduler.getGridAtBlockStart (beatPosition, samplesPerBeat))
+    {
+        return blockStart;
+    }
+
+    const double beatsPerStep = quantize == RecordQuantize::bar ? kBeatsPerBar : 1.0;
+    const double previousBoundary = std::floor (beatPosition / beatsPerStep) * beatsPerStep;
+
+    // a boundary that passed moments ago (e.g. MIDI start arriving via the
+    // message thread) is closer than the next one
+    if (beatPosition - previousBoundary < kLateLatchToleranceBeats)
+        return blockStart;
+
+    const double beatsToBoundary = previousBoundary + beatsPerStep - beatPosition;
+    return blockStart + static_cast<juce::int64> (std::llround (beatsToBoundary * samplesPerBeat));
+}
+
+void AudioEngine::setPadModeEnabled (bool enabled)
+{
+    padModeEnabled.store (enabled);
+    updateMidiInputState();
+}
+
+bool AudioEngine::isPadModeEnabled() const
+{
+    return padModeEnabled.load();
+}
+
+void AudioEngine::setPadChokeMode (PadChokeMode mode)
+{
+    padChokeMode = mode;
+    applyPadChokeGroups();
+}
+
+AudioEngine::PadChokeMode AudioEngine::getPadChokeMode() const
+{
+    return padChokeMode;
+}
+
+SliceVoicePool::LatencyStats AudioEngine::getPadLatencyStats() const
+{
+    return sliceVoicePool.getPadLatencyStats();
+}
+
+void AudioEngine::applyPadChokeGroups()
+{
+    for (int pad = 0; pad < SliceVoicePool::kNumPads; ++pad)
+    {
+        int group = -1;
+        if (padChokeMode == PadChokeMode::perPad)
+            group = pad;
+        else if (padChokeMode == PadChokeMode::allPads)
+            group = 0;
+
+        sliceVoicePool.setPadChokeGroup (pad, group);
+    }
+}
+
 bool AudioEngine::hasLatchedRecorders() const
 {
     return recordingBus.hasLatchedRecorders();
@@ -822,9 +1136,9 @@ void AudioEngine::armLatchedRecorders()
     recordingBus.armLatchedRecorders();
 }
 
-RecordingModule::StopResult AudioEngine::stopLatchedRecorders()
+void AudioEngine::stopLatchedRecorders (RecordingBus::StopHandler onStopped)
 {
-    return recordingBus.stopLatchedRecorders();
+    recordingBus.stopLatchedRecorders (std::move (onStopped));
 }
 
 bool AudioEngine::startLatchedPlayback()
@@ -839,7 +1153,7 @@ void AudioEngine::stopLatchedPlayback()
 
 int AudioEngine::getRecorderInputChannel (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return -1;
 
     return recorderPhysicalChannels[index];
@@ -847,7 +1161,7 @@ int AudioEngine::getRecorderInputChannel (int index) const
 
 bool AudioEngine::isRecorderMonitoringEnabled (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return false;
 
     return recorderMonitoringEnabled[index];
@@ -855,7 +1169,7 @@ bool AudioEngine::isRecorderMonitoringEnabled (int index) const
 
 bool AudioEngine::isRecorderLatchEnabled (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return false;
 
     return recorderLatchEnabled[index];
@@ -863,7 +1177,7 @@ bool AudioEngine::isRecorderLatchEnabled (int index) const
 
 bool AudioEngine::isRecorderIncludeInGenerationEnabled (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return false;
 
     return recorderIncludeInGeneration[index];
@@ -871,7 +1185,7 @@ bool AudioEngine::isRecorderIncludeInGenerationEnabled (int index) const
 
 bool AudioEngine::isRecorderRecordArmEnabled (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return false;
 
     return recorderRecordArmEnabled[index];
@@ -879,7 +1193,7 @@ bool AudioEngine::isRecorderRecordArmEnabled (int index) const
 
 bool AudioEngine::isRecorderLocked (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return false;
 
     return recorderLocked[index];
@@ -897,20 +1211,25 @@ bool AudioEngine::isRecorderPlaying (int index) const
 
 float AudioEngine::getRecorderInputGainDb (int index) const
 {
-    if (index < 0 || index >= RecordingBus::kNumRecorders)
+    if (index < 0 || index >= getNumRecorders())
         return 0.0f;
 
     return recorderInputGainDb[index];
 }
 
-float AudioEngine::getRecorderRms (int index) const
+LevelMeter::Reading AudioEngine::getRecorderMeterReading (int index) const
+{
+    return recordingBus.getRecorderMeterReading (index);
+}
+
+int AudioEngine::popRecorderWaveformPeaks (int index, PeakFifo::Peak* dest, int maxPeaks)
 {
-    return recordingBus.getRecorderRms (index);
+    return recordingBus.popRecorderWaveformPeaks (index, dest, maxPeaks);
 }
 
-float AudioEngine::getRecorderPeak (int index) const
+std::shared_ptr<const LiveTakeAnalyzer::TakeAnalysis> AudioEngine::getRecorderTakeAnalysis (int index) const
 {
-    return recordingBus.getRecorderPeak (index);
+    return recordingBus.getRecorderTakeAnalysis (index);
 }
 
 double AudioEngine::getRecorderPlaybackProgress (int index) const
@@ -938,6 +1257,16 @@ int AudioEngine::getRecorderMaxSamples (int index) const
     return recordingBus.getRecorderMaxSamples (index);
 }
 
+void AudioEngine::setMaxTakeSeconds (double seconds)
+{
+    recordingBus.setMaxTakeSeconds (seconds);
+}
+
+double AudioEngine::getMaxTakeSeconds() const
+{
+    return recordingBus.getMaxTakeSeconds();
+}
+
 // =====================================================
 // TIMING
 // =====================================================
@@ -948,19 +1277,43 @@ double AudioEngine::getRecorderCurrentPassSeconds (int index) const
 }
 
 // =====================================================
-// METERS
+// RETROSPECTIVE CAPTURE
 // =====================================================
 
-float AudioEngine::getInputRMS() const
+bool AudioEngine::setRecorderCaptureEnabled (int index, bool enabled)
+{
+    return recordingBus.setRecorderCaptureEnabled (index, enabled, deviceManager.getAudioCallbackLock());
+}
+
+bool AudioEngine::isRecorderCaptureEnabled (int index) const
+{
+    return recordingBus.isRecorderCaptureEnabled (index);
+}
+
+// The copy out of the ring and the WAV write both run on the commit thread;
+// the recorder cannot be armed or cleared until the job releases it.
+bool AudioEngine::captureRecorderHistory (int index, double seconds)
 {
-    return inputRMS.load();
+    if (! recordingBus.beginCaptureCommit (index, seconds))
+        return false;
+
+    captureCommitPool.addJob ([this, index]
+    {
+        if (! recordingBus.commitCapturedHistory (index))
+            juce::Logger::writeToLog ("Capture: recorder " + juce::String (index + 1) + " kept nothing");
+    });
+    return true;
 }
 
-float AudioEngine::getInputPeak() const
+bool AudioEngine::isRecorderCaptureCommitting (int index) const
 {
-    return inputPeak.load();
+    return recordingBus.isCaptureCommitInProgress (index);
 }
 
+// =====================================================
+// UI SOUNDS
+// =====================================================
+
 void AudioEngine::playUiSound (UiSound sound)
 {
     currentSound.store (sound);
@@ -974,6 +1327,71 @@ void AudioEngine::playUiSound (UiSound sound)
     soundPosition.store (0);
 }
 
+SliceVoicePool& AudioEngine::getSliceVoicePool()
+{
+    return sliceVoicePool;
+}
+
+CallbackProfiler::Snapshot AudioEngine::getCallbackDiagnostics() const
+{
+    auto snapshot = callbackProfiler.getSnapshot();
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        snapshot.deviceXRuns = device->getXRunCount();
+
+    return snapshot;
+}
+
+void AudioEngine::resetCallbackDiagnostics()
+{
+    callbackProfiler.reset();
+}
+
+void AudioEngine::setBufferAutoTuneEnabled (bool enabled)
+{
+    bufferAutoTuneEnabled = enabled;
+
+    if (enabled)
+        bufferSizeTuner.start();
+    else
+        bufferSizeTuner.cancel();
+}
+
+bool AudioEngine::isBufferAutoTuneEnabled() const
+{
+    return bufferAutoTuneEnabled;
+}
+
+bool AudioEngine::isBufferAutoTuneRunning() const
+{
+    return bufferSizeTuner.isRunning();
+}
+
+juce::String AudioEngine::getBufferAutoTuneStatus() const
+{
+    return bufferSizeTuner.getStatusText();
+}
+
+void AudioEngine::applyTunedBufferSize()
+{
+    if (! bufferAutoTuneEnabled || tunedBufferSize <= 0)
+        return;
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || device->getName() != tunedBufferDevice)
+        return;
+
+    if (device->getCurrentBufferSizeSamples() == tunedBufferSize
+        || ! device->getAvailableBufferSizes().contains (tunedBufferSize))
+        return;
+
+    juce::AudioDeviceManager::AudioDeviceSetup setup;
+    deviceManager.getAudioDeviceSetup (setup);
+    setup.bufferSize = tunedBufferSize;
+    const auto error = deviceManager.setAudioDeviceSetup (setup, true);
+    if (error.isNotEmpty())
+        juce::Logger::writeToLog ("Tuned buffer size not applied: " + error);
+}
+
 // =====================================================
 // JUCE CALLBACKS
 // =====================================================
@@ -982,6 +1400,20 @@ void AudioEngine::audioDeviceAboutToStart (juce::AudioIODevice* device)
 {
     recordingBus.prepare (device->getCurrentSampleRate(),
                           device->getCurrentBufferSizeSamples());
+    sliceVoicePool.prepare (device->getCurrentSampleRate(),
+                            device->getCurrentBufferSizeSamples(),
+                            device->getOutputLatencyInSamples()
+                                + device->getCurrentBufferSizeSamples());
+    voiceScratch.setSize (kVoiceBusChannels, device->getCurrentBufferSizeSamples(), false, false, true);
+    deviceSampleRate = device->getCurrentSampleRate();
+    AudioFileIO::setProcessingSampleRate (deviceSampleRate);
+    deviceBufferSize = device->getCurrentBufferSizeSamples();
+    deviceInputLatencySamples = device->getInputLatencyInSamples();
+    callbackProfiler.prepare (deviceSampleRate, deviceBufferSize);
+    blockClock.prepare (device->getCurrentSampleRate());
+    midiClockScheduler.prepare (device->getCurrentSampleRate(),
+                                device->getOutputLatencyInSamples()
+                                    + device->getCurrentBufferSizeSamples());
 
     if (soundFormatManager.getNumKnownFormats() == 0)
         soundFormatManager.registerBasicFormats();
@@ -1015,15 +1447,26 @@ void AudioEngine::audioDeviceAboutToStart (juce::AudioIODevice* device)
 
     if (firstActive >= 0)
     {
-        for (int r = 0; r < RecordingBus::kNumRecorders; ++r)
+        for (int r = 0; r < getNumRecorders(); ++r)
         {
             if (recorderPhysicalChannels[r] < 0)
                 recorderPhysicalChannels[r] = firstActive;
         }
     }
+
+    updateRecorderRouting (device);
 }
 
-void AudioEngine::audioDeviceStopped() {}
+void AudioEngine::audioDeviceStopped()
+{
+    if (midiClockStopping.load())
+        triggerAsyncUpdate();
+
+    // keeps a record of each device session in the app log
+    const auto diagnostics = getCallbackDiagnostics();
+    if (diagnostics.callbacks > 0)
+        juce::Logger::writeToLog (CallbackProfiler::createReport (diagnostics));
+}
 
 // =====================================================
 // AUDIO CALLBACK
@@ -1035,54 +1478,71 @@ void AudioEngine::audioDeviceIOCallbackWithContext (
     float* const* output,
     int numOutputChannels,
     int numSamples,
-    const juce::AudioIODeviceCallbackContext&)
+    const juce::AudioIODeviceCallbackContext& context)
 {
+    // everything timed from the block follows the device clock, not the
+    // moment this callback happened to be scheduled
+    const double blockStartMs = blockClock.advance (numSamples,
+                                                    juce::Time::getMillisecondCounterHiRes(),
+                                                    context.hostTimeNs);
+
     auto* device = deviceManager.getCurrentAudioDevice();
     if (! device)
         return;
 
-    // -------------------------------------------------
-    // PHYSICAL → BUFFER MAP
-    // -------------------------------------------------
+    callbackProfiler.beginBlock (numSamples);
 
-    const auto activeMask = device->getActiveInputChannels();
+    // physical → buffer routing is published by updateRecorderRouting();
+    // this stage applies it through the matrix
+    recordingBus.routeInputs (input, numInputChannels, output, numOutputChannels, numSamples);
+    callbackProfiler.markStage (CallbackProfiler::Stage::routing);
 
-    int physicalToBuffer[64];
-    int bufferIndex = 0;
-
-    const int highest =
-        juce::jmin (64, activeMask.getHighestBit() + 1);
-
-    for (int phys = 0; phys < highest; ++phys)
-    {
-        if (activeMask[phys])
-            physicalToBuffer[phys] = bufferIndex++;
-        else
-            physicalToBuffer[phys] = -1;
-    }
-
-    for (int r = 0; r < RecordingBus::kNumRecorders; ++r)
-    {
-        const int phys = recorderPhysicalChannels[r];
-        int buf = -1;
-
-        if (phys >= 0 && phys < highest)
-            buf = physicalToBuffer[phys];
-
-        recordingBus.setRecorderInputBufferIndex (r, buf);
-    }
+    recordingBus.processMeters (numSamples);
+    callbackProfiler.markStage (CallbackProfiler::Stage::metering);
 
     // -------------------------------------------------
     // PROCESS
     // -------------------------------------------------
 
+    if (recordingBus.hasLatchRequests())
+        recordingBus.scheduleLatchRequests (getQuantizedLatchSample (blockStartMs));
+
     recordingBus.processAudioBlock (
-        input,
-        numInputChannels,
         output,
         numOutputChannels,
         numSamples);
 
+    if (recordingBus.takeCompletedLatchedStop())
+    {
+        latchedStopFinalisePending.store (true);
+        triggerAsyncUpdate();
+    }
+
+    callbackProfiler.markStage (CallbackProfiler::Stage::recording);
+
+    midiClockScheduler.processBlock (numSamples, blockStartMs);
+    callbackProfiler.markStage (CallbackProfiler::Stage::midiClock);
+
+    // a block longer than the device reported at start renders through
+    // the scratch in pieces, each timed from its own first sample
+    const int scratchSamples = voiceScratch.getNumSamples();
+    const int numVoiceOutputs = juce::jmin (numOutputChannels, RoutingMatrix::kMaxOutputs);
+    for (int offset = 0; scratchSamples > 0 && offset < numSamples; offset += scratchSamples)
+    {
+        const int count = juce::jmin (scratchSamples, numSamples - offset);
+        float* voiceOutput[RoutingMatrix::kMaxOutputs];
+        for (int ch = 0; ch < numVoiceOutputs; ++ch)
+            voiceOutput[ch] = output[ch] + offset;
+
+        voiceScratch.clear (0, count);
+        sliceVoicePool.render (voiceScratch.getArrayOfWritePointers(), kVoiceBusChannels, count,
+                               blockStartMs + offset * 1000.0 / deviceSampleRate,
+                               blockClock.getPresentationDelayMs());
+        recordingBus.mixSliceVoices (voiceScratch.getArrayOfReadPointers(), kVoiceBusChannels,
+                                     voiceOutput, numVoiceOutputs, count);
+    }
+    callbackProfiler.markStage (CallbackProfiler::Stage::voices);
+
     const int currentPos = soundPosition.load();
     const int length = soundLength.load();
     if (length > 0 && currentPos < length)
@@ -1106,27 +1566,6 @@ void AudioEngine::audioDeviceIOCallbackWithContext (
         soundPosition.store (currentPos + toCopy);
     }
 
-    // -------------------------------------------------
-    // METERS
-    // -------------------------------------------------
-
-    float rms  = 0.0f;
-    float peak = 0.0f;
-
-    for (int ch = 0; ch < numInputChannels; ++ch)
-    {
-        const float* src = input[ch];
-        for (int i = 0; i < numSamples; ++i)
-        {
-            const float v = std::abs (src[i]);
-            peak = juce::jmax (peak, v);
-            rms += v * v;
-        }
-    }
-
-    if (numInputChannels > 0 && numSamples > 0)
-        rms = std::sqrt (rms / (numSamples * numInputChannels));
-
-    inputRMS.store (rms);
-    inputPeak.store (peak);
+    callbackProfiler.markStage (CallbackProfiler::Stage::uiSound);
+    callbackProfiler.endBlock();
 }
@@ -3,8 +3,16 @@
 #include <JuceHeader.h>
 #include <atomic>
 #include <array>
+#include <vector>
 #include "RecordingBus.h"
 #include "RecordingModule.h"
+#include "BlockClock.h"
+#include "MidiClockScheduler.h"
+#include "MidiClockFollower.h"
+#include "SliceVoicePool.h"
+#include "CallbackProfiler.h"
+#include "BufferSizeTuner.h"
+#include "LevelMeter.h"
 
 class AudioEngine final : public juce::AudioIODeviceCallback,
                           private juce::HighResolutionTimer,
@@ -28,6 +36,20 @@ public:
         send = 2
     };
 
+    enum class RecordQuantize
+    {
+        off = 0,
+        beat = 1,
+        bar = 2
+    };
+
+    enum class PadChokeMode
+    {
+        none = 0,
+        perPad = 1,
+        allPads = 2
+    };
+
     struct ActiveInputChannel
     {
         juce::String name;
@@ -47,6 +69,11 @@ public:
     // device
     juce::AudioDeviceManager& getDeviceManager();
 
+    // recorder bank; a new count is persisted and applies on next launch
+    int getNumRecorders() const;
+    void setConfiguredRecorderCount (int count);
+    int getConfiguredRecorderCount() const;
+
     // input channels (UI)
     juce::StringArray getInputChannelNames() const;
     juce::Array<ActiveInputChannel> getActiveInputChannels() const;
@@ -62,6 +89,8 @@ public:
     bool getMidiVirtualPortsEnabled() const;
     void setMidiSyncBpm (double bpm);
     double getMidiSyncBpm() const;
+    MidiClockScheduler::JitterStats getMidiClockJitterStats() const;
+    MidiClockFollower::Estimate getExternalClockEstimate() const;
 
     void setRecorderMidiInEnabled (int index, bool enabled);
     void setRecorderMidiOutEnabled (int index, bool enabled);
@@ -71,7 +100,7 @@ public:
 
     // recorder control
     void armRecorder (int index);
-    RecordingModule::StopResult confirmStopRecorder (int index);
+    void confirmStopRecorder (int index, RecordingBus::StopHandler onStopped = {});
     void cancelStopRecorder (int index);
     void clearRecorder (int index);
     bool startPlayback (int index);
@@ -79,18 +108,33 @@ public:
 
     void setRecorderMonitoringEnabled (int index, bool enabled);
     void setRecorderInputChannel (int index, int physicalChannel);
+    // a recorder with N channels takes N consecutive physical inputs; only
+    // changes while the recorder holds no take
+    bool setRecorderChannelCount (int index, int numChannels);
+    int getRecorderChannelCount (int index) const;
     void setRecorderLatchEnabled (int index, bool enabled);
     void setRecorderIncludeInGenerationEnabled (int index, bool enabled);
     void setRecorderRecordArmEnabled (int index, bool enabled);
     void setRecorderLocked (int index, bool locked);
     void setRecorderInputGainDb (int index, float gainDb);
 
+    // latched record start/stop snap to this grid of the active tempo source
+    void setRecordQuantize (RecordQuantize quantize);
+    RecordQuantize getRecordQuantize() const;
+
     bool hasLatchedRecorders() const;
     void armLatchedRecorders();
-    RecordingModule::StopResult stopLatchedRecorders();
+    void stopLatchedRecorders (RecordingBus::StopHandler onStopped = {});
     bool startLatchedPlayback();
     void stopLatchedPlayback();
 
+    // MIDI notes from the sync input play the 16 slices as pads
+    void setPadModeEnabled (bool enabled);
+    bool isPadModeEnabled() const;
+    void setPadChokeMode (PadChokeMode mode);
+    PadChokeMode getPadChokeMode() const;
+    SliceVoicePool::LatencyStats getPadLatencyStats() const;
+
     int getRecorderInputChannel (int index) const;
     bool isRecorderMonitoringEnabled (int index) const;
     bool isRecorderLatchEnabled (int index) const;
@@ -100,24 +144,47 @@ public:
     bool isRecorderArmed (int index) const;
     bool isRecorderPlaying (int index) const;
     float getRecorderInputGainDb (int index) const;
-    float getRecorderRms (int index) const;
-    float getRecorderPeak (int index) const;
+    LevelMeter::Reading getRecorderMeterReading (int index) const;
+    int popRecorderWaveformPeaks (int index, PeakFifo::Peak* dest, int maxPeaks);
+    std::shared_ptr<const LiveTakeAnalyzer::TakeAnalysis> getRecorderTakeAnalysis (int index) const;
     double getRecorderPlaybackProgress (int index) const;
     void seekRecorderPlayback (int index, double progress);
     double getRecorderRecordStartMs (int index) const;
     int getRecorderTotalSamples (int index) const;
     int getRecorderMaxSamples (int index) const;
 
+    // the longest pass a recorder records; a take's room grows with the
+    // pass, so a longer limit costs nothing until it is recorded
+    void setMaxTakeSeconds (double seconds);
+    double getMaxTakeSeconds() const;
+
     // timing
     double getRecorderCurrentPassSeconds (int index) const;
 
-    // meters
-    float getInputRMS() const;
-    float getInputPeak() const;
+    // retrospective capture: an enabled recorder keeps the last
+    // RecordingBus::kCaptureRingSeconds of its input even while disarmed, and
+    // captureRecorderHistory appends part of it to the take in the background
+    bool setRecorderCaptureEnabled (int index, bool enabled);
+    bool isRecorderCaptureEnabled (int index) const;
+    bool captureRecorderHistory (int index, double seconds);
+    bool isRecorderCaptureCommitting (int index) const;
 
     // ui sounds
     void playUiSound (UiSound sound);
 
+    // slice audition voices, mixed in the device callback
+    SliceVoicePool& getSliceVoicePool();
+
+    // device callback timing against the block deadline
+    CallbackProfiler::Snapshot getCallbackDiagnostics() const;
+    void resetCallbackDiagnostics();
+
+    // buffer size auto-tune: probes smaller sizes until callbacks glitch
+    void setBufferAutoTuneEnabled (bool enabled);
+    bool isBufferAutoTuneEnabled() const;
+    bool isBufferAutoTuneRunning() const;
+    juce::String getBufferAutoTuneStatus() const;
+
     // JUCE callbacks
     void audioDeviceAboutToStart (juce::AudioIODevice*) override;
     void audioDeviceStopped() override;
@@ -136,60 +203,38 @@ private:
                                     const juce::MidiMessage& message) override;
     void handleAsyncUpdate() override;
     void updateMidiClockState();
+    void logMidiClockStats();
     void updateMidiInputState();
+    void applyPadChokeGroups();
+    void applyTunedBufferSize();
+    void updateRecorderRouting (juce::AudioIODevice* device);
     void openMidiInputDevice();
     void closeMidiInputDevice();
     void openMidiOutputDevice();
     void closeMidiOutputDevice();
     juce::MidiOutput* getActiveMidiOutput() const;
-    void sendMidiStart();
     void sendMidiStop();
     void applyExternalTransportStart();
     void applyExternalTransportStop();
     bool hasAnyRecorderMidiInEnabled() const;
-    void enforceSampleRate (double targetSampleRate);
+    juce::int64 getQuantizedLatchSample (double blockStartMs) const;
 
     juce::AudioDeviceManager deviceManager;
     RecordingBus recordingBus;
+    juce::ThreadPool captureCommitPool { 1 }; // after recordingBus: joined before it is destroyed
 
+    // per-recorder settings, sized once from the recorder count
     // PHYSICAL channel per recorder (stable)
-    std::array<int, RecordingBus::kNumRecorders> recorderPhysicalChannels
-    {
-        -1, -1, -1, -1
-    };
-    std::array<bool, RecordingBus::kNumRecorders> recorderMonitoringEnabled
-    {
-        false, false, false, false
-    };
-    std::array<bool, RecordingBus::kNumRecorders> recorderLatchEnabled
-    {
-        false, false, false, false
-    };
-    std::array<bool, RecordingBus::kNumRecorders> recorderIncludeInGeneration
-    {
-        true, true, true, true
-    };
-    std::array<bool, RecordingBus::kNumRecorders> recorderMidiInEnabled
-    {
-        false, false, false, false
-    };
-    std::array<bool, RecordingBus::kNumRecorders> recorderMidiOutEnabled
-    {
-        false, false, false, false
-    };
+    std::vector<int> recorderPhysicalChannels;
+    std::vector<bool> recorderMonitoringEnabled;
+    std::vector<bool> recorderLatchEnabled;
+    std::vector<bool> recorderIncludeInGeneration;
+    std::vector<bool> recorderMidiInEnabled;
+    std::vector<bool> recorderMidiOutEnabled;
     int transportMasterRecorderIndex = -1;
-    std::array<bool, RecordingBus::kNumRecorders> recorderRecordArmEnabled
-    {
-        true, true, true, true
-    };
-    std::array<bool, RecordingBus::kNumRecorders> recorderLocked
-    {
-        false, false, false, false
-    };
-    std::array<float, RecordingBus::kNumRecorders> recorderInputGainDb
-    {
-        0.0f, 0.0f, 0.0f, 0.0f
-    };
+    std::vector<bool> recorderRecordArmEnabled;
+    std::vector<bool> recorderLocked;
+    std::vector<float> recorderInputGainDb;
 
     MidiSyncMode midiSyncMode = MidiSyncMode::off;
     juce::String midiSyncInputDeviceIdentifier;
@@ -201,8 +246,12 @@ private:
 #endif
     double midiSyncBpm = 120.0;
     bool midiClockRunning = false;
+    std::atomic<bool> midiClockStopping { false }; // a Stop is queued; the output stays open until it is sent
+    BlockClock blockClock;
+    MidiClockScheduler midiClockScheduler;
     std::atomic<bool> externalTransportPlaying { false };
     std::atomic<double> lastExternalClockMs { 0.0 };
+    MidiClockFollower midiClockFollower;
     std::atomic<int> pendingExternalTransportCommand { 0 };
     juce::String activeMidiInputIdentifier;
     std::unique_ptr<juce::MidiInput> midiInput;
@@ -210,6 +259,17 @@ private:
     std::unique_ptr<juce::MidiOutput> midiOutput;
     std::unique_ptr<juce::MidiOutput> midiVirtualOutput;
 
+    SliceVoicePool sliceVoicePool;
+    juce::AudioBuffer<float> voiceScratch; // the pool renders here, the routing matrix mixes it out
+    CallbackProfiler callbackProfiler;
+    BufferSizeTuner bufferSizeTuner { *this };
+    bool bufferAutoTuneEnabled = false;
+    int tunedBufferSize = 0;
+    juce::String tunedBufferDevice;
+    std::atomic<bool> padModeEnabled { false };
+    int configuredRecorderCount = RecordingBus::kDefaultNumRecorders;
+    PadChokeMode padChokeMode = PadChokeMode::perPad;
+
     juce::AudioFormatManager soundFormatManager;
     juce::AudioBuffer<float> bleepBuffer;
     juce::AudioBuffer<float> cowbellBuffer;
@@ -217,8 +277,11 @@ private:
     std::atomic<int> soundLength { 0 };
     std::atomic<UiSound> currentSound { UiSound::Cowbell };
 
-    std::atomic<float> inputRMS  { 0.0f };
-    std::atomic<float> inputPeak { 0.0f };
+    std::atomic<RecordQuantize> recordQuantize { RecordQuantize::bar };
+    std::atomic<bool> latchedStopFinalisePending { false };
+    double deviceSampleRate = 0.0;
+    int deviceBufferSize = 0;
+    int deviceInputLatencySamples = 0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioEngine)
 };
@@ -1,8 +1,9 @@
 #include "AudioFileIO.h"
+#include <atomic>
 
 namespace
 {
-    constexpr double kTargetSampleRate = 44100.0;
+    constexpr double kDefaultSampleRate = 44100.0;
     constexpr int kTargetBitsPerSample = 16;
     constexpr int kTargetChannels = 1;
 
@@ -26,13 +27,17 @@ namespace
         return monoBuffer;
     }
 
-    juce::AudioBuffer<float> resampleToTarget (const juce::AudioBuffer<float>& input, double sourceRate)
+    std::atomic<double> processingSampleRate { kDefaultSampleRate };
+
+    juce::AudioBuffer<float> resampleToTarget (const juce::AudioBuffer<float>& input,
+                                               double sourceRate,
+                                               double targetRate)
     {
-        if (juce::approximatelyEqual (sourceRate, kTargetSampleRate))
+        if (juce::approximatelyEqual (sourceRate, targetRate))
             return input;
 
         const int inputSamples = input.getNumSamples();
-        const double ratio = sourceRate / kTargetSampleRate;
+        const double ratio = sourceRate / targetRate;
         const int outputSamples = static_cast<int> (std::ceil (static_cast<double> (inputSamples) / ratio));
 
         juce::AudioBuffer<float> resampled (1, outputSamples);
@@ -65,10 +70,40 @@ namespace
 }
 
 AudioFileIO::AudioFileIO()
+    : AudioFileIO (getProcessingSampleRate())
+{
+}
+
+AudioFileIO::AudioFileIO (double targetSampleRateToUse)
+    : targetSampleRate (targetSampleRateToUse > 0.0 ? targetSampleRateToUse : kDefaultSampleRate)
 {
     formatManager.registerBasicFormats();
 }
 
+double AudioFileIO::getTargetSampleRate() const
+{
+    return targetSampleRate;
+}
+
+void AudioFileIO::setProcessingSampleRate (double sampleRate)
+{
+    if (sampleRate > 0.0)
+        processingSampleRate.store (sampleRate);
+}
+
+double AudioFileIO::getProcessingSampleRate()
+{
+    return processingSampleRate.load();
+}
+
+int AudioFileIO::rescaleFrames (int frames, double fromSampleRate, double toSampleRate)
+{
+    if (fromSampleRate <= 0.0 || toSampleRate <= 0.0 || juce::approximatelyEqual (fromSampleRate, toSampleRate))
+        return frames;
+
+    return static_cast<int> (std::lround (static_cast<double> (frames) * toSampleRate / fromSampleRate));
+}
+
 bool AudioFileIO::readToMonoBuffer (const juce::File& inputFile,
                                     ConvertedAudio& output,
                                     juce::String& formatDescription) const
@@ -89,18 +124,19 @@ bool AudioFileIO::readToMonoBuffer (const juce::File& inputFile,
         return false;
 
     const bool needsDownmix = tempBuffer.getNumChannels() != kTargetChannels;
-    const bool needsResample = ! juce::approximatelyEqual (reader->sampleRate, kTargetSampleRate);
+    const bool needsResample = ! juce::approximatelyEqual (reader->sampleRate, targetSampleRate);
     if (needsDownmix || needsResample)
-        formatDescription = formatDescription + " -> converted to 44.1k/mono";
+        formatDescription = formatDescription + " -> converted to "
+                            + juce::String (targetSampleRate / 1000.0, 1) + "k/mono";
 
     juce::AudioBuffer<float> monoBuffer = needsDownmix
         ? mixToMono (tempBuffer)
         : tempBuffer;
 
-    juce::AudioBuffer<float> resampled = resampleToTarget (monoBuffer, reader->sampleRate);
+    juce::AudioBuffer<float> resampled = resampleToTarget (monoBuffer, reader->sampleRate, targetSampleRate);
 
     output.buffer = std::move (resampled);
-    output.sampleRate = kTargetSampleRate;
+    output.sampleRate = targetSampleRate;
 
     return true;
 }
@@ -124,7 +160,7 @@ bool AudioFileIO::readToMonoBufferSegment (const juce::File& inputFile,
         return false;
 
     const double sourceRate = reader->sampleRate;
-    const double ratio = sourceRate / kTargetSampleRate;
+    const double ratio = sourceRate / targetSampleRate;
     const auto startSample = static_cast<juce::int64> (std::floor (static_cast<double> (startFrame) * ratio));
     const auto requestedSamples = static_cast<juce::int64> (std::ceil (static_cast<double> (frameCount) * ratio));
     const juce::int64 totalSamples = reader->lengthInSamples;
@@ -142,19 +178,20 @@ bool AudioFileIO::readToMonoBufferSegment (const juce::File& inputFile,
         return false;
 
     const bool needsDownmix = tempBuffer.getNumChannels() != kTargetChannels;
-    const bool needsResample = ! juce::approximatelyEqual (reader->sampleRate, kTargetSampleRate);
+    const bool needsResample = ! juce::approximatelyEqual (reader->sampleRate, targetSampleRate);
     if (needsDownmix || needsResample)
-        formatDescription = formatDescription + " -> converted to 44.1k/mono";
+        formatDescription = formatDescription + " -> converted to "
+                            + juce::String (targetSampleRate / 1000.0, 1) + "k/mono";
 
     juce::AudioBuffer<float> monoBuffer = needsDownmix
         ? mixToMono (tempBuffer)
         : tempBuffer;
 
-    juce::AudioBuffer<float> resampled = resampleToTarget (monoBuffer, reader->sampleRate);
+    juce::AudioBuffer<float> resampled = resampleToTarget (monoBuffer, reader->sampleRate, targetSampleRate);
     juce::AudioBuffer<float> trimmed = trimOrPadToTarget (resampled, frameCount);
 
     output.buffer = std::move (trimmed);
-    output.sampleRate = kTargetSampleRate;
+    output.sampleRate = targetSampleRate;
 
     return true;
 }
@@ -172,7 +209,7 @@ bool AudioFileIO::getFileDurationFrames (const juce::File& inputFile,
 
     formatDescription = describeFormat (*reader);
 
-    const double ratio = kTargetSampleRate / reader->sampleRate;
+    const double ratio = targetSampleRate / reader->sampleRate;
     durationFrames = static_cast<int> (std::ceil (static_cast<double> (reader->lengthInSamples) * ratio));
     return durationFrames > 0;
 }
@@ -180,7 +217,7 @@ bool AudioFileIO::getFileDurationFrames (const juce::File& inputFile,
 bool AudioFileIO::writeMonoWav16 (const juce::File& outputFile,
                                   const ConvertedAudio& input) const
 {
-    if (input.sampleRate != kTargetSampleRate)
+    if (input.sampleRate <= 0.0)
         return false;
 
     if (input.buffer.getNumChannels() != kTargetChannels)
@@ -192,7 +229,7 @@ bool AudioFileIO::writeMonoWav16 (const juce::File& outputFile,
         return false;
 
     std::unique_ptr<juce::AudioFormatWriter> writer (wavFormat.createWriterFor (outputStream.get(),
-                                                                               kTargetSampleRate,
+                                                                               input.sampleRate,
                                                                                kTargetChannels,
                                                                                kTargetBitsPerSample,
                                                                                {},
@@ -232,7 +269,8 @@ void AudioFileIO::runSmokeTestAtStartup()
     const bool writeOk = audioFileIO.writeMonoWav16 (outputFile, converted);
 
     juce::Logger::writeToLog ("AudioFileIO smoke test: input format=" + inputFormat);
-    juce::Logger::writeToLog ("AudioFileIO smoke test: output format=sr=44100.0, bits=16, ch=1");
+    juce::Logger::writeToLog ("AudioFileIO smoke test: output format=sr=" + juce::String (converted.sampleRate, 1)
+                              + ", bits=16, ch=1");
     juce::Logger::writeToLog ("AudioFileIO smoke test: output path=" + outputFile.getFullPathName());
     juce::Logger::writeToLog (juce::String ("AudioFileIO smoke test: success=") + (writeOk ? "true" : "false"));
 }
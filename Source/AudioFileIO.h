@@ -11,7 +11,16 @@ public:
         double sampleRate = 44100.0;
     };
 
+    // frames are counted at the session processing rate current at construction
     AudioFileIO();
+    explicit AudioFileIO (double targetSampleRateToUse);
+
+    double getTargetSampleRate() const;
+
+    // the session follows the audio device; sources are converted only when they differ
+    static void setProcessingSampleRate (double sampleRate);
+    static double getProcessingSampleRate();
+    static int rescaleFrames (int frames, double fromSampleRate, double toSampleRate);
 
     bool readToMonoBuffer (const juce::File& inputFile,
                            ConvertedAudio& output,
@@ -34,6 +43,7 @@ public:
 
 private:
     mutable juce::AudioFormatManager formatManager;
+    double targetSampleRate = 44100.0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFileIO)
 };
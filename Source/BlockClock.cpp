@@ -0,0 +1,165 @@
+#include "BlockClock.h"
+#include <cmath>
+
+namespace
+{
+    // narrow enough that callback jitter moves block times by microseconds,
+    // wide enough to follow a device clock drifting against the host's
+    constexpr double kLoopBandwidthHz = 0.2;
+    constexpr double kHostOffsetSmoothing = 0.01;
+
+    // a stall or a dropped buffer moves the sample clock further than the
+    // loop should be asked to pull; start again from the callback time
+    constexpr double kRelockErrorMs = 20.0;
+    constexpr double kMaxRateError = 0.01;
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+BlockClock::BlockClock() {}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void BlockClock::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    hostOffsetValid = false;
+    hostTimeThisBlock = false;
+    locked = false;
+}
+
+double BlockClock::advance (int numSamples, double callbackMs, const std::uint64_t* hostTimeNs)
+{
+    hostTimeThisBlock = hostTimeNs != nullptr;
+
+    if (sampleRate <= 0.0 || numSamples <= 0)
+        return callbackMs;
+
+    if (hostTimeNs != nullptr)
+        return fromHostTime (*hostTimeNs, callbackMs);
+
+    return fromSamplePosition (numSamples, callbackMs);
+}
+
+double BlockClock::getPresentationDelayMs() const
+{
+    // an output timestamp lies ahead of the callback; an input one behind
+    if (! hostTimeThisBlock || ! hostOffsetValid || hostOffsetMs >= 0.0)
+        return -1.0;
+
+    return -hostOffsetMs;
+}
+
+double BlockClock::fromHostTime (std::uint64_t hostTimeNs, double callbackMs)
+{
+    // the host clock need not share the counter's origin; only the offset
+    // between the two is smoothed, never the timestamp itself
+    const double hostMs = static_cast<double> (hostTimeNs) * 1.0e-6;
+    const double offsetMs = callbackMs - hostMs;
+
+    if (! hostOffsetValid || std::abs (offsetMs - hostOffsetMs) > kRelockErrorMs)
+    {
+        hostOffsetMs = offsetMs;
+        hostOffsetValid = true;
+    }
+    else
+    {
+        hostOffsetMs += kHostOffsetSmoothing * (offsetMs - hostOffsetMs);
+    }
+
+    return hostMs + hostOffsetMs;
+}
+
+double BlockClock::fromSamplePosition (int numSamples, double callbackMs)
+{
+    const double nominalMsPerSample = 1000.0 / sampleRate;
+    const double errorMs = callbackMs - nextBlockMs;
+
+    if (! locked || std::abs (errorMs) > juce::jmax (kRelockErrorMs, 2.0 * numSamples * nominalMsPerSample))
+    {
+        locked = true;
+        msPerSample = nominalMsPerSample;
+        nextBlockMs = callbackMs + numSamples * msPerSample;
+        return callbackMs;
+    }
+
+    // second-order delay-locked loop (Adriaensen, "Using a DLL to filter time"):
+    // this block starts where the last one predicted, and the error only
+    // nudges the next prediction and the estimated sample period
+    const double omega = juce::MathConstants<double>::twoPi * kLoopBandwidthHz * numSamples / sampleRate;
+    const double blockMs = nextBlockMs;
+
+    nextBlockMs += juce::MathConstants<double>::sqrt2 * omega * errorMs + numSamples * msPerSample;
+    msPerSample = juce::jlimit (nominalMsPerSample * (1.0 - kMaxRateError),
+                                nominalMsPerSample * (1.0 + kMaxRateError),
+                                msPerSample + omega * omega * errorMs / numSamples);
+
+    return blockMs;
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class BlockClockTests final : public juce::UnitTest
+{
+public:
+    BlockClockTests() : juce::UnitTest ("BlockClock", "Slicebot") {}
+
+    void runTest() override
+    {
+        beginTest ("callback jitter stays out of block times");
+        expectLessThan (worstIntervalErrorMs (false), kToleranceMs);
+
+        beginTest ("host timestamps set block times");
+        expectLessThan (worstIntervalErrorMs (true), kToleranceMs);
+    }
+
+private:
+    static constexpr double kToleranceMs = 0.1;
+
+    // 256-sample blocks from a device running 100 ppm fast, each callback up
+    // to 3 ms late; returns the worst block-to-block error once settled
+    static double worstIntervalErrorMs (bool withHostTime)
+    {
+        constexpr double nominalRate = 48000.0;
+        constexpr double deviceRate = 48004.8;
+        constexpr int blockSize = 256;
+        constexpr int numBlocks = 20000;
+        constexpr int settleBlocks = 2000;
+
+        BlockClock clock;
+        clock.prepare (nominalRate);
+
+        juce::Random random (1);
+        const double periodMs = blockSize * 1000.0 / deviceRate;
+        double previousMs = 0.0;
+        double worstMs = 0.0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const double idealMs = 1000.0 + block * periodMs;
+            const auto hostTimeNs = static_cast<std::uint64_t> (idealMs * 1.0e6);
+            const double startMs = clock.advance (blockSize,
+                                                  idealMs + 3.0 * random.nextDouble(),
+                                                  withHostTime ? &hostTimeNs : nullptr);
+
+            if (block > settleBlocks)
+                worstMs = juce::jmax (worstMs, std::abs ((startMs - previousMs) - periodMs));
+
+            previousMs = startMs;
+        }
+
+        return worstMs;
+    }
+};
+
+static BlockClockTests blockClockTests;
+
+#endif
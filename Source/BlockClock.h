@@ -0,0 +1,46 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+
+// Gives each audio block a start time on the hi-res millisecond counter that
+// follows the device's sample clock rather than the moment the callback ran.
+// With a host timestamp the time comes from that; without one a delay-locked
+// loop fits the running sample count to the callback times, so scheduling
+// jitter in the callback never reaches what is timed from the block.
+class BlockClock
+{
+public:
+    BlockClock();
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    void prepare (double sampleRate);
+
+    // callbackMs is the millisecond counter read on entry to the callback;
+    // hostTimeNs is the device context's timestamp, when it has one
+    double advance (int numSamples, double callbackMs, const std::uint64_t* hostTimeNs);
+
+    // how far ahead of the callback the device said this block will be
+    // heard, from its output timestamps; negative when it gave none
+    double getPresentationDelayMs() const;
+
+private:
+    double fromHostTime (std::uint64_t hostTimeNs, double callbackMs);
+    double fromSamplePosition (int numSamples, double callbackMs);
+
+    double sampleRate = 0.0;
+
+    // host timestamps: their offset from the millisecond counter
+    bool hostOffsetValid = false;
+    bool hostTimeThisBlock = false;
+    double hostOffsetMs = 0.0;
+
+    // sample position: the loop's state
+    bool locked = false;
+    double nextBlockMs = 0.0;
+    double msPerSample = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockClock)
+};
@@ -0,0 +1,203 @@
+#include "BufferSizeTuner.h"
+#include "AudioEngine.h"
+
+namespace
+{
+    constexpr int kTimerIntervalMs = 250;
+    constexpr double kSettleMs = 500.0;    // ignore the restart transient
+    constexpr double kMeasureMs = 5000.0;
+    constexpr double kMaxStableLoad = 0.8; // leave room for heavier scenes than the probe saw
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+BufferSizeTuner::BufferSizeTuner (AudioEngine& audioEngineToUse)
+    : audioEngine (audioEngineToUse)
+{
+}
+
+BufferSizeTuner::~BufferSizeTuner()
+{
+    stopTimer();
+}
+
+// =====================================================
+// CONTROL
+// =====================================================
+
+void BufferSizeTuner::start()
+{
+    cancel();
+
+    auto* device = audioEngine.getDeviceManager().getCurrentAudioDevice();
+    if (device == nullptr)
+    {
+        statusText = "No audio device";
+        return;
+    }
+
+    candidates = device->getAvailableBufferSizes();
+    candidates.sort();
+    originalBufferSize = device->getCurrentBufferSizeSamples();
+
+    const int startIndex = candidates.indexOf (originalBufferSize);
+    if (startIndex < 0)
+    {
+        statusText = "Current buffer size is not in the device list";
+        return;
+    }
+
+    bestStableIndex = -1;
+    probingDown = true;
+    calibrate (startIndex);
+}
+
+void BufferSizeTuner::cancel()
+{
+    if (! isRunning())
+        return;
+
+    stopTimer();
+    phase = Phase::idle;
+    applyBufferSize (originalBufferSize);
+    statusText = "Cancelled, kept " + juce::String (originalBufferSize) + " samples";
+}
+
+bool BufferSizeTuner::isRunning() const
+{
+    return phase != Phase::idle;
+}
+
+juce::String BufferSizeTuner::getStatusText() const
+{
+    return statusText;
+}
+
+// =====================================================
+// CALIBRATION
+// =====================================================
+
+void BufferSizeTuner::calibrate (int candidateIndex)
+{
+    currentIndex = candidateIndex;
+    const int bufferSize = candidates[candidateIndex];
+
+    if (! applyBufferSize (bufferSize))
+    {
+        phase = Phase::measuring;
+        evaluate (false);
+        return;
+    }
+
+    statusText = "Testing " + juce::String (bufferSize) + " samples...";
+    phase = Phase::settling;
+    phaseStartMs = juce::Time::getMillisecondCounterHiRes();
+    startTimer (kTimerIntervalMs);
+}
+
+void BufferSizeTuner::timerCallback()
+{
+    const double elapsedMs = juce::Time::getMillisecondCounterHiRes() - phaseStartMs;
+
+    if (phase == Phase::settling)
+    {
+        if (elapsedMs < kSettleMs)
+            return;
+
+        audioEngine.resetCallbackDiagnostics();
+        xrunsAtStart = getDeviceXRuns();
+        phase = Phase::measuring;
+        phaseStartMs = juce::Time::getMillisecondCounterHiRes();
+        return;
+    }
+
+    if (phase != Phase::measuring)
+        return;
+
+    const auto diagnostics = audioEngine.getCallbackDiagnostics();
+    const int xruns = getDeviceXRuns();
+    const bool failed = diagnostics.overruns > 0
+                        || diagnostics.discontinuities > 0
+                        || diagnostics.maxLoad > kMaxStableLoad
+                        || (xrunsAtStart >= 0 && xruns > xrunsAtStart);
+
+    if (failed)
+    {
+        evaluate (false);
+        return;
+    }
+
+    if (elapsedMs >= kMeasureMs)
+        evaluate (diagnostics.callbacks > 0);
+}
+
+void BufferSizeTuner::evaluate (bool stable)
+{
+    stopTimer();
+
+    if (stable)
+    {
+        bestStableIndex = currentIndex;
+
+        if (probingDown && currentIndex > 0)
+            calibrate (currentIndex - 1);
+        else
+            finish (currentIndex);
+        return;
+    }
+
+    if (bestStableIndex >= 0)
+    {
+        finish (bestStableIndex);
+        return;
+    }
+
+    // even the starting size glitched; walk upwards until one holds
+    probingDown = false;
+    if (currentIndex + 1 < candidates.size())
+        calibrate (currentIndex + 1);
+    else
+        finish (currentIndex);
+}
+
+void BufferSizeTuner::finish (int candidateIndex)
+{
+    phase = Phase::idle;
+    const int bufferSize = candidates[candidateIndex];
+    applyBufferSize (bufferSize);
+
+    statusText = "Settled on " + juce::String (bufferSize) + " samples";
+    juce::Logger::writeToLog ("Buffer auto-tune: " + statusText);
+
+    if (onSettled)
+        onSettled (bufferSize);
+}
+
+bool BufferSizeTuner::applyBufferSize (int bufferSize)
+{
+    auto& deviceManager = audioEngine.getDeviceManager();
+    juce::AudioDeviceManager::AudioDeviceSetup setup;
+    deviceManager.getAudioDeviceSetup (setup);
+    if (setup.bufferSize == bufferSize)
+        return true;
+
+    setup.bufferSize = bufferSize;
+    const auto error = deviceManager.setAudioDeviceSetup (setup, true);
+    if (error.isNotEmpty())
+    {
+        juce::Logger::writeToLog ("Buffer auto-tune: " + juce::String (bufferSize) + " failed: " + error);
+        return false;
+    }
+
+    return true;
+}
+
+int BufferSizeTuner::getDeviceXRuns() const
+{
+    if (auto* device = audioEngine.getDeviceManager().getCurrentAudioDevice())
+        return device->getXRunCount();
+
+    return -1;
+}
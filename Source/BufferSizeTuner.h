@@ -0,0 +1,51 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+
+class AudioEngine;
+
+// Steps the device through smaller buffer sizes while watching the callback
+// diagnostics, and settles on the smallest size that stayed clean for a full
+// calibration window. Runs entirely on the message thread.
+class BufferSizeTuner final : private juce::Timer
+{
+public:
+    explicit BufferSizeTuner (AudioEngine& audioEngineToUse);
+    ~BufferSizeTuner() override;
+
+    void start();
+    void cancel();
+    bool isRunning() const;
+    juce::String getStatusText() const;
+
+    std::function<void (int bufferSize)> onSettled;
+
+private:
+    enum class Phase
+    {
+        idle,
+        settling,
+        measuring
+    };
+
+    void timerCallback() override;
+    void calibrate (int candidateIndex);
+    void evaluate (bool stable);
+    void finish (int candidateIndex);
+    bool applyBufferSize (int bufferSize);
+    int getDeviceXRuns() const;
+
+    AudioEngine& audioEngine;
+    juce::Array<int> candidates;
+    Phase phase = Phase::idle;
+    int currentIndex = -1;
+    int bestStableIndex = -1;
+    int originalBufferSize = 0;
+    bool probingDown = true;
+    double phaseStartMs = 0.0;
+    int xrunsAtStart = -1;
+    juce::String statusText;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BufferSizeTuner)
+};
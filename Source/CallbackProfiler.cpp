@@ -0,0 +1,237 @@
+#include "CallbackProfiler.h"
+
+namespace
+{
+    constexpr double kMeanSmoothing = 0.01;
+
+    // a callback starting this much later than the previous block's length
+    // means the device skipped or stalled
+    constexpr double kDiscontinuityFactor = 1.8;
+
+    void storeMax (std::atomic<double>& target, double value)
+    {
+        if (value > target.load (std::memory_order_relaxed))
+            target.store (value, std::memory_order_relaxed);
+    }
+
+    void storeSmoothed (std::atomic<double>& target, double value, bool first)
+    {
+        const double previous = target.load (std::memory_order_relaxed);
+        target.store (first ? value : previous + kMeanSmoothing * (value - previous),
+                      std::memory_order_relaxed);
+    }
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+CallbackProfiler::CallbackProfiler()
+{
+    for (auto& bucket : loadHistogram)
+        bucket.store (0);
+
+    for (int i = 0; i < kNumStages; ++i)
+    {
+        stageMeanMicros[static_cast<size_t> (i)].store (0.0);
+        stageMaxMicros[static_cast<size_t> (i)].store (0.0);
+    }
+
+    ticksToMicros = 1.0e6 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
+}
+
+juce::String CallbackProfiler::getStageName (Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::routing:   return "routing";
+        case Stage::metering:  return "metering";
+        case Stage::recording: return "recording";
+        case Stage::midiClock: return "midi clock";
+        case Stage::voices:    return "voices";
+        case Stage::uiSound:   return "ui sound";
+        case Stage::count:     break;
+    }
+
+    return {};
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void CallbackProfiler::prepare (double newSampleRate, int blockSize)
+{
+    sampleRate = newSampleRate;
+    publishedSampleRate.store (newSampleRate);
+    publishedBlockSize.store (blockSize);
+    deadlineMicros.store (newSampleRate > 0.0 ? blockSize * 1.0e6 / newSampleRate : 0.0);
+    resetRequested.store (true);
+}
+
+void CallbackProfiler::beginBlock (int numSamples)
+{
+    applyPendingReset();
+
+    const auto now = juce::Time::getHighResolutionTicks();
+    const bool first = callbacks.load (std::memory_order_relaxed) == 0;
+
+    if (! first && lastBlockPeriodMicros > 0.0)
+    {
+        const double gapMicros = static_cast<double> (now - lastBlockStartTicks) * ticksToMicros;
+        if (gapMicros > lastBlockPeriodMicros * kDiscontinuityFactor)
+            discontinuities.store (discontinuities.load (std::memory_order_relaxed) + 1,
+                                   std::memory_order_relaxed);
+    }
+
+    currentDeadlineMicros = sampleRate > 0.0 ? numSamples * 1.0e6 / sampleRate : 0.0;
+    lastBlockPeriodMicros = currentDeadlineMicros;
+    lastBlockStartTicks = now;
+    blockStartTicks = now;
+    stageStartTicks = now;
+}
+
+void CallbackProfiler::markStage (Stage stage)
+{
+    const auto now = juce::Time::getHighResolutionTicks();
+    const double micros = static_cast<double> (now - stageStartTicks) * ticksToMicros;
+    stageStartTicks = now;
+
+    const auto index = static_cast<size_t> (stage);
+    storeSmoothed (stageMeanMicros[index], micros, callbacks.load (std::memory_order_relaxed) == 0);
+    storeMax (stageMaxMicros[index], micros);
+}
+
+void CallbackProfiler::endBlock()
+{
+    if (currentDeadlineMicros <= 0.0)
+        return;
+
+    const auto now = juce::Time::getHighResolutionTicks();
+    const double micros = static_cast<double> (now - blockStartTicks) * ticksToMicros;
+    const double load = micros / currentDeadlineMicros;
+    const auto count = callbacks.load (std::memory_order_relaxed);
+
+    if (load > 1.0)
+        overruns.store (overruns.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    storeSmoothed (meanLoad, load, count == 0);
+    storeMax (maxLoad, load);
+
+    // rolling histogram: the oldest block leaves as the newest one enters
+    const auto bucket = static_cast<juce::uint8> (juce::jlimit (0, kNumLoadBuckets - 1,
+                                                                static_cast<int> (load * 10.0)));
+    auto& slot = windowBuckets[static_cast<size_t> (windowWritePosition)];
+    if (windowFill == kWindowBlocks)
+    {
+        auto& leaving = loadHistogram[static_cast<size_t> (slot)];
+        leaving.store (leaving.load (std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+    else
+    {
+        ++windowFill;
+    }
+
+    slot = bucket;
+    auto& entering = loadHistogram[static_cast<size_t> (bucket)];
+    entering.store (entering.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    windowWritePosition = (windowWritePosition + 1) % kWindowBlocks;
+
+    publishedWindowFill.store (windowFill, std::memory_order_relaxed);
+    callbacks.store (count + 1, std::memory_order_relaxed);
+}
+
+void CallbackProfiler::applyPendingReset()
+{
+    if (! resetRequested.exchange (false))
+        return;
+
+    callbacks.store (0);
+    overruns.store (0);
+    discontinuities.store (0);
+    meanLoad.store (0.0);
+    maxLoad.store (0.0);
+
+    for (auto& bucket : loadHistogram)
+        bucket.store (0);
+
+    for (int i = 0; i < kNumStages; ++i)
+    {
+        stageMeanMicros[static_cast<size_t> (i)].store (0.0);
+        stageMaxMicros[static_cast<size_t> (i)].store (0.0);
+    }
+
+    windowFill = 0;
+    windowWritePosition = 0;
+    publishedWindowFill.store (0);
+    lastBlockPeriodMicros = 0.0;
+}
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+CallbackProfiler::Snapshot CallbackProfiler::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.sampleRate = publishedSampleRate.load();
+    snapshot.blockSize = publishedBlockSize.load();
+    snapshot.deadlineMicros = deadlineMicros.load();
+    snapshot.callbacks = callbacks.load();
+    snapshot.overruns = overruns.load();
+    snapshot.discontinuities = discontinuities.load();
+    snapshot.meanLoad = meanLoad.load();
+    snapshot.maxLoad = maxLoad.load();
+    snapshot.windowBlocks = publishedWindowFill.load();
+
+    for (int i = 0; i < kNumLoadBuckets; ++i)
+        snapshot.loadHistogram[static_cast<size_t> (i)] = juce::jmax (0, loadHistogram[static_cast<size_t> (i)].load());
+
+    for (int i = 0; i < kNumStages; ++i)
+    {
+        snapshot.stages[static_cast<size_t> (i)].meanMicros = stageMeanMicros[static_cast<size_t> (i)].load();
+        snapshot.stages[static_cast<size_t> (i)].maxMicros = stageMaxMicros[static_cast<size_t> (i)].load();
+    }
+
+    return snapshot;
+}
+
+void CallbackProfiler::reset()
+{
+    resetRequested.store (true);
+}
+
+juce::String CallbackProfiler::createReport (const Snapshot& snapshot)
+{
+    juce::String report;
+    report << "SliceBot callback diagnostics " << juce::Time::getCurrentTime().toString (true, true) << "\n"
+           << "device: " << juce::String (snapshot.sampleRate, 0) << " Hz, "
+           << snapshot.blockSize << " samples, deadline "
+           << juce::String (snapshot.deadlineMicros, 1) << " us\n"
+           << "callbacks: " << juce::String (snapshot.callbacks)
+           << ", overruns: " << juce::String (snapshot.overruns)
+           << ", discontinuities: " << juce::String (snapshot.discontinuities)
+           << ", device xruns: " << (snapshot.deviceXRuns >= 0 ? juce::String (snapshot.deviceXRuns) : juce::String ("n/a"))
+           << "\n"
+           << "load: mean " << juce::String (snapshot.meanLoad * 100.0, 1)
+           << "%, max " << juce::String (snapshot.maxLoad * 100.0, 1) << "%\n"
+           << "\nload histogram (last " << snapshot.windowBlocks << " blocks)\n";
+
+    for (int i = 0; i < kNumLoadBuckets; ++i)
+    {
+        const juce::String range = i == kNumLoadBuckets - 1
+                                       ? ">" + juce::String (i * 10) + "%"
+                                       : juce::String (i * 10) + "-" + juce::String (i * 10 + 10) + "%";
+        report << range.paddedRight (' ', 10) << snapshot.loadHistogram[static_cast<size_t> (i)] << "\n";
+    }
+
+    report << "\nstages (mean / max us)\n";
+    for (int i = 0; i < kNumStages; ++i)
+    {
+        const auto& stage = snapshot.stages[static_cast<size_t> (i)];
+        report << getStageName (static_cast<Stage> (i)).paddedRight (' ', 12)
+               << juce::String (stage.meanMicros, 1) << " / " << juce::String (stage.maxMicros, 1) << "\n";
+    }
+
+    return report;
+}
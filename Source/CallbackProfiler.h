@@ -0,0 +1,99 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// Times AudioEngine's device callback against its block deadline. The audio
+// thread only does relaxed atomic stores; readers take an approximate but
+// tear-free copy of each counter.
+class CallbackProfiler
+{
+public:
+    enum class Stage
+    {
+        routing = 0,
+        metering,
+        recording,
+        midiClock,
+        voices,
+        uiSound,
+        count
+    };
+
+    static constexpr int kNumStages = static_cast<int> (Stage::count);
+    static constexpr int kNumLoadBuckets = 12; // 10% of the deadline each, last one is > 110%
+    static constexpr int kWindowBlocks = 2048;
+
+    struct StageTiming
+    {
+        double meanMicros = 0.0;
+        double maxMicros = 0.0;
+    };
+
+    struct Snapshot
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        double deadlineMicros = 0.0;
+        juce::int64 callbacks = 0;
+        juce::int64 overruns = 0;
+        juce::int64 discontinuities = 0;
+        int deviceXRuns = -1;
+        double meanLoad = 0.0;
+        double maxLoad = 0.0;
+        int windowBlocks = 0;
+        std::array<int, kNumLoadBuckets> loadHistogram {};
+        std::array<StageTiming, kNumStages> stages {};
+    };
+
+    CallbackProfiler();
+
+    static juce::String getStageName (Stage stage);
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    void prepare (double sampleRate, int blockSize);
+    void beginBlock (int numSamples);
+    void markStage (Stage stage);
+    void endBlock();
+
+    // =====================================================
+    // MESSAGE THREAD
+    // =====================================================
+    Snapshot getSnapshot() const;
+    void reset();
+    static juce::String createReport (const Snapshot& snapshot);
+
+private:
+    void applyPendingReset();
+
+    // audio thread
+    double sampleRate = 0.0;
+    juce::int64 blockStartTicks = 0;
+    juce::int64 stageStartTicks = 0;
+    juce::int64 lastBlockStartTicks = 0;
+    double lastBlockPeriodMicros = 0.0;
+    double currentDeadlineMicros = 0.0;
+    std::array<juce::uint8, kWindowBlocks> windowBuckets {};
+    int windowWritePosition = 0;
+    int windowFill = 0;
+    double ticksToMicros = 0.0;
+
+    std::atomic<bool> resetRequested { false };
+    std::atomic<double> publishedSampleRate { 0.0 };
+    std::atomic<int> publishedBlockSize { 0 };
+    std::atomic<double> deadlineMicros { 0.0 };
+    std::atomic<juce::int64> callbacks { 0 };
+    std::atomic<juce::int64> overruns { 0 };
+    std::atomic<juce::int64> discontinuities { 0 };
+    std::atomic<double> meanLoad { 0.0 };
+    std::atomic<double> maxLoad { 0.0 };
+    std::atomic<int> publishedWindowFill { 0 };
+    std::array<std::atomic<int>, kNumLoadBuckets> loadHistogram {};
+    std::array<std::atomic<double>, kNumStages> stageMeanMicros {};
+    std::array<std::atomic<double>, kNumStages> stageMaxMicros {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackProfiler)
+};
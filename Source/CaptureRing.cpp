@@ -0,0 +1,95 @@
+#include "CaptureRing.h"
+#include <cstring>
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+CaptureRing::CaptureRing (int numChannels, int capacitySamples)
+    : buffer (juce::jmax (1, numChannels), juce::jmax (1, capacitySamples))
+{
+    buffer.clear();
+}
+
+int CaptureRing::getNumChannels() const
+{
+    return buffer.getNumChannels();
+}
+
+int CaptureRing::getCapacity() const
+{
+    return buffer.getNumSamples();
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void CaptureRing::write (const float* const* input, int numChannels, int numSamples)
+{
+    if (numChannels <= 0 || numSamples <= 0)
+        return;
+
+    const int capacity = buffer.getNumSamples();
+    const auto written = totalWritten.load (std::memory_order_relaxed);
+
+    writeReserved.store (written + numSamples, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    // only the newest capacity samples of an oversized block survive
+    const int toWrite = juce::jmin (numSamples, capacity);
+    const int skipped = numSamples - toWrite;
+    const int position = static_cast<int> ((written + skipped) % capacity);
+    const int firstPart = juce::jmin (toWrite, capacity - position);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+    {
+        const float* source = input[juce::jmin (ch, numChannels - 1)] + skipped;
+        buffer.copyFrom (ch, position, source, firstPart);
+        if (toWrite > firstPart)
+            buffer.copyFrom (ch, 0, source + firstPart, toWrite - firstPart);
+    }
+
+    totalWritten.store (written + numSamples, std::memory_order_release);
+}
+
+// =====================================================
+// READER THREAD
+// =====================================================
+
+int CaptureRing::copyLatest (juce::AudioBuffer<float>& dest, int maxSamples) const
+{
+    const int capacity = buffer.getNumSamples();
+    const auto end = totalWritten.load (std::memory_order_acquire);
+    const int count = static_cast<int> (juce::jmin<juce::int64> (end, capacity, maxSamples));
+    if (count <= 0)
+        return 0;
+
+    dest.setSize (buffer.getNumChannels(), count, false, false, true);
+
+    const auto start = end - count;
+    const int position = static_cast<int> (start % capacity);
+    const int firstPart = juce::jmin (count, capacity - position);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+    {
+        dest.copyFrom (ch, 0, buffer, ch, position, firstPart);
+        if (count > firstPart)
+            dest.copyFrom (ch, firstPart, buffer, ch, 0, count - firstPart);
+    }
+
+    // anything the writer reached during the copy is torn; drop it from the front
+    std::atomic_thread_fence (std::memory_order_acquire);
+    const auto overwrittenEnd = writeReserved.load (std::memory_order_relaxed) - capacity;
+    const int lapped = static_cast<int> (juce::jlimit<juce::int64> (0, count, overwrittenEnd - start));
+    if (lapped == 0)
+        return count;
+
+    const int valid = count - lapped;
+    for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+        std::memmove (dest.getWritePointer (ch),
+                      dest.getReadPointer (ch, lapped),
+                      static_cast<size_t> (valid) * sizeof (float));
+
+    return valid;
+}
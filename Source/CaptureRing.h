@@ -0,0 +1,38 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+
+// Fixed-length history of a recorder's input, kept while the recorder is
+// disarmed. The audio thread overwrites the oldest samples every block; like a
+// seqlock, it announces the span it is about to write and then publishes it.
+// A single reader on another thread copies the newest span out and afterwards
+// drops whatever the writer lapped while the copy was running.
+class CaptureRing
+{
+public:
+    CaptureRing (int numChannels, int capacitySamples);
+
+    int getNumChannels() const;
+    int getCapacity() const;
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    // missing channels repeat the first one
+    void write (const float* const* input, int numChannels, int numSamples);
+
+    // =====================================================
+    // READER THREAD
+    // =====================================================
+    // copies up to maxSamples of the newest history, oldest first, into
+    // dest (resized as needed) and returns how many samples are valid
+    int copyLatest (juce::AudioBuffer<float>& dest, int maxSamples) const;
+
+private:
+    juce::AudioBuffer<float> buffer;
+    std::atomic<juce::int64> writeReserved { 0 }; // end of the block being written
+    std::atomic<juce::int64> totalWritten { 0 };  // end of the last complete block
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureRing)
+};
@@ -4,7 +4,6 @@
 
 namespace
 {
-    constexpr double kTargetSampleRate = 44100.0;
     constexpr int kSliceCount = 4;
     constexpr double kBpm = 120.0;
 
@@ -43,10 +42,10 @@ namespace
         return 60.0 / sanitizedBpm();
     }
 
-    int windowFramesPerBar()
+    int windowFramesPerBar (double sampleRate)
     {
         const double seconds = secondsPerBeat() * 4.0;
-        return static_cast<int> (std::lround (seconds * kTargetSampleRate));
+        return static_cast<int> (std::lround (seconds * sampleRate));
     }
 
     double subdivisionToQuarterNotes (int subdivisionSteps)
@@ -74,17 +73,17 @@ namespace
         return 4;
     }
 
-    int subdivisionToFrameCount (int subdivisionSteps)
+    int subdivisionToFrameCount (int subdivisionSteps, double sampleRate)
     {
         const double quarterNotes = subdivisionToQuarterNotes (subdivisionSteps);
         const double durationSeconds = secondsPerBeat() * (quarterNotes / 4.0);
-        return static_cast<int> (std::lround (durationSeconds * kTargetSampleRate));
+        return static_cast<int> (std::lround (durationSeconds * sampleRate));
     }
 
-    int computedNoGoZoneFrames()
+    int computedNoGoZoneFrames (double sampleRate)
     {
         const double seconds = std::ceil (secondsPerBeat() * 8.0);
-        return static_cast<int> (std::lround (seconds * kTargetSampleRate));
+        return static_cast<int> (std::lround (seconds * sampleRate));
     }
 }
 
@@ -120,10 +119,10 @@ void DeterministicPreviewHarness::runTemporaryResliceAllDebug()
         return;
 
     const auto snapshot = stateStore.getSnapshot();
-    if (snapshot.previewChainURL == juce::File())
+    if (snapshot->previewChainURL == juce::File())
         return;
 
-    previewChainFile = snapshot.previewChainURL;
+    previewChainFile = snapshot->previewChainURL;
     stopPlayback();
     startPlayback();
 }
@@ -151,8 +150,10 @@ bool DeterministicPreviewHarness::buildDeterministicSlices()
     pendingPreviewSnippetURLs.reserve (targetSlices);
     pendingSliceVolumeSettings.reserve (targetSlices);
 
-    const int noGoZoneFrames = computedNoGoZoneFrames();
-    const int windowFrames = windowFramesPerBar();
+    AudioFileIO audioFileIO;
+    const double sampleRate = audioFileIO.getTargetSampleRate();
+    const int noGoZoneFrames = computedNoGoZoneFrames (sampleRate);
+    const int windowFrames = windowFramesPerBar (sampleRate);
 
     for (int index = 0; index < targetSlices; ++index)
     {
@@ -178,7 +179,12 @@ bool DeterministicPreviewHarness::buildDeterministicSlices()
         int startFrame = 0;
         if (kTransientDetectEnabled)
         {
-            const auto refined = refinedStart (converted.buffer, random, maxCandidateStart, windowFrames, kTransientDetectEnabled);
+            const auto refined = refinedStart (converted.buffer,
+                                              random,
+                                              maxCandidateStart,
+                                              windowFrames,
+                                              kTransientDetectEnabled,
+                                              sampleRate);
             if (! refined.has_value())
                 continue;
             startFrame = refined.value();
@@ -192,7 +198,7 @@ bool DeterministicPreviewHarness::buildDeterministicSlices()
             ? kAllowedSubdivisionsSteps[random.nextInt (kAllowedSubdivisionsSteps.size())]
             : resolvedSelectedSubdivision();
 
-        const int sliceFrameCount = subdivisionToFrameCount (subdivisionSteps);
+        const int sliceFrameCount = subdivisionToFrameCount (subdivisionSteps, sampleRate);
 
         if (startFrame + sliceFrameCount > fileDurationFrames)
             continue;
@@ -204,7 +210,7 @@ bool DeterministicPreviewHarness::buildDeterministicSlices()
 
         AudioFileIO::ConvertedAudio sliceAudio;
         sliceAudio.buffer = std::move (sliceBuffer);
-        sliceAudio.sampleRate = kTargetSampleRate;
+        sliceAudio.sampleRate = sampleRate;
 
         if (! audioFileIO.writeMonoWav16 (outputFile, sliceAudio))
             continue;
@@ -214,6 +220,7 @@ bool DeterministicPreviewHarness::buildDeterministicSlices()
         info.startFrame = startFrame;
         info.subdivisionSteps = subdivisionSteps;
         info.snippetFrameCount = sliceFrameCount;
+        info.sampleRate = sampleRate;
 
         pendingSliceInfos.push_back (info);
         pendingPreviewSnippetURLs.push_back (outputFile);
@@ -234,6 +241,7 @@ bool DeterministicPreviewHarness::buildPreviewChain()
         return false;
     }
 
+    AudioFileIO audioFileIO;
     std::vector<juce::AudioBuffer<float>> snippetBuffers;
     snippetBuffers.reserve (pendingPreviewSnippetURLs.size());
 
@@ -269,7 +277,7 @@ bool DeterministicPreviewHarness::buildPreviewChain()
 
     AudioFileIO::ConvertedAudio chainAudio;
     chainAudio.buffer = std::move (chainBuffer);
-    chainAudio.sampleRate = kTargetSampleRate;
+    chainAudio.sampleRate = audioFileIO.getTargetSampleRate();
 
     if (! audioFileIO.writeMonoWav16 (previewChainFile, chainAudio))
     {
@@ -298,8 +306,9 @@ bool DeterministicPreviewHarness::startPlayback()
         return false;
     }
 
+    const double chainSampleRate = reader->sampleRate;
     readerSource = std::make_unique<juce::AudioFormatReaderSource> (reader.release(), true);
-    transportSource.setSource (readerSource.get(), 0, nullptr, kTargetSampleRate);
+    transportSource.setSource (readerSource.get(), 0, nullptr, chainSampleRate);
 
     sourcePlayer.setSource (&transportSource);
     deviceManager.addAudioCallback (&sourcePlayer);
@@ -23,7 +23,6 @@ private:
     void clearPendingState();
 
     juce::AudioDeviceManager& deviceManager;
-    AudioFileIO audioFileIO;
     SliceStateStore stateStore;
 
     juce::AudioFormatManager formatManager;
@@ -0,0 +1,453 @@
+#include "EnergyMap.h"
+#include "JobScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <list>
+#include <map>
+
+namespace
+{
+    constexpr float kFloorDb = -100.0f;
+    constexpr int kAudibleBelowPeakDb = 30;  // quieter than this relative to the loudest frame is a fade
+    constexpr int kAudibleFloorDb = -60;     // and nothing under this counts, however quiet the file
+    constexpr int kFramesPerRead = 512;
+    constexpr size_t kMaxCachedMaps = 512;
+    constexpr int kFileMagic = 0x4d454253;   // "SBEM"
+    constexpr int kFileVersion = 1;
+    constexpr int kFilesPerBuildJob = 16;
+
+    // the most recently used maps, up to kMaxCachedMaps
+    class MapCache
+    {
+    public:
+        std::shared_ptr<const EnergyMap> find (const juce::File& file)
+        {
+            const juce::ScopedLock lock (cacheLock);
+            const auto found = index.find (file.getFullPathName());
+            if (found == index.end())
+                return nullptr;
+
+            const auto entry = found->second;
+            if (! entry->second->isCurrentFor (file))
+            {
+                index.erase (found);
+                recent.erase (entry);
+                return nullptr;
+            }
+
+            recent.splice (recent.begin(), recent, entry);
+            return entry->second;
+        }
+
+        void insert (const juce::String& path, std::shared_ptr<const EnergyMap> map)
+        {
+            const juce::ScopedLock lock (cacheLock);
+            const auto found = index.find (path);
+            if (found != index.end())
+            {
+                recent.erase (found->second);
+                index.erase (found);
+            }
+
+            recent.emplace_front (path, std::move (map));
+            index[path] = recent.begin();
+
+            if (recent.size() > kMaxCachedMaps)
+            {
+                index.erase (recent.back().first);
+                recent.pop_back();
+            }
+        }
+
+    private:
+        using Entry = std::pair<juce::String, std::shared_ptr<const EnergyMap>>;
+
+        juce::CriticalSection cacheLock;
+        std::list<Entry> recent; // most recently used first
+        std::map<juce::String, std::list<Entry>::iterator> index;
+    };
+
+    MapCache& getMapCache()
+    {
+        static MapCache cache;
+        return cache;
+    }
+
+    // message thread only
+    struct PendingBuilds
+    {
+        JobScheduler::Token token;
+        std::vector<JobScheduler::JobHandle> jobs;
+    };
+
+    PendingBuilds& getPendingBuilds()
+    {
+        static PendingBuilds builds;
+        return builds;
+    }
+
+    std::atomic<int> mapGeneration { 0 };
+
+    juce::File getMapFileFor (const juce::File& source)
+    {
+        const auto folder = AudioCacheStore::getEnergyMapFolder();
+        if (folder == juce::File())
+            return juce::File();
+
+        return folder.getChildFile (juce::String::toHexString (source.getFullPathName().hashCode64()) + ".energy");
+    }
+}
+
+// =====================================================
+// LOOKUP
+// =====================================================
+
+std::shared_ptr<const EnergyMap> EnergyMap::findForFile (const juce::File& file)
+{
+    auto& cache = getMapCache();
+    if (auto map = cache.find (file))
+        return map;
+
+    const auto mapFile = getMapFileFor (file);
+    if (mapFile == juce::File())
+        return nullptr;
+
+    auto map = read (mapFile, file);
+    if (map != nullptr)
+        cache.insert (file.getFullPathName(), map);
+
+    return map;
+}
+
+bool EnergyMap::isCurrentFor (const juce::File& source) const
+{
+    return sourcePath == source.getFullPathName()
+           && sourceSizeBytes == source.getSize()
+           && sourceModifiedMs == source.getLastModificationTime().toMilliseconds();
+}
+
+int EnergyMap::getNumFrames() const
+{
+    return static_cast<int> (levelsDb.size());
+}
+
+// =====================================================
+// BUILDING
+// =====================================================
+
+void EnergyMap::buildMissing (const AudioCacheStore::CacheData& data)
+{
+    auto& builds = getPendingBuilds();
+    auto& scheduler = JobScheduler::get();
+
+    if (builds.token != nullptr)
+        builds.token->cancel();
+
+    builds.jobs.erase (std::remove_if (builds.jobs.begin(), builds.jobs.end(),
+                                       [&scheduler] (const auto& job) { return scheduler.isFinished (job); }),
+                       builds.jobs.end());
+
+    builds.token = JobScheduler::makeToken();
+
+    // a job per batch of files, so cancelling waits for one decode at most
+    const int numEntries = data.entries.size();
+    for (int first = 0; first < numEntries; first += kFilesPerBuildJob)
+    {
+        std::vector<juce::String> paths;
+        for (int i = first; i < juce::jmin (numEntries, first + kFilesPerBuildJob); ++i)
+            paths.push_back (data.entries.getPath (i));
+
+        const auto token = builds.token;
+        builds.jobs.push_back (scheduler.submit (JobScheduler::Priority::background, [paths = std::move (paths), token]
+        {
+            for (const auto& path : paths)
+            {
+                if (token->isCancelled())
+                    return;
+
+                build (juce::File (path));
+            }
+        }, token));
+    }
+}
+
+void EnergyMap::cancelBuilds()
+{
+    auto& builds = getPendingBuilds();
+    if (builds.token != nullptr)
+        builds.token->cancel();
+
+    for (const auto& job : builds.jobs)
+        JobScheduler::get().wait (job);
+
+    builds.jobs.clear();
+}
+
+void EnergyMap::build (const juce::File& file)
+{
+    if (getMapCache().find (file) != nullptr)
+        return;
+
+    const auto mapFile = getMapFileFor (file);
+    if (mapFile != juce::File())
+    {
+        juce::FileInputStream stream (mapFile);
+        EnergyMap saved;
+        if (stream.openedOk() && readHeader (stream, saved) && saved.isCurrentFor (file))
+            return;
+    }
+
+    const auto map = compute (file);
+    if (map == nullptr)
+        return;
+
+    // picks read a saved map back when they need it; one that cannot be
+    // saved is only kept in memory
+    if (mapFile == juce::File() || ! map->write (mapFile))
+    {
+        juce::Logger::writeToLog ("EnergyMap: could not save the map of " + file.getFullPathName());
+        getMapCache().insert (file.getFullPathName(), map);
+    }
+
+    ++mapGeneration;
+}
+
+int EnergyMap::getGeneration()
+{
+    return mapGeneration.load();
+}
+
+// =====================================================
+// START SELECTION
+// =====================================================
+
+int EnergyMap::randomStart (const EnergyMap* map, juce::Random& random, int maxStartFrame, double sampleRate)
+{
+    const int drawn = random.nextInt (maxStartFrame + 1);
+
+    if (map != nullptr)
+    {
+        if (const auto audible = map->audibleStartFor (drawn, maxStartFrame, sampleRate))
+            return *audible;
+    }
+
+    return drawn;
+}
+
+std::optional<int> EnergyMap::audibleStartFor (int uniformStart, int maxStartFrame, double sampleRate) const
+{
+    if (maxStartFrame < 0 || sampleRate <= 0.0)
+        return std::nullopt;
+
+    const int framesPerLevel = juce::jmax (1, juce::roundToInt (sampleRate * kFrameSeconds));
+    const int lastLevel = maxStartFrame / framesPerLevel;
+    const auto end = std::upper_bound (audibleFrames.begin(), audibleFrames.end(), lastLevel);
+    const int count = static_cast<int> (end - audibleFrames.begin());
+    if (count == 0)
+        return std::nullopt;
+
+    const auto place = juce::jlimit (0, maxStartFrame, uniformStart);
+    const auto rank = static_cast<int> (static_cast<int64_t> (place) * count / (static_cast<int64_t> (maxStartFrame) + 1));
+    const int level = audibleFrames[static_cast<size_t> (rank)];
+    const int start = level * framesPerLevel + place % framesPerLevel;
+    return juce::jmin (start, maxStartFrame);
+}
+
+// =====================================================
+// ANALYSIS AND STORAGE
+// =====================================================
+
+std::shared_ptr<const EnergyMap> EnergyMap::compute (const juce::File& file)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+        return nullptr;
+
+    std::shared_ptr<EnergyMap> map (new EnergyMap());
+    map->sourcePath = file.getFullPathName();
+    map->sourceSizeBytes = file.getSize();
+    map->sourceModifiedMs = file.getLastModificationTime().toMilliseconds();
+
+    const int numChannels = static_cast<int> (reader->numChannels);
+    const int frameSamples = juce::jmax (1, juce::roundToInt (reader->sampleRate * kFrameSeconds));
+    const auto totalSamples = reader->lengthInSamples;
+    map->levelsDb.reserve (static_cast<size_t> (totalSamples / frameSamples + 1));
+
+    juce::AudioBuffer<float> block (numChannels, frameSamples * kFramesPerRead);
+    for (juce::int64 position = 0; position < totalSamples; position += block.getNumSamples())
+    {
+        const int numRead = static_cast<int> (juce::jmin<juce::int64> (block.getNumSamples(), totalSamples - position));
+        if (! reader->read (&block, 0, numRead, position, true, true))
+            return nullptr;
+
+        for (int start = 0; start < numRead; start += frameSamples)
+        {
+            const int length = juce::jmin (frameSamples, numRead - start);
+            float meanSquare = 0.0f;
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const float rms = block.getRMSLevel (ch, start, length);
+                meanSquare += rms * rms;
+            }
+
+            const float db = juce::Decibels::gainToDecibels (std::sqrt (meanSquare / numChannels), kFloorDb);
+            map->levelsDb.push_back (static_cast<int8_t> (juce::roundToInt (juce::jlimit (kFloorDb, 0.0f, db))));
+        }
+    }
+
+    map->findAudibleFrames();
+    return map;
+}
+
+std::shared_ptr<const EnergyMap> EnergyMap::read (const juce::File& mapFile, const juce::File& source)
+{
+    juce::FileInputStream stream (mapFile);
+    if (! stream.openedOk())
+        return nullptr;
+
+    std::shared_ptr<EnergyMap> map (new EnergyMap());
+    if (! readHeader (stream, *map) || ! map->isCurrentFor (source))
+        return nullptr;
+
+    const int numFrames = stream.readInt();
+    if (numFrames < 0 || numFrames > stream.getNumBytesRemaining())
+        return nullptr;
+
+    map->levelsDb.resize (static_cast<size_t> (numFrames));
+    if (stream.read (map->levelsDb.data(), numFrames) != numFrames)
+        return nullptr;
+
+    map->findAudibleFrames();
+    return map;
+}
+
+bool EnergyMap::readHeader (juce::InputStream& stream, EnergyMap& map)
+{
+    if (stream.readInt() != kFileMagic || stream.readInt() != kFileVersion)
+        return false;
+
+    map.sourcePath = stream.readString();
+    map.sourceSizeBytes = stream.readInt64();
+    map.sourceModifiedMs = stream.readInt64();
+    return true;
+}
+
+bool EnergyMap::write (const juce::File& mapFile) const
+{
+    if (! mapFile.getParentDirectory().createDirectory())
+        return false;
+
+    juce::TemporaryFile temp (mapFile);
+    {
+        juce::FileOutputStream stream (temp.getFile());
+        if (! stream.openedOk())
+            return false;
+
+        stream.writeInt (kFileMagic);
+        stream.writeInt (kFileVersion);
+        stream.writeString (sourcePath);
+        stream.writeInt64 (sourceSizeBytes);
+        stream.writeInt64 (sourceModifiedMs);
+        stream.writeInt (getNumFrames());
+        stream.write (levelsDb.data(), levelsDb.size());
+        stream.flush();
+        if (stream.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+void EnergyMap::findAudibleFrames()
+{
+    audibleFrames.clear();
+    if (levelsDb.empty())
+        return;
+
+    const int peakDb = *std::max_element (levelsDb.begin(), levelsDb.end());
+    const int thresholdDb = juce::jmax (kAudibleFloorDb, peakDb - kAudibleBelowPeakDb);
+
+    for (size_t i = 0; i < levelsDb.size(); ++i)
+    {
+        if (levelsDb[i] >= thresholdDb)
+            audibleFrames.push_back (static_cast<int> (i));
+    }
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class EnergyMapTests final : public juce::UnitTest
+{
+public:
+    EnergyMapTests() : juce::UnitTest ("EnergyMap", "Slicebot") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr juce::int64 seed = 0x5eed;
+        constexpr int numPicks = 200;
+
+        // ten seconds, audible only in the middle four
+        EnergyMap map;
+        map.levelsDb.assign (1000, static_cast<int8_t> (kFloorDb));
+        std::fill (map.levelsDb.begin() + 300, map.levelsDb.begin() + 700, static_cast<int8_t> (-12));
+        map.findAudibleFrames();
+
+        const int maxStart = static_cast<int> (9.0 * sampleRate);
+
+        // the draws a cut takes between two starts, e.g. a subdivision
+        const auto cut = [&] (const EnergyMap* energyMap)
+        {
+            juce::Random random (seed);
+            std::vector<std::pair<int, int>> picks;
+            for (int i = 0; i < numPicks; ++i)
+            {
+                const int start = EnergyMap::randomStart (energyMap, random, maxStart, sampleRate);
+                picks.emplace_back (start, random.nextInt (16));
+            }
+            return picks;
+        };
+
+        beginTest ("a cut takes the same draws with and without a map");
+        {
+            const auto withoutMap = cut (nullptr);
+            const auto withMap = cut (&map);
+            const auto again = cut (&map);
+
+            int audible = 0;
+            for (int i = 0; i < numPicks; ++i)
+            {
+                const auto& plain = withoutMap[static_cast<size_t> (i)];
+                const auto& mapped = withMap[static_cast<size_t> (i)];
+                expectEquals (mapped.second, plain.second);
+                expectEquals (mapped.first, *map.audibleStartFor (plain.first, maxStart, sampleRate));
+                expect (again[static_cast<size_t> (i)] == mapped);
+
+                const int level = mapped.first / juce::roundToInt (sampleRate * EnergyMap::kFrameSeconds);
+                audible += (level >= 300 && level < 700) ? 1 : 0;
+            }
+
+            expectEquals (audible, numPicks);
+        }
+
+        beginTest ("a quiet range keeps the uniform draw");
+        {
+            juce::Random random (seed);
+            juce::Random plain (seed);
+            const int quietMax = static_cast<int> (2.0 * sampleRate);
+            expectEquals (EnergyMap::randomStart (&map, random, quietMax, sampleRate), plain.nextInt (quietMax + 1));
+        }
+    }
+};
+
+static EnergyMapTests energyMapTests;
+
+#endif
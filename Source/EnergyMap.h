@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioCacheStore.h"
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Coarse loudness envelope of one source file: RMS over 10 ms frames, in
+// whole dB. Background jobs compute it from a single decode once a
+// file is in the audio cache, then keep it next to the cache until the
+// file's size or modification time changes. Start selection uses it to avoid
+// silence, and draws uniformly for a file whose map is not built yet; either
+// way a pick takes the same draws, so the map only moves where it lands.
+class EnergyMap
+{
+public:
+    static constexpr double kFrameSeconds = 0.01;
+
+    // message or worker thread; the recently used maps are kept in memory,
+    // others are read back from disk. Never decodes the file: null when no
+    // current map has been built for it yet
+    static std::shared_ptr<const EnergyMap> findForFile (const juce::File& file);
+
+    // message thread; queues background jobs that build and save the map of
+    // every cached file without a current one, cancelling whatever a
+    // previous call left queued
+    static void buildMissing (const AudioCacheStore::CacheData& data);
+
+    // message thread; stops the queued builds and waits for the running ones
+    static void cancelBuilds();
+
+    // any thread; moves on each time a build makes a map available, so a cut
+    // can tell whether picks would still land where its own did
+    static int getGeneration();
+
+    // a random frame at sampleRate in [0, maxStartFrame]: one uniform draw,
+    // moved onto audible material when map is not null
+    static int randomStart (const EnergyMap* map, juce::Random& random, int maxStartFrame, double sampleRate);
+
+    // the frame at sampleRate inside the audible 10 ms frame whose rank among
+    // the audible ones in [0, maxStartFrame] matches uniformStart's place in
+    // that range; nullopt when the whole range is quiet
+    std::optional<int> audibleStartFor (int uniformStart, int maxStartFrame, double sampleRate) const;
+
+    int getNumFrames() const;
+    bool isCurrentFor (const juce::File& source) const;
+
+private:
+    EnergyMap() = default;
+
+    static void build (const juce::File& file);
+    static std::shared_ptr<const EnergyMap> compute (const juce::File& file);
+    static std::shared_ptr<const EnergyMap> read (const juce::File& mapFile, const juce::File& source);
+    static bool readHeader (juce::InputStream& stream, EnergyMap& map);
+    bool write (const juce::File& mapFile) const;
+    void findAudibleFrames();
+
+    juce::String sourcePath;
+    int64_t sourceSizeBytes = 0;
+    int64_t sourceModifiedMs = 0;
+    std::vector<int8_t> levelsDb;   // one per frame, clamped to [kFloorDb, 0]
+    std::vector<int> audibleFrames; // ascending indices into levelsDb
+
+    friend class EnergyMapTests;
+
+    // maps outlive the leak detector in the process-wide cache
+    JUCE_DECLARE_NON_COPYABLE (EnergyMap)
+};
@@ -88,7 +88,7 @@ bool ExportOrchestrator::exportSlices (const std::optional<SliceStateStore::Expo
         return false;
 
     const auto snapshot = stateStore.getSnapshot();
-    const auto& previewSnippetURLs = snapshot.previewSnippetURLs;
+    const auto& previewSnippetURLs = snapshot->previewSnippetURLs;
     if (previewSnippetURLs.empty())
         return false;
 
@@ -102,7 +102,7 @@ bool ExportOrchestrator::exportSlices (const std::optional<SliceStateStore::Expo
     const int retryCount = settings.sliceExportRetryCount > 0 ? settings.sliceExportRetryCount : kDefaultExportRetries;
     bool exportedAny = false;
     AudioFileIO audioFileIO;
-    const auto& sliceVolumeSettings = snapshot.sliceVolumeSettings;
+    const auto& sliceVolumeSettings = snapshot->sliceVolumeSettings;
     const int startingNumber = nextAvailableExportNumber (settings.exportPrefix, destinationDirectory);
     int exportNumber = startingNumber;
 
@@ -145,7 +145,7 @@ bool ExportOrchestrator::exportFullChainWithoutVolume (const std::optional<Slice
         return false;
 
     const auto snapshot = stateStore.getSnapshot();
-    const juce::File previewChainURL = snapshot.previewChainURL;
+    const juce::File previewChainURL = snapshot->previewChainURL;
     if (! previewChainURL.existsAsFile())
         return false;
 
@@ -171,7 +171,7 @@ bool ExportOrchestrator::exportFullChainWithVolume (const std::optional<SliceSta
         return false;
 
     const auto snapshot = stateStore.getSnapshot();
-    if (snapshot.previewSnippetURLs.empty())
+    if (snapshot->previewSnippetURLs.empty())
         return false;
 
     const juce::File destinationDirectory = settings.exportDirectory;
@@ -186,16 +186,16 @@ bool ExportOrchestrator::exportFullChainWithVolume (const std::optional<SliceSta
         destinationDirectory.getChildFile (settings.exportPrefix
                                            + "_" + juce::String (exportNumber) + "_chain.wav");
 
-    return buildVolumeChain (snapshot, destinationFile);
+    return buildVolumeChain (*snapshot, destinationFile);
 }
 
 bool ExportOrchestrator::resolveSettings (const std::optional<SliceStateStore::ExportSettings>& overrideSettings,
                                           SliceStateStore::ExportSettings& resolved) const
 {
     const auto snapshot = stateStore.getSnapshot();
-    if (snapshot.exportSettingsLocked)
+    if (snapshot->exportSettingsLocked)
     {
-        resolved = snapshot.exportSettings;
+        resolved = snapshot->exportSettings;
         return true;
     }
 
@@ -256,7 +256,7 @@ bool ExportOrchestrator::buildVolumeChain (const SliceStateStore::SliceStateSnap
 
     AudioFileIO::ConvertedAudio chainAudio;
     chainAudio.buffer = std::move (chainBuffer);
-    chainAudio.sampleRate = 44100.0;
+    chainAudio.sampleRate = audioFileIO.getTargetSampleRate();
 
     return audioFileIO.writeMonoWav16 (chainFile, chainAudio);
 }
@@ -62,7 +62,7 @@ GlobalTabView::GlobalTabView (SliceStateStore& stateStoreToUse)
     configureMergeButton (mergeCrossfadeReverse, SliceStateStore::MergeMode::crossfadeReverse);
     configureMergeButton (mergePachinko, SliceStateStore::MergeMode::pachinko);
 
-    applySettingsSnapshot (stateStore.getSnapshot());
+    applySettingsSnapshot (*stateStore.getSnapshot());
 }
 
 GlobalTabView::~GlobalTabView()
@@ -111,9 +111,9 @@ void GlobalTabView::applySettingsSnapshot (const SliceStateStore::SliceStateSnap
 void GlobalTabView::updateTransientSetting()
 {
     const auto snapshot = stateStore.getSnapshot();
-    stateStore.setSliceSettings (snapshot.bpm,
-                                 snapshot.subdivisionSteps,
-                                 snapshot.sampleCountSetting,
+    stateStore.setSliceSettings (snapshot->bpm,
+                                 snapshot->subdivisionSteps,
+                                 snapshot->sampleCountSetting,
                                  transientToggle.getToggleState());
 }
 
@@ -121,7 +121,7 @@ void GlobalTabView::updateLayeringSetting()
 {
     const auto snapshot = stateStore.getSnapshot();
     const bool isLayering = layeringToggle.getToggleState();
-    stateStore.setLayeringState (isLayering, snapshot.sampleCountSetting);
+    stateStore.setLayeringState (isLayering, snapshot->sampleCountSetting);
     updateMergeModeButtons (isLayering);
 }
 
@@ -0,0 +1,389 @@
+#include "JobScheduler.h"
+
+namespace
+{
+    constexpr int kReservedCores = 2; // the audio thread and the message thread
+    constexpr int kMaxWorkers = 8;
+    constexpr int kHelpPollMs = 1;
+
+    constexpr int indexOf (JobScheduler::Priority priority)
+    {
+        return static_cast<int> (priority);
+    }
+
+    // analysis and everything below it share the cap
+    constexpr int kAnalysisIndex = indexOf (JobScheduler::Priority::analysis);
+}
+
+struct JobScheduler::Job
+{
+    Priority priority = Priority::analysis;
+    std::function<void()> function;
+    Token token;
+    bool countedAgainstCap = false; // only touched by the thread running it
+
+    // guarded by finishLock
+    int unfinishedDependencies = 0;
+    std::vector<JobHandle> dependents;
+    bool finished = false;
+};
+
+thread_local JobScheduler::Worker* JobScheduler::currentWorker = nullptr;
+thread_local JobScheduler::Job* JobScheduler::currentJob = nullptr;
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+// Process-wide, like AppProperties; the workers are plain std::threads so
+// they can outlive JUCE's shutdown until static destruction joins them.
+JobScheduler& JobScheduler::get()
+{
+    static JobScheduler instance;
+    return instance;
+}
+
+JobScheduler::Token JobScheduler::makeToken()
+{
+    return std::make_shared<CancellationToken>();
+}
+
+JobScheduler::JobScheduler()
+{
+    const int numWorkers = juce::jlimit (1, kMaxWorkers, juce::SystemStats::getNumCpus() - kReservedCores);
+    analysisCap = juce::jmax (1, numWorkers / 2);
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.push_back (std::make_unique<Worker>());
+
+    for (auto& worker : workers)
+    {
+        auto* workerToRun = worker.get();
+        worker->thread = std::thread ([this, workerToRun] { workerLoop (*workerToRun); });
+    }
+}
+
+JobScheduler::~JobScheduler()
+{
+    {
+        const std::lock_guard<std::mutex> lock (sleepLock);
+        shuttingDown = true;
+    }
+    workAvailable.notify_all();
+
+    // jobs still queued are dropped; nothing is left to wait on them
+    for (auto& worker : workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+int JobScheduler::getNumWorkers() const
+{
+    return static_cast<int> (workers.size());
+}
+
+// =====================================================
+// SUBMITTING AND WAITING
+// =====================================================
+
+JobScheduler::JobHandle JobScheduler::submit (Priority priority,
+                                              std::function<void()> function,
+                                              Token token,
+                                              const std::vector<JobHandle>& dependencies)
+{
+    auto job = std::make_shared<Job>();
+    job->priority = priority;
+    job->function = std::move (function);
+    job->token = std::move (token);
+
+    {
+        const std::lock_guard<std::mutex> lock (finishLock);
+        for (const auto& dependency : dependencies)
+        {
+            if (dependency == nullptr || dependency->finished)
+                continue;
+
+            dependency->dependents.push_back (job);
+            ++job->unfinishedDependencies;
+        }
+
+        if (job->unfinishedDependencies > 0)
+            return job;
+    }
+
+    enqueue (job);
+    return job;
+}
+
+void JobScheduler::wait (const JobHandle& job)
+{
+    if (job == nullptr)
+        return;
+
+    // a cancelled job would only be skipped once it reached the front of its
+    // queue, behind everything queued before it; a worker runs the job it
+    // waits on itself, whatever its priority, rather than wait for another
+    const bool cancelled = job->token != nullptr && job->token->isCancelled();
+    if ((cancelled || currentWorker != nullptr) && removeQueued (job))
+    {
+        execute (job);
+        return;
+    }
+
+    if (currentWorker == nullptr)
+    {
+        std::unique_lock<std::mutex> lock (finishLock);
+        jobFinished.wait (lock, [&job] { return job->finished; });
+        return;
+    }
+
+    // helping does not add a running thread, so it ignores the analysis cap;
+    // it only takes work as urgent as the waiter's, so a slicing job never
+    // ends up running a long scan nested inside itself
+    const int lowestPriority = currentJob != nullptr ? indexOf (currentJob->priority) : kNumPriorities - 1;
+
+    while (! isFinished (job))
+    {
+        if (const auto other = takeJob (currentWorker, false, lowestPriority))
+        {
+            execute (other);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock (finishLock);
+        jobFinished.wait_for (lock, std::chrono::milliseconds (kHelpPollMs), [&job] { return job->finished; });
+    }
+}
+
+bool JobScheduler::isFinished (const JobHandle& job) const
+{
+    const std::lock_guard<std::mutex> lock (finishLock);
+    return job == nullptr || job->finished;
+}
+
+void JobScheduler::run (Priority priority, std::function<void()> function, Token token)
+{
+    wait (submit (priority, std::move (function), std::move (token)));
+}
+
+void JobScheduler::releaseAnalysisSlot()
+{
+    if (currentJob == nullptr || ! currentJob->countedAgainstCap)
+        return;
+
+    currentJob->countedAgainstCap = false;
+    runningAnalysis.fetch_sub (1);
+    wakeWorkers (true);
+}
+
+bool JobScheduler::removeQueued (const JobHandle& job)
+{
+    const auto slot = static_cast<size_t> (indexOf (job->priority));
+
+    auto removeFrom = [&] (std::mutex& lock, std::deque<JobHandle>& queue)
+    {
+        const std::lock_guard<std::mutex> guard (lock);
+        const auto found = std::find (queue.begin(), queue.end(), job);
+        if (found == queue.end())
+            return false;
+
+        queue.erase (found);
+        return true;
+    };
+
+    bool removed = removeFrom (sharedLock, sharedQueues[slot]);
+    for (size_t i = 0; ! removed && i < workers.size(); ++i)
+        removed = removeFrom (workers[i]->lock, workers[i]->queues[slot]);
+
+    if (removed)
+        queuedCounts[slot].fetch_sub (1);
+
+    return removed;
+}
+
+// =====================================================
+// WORKERS
+// =====================================================
+
+void JobScheduler::enqueue (const JobHandle& job)
+{
+    const int priority = indexOf (job->priority);
+
+    // a job submitted from a worker stays on that worker until stolen
+    if (currentWorker != nullptr)
+    {
+        const std::lock_guard<std::mutex> lock (currentWorker->lock);
+        currentWorker->queues[static_cast<size_t> (priority)].push_back (job);
+    }
+    else
+    {
+        const std::lock_guard<std::mutex> lock (sharedLock);
+        sharedQueues[static_cast<size_t> (priority)].push_back (job);
+    }
+
+    queuedCounts[static_cast<size_t> (priority)].fetch_add (1);
+    wakeWorkers (false);
+}
+
+void JobScheduler::workerLoop (Worker& worker)
+{
+    currentWorker = &worker;
+
+    while (true)
+    {
+        if (const auto job = takeJob (&worker, true))
+        {
+            execute (job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock (sleepLock);
+        workAvailable.wait (lock, [this] { return shuttingDown || hasRunnableWork(); });
+        if (shuttingDown)
+            return;
+    }
+}
+
+JobScheduler::JobHandle JobScheduler::takeJob (Worker* worker, bool respectAnalysisCap, int lowestPriority)
+{
+    auto popFront = [] (std::mutex& lock, std::deque<JobHandle>& queue) -> JobHandle
+    {
+        const std::lock_guard<std::mutex> guard (lock);
+        if (queue.empty())
+            return {};
+
+        auto job = std::move (queue.front());
+        queue.pop_front();
+        return job;
+    };
+
+    const auto ownIndex = worker != nullptr
+                              ? std::find_if (workers.begin(), workers.end(),
+                                              [worker] (const auto& w) { return w.get() == worker; }) - workers.begin()
+                              : 0;
+
+    for (int priority = 0; priority <= lowestPriority; ++priority)
+    {
+        const auto slot = static_cast<size_t> (priority);
+        if (queuedCounts[slot].load() <= 0)
+            continue;
+
+        const bool capped = respectAnalysisCap && priority >= kAnalysisIndex;
+        if (capped && runningAnalysis.fetch_add (1) >= analysisCap)
+        {
+            runningAnalysis.fetch_sub (1);
+            continue;
+        }
+
+        JobHandle job;
+
+        // own work newest first, while it is still in cache
+        if (worker != nullptr)
+        {
+            const std::lock_guard<std::mutex> guard (worker->lock);
+            auto& queue = worker->queues[slot];
+            if (! queue.empty())
+            {
+                job = std::move (queue.back());
+                queue.pop_back();
+            }
+        }
+
+        if (job == nullptr)
+            job = popFront (sharedLock, sharedQueues[slot]);
+
+        // steal the oldest, starting with the next worker along
+        for (size_t i = 1; job == nullptr && i <= workers.size(); ++i)
+        {
+            auto& victim = *workers[(static_cast<size_t> (ownIndex) + i) % workers.size()];
+            if (&victim != worker)
+                job = popFront (victim.lock, victim.queues[slot]);
+        }
+
+        if (job != nullptr)
+        {
+            queuedCounts[slot].fetch_sub (1);
+            job->countedAgainstCap = capped;
+            return job;
+        }
+
+        if (capped)
+            runningAnalysis.fetch_sub (1);
+    }
+
+    return {};
+}
+
+void JobScheduler::execute (const JobHandle& job)
+{
+    // a job run while waiting inside another nests within it
+    auto* const outerJob = currentJob;
+    currentJob = job.get();
+
+    if (job->token == nullptr || ! job->token->isCancelled())
+        job->function();
+
+    currentJob = outerJob;
+
+    // the captures may own large buffers; release them with the job done
+    job->function = nullptr;
+
+    if (job->countedAgainstCap)
+    {
+        runningAnalysis.fetch_sub (1);
+        wakeWorkers (true);
+    }
+
+    finish (job);
+}
+
+void JobScheduler::finish (const JobHandle& job)
+{
+    std::vector<JobHandle> ready;
+    {
+        const std::lock_guard<std::mutex> lock (finishLock);
+        job->finished = true;
+
+        for (auto& dependent : job->dependents)
+        {
+            if (--dependent->unfinishedDependencies == 0)
+                ready.push_back (std::move (dependent));
+        }
+
+        job->dependents.clear();
+    }
+
+    jobFinished.notify_all();
+
+    for (const auto& dependent : ready)
+        enqueue (dependent);
+}
+
+bool JobScheduler::hasRunnableWork() const
+{
+    for (int priority = 0; priority < kNumPriorities; ++priority)
+    {
+        if (queuedCounts[static_cast<size_t> (priority)].load() <= 0)
+            continue;
+
+        if (priority < kAnalysisIndex || runningAnalysis.load() < analysisCap)
+            return true;
+    }
+
+    return false;
+}
+
+void JobScheduler::wakeWorkers (bool all)
+{
+    // taking the lock orders this wake after any worker's check of the counts
+    {
+        const std::lock_guard<std::mutex> lock (sleepLock);
+    }
+
+    if (all)
+        workAvailable.notify_all();
+    else
+        workAvailable.notify_one();
+}
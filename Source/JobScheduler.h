@@ -0,0 +1,123 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The app's one pool of worker threads. Every worker keeps a queue per
+// priority; a worker that runs dry takes from the shared queue and then
+// steals from the other workers, always trying the highest priority first.
+// There are fewer workers than cores, so the audio and message threads
+// always have one each, and analysis and background work together never
+// hold more than half of the workers.
+class JobScheduler
+{
+public:
+    // highest first
+    enum class Priority
+    {
+        interactive, // preview and anything else the user is listening for
+        slicing,
+        exporting,
+        analysis,    // cache scans and other work the user is waiting to see
+        background   // energy maps and anything else nobody is waiting on
+    };
+
+    // shared by whoever may cancel and the jobs it covers; a job whose token
+    // is cancelled before it starts is skipped, a running one polls it
+    class CancellationToken
+    {
+    public:
+        void cancel()             { cancelled.store (true); }
+        bool isCancelled() const  { return cancelled.load(); }
+
+    private:
+        std::atomic<bool> cancelled { false };
+    };
+
+    using Token = std::shared_ptr<CancellationToken>;
+
+    struct Job;
+    using JobHandle = std::shared_ptr<Job>;
+
+    static JobScheduler& get();
+
+    static Token makeToken();
+
+    // queued once every dependency has finished, whether it ran or was
+    // skipped; a job cancelled this way does not cancel its dependents
+    JobHandle submit (Priority priority,
+                      std::function<void()> function,
+                      Token token = {},
+                      const std::vector<JobHandle>& dependencies = {});
+
+    // a worker that waits runs the job itself if it is still queued, and
+    // other queued jobs of its own priority or higher meanwhile, so a job
+    // may wait on jobs it submitted. Waiting on a queued job whose token is
+    // cancelled takes it out of its queue and finishes it at once
+    void wait (const JobHandle& job);
+    bool isFinished (const JobHandle& job) const;
+
+    // submit and wait, for callers that need the work done before they return
+    void run (Priority priority, std::function<void()> function, Token token = {});
+
+    // called from a running analysis job that only hands work out (walks a
+    // folder, then waits on the jobs it submitted): it stops counting
+    // against the analysis cap, so those jobs can run beside it. Does
+    // nothing on any other thread or job
+    void releaseAnalysisSlot();
+
+    int getNumWorkers() const;
+
+private:
+    static constexpr int kNumPriorities = 5;
+
+    struct Worker
+    {
+        std::mutex lock;
+        std::array<std::deque<JobHandle>, kNumPriorities> queues;
+        std::thread thread;
+    };
+
+    JobScheduler();
+    ~JobScheduler();
+
+    void workerLoop (Worker& worker);
+    JobHandle takeJob (Worker* worker, bool respectAnalysisCap, int lowestPriority = kNumPriorities - 1);
+    void execute (const JobHandle& job);
+    void enqueue (const JobHandle& job);
+    void finish (const JobHandle& job);
+    bool removeQueued (const JobHandle& job);
+    bool hasRunnableWork() const;
+    void wakeWorkers (bool all);
+
+    static thread_local Worker* currentWorker;
+    static thread_local Job* currentJob; // innermost job this thread is running
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    int analysisCap = 1;
+
+    std::mutex sharedLock;
+    std::array<std::deque<JobHandle>, kNumPriorities> sharedQueues;
+
+    std::array<std::atomic<int>, kNumPriorities> queuedCounts {};
+    std::atomic<int> runningAnalysis { 0 };
+
+    std::mutex sleepLock;
+    std::condition_variable workAvailable;
+    bool shuttingDown = false; // guarded by sleepLock
+
+    // guards every job's finished flag, dependents and dependency count
+    mutable std::mutex finishLock;
+    std::condition_variable jobFinished;
+
+    JUCE_DECLARE_NON_COPYABLE (JobScheduler)
+};
@@ -0,0 +1,228 @@
+#include "LatchQueue.h"
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+bool LatchQueue::request (Command command)
+{
+    if (command == Command::none)
+        return false;
+
+    // counted before it is visible, so the start is pending until the audio
+    // thread has reached or dropped it
+    if (command == Command::start)
+        startsPending.fetch_add (1);
+
+    const auto scope = fifo.write (1);
+    if (scope.blockSize1 > 0)
+    {
+        commands[static_cast<size_t> (scope.startIndex1)] = command;
+        return true;
+    }
+
+    if (scope.blockSize2 > 0)
+    {
+        commands[static_cast<size_t> (scope.startIndex2)] = command;
+        return true;
+    }
+
+    if (command == Command::start)
+        startsPending.fetch_sub (1);
+
+    return false;
+}
+
+bool LatchQueue::isStartPending() const
+{
+    return startsPending.load() > 0;
+}
+
+void LatchQueue::stopFinalised()
+{
+    stopUnfinalised.store (false);
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+bool LatchQueue::hasRequests() const
+{
+    return fifo.getNumReady() > 0;
+}
+
+void LatchQueue::scheduleRequests (juce::int64 targetSample)
+{
+    while (fifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (1, start1, size1, start2, size2);
+        const auto command = commands[static_cast<size_t> (size1 > 0 ? start1 : start2)];
+
+        if (command == Command::start
+            && (scheduledCommand == Command::stop || stopUnfinalised.load()))
+            return;
+
+        fifo.finishedRead (1);
+        schedule (command, targetSample);
+    }
+}
+
+void LatchQueue::schedule (Command command, juce::int64 targetSample)
+{
+    if (command == Command::start)
+    {
+        // already starting; the recorders cannot start twice
+        if (scheduledCommand == Command::start)
+        {
+            startsPending.fetch_sub (1);
+            return;
+        }
+
+        scheduledCommand = Command::start;
+        scheduledSample = targetSample;
+        return;
+    }
+
+    // a start not reached yet is dropped; the stop still runs, so whatever
+    // an earlier start is recording stops with it
+    if (scheduledCommand == Command::start)
+        startsPending.fetch_sub (1);
+
+    // a second stop does not put off the first
+    if (scheduledCommand != Command::stop)
+        scheduledSample = targetSample;
+
+    scheduledCommand = Command::stop;
+}
+
+LatchQueue::BlockEvents LatchQueue::getBlockEvents (juce::int64 blockStart, int numSamples) const
+{
+    BlockEvents events;
+    if (scheduledCommand == Command::none || scheduledSample - blockStart >= numSamples)
+        return events;
+
+    const int offset = static_cast<int> (juce::jmax<juce::int64> (0, scheduledSample - blockStart));
+    if (scheduledCommand == Command::start)
+        events.startOffset = offset;
+    else
+        events.stopOffset = offset;
+
+    return events;
+}
+
+void LatchQueue::completeBlock (const BlockEvents& events)
+{
+    if (events.startOffset >= 0)
+    {
+        scheduledCommand = Command::none;
+        startsPending.fetch_sub (1);
+    }
+
+    // signalled even when no recorder was armed, so every stop completes
+    if (events.stopOffset >= 0)
+    {
+        scheduledCommand = Command::none;
+        stopUnfinalised.store (true);
+        stopCompleted.store (true);
+    }
+}
+
+bool LatchQueue::takeCompletedStop()
+{
+    return stopCompleted.exchange (false);
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class LatchQueueTests final : public juce::UnitTest
+{
+public:
+    LatchQueueTests() : juce::UnitTest ("LatchQueue", "Slicebot") {}
+
+    void runTest() override
+    {
+        constexpr int blockSize = 64;
+
+        beginTest ("a stop then a start in one block both run, in order");
+        {
+            LatchQueue queue;
+            juce::int64 blockStart = 0;
+
+            expect (queue.request (Command::start));
+            expectEquals (runBlock (queue, blockStart, blockSize).startOffset, 0);
+
+            expect (queue.request (Command::stop));
+            expect (queue.request (Command::start));
+            expect (queue.isStartPending());
+
+            const auto stopBlock = runBlock (queue, blockStart, blockSize);
+            expectEquals (stopBlock.stopOffset, 0);
+            expectEquals (stopBlock.startOffset, -1);
+            expect (queue.takeCompletedStop());
+
+            // the start waits for the stopped takes to be finalised
+            expectEquals (runBlock (queue, blockStart, blockSize).startOffset, -1);
+            expect (queue.isStartPending());
+
+            queue.stopFinalised();
+            expectEquals (runBlock (queue, blockStart, blockSize).startOffset, 0);
+            expect (! queue.isStartPending());
+        }
+
+        beginTest ("a stop before a scheduled start is reached cancels it");
+        {
+            LatchQueue queue;
+            juce::int64 blockStart = 0;
+
+            expect (queue.request (Command::start));
+            queue.scheduleRequests (4 * blockSize);
+            expect (queue.request (Command::stop));
+
+            const auto events = runBlock (queue, blockStart, blockSize);
+            expectEquals (events.startOffset, -1);
+            expectEquals (events.stopOffset, 0);
+            expect (queue.takeCompletedStop());
+            expect (! queue.isStartPending());
+
+            queue.stopFinalised();
+            for (int block = 0; block < 8; ++block)
+                expectEquals (runBlock (queue, blockStart, blockSize).startOffset, -1);
+        }
+
+        beginTest ("commands land at their sample in the block");
+        {
+            LatchQueue queue;
+            juce::int64 blockStart = 0;
+
+            expect (queue.request (Command::stop));
+            queue.scheduleRequests (blockSize + 10);
+            expectEquals (runBlock (queue, blockStart, blockSize).stopOffset, -1);
+            expectEquals (runBlock (queue, blockStart, blockSize).stopOffset, 10);
+        }
+    }
+
+private:
+    using Command = LatchQueue::Command;
+
+    // what the audio callback does with the queue in one block
+    static LatchQueue::BlockEvents runBlock (LatchQueue& queue, juce::int64& blockStart, int numSamples)
+    {
+        if (queue.hasRequests())
+            queue.scheduleRequests (blockStart);
+
+        const auto events = queue.getBlockEvents (blockStart, numSamples);
+        queue.completeBlock (events);
+        blockStart += numSamples;
+        return events;
+    }
+};
+
+static LatchQueueTests latchQueueTests;
+
+#endif
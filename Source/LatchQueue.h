@@ -0,0 +1,80 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+// Latched start and stop requests, handed from the message thread to the
+// audio thread. Requests queue in order and the audio thread schedules each
+// at a sample position; none is ever overwritten by the next.
+//
+// At most one command is scheduled at a time. A stop replaces a start that
+// has not been reached yet. A start waits in the queue while a stop is
+// scheduled or its takes have not been finalised, so it never lands on
+// recorders the stop has not finished with.
+class LatchQueue
+{
+public:
+    static constexpr int kCapacity = 16;
+
+    enum class Command
+    {
+        none = 0,
+        start = 1,
+        stop = 2
+    };
+
+    // where the scheduled command falls in one block, or -1
+    struct BlockEvents
+    {
+        int startOffset = -1;
+        int stopOffset = -1;
+    };
+
+    LatchQueue() = default;
+
+    // =====================================================
+    // MESSAGE THREAD
+    // =====================================================
+    // false when the queue is full, i.e. the device is not running
+    bool request (Command command);
+
+    // a start has been requested and not yet reached or cancelled
+    bool isStartPending() const;
+
+    // the takes of a completed stop have been finalised; a waiting start
+    // can be scheduled from the next block
+    void stopFinalised();
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    bool hasRequests() const;
+
+    // takes every request that can be scheduled now, each at targetSample
+    void scheduleRequests (juce::int64 targetSample);
+
+    BlockEvents getBlockEvents (juce::int64 blockStart, int numSamples) const;
+
+    // after the block has been processed with the events getBlockEvents gave
+    void completeBlock (const BlockEvents& events);
+
+    // true once for every stop the audio thread has reached
+    bool takeCompletedStop();
+
+private:
+    void schedule (Command command, juce::int64 targetSample);
+
+    juce::AbstractFifo fifo { kCapacity };
+    std::array<Command, kCapacity> commands {};
+
+    // audio thread
+    Command scheduledCommand = Command::none;
+    juce::int64 scheduledSample = 0;
+
+    std::atomic<int> startsPending { 0 };
+    std::atomic<bool> stopUnfinalised { false };
+    std::atomic<bool> stopCompleted { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LatchQueue)
+};
@@ -0,0 +1,304 @@
+#include "LevelMeter.h"
+#include "SampleSum.h"
+#include <cmath>
+
+namespace
+{
+    constexpr double kRmsIntegrationSeconds = 0.3;
+    constexpr double kPeakDecayDbPerSecond = 20.0;
+    constexpr double kSubBlockSeconds = 0.1;
+    constexpr int kMaxReadAttempts = 8;
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+LevelMeter::LevelMeter()
+{
+    // windowed-sinc interpolator split into its polyphase branches, each
+    // normalised to unity gain at DC
+    constexpr int numTaps = kOversampling * kTapsPerPhase;
+    const double centre = (numTaps - 1) * 0.5;
+    const double pi = juce::MathConstants<double>::pi;
+
+    for (int phase = 0; phase < kOversampling; ++phase)
+    {
+        auto& taps = phaseTaps[static_cast<size_t> (phase)];
+        double sum = 0.0;
+
+        for (int k = 0; k < kTapsPerPhase; ++k)
+        {
+            const int n = phase + k * kOversampling;
+            const double x = (n - centre) / kOversampling;
+            const double sinc = x == 0.0 ? 1.0 : std::sin (pi * x) / (pi * x);
+            const double window = 0.42 - 0.5 * std::cos (2.0 * pi * n / (numTaps - 1))
+                                  + 0.08 * std::cos (4.0 * pi * n / (numTaps - 1));
+            taps[static_cast<size_t> (k)] = static_cast<float> (sinc * window);
+            sum += taps[static_cast<size_t> (k)];
+        }
+
+        for (auto& tap : taps)
+            tap = static_cast<float> (tap / sum);
+    }
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void LevelMeter::prepare (double newSampleRate, int newMaxBlockSize, int maxChannels)
+{
+    sampleRate = newSampleRate;
+    maxBlockSize = juce::jmax (1, newMaxBlockSize);
+    numPreparedChannels = juce::jmax (0, maxChannels);
+
+    filterStates.assign (static_cast<size_t> (numPreparedChannels), {});
+    chunkChannels.assign (static_cast<size_t> (numPreparedChannels), nullptr);
+    truePeakHistory.setSize (juce::jmax (1, numPreparedChannels), kTapsPerPhase - 1);
+    scratch.setSize (4, maxBlockSize + kTapsPerPhase - 1);
+
+    if (sampleRate > 0.0)
+    {
+        // BS.1770 K-weighting (high shelf, then RLB high-pass) redesigned
+        // for the device rate from the standard's analogue prototypes
+        const double pi = juce::MathConstants<double>::pi;
+        {
+            const double f0 = 1681.974450955533;
+            const double q = 0.7071752369554196;
+            const double k = std::tan (pi * f0 / sampleRate);
+            const double vh = std::pow (10.0, 3.999843853973347 / 20.0);
+            const double vb = std::pow (vh, 0.4996667741545416);
+            const double a0 = 1.0 + k / q + k * k;
+            shelf = { (vh + vb * k / q + k * k) / a0,
+                      2.0 * (k * k - vh) / a0,
+                      (vh - vb * k / q + k * k) / a0,
+                      2.0 * (k * k - 1.0) / a0,
+                      (1.0 - k / q + k * k) / a0 };
+        }
+        {
+            const double f0 = 38.13547087602444;
+            const double q = 0.5003270373238773;
+            const double k = std::tan (pi * f0 / sampleRate);
+            const double a0 = 1.0 + k / q + k * k;
+            highPass = { 1.0, -2.0, 1.0,
+                         2.0 * (k * k - 1.0) / a0,
+                         (1.0 - k / q + k * k) / a0 };
+        }
+
+        subBlockSamples = juce::jmax (1, juce::roundToInt (sampleRate * kSubBlockSeconds));
+    }
+
+    hasHistory = true;
+    clear();
+}
+
+void LevelMeter::process (const float* const* channels, int numChannels, int numSamples)
+{
+    numChannels = juce::jmin (numChannels, numPreparedChannels);
+    if (numChannels <= 0 || numSamples <= 0 || sampleRate <= 0.0)
+        return;
+
+    // devices may deliver more than the block size they were opened with
+    for (int offset = 0; offset < numSamples; offset += maxBlockSize)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            chunkChannels[static_cast<size_t> (ch)] = channels[ch] + offset;
+
+        processChunk (chunkChannels.data(), numChannels, juce::jmin (maxBlockSize, numSamples - offset));
+    }
+
+    hasHistory = true;
+    publish();
+}
+
+void LevelMeter::clear()
+{
+    if (! hasHistory)
+        return;
+
+    for (auto& states : filterStates)
+        states = {};
+
+    truePeakHistory.clear();
+    meanSquare = 0.0;
+    peakHold = 0.0f;
+    truePeakHold = 0.0f;
+    subBlockFill = 0;
+    subBlockEnergy = 0.0;
+    shortTermEnergy.fill (0.0);
+    shortTermWrite = 0;
+    shortTermFill = 0;
+    shortTermLufs = kSilenceLufs;
+
+    hasHistory = false;
+    publish();
+}
+
+void LevelMeter::processChunk (const float* const* channels, int numChannels, int numSamples)
+{
+    auto* energy = scratch.getWritePointer (0);
+    auto* work = scratch.getWritePointer (1);
+    juce::FloatVectorOperations::clear (energy, numSamples);
+
+    float blockPeak = 0.0f;
+    float blockTruePeak = 0.0f;
+    double sumSquares = 0.0;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* source = channels[ch];
+
+        const auto range = juce::FloatVectorOperations::findMinAndMax (source, numSamples);
+        blockPeak = juce::jmax (blockPeak, -range.getStart(), range.getEnd());
+
+        juce::FloatVectorOperations::multiply (work, source, source, numSamples);
+        sumSquares += sumOfSamples (work, numSamples);
+
+        blockTruePeak = juce::jmax (blockTruePeak, processTruePeak (ch, source, numSamples));
+
+        juce::FloatVectorOperations::copy (work, source, numSamples);
+        applyKWeighting (ch, work, numSamples);
+        juce::FloatVectorOperations::multiply (work, work, numSamples);
+        juce::FloatVectorOperations::add (energy, work, numSamples);
+    }
+
+    // RMS integrates exponentially; peaks jump up and fall at a fixed dB rate
+    const double blockMeanSquare = sumSquares / (static_cast<double> (numSamples) * numChannels);
+    const double integration = std::exp (-numSamples / (kRmsIntegrationSeconds * sampleRate));
+    meanSquare = blockMeanSquare + integration * (meanSquare - blockMeanSquare);
+
+    const auto release = static_cast<float> (
+        std::pow (10.0, -kPeakDecayDbPerSecond * numSamples / (20.0 * sampleRate)));
+    peakHold = juce::jmax (blockPeak, peakHold * release);
+    truePeakHold = juce::jmax (blockPeak, blockTruePeak, truePeakHold * release);
+
+    accumulateLoudness (energy, numSamples);
+}
+
+float LevelMeter::processTruePeak (int channel, const float* source, int numSamples)
+{
+    constexpr int historySize = kTapsPerPhase - 1;
+    auto* extended = scratch.getWritePointer (2);
+    auto* phaseOutput = scratch.getWritePointer (3);
+    auto* history = truePeakHistory.getWritePointer (channel);
+
+    juce::FloatVectorOperations::copy (extended, history, historySize);
+    juce::FloatVectorOperations::copy (extended + historySize, source, numSamples);
+
+    // each phase is one interpolated point between consecutive inputs:
+    // y[n] = sum of taps[k] * x[n - k], with x[n] at extended[historySize + n]
+    float peak = 0.0f;
+    for (const auto& taps : phaseTaps)
+    {
+        juce::FloatVectorOperations::copyWithMultiply (phaseOutput, extended + historySize, taps[0], numSamples);
+        for (int k = 1; k < kTapsPerPhase; ++k)
+            juce::FloatVectorOperations::addWithMultiply (phaseOutput,
+                                                          extended + historySize - k,
+                                                          taps[static_cast<size_t> (k)],
+                                                          numSamples);
+
+        const auto range = juce::FloatVectorOperations::findMinAndMax (phaseOutput, numSamples);
+        peak = juce::jmax (peak, -range.getStart(), range.getEnd());
+    }
+
+    juce::FloatVectorOperations::copy (history, extended + numSamples, historySize);
+    return peak;
+}
+
+void LevelMeter::applyKWeighting (int channel, float* samples, int numSamples)
+{
+    auto& states = filterStates[static_cast<size_t> (channel)];
+
+    for (int stage = 0; stage < 2; ++stage)
+    {
+        const auto& filter = stage == 0 ? shelf : highPass;
+        double z1 = states[static_cast<size_t> (stage)].z1;
+        double z2 = states[static_cast<size_t> (stage)].z2;
+
+        // transposed direct form II
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double x = samples[i];
+            const double y = filter.b0 * x + z1;
+            z1 = filter.b1 * x - filter.a1 * y + z2;
+            z2 = filter.b2 * x - filter.a2 * y;
+            samples[i] = static_cast<float> (y);
+        }
+
+        states[static_cast<size_t> (stage)].z1 = z1;
+        states[static_cast<size_t> (stage)].z2 = z2;
+    }
+}
+
+void LevelMeter::accumulateLoudness (const float* energy, int numSamples)
+{
+    int offset = 0;
+    while (offset < numSamples)
+    {
+        const int count = juce::jmin (numSamples - offset, subBlockSamples - subBlockFill);
+        subBlockEnergy += sumOfSamples (energy + offset, count);
+        subBlockFill += count;
+        offset += count;
+
+        if (subBlockFill < subBlockSamples)
+            break;
+
+        shortTermEnergy[static_cast<size_t> (shortTermWrite)] = subBlockEnergy / subBlockSamples;
+        shortTermWrite = (shortTermWrite + 1) % kShortTermBlocks;
+        shortTermFill = juce::jmin (shortTermFill + 1, kShortTermBlocks);
+        subBlockEnergy = 0.0;
+        subBlockFill = 0;
+
+        // short-term loudness is the ungated mean over the last 3 s
+        double total = 0.0;
+        for (int i = 0; i < shortTermFill; ++i)
+            total += shortTermEnergy[static_cast<size_t> (i)];
+
+        const double meanEnergy = total / shortTermFill;
+        shortTermLufs = meanEnergy > 0.0
+                            ? juce::jmax (kSilenceLufs, static_cast<float> (-0.691 + 10.0 * std::log10 (meanEnergy)))
+                            : kSilenceLufs;
+    }
+}
+
+void LevelMeter::publish()
+{
+    // odd while the values are being replaced
+    const auto current = sequence.load (std::memory_order_relaxed);
+    sequence.store (current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    publishedRms.store (static_cast<float> (std::sqrt (meanSquare)), std::memory_order_relaxed);
+    publishedPeak.store (peakHold, std::memory_order_relaxed);
+    publishedTruePeak.store (truePeakHold, std::memory_order_relaxed);
+    publishedLufs.store (shortTermLufs, std::memory_order_relaxed);
+
+    sequence.store (current + 2, std::memory_order_release);
+}
+
+// =====================================================
+// ANY THREAD
+// =====================================================
+
+LevelMeter::Reading LevelMeter::getReading() const
+{
+    // the writer holds the sequence odd for four stores, so a retry is rare;
+    // if every attempt collides the last values read are still per-field exact
+    Reading reading;
+    for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt)
+    {
+        const auto before = sequence.load (std::memory_order_acquire);
+
+        reading.rms = publishedRms.load (std::memory_order_relaxed);
+        reading.peak = publishedPeak.load (std::memory_order_relaxed);
+        reading.truePeak = publishedTruePeak.load (std::memory_order_relaxed);
+        reading.shortTermLufs = publishedLufs.load (std::memory_order_relaxed);
+
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if ((before & 1u) == 0 && sequence.load (std::memory_order_relaxed) == before)
+            break;
+    }
+
+    return reading;
+}
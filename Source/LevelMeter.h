@@ -0,0 +1,98 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Multichannel level meter for the device callback: RMS and sample peak with
+// meter ballistics, 4x oversampled true peak and short-term (3 s) loudness
+// after BS.1770 K-weighting. The audio thread publishes a Reading through a
+// sequence counter so any other thread gets all four values from the same
+// block without ever blocking the writer.
+class LevelMeter
+{
+public:
+    static constexpr float kSilenceLufs = -70.0f;
+
+    struct Reading
+    {
+        float rms = 0.0f;       // linear, 300 ms integration
+        float peak = 0.0f;      // linear sample peak with decay
+        float truePeak = 0.0f;  // linear inter-sample peak with decay
+        float shortTermLufs = kSilenceLufs;
+    };
+
+    LevelMeter();
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    // prepare is called while the device is stopped
+    void prepare (double sampleRate, int maxBlockSize, int maxChannels);
+
+    // channels beyond the prepared count are ignored
+    void process (const float* const* channels, int numChannels, int numSamples);
+
+    // drops all history and publishes silence
+    void clear();
+
+    // =====================================================
+    // ANY THREAD
+    // =====================================================
+    Reading getReading() const;
+
+private:
+    static constexpr int kOversampling = 4;
+    static constexpr int kTapsPerPhase = 12;
+    static constexpr int kShortTermBlocks = 30; // 100 ms each
+
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    struct BiquadState
+    {
+        double z1 = 0.0, z2 = 0.0;
+    };
+
+    void processChunk (const float* const* channels, int numChannels, int numSamples);
+    float processTruePeak (int channel, const float* source, int numSamples);
+    void applyKWeighting (int channel, float* samples, int numSamples);
+    void accumulateLoudness (const float* energy, int numSamples);
+    void publish();
+
+    // audio thread
+    double sampleRate = 0.0;
+    int maxBlockSize = 0;
+    int numPreparedChannels = 0;
+    std::array<std::array<float, kTapsPerPhase>, kOversampling> phaseTaps {};
+    Biquad shelf;
+    Biquad highPass;
+    std::vector<std::array<BiquadState, 2>> filterStates;
+    std::vector<const float*> chunkChannels;
+    juce::AudioBuffer<float> truePeakHistory; // last kTapsPerPhase - 1 inputs per channel
+    juce::AudioBuffer<float> scratch;         // 0: K-weighted energy, 1: work, 2: history + block, 3: phase output
+
+    bool hasHistory = false;
+    double meanSquare = 0.0;
+    float peakHold = 0.0f;
+    float truePeakHold = 0.0f;
+    int subBlockSamples = 0;
+    int subBlockFill = 0;
+    double subBlockEnergy = 0.0;
+    std::array<double, kShortTermBlocks> shortTermEnergy {};
+    int shortTermWrite = 0;
+    int shortTermFill = 0;
+    float shortTermLufs = kSilenceLufs;
+
+    // published
+    std::atomic<juce::uint32> sequence { 0 };
+    std::atomic<float> publishedRms { 0.0f };
+    std::atomic<float> publishedPeak { 0.0f };
+    std::atomic<float> publishedTruePeak { 0.0f };
+    std::atomic<float> publishedLufs { kSilenceLufs };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
+};
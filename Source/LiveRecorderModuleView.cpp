@@ -8,11 +8,14 @@
 static constexpr int kModuleW = 120;
 static constexpr int kModuleH = 150;
 static constexpr double kMinSeconds = 25.0;
-static constexpr double kMaxRecordSeconds = 600.0;
 static constexpr float kMinGainDb = AudioEngine::kRecorderMinGainDb;
 static constexpr float kMaxGainDb = AudioEngine::kRecorderMaxGainDb;
 static constexpr float kMeterMinDb = -40.0f;
 static constexpr float kMeterMaxDb = 0.0f;
+static constexpr int kStereoItemOffset = 1000; // channel box ids above this are stereo pairs
+static constexpr int kCaptureToggleItemId = 1;
+static constexpr int kCaptureItemOffset = 100; // capture menu ids above this are seconds to keep
+static constexpr int kCaptureMenuSeconds[] = { 10, 30, 60 };
 
 // =====================================================
 // CONSTRUCTION
@@ -98,7 +101,7 @@ LiveRecorderModuleView::~LiveRecorderModuleView()
 }
 
 // =====================================================
-// PAINT (BACKGROUND + VU ONLY)
+// PAINT (BACKGROUND, VU + WAVEFORM)
 // =====================================================
 
 void LiveRecorderModuleView::paint (juce::Graphics& g)
@@ -120,6 +123,17 @@ void LiveRecorderModuleView::paint (juce::Graphics& g)
                 int (meterBounds.getWidth() * juce::jlimit (0.0f, 1.0f, rms)),
                 meterBounds.getHeight());
 
+    // the last 3 s of loudness, as a tick along the bottom of the meter
+    if (loudness > 0.0f)
+    {
+        const int loudnessX = meterBounds.getX() + int (meterBounds.getWidth() * loudness);
+        g.setColour (juce::Colours::orange);
+        g.fillRect (loudnessX - 1,
+                    meterBounds.getCentreY(),
+                    2,
+                    meterBounds.getBottom() - meterBounds.getCentreY());
+    }
+
     const float gainPos =
         juce::jlimit (0.0f, 1.0f, gainPosition);
     const int lineX = meterBounds.getX() + int (meterBounds.getWidth() * gainPos);
@@ -153,6 +167,33 @@ void LiveRecorderModuleView::paint (juce::Graphics& g)
         g.setColour (juce::Colours::white);
         g.fillRect (progressBounds.withWidth (int (progressBounds.getWidth() * progress)));
     }
+
+    paintWaveform (g);
+}
+
+void LiveRecorderModuleView::paintWaveform (juce::Graphics& g) const
+{
+    if (waveformBounds.getHeight() <= 0)
+        return;
+
+    g.setColour (juce::Colours::black.withAlpha (0.85f));
+    g.fillRect (waveformBounds);
+
+    // newest column on the right edge
+    const int columns = juce::jmin (waveformFill, waveformBounds.getWidth());
+    const float centreY = waveformBounds.toFloat().getCentreY();
+    const float halfHeight = waveformBounds.getHeight() * 0.5f;
+    const int startX = waveformBounds.getRight() - columns;
+
+    g.setColour (isRecording ? juce::Colours::red : juce::Colours::white.withAlpha (0.6f));
+    for (int i = 0; i < columns; ++i)
+    {
+        const auto& column = waveformColumns[static_cast<size_t> (
+            (waveformWrite - columns + i + kWaveformColumns) % kWaveformColumns)];
+        const float top = centreY - juce::jlimit (0.0f, 1.0f, column.max) * halfHeight;
+        const float bottom = centreY - juce::jlimit (-1.0f, 0.0f, column.min) * halfHeight;
+        g.fillRect (float (startX + i), top, 1.0f, juce::jmax (1.0f, bottom - top));
+    }
 }
 
 // =====================================================
@@ -193,9 +234,12 @@ void LiveRecorderModuleView::resized()
     const int meterHeight = 12;
     const int meterY = getHeight() - padding - meterHeight;
     const int progressY = meterY - gap - progressHeight;
-    const int bigButtonHeight = progressY - bigButtonY - gap;
+    const int centreHeight = progressY - bigButtonY - gap;
+    const int waveformHeight = centreHeight / 3;
+    const int bigButtonHeight = centreHeight - waveformHeight - gap;
 
     timeCounter.setBounds (leftX, bigButtonY, contentWidth, bigButtonHeight);
+    waveformBounds = { leftX, bigButtonY + bigButtonHeight + gap, contentWidth, waveformHeight };
     progressBounds = { leftX, progressY, contentWidth, progressHeight };
     meterBounds = { leftX, meterY, contentWidth, meterHeight };
 }
@@ -214,6 +258,16 @@ void LiveRecorderModuleView::refreshInputChannels()
     for (const auto& ch : activeInputs)
         channelBox.addItem (ch.name, ch.physicalIndex + 1);
 
+    // neighbouring odd/even inputs also appear as stereo pairs
+    for (int i = 0; i + 1 < activeInputs.size(); ++i)
+    {
+        const auto& left = activeInputs.getReference (i);
+        const auto& right = activeInputs.getReference (i + 1);
+        if (left.physicalIndex % 2 == 0 && right.physicalIndex == left.physicalIndex + 1)
+            channelBox.addItem (left.name + " + " + right.name,
+                                kStereoItemOffset + left.physicalIndex + 1);
+    }
+
     if (channelBox.getNumItems() == 0)
         return;
 
@@ -232,12 +286,13 @@ void LiveRecorderModuleView::refreshInputChannels()
     if (selectedId == 0)
     {
         const int desiredChannel = audioEngine.getRecorderInputChannel (recorderIndex);
+        const int desiredOffset = audioEngine.getRecorderChannelCount (recorderIndex) > 1 ? kStereoItemOffset : 0;
         if (desiredChannel >= 0)
         {
             for (int i = 0; i < channelBox.getNumItems(); ++i)
             {
                 const int id = channelBox.getItemId (i);
-                if (id == desiredChannel + 1)
+                if (id == desiredOffset + desiredChannel + 1)
                 {
                     selectedId = id;
                     break;
@@ -257,9 +312,19 @@ void LiveRecorderModuleView::refreshInputChannels()
     channelBox.setSelectedId (selectedId,
                               juce::dontSendNotification);
 
+    applyChannelSelection (selectedId);
+}
+
+bool LiveRecorderModuleView::applyChannelSelection (int itemId)
+{
+    const bool stereo = itemId > kStereoItemOffset;
+    if (! audioEngine.setRecorderChannelCount (recorderIndex, stereo ? 2 : 1))
+        return false;
+
     audioEngine.setRecorderInputChannel (
         recorderIndex,
-        selectedId - 1);
+        (stereo ? itemId - kStereoItemOffset : itemId) - 1);
+    return true;
 }
 
 // =====================================================
@@ -282,9 +347,12 @@ void LiveRecorderModuleView::comboBoxChanged (juce::ComboBox* box)
     if (selectedId <= 0)
         return;
 
-    audioEngine.setRecorderInputChannel (
-        recorderIndex,
-        selectedId - 1);
+    if (! applyChannelSelection (selectedId))
+    {
+        showChannelLayoutWarning();
+        channelBox.setSelectedId (0, juce::dontSendNotification);
+        refreshInputChannels();
+    }
 }
 
 // =====================================================
@@ -425,7 +493,7 @@ void LiveRecorderModuleView::buttonClicked (juce::Button* b)
             if (hasLatched)
             {
                 audioEngine.stopLatchedPlayback();
-                for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+                for (int index = 0; index < audioEngine.getNumRecorders(); ++index)
                     audioEngine.seekRecorderPlayback (index, 0.0);
             }
             else
@@ -472,18 +540,18 @@ void LiveRecorderModuleView::buttonClicked (juce::Button* b)
         return;
     }
 
-    if (hasLatched)
+    // the bleep confirms a take that was actually kept, which for a latched
+    // stop is only known once the audio thread has reached the stop sample
+    auto bleepIfKept = [&engine = audioEngine] (RecordingModule::StopResult result)
     {
-        const auto result = audioEngine.stopLatchedRecorders();
         if (result == RecordingModule::StopResult::Kept)
-            audioEngine.playUiSound (AudioEngine::UiSound::Bleep);
-    }
+            engine.playUiSound (AudioEngine::UiSound::Bleep);
+    };
+
+    if (hasLatched)
+        audioEngine.stopLatchedRecorders (bleepIfKept);
     else
-    {
-        const auto result = audioEngine.confirmStopRecorder (recorderIndex);
-        if (result == RecordingModule::StopResult::Kept)
-            audioEngine.playUiSound (AudioEngine::UiSound::Bleep);
-    }
+        audioEngine.confirmStopRecorder (recorderIndex, bleepIfKept);
     isRecording = false;
     lastRecordedSeconds = recordingOffsetSeconds + secs;
 }
@@ -573,6 +641,24 @@ void LiveRecorderModuleView::showRecordingInProgressWarning()
         "Stop the current recording before switching to playback mode.");
 }
 
+void LiveRecorderModuleView::showChannelLayoutWarning()
+{
+    audioEngine.playUiSound (AudioEngine::UiSound::Cowbell);
+    juce::AlertWindow::showMessageBoxAsync (
+        juce::AlertWindow::WarningIcon,
+        "Recording Exists",
+        "Clear this recorder before switching between mono and stereo.");
+}
+
+void LiveRecorderModuleView::showCaptureUnavailableWarning()
+{
+    audioEngine.playUiSound (AudioEngine::UiSound::Cowbell);
+    juce::AlertWindow::showMessageBoxAsync (
+        juce::AlertWindow::WarningIcon,
+        "Capture Unavailable",
+        "Stop recording and wait for the previous capture to finish.");
+}
+
 void LiveRecorderModuleView::applyPersistedControlState()
 {
     syncMidiButtonStates();
@@ -608,6 +694,12 @@ void LiveRecorderModuleView::setDeleteModuleHandler (std::function<void()> handl
 
 void LiveRecorderModuleView::mouseDown (const juce::MouseEvent& event)
 {
+    if (event.mods.isPopupMenu())
+    {
+        showCaptureMenu();
+        return;
+    }
+
     if (meterBounds.contains (event.getPosition()))
     {
         if (audioEngine.isRecorderLocked (recorderIndex))
@@ -666,6 +758,92 @@ void LiveRecorderModuleView::mouseUp (const juce::MouseEvent&)
     audioEngine.saveState();
 }
 
+// =====================================================
+// RETROSPECTIVE CAPTURE
+// =====================================================
+
+void LiveRecorderModuleView::showCaptureMenu()
+{
+    const bool captureEnabled = audioEngine.isRecorderCaptureEnabled (recorderIndex);
+
+    juce::PopupMenu menu;
+    menu.addItem (kCaptureToggleItemId, "Always-on capture", true, captureEnabled);
+    menu.addSeparator();
+    for (const int seconds : kCaptureMenuSeconds)
+        menu.addItem (kCaptureItemOffset + seconds,
+                      "Capture last " + juce::String (seconds) + " s",
+                      captureEnabled);
+
+    juce::Component::SafePointer<LiveRecorderModuleView> safeThis (this);
+    menu.showMenuAsync (juce::PopupMenu::Options().withTargetComponent (this),
+                        [safeThis] (int result)
+                        {
+                            if (safeThis != nullptr)
+                                safeThis->handleCaptureMenuResult (result);
+                        });
+}
+
+void LiveRecorderModuleView::handleCaptureMenuResult (int result)
+{
+    if (result == kCaptureToggleItemId)
+    {
+        if (! audioEngine.setRecorderCaptureEnabled (recorderIndex,
+                                                     ! audioEngine.isRecorderCaptureEnabled (recorderIndex)))
+        {
+            showCaptureUnavailableWarning();
+            return;
+        }
+
+        audioEngine.saveState();
+        return;
+    }
+
+    if (result <= kCaptureItemOffset)
+        return;
+
+    if (audioEngine.isRecorderLocked (recorderIndex))
+    {
+        showLockedWarning();
+        return;
+    }
+
+    if (! audioEngine.captureRecorderHistory (recorderIndex, result - kCaptureItemOffset))
+        showCaptureUnavailableWarning();
+}
+
+// =====================================================
+// WAVEFORM
+// =====================================================
+
+void LiveRecorderModuleView::drainWaveformPeaks (bool newTake)
+{
+    // peaks are only pushed while armed, so whatever is queued when a take
+    // starts already belongs to it
+    if (newTake)
+    {
+        waveformWrite = 0;
+        waveformFill = 0;
+    }
+
+    std::array<PeakFifo::Peak, 64> batch;
+    for (;;)
+    {
+        const int count = audioEngine.popRecorderWaveformPeaks (recorderIndex,
+                                                                batch.data(),
+                                                                static_cast<int> (batch.size()));
+        if (count <= 0)
+            break;
+
+        for (int i = 0; i < count; ++i)
+        {
+            waveformColumns[static_cast<size_t> (waveformWrite)] = batch[static_cast<size_t> (i)];
+            waveformWrite = (waveformWrite + 1) % kWaveformColumns;
+        }
+
+        waveformFill = juce::jmin (waveformFill + count, kWaveformColumns);
+    }
+}
+
 // =====================================================
 // TIMER (ONLY SECTION THAT CHANGED MEANINGFULLY)
 // =====================================================
@@ -675,16 +853,17 @@ void LiveRecorderModuleView::timerCallback()
     refreshInputChannels();
     syncMidiButtonStates();
 
-    const float linearRms = audioEngine.getRecorderRms (recorderIndex);
-    const float linearPeak = audioEngine.getRecorderPeak (recorderIndex);
-
-    const float rmsDb = juce::Decibels::gainToDecibels (linearRms, kMeterMinDb);
-    const float peakDb = juce::Decibels::gainToDecibels (linearPeak, kMeterMinDb);
+    // one snapshot so level, peak and loudness always come from the same block
+    const auto meter = audioEngine.getRecorderMeterReading (recorderIndex);
+    const float rmsDb = juce::Decibels::gainToDecibels (meter.rms, kMeterMinDb);
+    const float peakDb = juce::Decibels::gainToDecibels (meter.truePeak, kMeterMinDb);
 
     rms = juce::jlimit (0.0f, 1.0f,
                         (rmsDb - kMeterMinDb) / (kMeterMaxDb - kMeterMinDb));
     peak = juce::jlimit (0.0f, 1.0f,
                          (peakDb - kMeterMinDb) / (kMeterMaxDb - kMeterMinDb));
+    loudness = juce::jlimit (0.0f, 1.0f,
+                             (meter.shortTermLufs - kMeterMinDb) / (kMeterMaxDb - kMeterMinDb));
 
     const float gainDb = audioEngine.getRecorderInputGainDb (recorderIndex);
     gainPosition = juce::jlimit (0.0f, 1.0f,
@@ -702,13 +881,15 @@ void LiveRecorderModuleView::timerCallback()
     const int maxSamples = audioEngine.getRecorderMaxSamples (recorderIndex);
     const double totalRecordedSeconds =
         maxSamples > 0
-            ? (static_cast<double> (totalSamples) * kMaxRecordSeconds
+            ? (static_cast<double> (totalSamples) * audioEngine.getMaxTakeSeconds()
                / static_cast<double> (maxSamples))
             : 0.0;
 
     if (! previouslyRecording && isRecording)
         recordingOffsetSeconds = lastRecordedSeconds;
 
+    drainWaveformPeaks (! previouslyRecording && isRecording);
+
     if (previouslyRecording && ! isRecording)
     {
         const double secs =
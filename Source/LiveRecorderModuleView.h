@@ -2,6 +2,8 @@
 
 #include <JuceHeader.h>
 #include "FlatTileLookAndFeel.h"
+#include "PeakFifo.h"
+#include <array>
 
 // Forward declaration
 class AudioEngine;
@@ -37,8 +39,15 @@ private:
     void showLockedWarning();
     void showMissingRecordingWarning();
     void showRecordingInProgressWarning();
+    void showChannelLayoutWarning();
+    void showCaptureUnavailableWarning();
+    void showCaptureMenu();
+    void handleCaptureMenuResult (int result);
+    bool applyChannelSelection (int itemId);
     void applyPersistedControlState();
     void syncMidiButtonStates();
+    void drainWaveformPeaks (bool newTake);
+    void paintWaveform (juce::Graphics& g) const;
 
     // state
     AudioEngine& audioEngine;
@@ -73,9 +82,18 @@ private:
 
     float rms  = 0.0f;
     float peak = 0.0f;
+    float loudness = 0.0f; // short-term LUFS on the meter's dB scale
     float gainPosition = 0.5f;
     juce::Rectangle<int> meterBounds;
     juce::Rectangle<int> progressBounds;
+    juce::Rectangle<int> waveformBounds;
+
+    // newest take's min/max columns, one pixel each; paint never looks
+    // further back than the strip is wide
+    static constexpr int kWaveformColumns = 1024;
+    std::array<PeakFifo::Peak, kWaveformColumns> waveformColumns {};
+    int waveformWrite = 0;
+    int waveformFill = 0;
     bool adjustingGain = false;
 
     std::function<void()> deleteModuleHandler;
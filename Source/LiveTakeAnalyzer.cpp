@@ -0,0 +1,412 @@
+#include "LiveTakeAnalyzer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double kHopSeconds = 0.01;
+    constexpr double kFeedSeconds = 1.0;       // analysis may lag this far behind the recorders
+    constexpr int kPollIntervalMs = 20;
+    constexpr float kSilenceDb = -50.0f;
+    constexpr int kNoFrame = std::numeric_limits<int>::max();
+
+    void mixToMono (float* dest, const float* const* channels, int numChannels, int offset, int numSamples)
+    {
+        if (numSamples <= 0)
+            return;
+
+        const float gain = 1.0f / static_cast<float> (numChannels);
+        juce::FloatVectorOperations::copyWithMultiply (dest, channels[0] + offset, gain, numSamples);
+        for (int ch = 1; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::addWithMultiply (dest, channels[ch] + offset, gain, numSamples);
+    }
+}
+
+int LiveTakeAnalyzer::TakeAnalysis::countSilentFrames (juce::Range<int> frames) const
+{
+    auto it = std::upper_bound (silentRanges.begin(), silentRanges.end(), frames.getStart(),
+                                [] (int frame, const juce::Range<int>& range) { return frame < range.getEnd(); });
+
+    int silent = 0;
+    for (; it != silentRanges.end() && it->getStart() < frames.getEnd(); ++it)
+        silent += it->getIntersectionWith (frames).getLength();
+
+    return silent;
+}
+
+int LiveTakeAnalyzer::TakeAnalysis::getAnalysedFramesAt (double otherSampleRate) const
+{
+    if (sampleRate <= 0.0 || otherSampleRate <= 0.0)
+        return 0;
+
+    const double ratio = otherSampleRate / sampleRate;
+    return static_cast<int> (std::ceil (static_cast<double> (analysedFrames) * ratio));
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+LiveTakeAnalyzer::LiveTakeAnalyzer (int numRecordersToUse)
+    : juce::Thread ("LiveTakeAnalyzer"),
+      numRecorders (juce::jmax (0, numRecordersToUse)),
+      trackers (static_cast<size_t> (numRecorders)),
+      published (static_cast<size_t> (numRecorders), std::make_shared<const TakeAnalysis>())
+{
+    for (int i = 0; i < numRecorders; ++i)
+        feeds.push_back (std::make_unique<Feed>());
+
+    startThread();
+}
+
+LiveTakeAnalyzer::~LiveTakeAnalyzer()
+{
+    stopThread (2000);
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void LiveTakeAnalyzer::prepare (double newSampleRate)
+{
+    const juce::ScopedLock sl (feedLock);
+
+    const int capacity = juce::jmax (1, juce::roundToInt (newSampleRate * kFeedSeconds));
+    for (auto& feed : feeds)
+    {
+        feed->samples.assign (static_cast<size_t> (capacity), 0.0f);
+        feed->sampleFifo.setTotalSize (capacity);
+        feed->segmentFifo.reset();
+    }
+
+    drainScratch.assign (static_cast<size_t> (capacity), 0.0f);
+
+    // whatever was still queued is gone; the next segment shows up as a gap
+    if (juce::approximatelyEqual (newSampleRate, sampleRate))
+        return;
+
+    sampleRate = newSampleRate;
+    hopSamples = juce::jmax (1, juce::roundToInt (sampleRate * kHopSeconds));
+
+    for (int recorder = 0; recorder < numRecorders; ++recorder)
+    {
+        auto& tracker = trackers[static_cast<size_t> (recorder)];
+        tracker = Tracker();
+        tracker.detector = std::make_unique<OnsetDetector> (sampleRate);
+        publish (recorder);
+    }
+}
+
+void LiveTakeAnalyzer::push (int recorder,
+                             int takeFrame,
+                             const float* const* channels,
+                             int numChannels,
+                             int numSamples)
+{
+    if (recorder < 0 || recorder >= numRecorders || numChannels <= 0 || numSamples <= 0)
+        return;
+
+    auto& feed = *feeds[static_cast<size_t> (recorder)];
+    if (feed.sampleFifo.getFreeSpace() < numSamples || feed.segmentFifo.getFreeSpace() < 1)
+        return;
+
+    {
+        const auto scope = feed.sampleFifo.write (numSamples);
+        mixToMono (feed.samples.data() + scope.startIndex1, channels, numChannels, 0, scope.blockSize1);
+        mixToMono (feed.samples.data() + scope.startIndex2, channels, numChannels, scope.blockSize1, scope.blockSize2);
+    }
+
+    // published after its samples, so a visible segment is always complete
+    const auto scope = feed.segmentFifo.write (1);
+    const int slot = scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2;
+    feed.segments[static_cast<size_t> (slot)] = { takeFrame, numSamples };
+}
+
+// =====================================================
+// ANY THREAD
+// =====================================================
+
+void LiveTakeAnalyzer::invalidateFrom (int recorder, int frame)
+{
+    if (recorder < 0 || recorder >= numRecorders)
+        return;
+
+    auto& target = feeds[static_cast<size_t> (recorder)]->invalidFrom;
+    int current = target.load();
+    while (frame < current && ! target.compare_exchange_weak (current, frame))
+    {
+    }
+
+    notify();
+}
+
+void LiveTakeAnalyzer::finishTake (int recorder, int takeFrames)
+{
+    if (recorder < 0 || recorder >= numRecorders)
+        return;
+
+    feeds[static_cast<size_t> (recorder)]->finishAt.store (takeFrames);
+    notify();
+}
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+std::shared_ptr<const LiveTakeAnalyzer::TakeAnalysis> LiveTakeAnalyzer::getAnalysis (int recorder) const
+{
+    if (recorder < 0 || recorder >= numRecorders)
+        return std::make_shared<const TakeAnalysis>();
+
+    const juce::ScopedLock sl (publishLock);
+    return published[static_cast<size_t> (recorder)];
+}
+
+// =====================================================
+// ANALYSIS THREAD
+// =====================================================
+
+void LiveTakeAnalyzer::run()
+{
+    while (! threadShouldExit())
+    {
+        {
+            const juce::ScopedLock sl (feedLock);
+            for (int recorder = 0; recorder < numRecorders; ++recorder)
+                drain (recorder);
+        }
+
+        wait (kPollIntervalMs);
+    }
+}
+
+void LiveTakeAnalyzer::drain (int recorder)
+{
+    auto& feed = *feeds[static_cast<size_t> (recorder)];
+    auto& tracker = trackers[static_cast<size_t> (recorder)];
+
+    const int invalidFrom = feed.invalidFrom.exchange (kNoFrame);
+    if (invalidFrom != kNoFrame)
+        truncate (tracker, invalidFrom);
+
+    for (int ready = feed.segmentFifo.getNumReady(); ready > 0; --ready)
+    {
+        Segment segment;
+        {
+            const auto scope = feed.segmentFifo.read (1);
+            segment = feed.segments[static_cast<size_t> (scope.blockSize1 > 0 ? scope.startIndex1
+                                                                               : scope.startIndex2)];
+        }
+
+        {
+            const auto scope = feed.sampleFifo.read (segment.numSamples);
+            std::copy_n (feed.samples.data() + scope.startIndex1, scope.blockSize1, drainScratch.data());
+            std::copy_n (feed.samples.data() + scope.startIndex2, scope.blockSize2, drainScratch.data() + scope.blockSize1);
+        }
+
+        // an earlier frame means the take was cut back and is being recorded
+        // over; a later one means segments were dropped
+        if (segment.takeFrame < tracker.nextFrame)
+        {
+            truncate (tracker, segment.takeFrame);
+        }
+        else if (segment.takeFrame > tracker.nextFrame)
+        {
+            tracker.gapFrame = juce::jmin (tracker.gapFrame, tracker.nextFrame);
+            resetHop (tracker, segment.takeFrame);
+        }
+
+        analyse (tracker, drainScratch.data(), segment.numSamples);
+    }
+
+    // the stop may arrive before the recorder's last blocks have been drained
+    const int finishAt = feed.finishAt.load();
+    if (finishAt != kNoFrame && tracker.nextFrame >= finishAt)
+    {
+        int expected = finishAt;
+        if (feed.finishAt.compare_exchange_strong (expected, kNoFrame) && tracker.nextFrame == finishAt)
+            flushTake (tracker);
+    }
+
+    if (tracker.changed)
+    {
+        tracker.changed = false;
+        publish (recorder);
+    }
+}
+
+void LiveTakeAnalyzer::analyse (Tracker& tracker, const float* samples, int numSamples)
+{
+    if (tracker.detector == nullptr)
+        return;
+
+    tracker.detector->process (samples, numSamples, tracker.detected);
+    collectOnsets (tracker);
+
+    int offset = 0;
+    while (offset < numSamples)
+    {
+        const int count = juce::jmin (numSamples - offset, hopSamples - tracker.hopFill);
+        for (int i = 0; i < count; ++i)
+            tracker.hopEnergy += static_cast<double> (samples[offset + i]) * samples[offset + i];
+
+        tracker.hopFill += count;
+        tracker.nextFrame += count;
+        offset += count;
+
+        if (tracker.hopFill == hopSamples)
+            finishHop (tracker);
+    }
+
+    tracker.changed = true;
+}
+
+void LiveTakeAnalyzer::finishHop (Tracker& tracker)
+{
+    const auto rms = static_cast<float> (std::sqrt (tracker.hopEnergy / tracker.hopFill));
+    const float hopDb = juce::Decibels::gainToDecibels (rms, -100.0f);
+    const int hopEnd = tracker.hopStart + tracker.hopFill;
+
+    if (hopDb < kSilenceDb)
+    {
+        if (! tracker.silentRanges.empty() && tracker.silentRanges.back().getEnd() == tracker.hopStart)
+            tracker.silentRanges.back().setEnd (hopEnd);
+        else
+            tracker.silentRanges.push_back ({ tracker.hopStart, hopEnd });
+    }
+
+    tracker.hopStart = hopEnd;
+    tracker.hopFill = 0;
+    tracker.hopEnergy = 0.0;
+}
+
+// the take ends here for now: the partial hop counts and the detector
+// reports what it was holding back. A later pass simply carries on.
+void LiveTakeAnalyzer::flushTake (Tracker& tracker)
+{
+    if (tracker.hopFill > 0)
+        finishHop (tracker);
+
+    if (tracker.detector != nullptr)
+    {
+        tracker.detector->flush (tracker.detected);
+        collectOnsets (tracker);
+    }
+
+    tracker.changed = true;
+}
+
+void LiveTakeAnalyzer::collectOnsets (Tracker& tracker)
+{
+    for (auto onset : tracker.detected)
+    {
+        onset.frame += tracker.detectorOrigin;
+        tracker.onsets.push_back (onset);
+    }
+
+    tracker.detected.clear();
+}
+
+void LiveTakeAnalyzer::truncate (Tracker& tracker, int frame)
+{
+    frame = juce::jmax (0, frame);
+    if (frame >= tracker.nextFrame)
+        return;
+
+    if (frame <= tracker.gapFrame)
+        tracker.gapFrame = kNoFrame;
+
+    const auto firstOnset = std::lower_bound (tracker.onsets.begin(), tracker.onsets.end(), frame,
+                                              [] (const Onset& onset, int f) { return onset.frame < f; });
+    tracker.onsets.erase (firstOnset, tracker.onsets.end());
+
+    while (! tracker.silentRanges.empty() && tracker.silentRanges.back().getStart() >= frame)
+        tracker.silentRanges.pop_back();
+    if (! tracker.silentRanges.empty() && tracker.silentRanges.back().getEnd() > frame)
+        tracker.silentRanges.back().setEnd (frame);
+
+    resetHop (tracker, frame);
+    tracker.changed = true;
+}
+
+void LiveTakeAnalyzer::resetHop (Tracker& tracker, int frame)
+{
+    tracker.nextFrame = frame;
+    tracker.hopStart = frame;
+    tracker.hopFill = 0;
+    tracker.hopEnergy = 0.0;
+
+    // the detector's history belongs to audio that is gone or not adjacent
+    if (tracker.detector != nullptr)
+        tracker.detector->reset();
+
+    tracker.detectorOrigin = frame;
+}
+
+void LiveTakeAnalyzer::publish (int recorder)
+{
+    const auto& tracker = trackers[static_cast<size_t> (recorder)];
+
+    auto analysis = std::make_shared<TakeAnalysis>();
+    analysis->sampleRate = sampleRate;
+    analysis->analysedFrames = juce::jmin (tracker.hopStart, tracker.gapFrame);
+    analysis->onsets = tracker.onsets;
+    analysis->silentRanges = tracker.silentRanges;
+
+    const juce::ScopedLock sl (publishLock);
+    published[static_cast<size_t> (recorder)] = std::move (analysis);
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class LiveTakeAnalyzerTests final : public juce::UnitTest
+{
+public:
+    LiveTakeAnalyzerTests() : juce::UnitTest ("LiveTakeAnalyzer", "Slicebot") {}
+
+    void runTest() override
+    {
+        beginTest ("a stopped take is covered to its last frame");
+
+        constexpr double sampleRate = 48000.0;
+        constexpr int takeFrames = 48000 + 123; // ends partway through a hop
+        constexpr int blockSize = 256;
+
+        std::vector<float> take (static_cast<size_t> (takeFrames), 0.0f);
+        for (int i = 0; i < 2000; ++i)
+            take[static_cast<size_t> (24000 + i)] = 0.5f * std::sin (0.3f * i) * std::exp (-i / 400.0f);
+
+        LiveTakeAnalyzer analyzer (1);
+        analyzer.prepare (sampleRate);
+
+        for (int frame = 0; frame < takeFrames; frame += blockSize)
+        {
+            const float* channels[] = { take.data() + frame };
+            analyzer.push (0, frame, channels, 1, juce::jmin (blockSize, takeFrames - frame));
+            juce::Thread::sleep (1); // the feed holds one second
+        }
+
+        analyzer.finishTake (0, takeFrames);
+
+        auto analysis = analyzer.getAnalysis (0);
+        for (int attempt = 0; attempt < 100 && analysis->analysedFrames < takeFrames; ++attempt)
+        {
+            juce::Thread::sleep (kPollIntervalMs);
+            analysis = analyzer.getAnalysis (0);
+        }
+
+        expectEquals (analysis->analysedFrames, takeFrames);
+        expectEquals (analysis->getAnalysedFramesAt (44100.0),
+                      static_cast<int> (std::ceil (takeFrames * 44100.0 / sampleRate)));
+        expectEquals (static_cast<int> (analysis->onsets.size()), 1);
+    }
+};
+
+static LiveTakeAnalyzerTests liveTakeAnalyzerTests;
+
+#endif
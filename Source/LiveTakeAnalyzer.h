@@ -0,0 +1,137 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "OnsetDetector.h"
+
+// Follows every recorder's take while it is being recorded and keeps an onset
+// list and a silence map for it, so LIVE slicing can place transient-aligned
+// slices without re-reading the take. The audio thread only copies what the
+// recorders wrote, mixed to mono, into per-recorder FIFOs; a background thread
+// runs them through an OnsetDetector, measures silence in 10 ms hops and
+// publishes immutable snapshots.
+//
+// That thread stays outside the JobScheduler on purpose. The FIFOs hold one
+// second of audio and have to be drained on time while recording, but
+// analysis jobs are capped and coarse (a recache batch or an energy map
+// decodes whole files), so a drain queued behind them could wait long enough
+// to drop audio. The thread wakes every 20 ms and does a few hops' work.
+class LiveTakeAnalyzer final : private juce::Thread
+{
+public:
+    // frame is a take frame
+    using Onset = OnsetDetector::Onset;
+
+    struct TakeAnalysis
+    {
+        double sampleRate = 0.0;
+        int analysedFrames = 0; // take frames [0, analysedFrames) are covered
+        std::vector<Onset> onsets;
+        std::vector<juce::Range<int>> silentRanges; // sorted, disjoint
+
+        int countSilentFrames (juce::Range<int> frames) const;
+
+        // analysedFrames at another rate, rounded the way AudioFileIO
+        // rounds a file's length when it converts it
+        int getAnalysedFramesAt (double otherSampleRate) const;
+    };
+
+    explicit LiveTakeAnalyzer (int numRecorders);
+    ~LiveTakeAnalyzer() override;
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    // prepare is called while the device is stopped; a new sample rate
+    // discards what was analysed so far
+    void prepare (double sampleRate);
+
+    // takeFrame is where the recorder's writer put the first sample; a
+    // segment that does not fit is dropped and leaves a gap in the analysis
+    void push (int recorder, int takeFrame, const float* const* channels, int numChannels, int numSamples);
+
+    // =====================================================
+    // ANY THREAD
+    // =====================================================
+    // the take was cut back to frame (rolled back, cleared, or extended by
+    // audio that did not pass through push)
+    void invalidateFrom (int recorder, int frame);
+
+    // the recorder stopped with takeFrames in its take: once the analysis
+    // reaches that frame its last partial hop is finished and published, so
+    // a complete take is covered to its end
+    void finishTake (int recorder, int takeFrames);
+
+    // =====================================================
+    // MESSAGE THREAD
+    // =====================================================
+    std::shared_ptr<const TakeAnalysis> getAnalysis (int recorder) const;
+
+private:
+    static constexpr int kSegmentCapacity = 512;
+
+    struct Segment
+    {
+        int takeFrame = 0;
+        int numSamples = 0;
+    };
+
+    // fed by the audio thread, drained by the analysis thread
+    struct Feed
+    {
+        juce::AbstractFifo sampleFifo { 1 };
+        std::vector<float> samples;
+        juce::AbstractFifo segmentFifo { kSegmentCapacity };
+        std::array<Segment, kSegmentCapacity> segments {};
+        std::atomic<int> invalidFrom { std::numeric_limits<int>::max() };
+        std::atomic<int> finishAt { std::numeric_limits<int>::max() };
+    };
+
+    // analysis thread only
+    struct Tracker
+    {
+        int nextFrame = 0;
+        int gapFrame = std::numeric_limits<int>::max();
+        int hopStart = 0;
+        int hopFill = 0;
+        double hopEnergy = 0.0;
+        std::unique_ptr<OnsetDetector> detector;
+        int detectorOrigin = 0; // the take frame the detector counts from
+        std::vector<Onset> detected;
+        std::vector<Onset> onsets;
+        std::vector<juce::Range<int>> silentRanges;
+        bool changed = false;
+    };
+
+    void run() override;
+    void drain (int recorder);
+    void analyse (Tracker& tracker, const float* samples, int numSamples);
+    void finishHop (Tracker& tracker);
+    void flushTake (Tracker& tracker);
+    void collectOnsets (Tracker& tracker);
+    void truncate (Tracker& tracker, int frame);
+    void resetHop (Tracker& tracker, int frame);
+    void publish (int recorder);
+
+    const int numRecorders;
+    std::vector<std::unique_ptr<Feed>> feeds;
+    std::vector<Tracker> trackers;
+    std::vector<float> drainScratch;
+    double sampleRate = 0.0;
+    int hopSamples = 1;
+
+    // held by the analysis thread while draining, and by prepare while the
+    // FIFOs are resized
+    juce::CriticalSection feedLock;
+
+    mutable juce::CriticalSection publishLock;
+    std::vector<std::shared_ptr<const TakeAnalysis>> published;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LiveTakeAnalyzer)
+};
@@ -1,7 +1,9 @@
 #include <JuceHeader.h>
 #include "AudioEngine.h"
 #include "DeterministicPreviewHarness.h"
+#include "EnergyMap.h"
 #include "MainComponent.h"
+#include "SliceRandom.h"
 
 class SliceBotJUCEApplication final : public juce::JUCEApplication
 {
@@ -9,8 +11,35 @@ public:
     const juce::String getApplicationName() override       { return "SliceBotJUCE"; }
     const juce::String getApplicationVersion() override    { return "0.1.0"; }
 
-    void initialise (const juce::String&) override
+    void initialise (const juce::String& commandLine) override
     {
+       #if JUCE_DEBUG
+        // debug builds carry the Slicebot checks; this runs them and quits
+        if (commandLine.contains ("--run-checks"))
+        {
+            setApplicationReturnValue (runChecks() ? 0 : 1);
+            quit();
+            return;
+        }
+       #endif
+
+        // jassert is compiled out, so a broken generator has to say so here
+        if (! SliceRandom::passesKnownAnswers())
+            juce::Logger::writeToLog ("SliceRandom: philox does not match its known answers; seeds will not replay");
+
+        // replays a session: the same seed cuts the same kits in order
+        if (commandLine.contains ("--seed="))
+        {
+            const auto seedArgument = commandLine.fromFirstOccurrenceOf ("--seed=", false, false)
+                                                 .upToFirstOccurrenceOf (" ", false, false);
+            if (const auto seed = SliceRandom::parseSeed (seedArgument))
+                SliceRandom::setSessionSeed (*seed);
+            else
+                juce::Logger::writeToLog ("--seed=" + seedArgument + " is not a whole number; using a drawn seed");
+        }
+
+        juce::Logger::writeToLog ("Session seed " + juce::String (SliceRandom::getSessionSeed()));
+
         audioEngine.restoreState();
         audioEngine.start();
 
@@ -25,10 +54,18 @@ public:
         });
 
         mainWindow.reset (new MainWindow (audioEngine));
+        started = true;
     }
 
     void shutdown() override
     {
+        // a checks-only run never loaded state, so it must not save any
+        if (! started)
+            return;
+
+        // first, so nothing the window waits on below is queued behind them
+        EnergyMap::cancelBuilds();
+
         mainWindow = nullptr;
         previewHarness = nullptr;
 
@@ -38,6 +75,21 @@ public:
     }
 
 private:
+   #if JUCE_DEBUG
+    static bool runChecks()
+    {
+        juce::UnitTestRunner runner;
+        runner.setAssertOnFailure (false);
+        runner.runTestsInCategory ("Slicebot");
+
+        int failures = 0;
+        for (int i = 0; i < runner.getNumResults(); ++i)
+            failures += runner.getResult (i)->failures;
+
+        return failures == 0;
+    }
+   #endif
+
     class MainWindow final : public juce::DocumentWindow
     {
     public:
@@ -61,6 +113,7 @@ private:
     AudioEngine audioEngine;
     std::unique_ptr<DeterministicPreviewHarness> previewHarness;
     std::unique_ptr<MainWindow> mainWindow;
+    bool started = false;
 };
 
 START_JUCE_APPLICATION (SliceBotJUCEApplication)
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "MainTabView.h"
 #include "GlobalTabView.h"
 #include "AudioCacheStore.h"
+#include "EnergyMap.h"
 #include "MutationOrchestrator.h"
 #include "PreviewChainOrchestrator.h"
 #include "RecordingModule.h"
@@ -509,7 +510,12 @@ namespace
         explicit LiveModuleContainer (AudioEngine& engineToUse)
             : audioEngine (engineToUse)
         {
-            for (int index = 0; index < 4; ++index)
+            // four modules fit across; larger banks scroll sideways
+            viewport.setViewedComponent (&strip, false);
+            viewport.setScrollBarsShown (false, audioEngine.getNumRecorders() > kVisibleModules);
+            addAndMakeVisible (viewport);
+
+            for (int index = 0; index < audioEngine.getNumRecorders(); ++index)
             {
                 auto slot = std::make_unique<LiveModuleSlot> (audioEngine, index);
                 slot->setPlaceholderClickHandler ([this, slotPtr = slot.get()]()
@@ -522,7 +528,7 @@ namespace
                 {
                     setSlotEnabled (*slotPtr, false);
                 });
-                addAndMakeVisible (*slot);
+                strip.addAndMakeVisible (*slot);
                 slots.add (std::move (slot));
             }
 
@@ -536,13 +542,17 @@ namespace
 
         void resized() override
         {
-            auto bounds = getLocalBounds();
+            viewport.setBounds (getLocalBounds());
+
             const int spacing = 3;
             const int slotWidth =
-                (bounds.getWidth() - spacing * 3) / 4;
-            const int slotHeight = bounds.getHeight();
-            auto startX = bounds.getX();
-            auto y = bounds.getY();
+                (getWidth() - spacing * (kVisibleModules - 1)) / kVisibleModules;
+            const int slotHeight = viewport.getMaximumVisibleHeight();
+            strip.setSize (slots.size() * slotWidth + juce::jmax (0, slots.size() - 1) * spacing,
+                           slotHeight);
+
+            auto startX = 0;
+            auto y = 0;
 
             for (int index = 0; index < slots.size(); ++index)
             {
@@ -552,6 +562,8 @@ namespace
         }
 
     private:
+        static constexpr int kVisibleModules = 4;
+
         juce::String slotKey (int index) const
         {
             return "liveModuleEnabled_" + juce::String (index);
@@ -592,6 +604,8 @@ namespace
         }
 
         AudioEngine& audioEngine;
+        juce::Component strip;
+        juce::Viewport viewport;
         juce::OwnedArray<LiveModuleSlot> slots;
         std::function<void()> moduleEnabledCallback;
     };
@@ -600,8 +614,6 @@ namespace
                                    private juce::ChangeListener
     {
     public:
-        static constexpr double kTargetSampleRate = 44100.0;
-
         FocusPreviewArea()
             : thumbnail (512, formatManager, thumbnailCache)
         {
@@ -1205,10 +1217,12 @@ namespace
         PersistentFrame (juce::TabbedComponent& tabsToTrack,
                          SliceStateStore& stateStoreToUse,
                          AudioEngine& audioEngineToUse,
+                         SpeculativeSlicePool& slicePoolToUse,
                          PreviewChainPlayer& previewPlayerToUse)
             : tabs (tabsToTrack),
               stateStore (stateStoreToUse),
               audioEngine (audioEngineToUse),
+              slicePool (slicePoolToUse),
               previewPlayer (previewPlayerToUse)
         {
             addAndMakeVisible (focusPlaceholder);
@@ -1248,7 +1262,7 @@ namespace
                         }
 
                         const auto snapshot = stateStore.getSnapshot();
-                        if (! snapshot.previewChainURL.existsAsFile())
+                        if (! snapshot->previewChainURL.existsAsFile())
                         {
                             setStatusText ("No preview chain available.");
                             previewPlayer.setLooping (false);
@@ -1256,7 +1270,7 @@ namespace
                             return;
                         }
                         previewPlayer.setLooping (true);
-                        if (! previewPlayer.startPlayback (snapshot.previewChainURL, true))
+                        if (! previewPlayer.startPlayback (snapshot->previewChainURL, true))
                         {
                             setStatusText ("Preview loop failed.");
                             previewPlayer.setLooping (false);
@@ -1280,7 +1294,7 @@ namespace
                         return;
                     }
 
-                    MutationOrchestrator orchestrator (stateStore, &audioEngine);
+                    MutationOrchestrator orchestrator (stateStore, &audioEngine, &slicePool);
                     setStatusText ("Slicing...");
 
                     if (! orchestrator.requestSliceAll())
@@ -1290,18 +1304,19 @@ namespace
                     }
 
                     const auto snapshot = stateStore.getSnapshot();
-                    if (! snapshot.previewSnippetURLs.empty())
+                    if (! snapshot->previewSnippetURLs.empty())
                     {
                         focusedSliceIndex = 0;
                         double durationSeconds = 0.0;
-                        if (! snapshot.sliceInfos.empty())
+                        if (! snapshot->sliceInfos.empty())
                         {
-                            durationSeconds = static_cast<double> (snapshot.sliceInfos.front().snippetFrameCount)
-                                              / FocusPreviewArea::kTargetSampleRate;
+                            const auto& info = snapshot->sliceInfos.front();
+                            durationSeconds = static_cast<double> (info.snippetFrameCount) / info.sampleRate;
                         }
-                        focusPlaceholder.setSourceFile (snapshot.previewSnippetURLs.front(), durationSeconds);
-                        grid.setSliceFiles (snapshot.previewSnippetURLs);
-                        grid.setSliceInfos (snapshot.sliceInfos);
+                        focusPlaceholder.setSourceFile (snapshot->previewSnippetURLs.front(), durationSeconds);
+                        grid.setSliceFiles (snapshot->previewSnippetURLs);
+                        grid.setSliceInfos (snapshot->sliceInfos);
+                        previewPlayer.preload (snapshot->previewSnippetURLs);
                     }
 
                     setStatusText ("Slice all complete.");
@@ -1389,8 +1404,9 @@ namespace
                     if (pendingResult.actionResult.statusText.isNotEmpty())
                         setStatusText (pendingResult.actionResult.statusText);
                     const auto snapshot = stateStore.getSnapshot();
-                    grid.setSliceFiles (snapshot.previewSnippetURLs);
-                    grid.setSliceInfos (snapshot.sliceInfos);
+                    grid.setSliceFiles (snapshot->previewSnippetURLs);
+                    grid.setSliceInfos (snapshot->sliceInfos);
+                    previewPlayer.preload (snapshot->previewSnippetURLs);
                     grid.setPendingState (sliceContextState.pendingOperation != SliceContextState::PendingOperation::none,
                                           sliceContextState.pendingSourceSliceIndex);
                     contextOverlay.hide();
@@ -1400,16 +1416,15 @@ namespace
                 focusedSliceIndex = index;
                 contextOverlay.hide();
                 const auto snapshot = stateStore.getSnapshot();
-                if (index >= 0 && index < static_cast<int> (snapshot.previewSnippetURLs.size()))
+                if (index >= 0 && index < static_cast<int> (snapshot->previewSnippetURLs.size()))
                 {
                     double durationSeconds = 0.0;
-                    if (index < static_cast<int> (snapshot.sliceInfos.size()))
+                    if (index < static_cast<int> (snapshot->sliceInfos.size()))
                     {
-                        durationSeconds =
-                            static_cast<double> (snapshot.sliceInfos[static_cast<std::size_t> (index)].snippetFrameCount)
-                            / FocusPreviewArea::kTargetSampleRate;
+                        const auto& info = snapshot->sliceInfos[static_cast<std::size_t> (index)];
+                        durationSeconds = static_cast<double> (info.snippetFrameCount) / info.sampleRate;
                     }
-                    focusPlaceholder.setSourceFile (snapshot.previewSnippetURLs[static_cast<std::size_t> (index)],
+                    focusPlaceholder.setSourceFile (snapshot->previewSnippetURLs[static_cast<std::size_t> (index)],
                                                     durationSeconds);
                 }
                 playSliceAtIndex (index);
@@ -1486,26 +1501,27 @@ namespace
                                                               index,
                                                               stateStore,
                                                               sliceContextState,
-                                                              audioEngine);
+                                                              audioEngine,
+                                                              &slicePool);
                 if (result.statusText.isNotEmpty())
                     setStatusText (result.statusText);
                 const auto snapshot = stateStore.getSnapshot();
-                grid.setSliceFiles (snapshot.previewSnippetURLs);
-                grid.setSliceInfos (snapshot.sliceInfos);
+                grid.setSliceFiles (snapshot->previewSnippetURLs);
+                grid.setSliceInfos (snapshot->sliceInfos);
+                previewPlayer.preload (snapshot->previewSnippetURLs);
                 grid.setPendingState (sliceContextState.pendingOperation != SliceContextState::PendingOperation::none,
                                       sliceContextState.pendingSourceSliceIndex);
                         if (focusedSliceIndex == index)
                 {
-                    if (index >= 0 && index < static_cast<int> (snapshot.previewSnippetURLs.size()))
+                    if (index >= 0 && index < static_cast<int> (snapshot->previewSnippetURLs.size()))
                     {
                         double durationSeconds = 0.0;
-                        if (index < static_cast<int> (snapshot.sliceInfos.size()))
+                        if (index < static_cast<int> (snapshot->sliceInfos.size()))
                         {
-                            durationSeconds =
-                                static_cast<double> (snapshot.sliceInfos[static_cast<std::size_t> (index)].snippetFrameCount)
-                                / FocusPreviewArea::kTargetSampleRate;
+                            const auto& info = snapshot->sliceInfos[static_cast<std::size_t> (index)];
+                            durationSeconds = static_cast<double> (info.snippetFrameCount) / info.sampleRate;
                         }
-                        focusPlaceholder.setSourceFile (snapshot.previewSnippetURLs[static_cast<std::size_t> (index)],
+                        focusPlaceholder.setSourceFile (snapshot->previewSnippetURLs[static_cast<std::size_t> (index)],
                                                         durationSeconds);
                     }
                 }
@@ -1580,13 +1596,13 @@ namespace
         void playSliceAtIndex (int index)
         {
             const auto snapshot = stateStore.getSnapshot();
-            if (index < 0 || index >= static_cast<int> (snapshot.previewSnippetURLs.size()))
+            if (index < 0 || index >= static_cast<int> (snapshot->previewSnippetURLs.size()))
             {
                 setStatusText ("No preview slice available.");
                 return;
             }
 
-            const auto& snippetFile = snapshot.previewSnippetURLs[static_cast<std::size_t> (index)];
+            const auto& snippetFile = snapshot->previewSnippetURLs[static_cast<std::size_t> (index)];
             if (! snippetFile.existsAsFile())
             {
                 setStatusText ("Preview slice missing.");
@@ -1619,6 +1635,7 @@ namespace
         juce::TabbedComponent& tabs;
         SliceStateStore& stateStore;
         AudioEngine& audioEngine;
+        SpeculativeSlicePool& slicePool;
         PreviewChainPlayer& previewPlayer;
         FocusPreviewArea focusPlaceholder;
         PreviewGrid grid;
@@ -1711,7 +1728,7 @@ namespace
             liveHeader.setVisible (showLive);
 
             if (showGlobal)
-                globalHeader.applySettingsSnapshot (stateStore.getSnapshot());
+                globalHeader.applySettingsSnapshot (*stateStore.getSnapshot());
         }
 
         juce::TabbedComponent& tabs;
@@ -1724,19 +1741,21 @@ namespace
     };
 
     class ContentArea final : public juce::Component,
-                              private juce::ChangeListener
+                              private juce::ChangeListener,
+                              private juce::Timer
     {
     public:
         ContentArea (juce::TabbedComponent& tabsToTrack,
                      AudioEngine& audioEngineToUse,
                      SettingsView& settingsToUse,
                      SliceStateStore& stateStoreToUse,
+                     SpeculativeSlicePool& slicePoolToUse,
                      PreviewChainPlayer& previewPlayerToUse,
                      juce::Component* liveContent)
             : tabs (tabsToTrack),
               audioEngine (audioEngineToUse),
               settingsView (settingsToUse),
-              persistentFrame (tabsToTrack, stateStoreToUse, audioEngineToUse, previewPlayerToUse),
+              persistentFrame (tabsToTrack, stateStoreToUse, audioEngineToUse, slicePoolToUse, previewPlayerToUse),
               mainTabView (stateStoreToUse),
               headerContainer (tabsToTrack, stateStoreToUse, mainTabView)
         {
@@ -1758,7 +1777,7 @@ namespace
                 audioEngine.setMidiSyncBpm (bpm);
                 audioEngine.saveState();
             });
-            audioEngine.setMidiSyncBpm (stateStoreToUse.getSnapshot().bpm);
+            audioEngine.setMidiSyncBpm (stateStoreToUse.getSnapshot()->bpm);
 
             if (auto* liveContainer = dynamic_cast<LiveModuleContainer*> (liveContent))
             {
@@ -1770,10 +1789,12 @@ namespace
 
             tabs.getTabbedButtonBar().addChangeListener (this);
             updateVisibleContent();
+            startTimerHz (10);
         }
 
         ~ContentArea() override
         {
+            stopTimer();
             tabs.getTabbedButtonBar().removeChangeListener (this);
         }
 
@@ -1819,6 +1840,16 @@ namespace
             updateVisibleContent();
         }
 
+        void timerCallback() override
+        {
+            // slicing tempo follows a locked external clock
+            const auto estimate = audioEngine.getExternalClockEstimate();
+            if (estimate.locked)
+                mainTabView.setExternalBpm (estimate.bpm);
+            else
+                mainTabView.setExternalBpm (std::nullopt);
+        }
+
         void updateVisibleContent()
         {
             const auto currentTab = tabs.getCurrentTabName();
@@ -1875,6 +1906,59 @@ SettingsView::SettingsView (AudioEngine& engine)
         updateVirtualPortsSetting();
     };
 
+    recordQuantizeBox.addItem ("Off", 1);
+    recordQuantizeBox.addItem ("Beat", 2);
+    recordQuantizeBox.addItem ("Bar", 3);
+    recordQuantizeBox.onChange = [this]()
+    {
+        updateRecordQuantizeSetting();
+    };
+
+    padModeToggle.onClick = [this]()
+    {
+        updatePadModeSetting();
+    };
+    padChokeBox.addItem ("None", 1);
+    padChokeBox.addItem ("Per pad", 2);
+    padChokeBox.addItem ("All pads", 3);
+    padChokeBox.onChange = [this]()
+    {
+        updatePadChokeSetting();
+    };
+
+    bufferAutoTuneToggle.onClick = [this]()
+    {
+        updateBufferAutoTuneSetting();
+    };
+
+    for (const int count : { 4, 8, 16, 32 })
+        recorderCountBox.addItem (juce::String (count), count);
+    recorderCountBox.setTooltip ("Takes effect after restarting SliceBot");
+    recorderCountBox.onChange = [this]()
+    {
+        updateRecorderCountSetting();
+    };
+
+    for (const int minutes : { 1, 2, 5, 10 })
+        maxTakeBox.addItem (juce::String (minutes) + " MIN", minutes * 60);
+    maxTakeBox.onChange = [this]()
+    {
+        updateMaxTakeSetting();
+    };
+
+    diagnosticsView.setMultiLine (true);
+    diagnosticsView.setReadOnly (true);
+    diagnosticsView.setCaretVisible (false);
+    diagnosticsView.setFont (juce::Font (juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+    resetDiagnosticsButton.onClick = [this]()
+    {
+        audioEngine.resetCallbackDiagnostics();
+    };
+    exportDiagnosticsButton.onClick = [this]()
+    {
+        exportDiagnostics();
+    };
+
     addAndMakeVisible (*deviceSelector);
     addAndMakeVisible (midiSectionLabel);
     addAndMakeVisible (syncModeLabel);
@@ -1884,9 +1968,26 @@ SettingsView::SettingsView (AudioEngine& engine)
     addAndMakeVisible (syncOutputLabel);
     addAndMakeVisible (syncOutputBox);
     addAndMakeVisible (virtualPortsToggle);
+    addAndMakeVisible (recordQuantizeLabel);
+    addAndMakeVisible (recordQuantizeBox);
+    addAndMakeVisible (padModeToggle);
+    addAndMakeVisible (padChokeLabel);
+    addAndMakeVisible (padChokeBox);
+    addAndMakeVisible (padLatencyLabel);
+    addAndMakeVisible (bufferAutoTuneToggle);
+    addAndMakeVisible (bufferAutoTuneStatusLabel);
+    addAndMakeVisible (recorderCountLabel);
+    addAndMakeVisible (recorderCountBox);
+    addAndMakeVisible (maxTakeLabel);
+    addAndMakeVisible (maxTakeBox);
+    addAndMakeVisible (diagnosticsSectionLabel);
+    addAndMakeVisible (diagnosticsView);
+    addAndMakeVisible (resetDiagnosticsButton);
+    addAndMakeVisible (exportDiagnosticsButton);
 
     refreshMidiDeviceLists();
     applyMidiSettings();
+    startTimerHz (2);
 }
 
 void SettingsView::resized()
@@ -1915,6 +2016,47 @@ void SettingsView::resized()
 
     bounds.removeFromTop (6);
     virtualPortsToggle.setBounds (bounds.removeFromTop (24));
+
+    bounds.removeFromTop (6);
+    row = bounds.removeFromTop (24);
+    recordQuantizeLabel.setBounds (row.removeFromLeft (140));
+    recordQuantizeBox.setBounds (row);
+
+    bounds.removeFromTop (6);
+    padModeToggle.setBounds (bounds.removeFromTop (24));
+
+    bounds.removeFromTop (6);
+    row = bounds.removeFromTop (24);
+    padChokeLabel.setBounds (row.removeFromLeft (140));
+    padChokeBox.setBounds (row);
+
+    bounds.removeFromTop (6);
+    padLatencyLabel.setBounds (bounds.removeFromTop (24));
+
+    bounds.removeFromTop (6);
+    row = bounds.removeFromTop (24);
+    bufferAutoTuneToggle.setBounds (row.removeFromLeft (180));
+    bufferAutoTuneStatusLabel.setBounds (row);
+
+    bounds.removeFromTop (6);
+    row = bounds.removeFromTop (24);
+    recorderCountLabel.setBounds (row.removeFromLeft (140));
+    recorderCountBox.setBounds (row);
+
+    bounds.removeFromTop (6);
+    row = bounds.removeFromTop (24);
+    maxTakeLabel.setBounds (row.removeFromLeft (140));
+    maxTakeBox.setBounds (row);
+
+    bounds.removeFromTop (10);
+    row = bounds.removeFromTop (24);
+    exportDiagnosticsButton.setBounds (row.removeFromRight (100));
+    row.removeFromRight (6);
+    resetDiagnosticsButton.setBounds (row.removeFromRight (80));
+    diagnosticsSectionLabel.setBounds (row);
+
+    bounds.removeFromTop (6);
+    diagnosticsView.setBounds (bounds);
 }
 
 void SettingsView::refreshMidiDeviceLists()
@@ -1976,6 +2118,14 @@ void SettingsView::applyMidiSettings()
     }
 
     virtualPortsToggle.setToggleState (audioEngine.getMidiVirtualPortsEnabled(), juce::dontSendNotification);
+    recordQuantizeBox.setSelectedId (static_cast<int> (audioEngine.getRecordQuantize()) + 1,
+                                     juce::dontSendNotification);
+    padModeToggle.setToggleState (audioEngine.isPadModeEnabled(), juce::dontSendNotification);
+    padChokeBox.setSelectedId (static_cast<int> (audioEngine.getPadChokeMode()) + 1,
+                               juce::dontSendNotification);
+    bufferAutoTuneToggle.setToggleState (audioEngine.isBufferAutoTuneEnabled(), juce::dontSendNotification);
+    recorderCountBox.setSelectedId (audioEngine.getConfiguredRecorderCount(), juce::dontSendNotification);
+    maxTakeBox.setSelectedId (juce::roundToInt (audioEngine.getMaxTakeSeconds()), juce::dontSendNotification);
 }
 
 void SettingsView::updateSyncModeSetting()
@@ -2040,6 +2190,105 @@ void SettingsView::updateVirtualPortsSetting()
     audioEngine.saveState();
 }
 
+void SettingsView::updateRecordQuantizeSetting()
+{
+    const int selected = recordQuantizeBox.getSelectedId();
+    if (selected <= 0)
+        return;
+
+    audioEngine.setRecordQuantize (static_cast<AudioEngine::RecordQuantize> (selected - 1));
+    audioEngine.saveState();
+}
+
+void SettingsView::updatePadModeSetting()
+{
+    audioEngine.setPadModeEnabled (padModeToggle.getToggleState());
+    audioEngine.saveState();
+}
+
+void SettingsView::updatePadChokeSetting()
+{
+    const int selected = padChokeBox.getSelectedId();
+    if (selected <= 0)
+        return;
+
+    audioEngine.setPadChokeMode (static_cast<AudioEngine::PadChokeMode> (selected - 1));
+    audioEngine.saveState();
+}
+
+void SettingsView::updateBufferAutoTuneSetting()
+{
+    audioEngine.setBufferAutoTuneEnabled (bufferAutoTuneToggle.getToggleState());
+    audioEngine.saveState();
+}
+
+void SettingsView::updateRecorderCountSetting()
+{
+    const int selected = recorderCountBox.getSelectedId();
+    if (selected <= 0)
+        return;
+
+    audioEngine.setConfiguredRecorderCount (selected);
+    audioEngine.saveState();
+}
+
+void SettingsView::updateMaxTakeSetting()
+{
+    const int selected = maxTakeBox.getSelectedId();
+    if (selected <= 0)
+        return;
+
+    audioEngine.setMaxTakeSeconds (selected);
+    audioEngine.saveState();
+}
+
+void SettingsView::refreshDiagnostics()
+{
+    diagnosticsView.setText (CallbackProfiler::createReport (audioEngine.getCallbackDiagnostics()), false);
+}
+
+void SettingsView::exportDiagnostics()
+{
+    const auto report = CallbackProfiler::createReport (audioEngine.getCallbackDiagnostics());
+    const auto defaultFile = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                                 .getChildFile ("slicebot_diagnostics.txt");
+
+    diagnosticsChooser = std::make_unique<juce::FileChooser> ("Export Diagnostics", defaultFile, "*.txt");
+    const int flags = juce::FileBrowserComponent::saveMode
+                      | juce::FileBrowserComponent::warnAboutOverwriting;
+    diagnosticsChooser->launchAsync (flags, [report] (const juce::FileChooser& chooser)
+    {
+        const auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        if (! file.replaceWithText (report))
+            juce::Logger::writeToLog ("Diagnostics export failed: " + file.getFullPathName());
+    });
+}
+
+void SettingsView::timerCallback()
+{
+    if (isShowing())
+        refreshDiagnostics();
+
+    bufferAutoTuneStatusLabel.setText (audioEngine.getBufferAutoTuneStatus(), juce::dontSendNotification);
+
+    // note timestamp to first sample at the DAC, including device output latency
+    const auto stats = audioEngine.getPadLatencyStats();
+    if (stats.notes == 0)
+    {
+        padLatencyLabel.setText ("PAD LATENCY: --", juce::dontSendNotification);
+        return;
+    }
+
+    padLatencyLabel.setText ("PAD LATENCY: " + juce::String (stats.lastMs, 1)
+                                 + " ms (avg " + juce::String (stats.meanMs, 1)
+                                 + ", max " + juce::String (stats.maxMs, 1)
+                                 + ", " + juce::String (stats.notes) + " notes)",
+                             juce::dontSendNotification);
+}
+
 // =======================
 // MAIN COMPONENT
 // =======================
@@ -2047,7 +2296,8 @@ void SettingsView::updateVirtualPortsSetting()
 MainComponent::MainComponent (AudioEngine& engine)
     : audioEngine (engine),
       settingsView (engine),
-      previewChainPlayer (engine.getDeviceManager())
+      slicePool (stateStore),
+      previewChainPlayer (engine)
 {
     liveModuleContainer = std::make_unique<LiveModuleContainer> (engine);
 
@@ -2082,6 +2332,7 @@ MainComponent::MainComponent (AudioEngine& engine)
                                          audioEngine,
                                          settingsView,
                                          stateStore,
+                                         slicePool,
                                          previewChainPlayer,
                                          liveModuleContainer.get());
     contentArea->setComponentID ("contentArea");
@@ -2093,7 +2344,9 @@ void MainComponent::visibilityChanged()
     if (! isVisible())
         return;
 
-    stateStore.setCacheData (AudioCacheStore::load());
+    const auto cacheData = AudioCacheStore::load();
+    stateStore.setCacheData (cacheData);
+    EnergyMap::buildMissing (cacheData);
 }
 
 void MainComponent::resized()
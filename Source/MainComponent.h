@@ -5,12 +5,14 @@
 #include "LiveRecorderModuleView.h"
 #include "SliceStateStore.h"
 #include "PreviewChainPlayer.h"
+#include "SpeculativeSlicePool.h"
 
 // =======================
 // SETTINGS VIEW
 // =======================
 
-class SettingsView final : public juce::Component
+class SettingsView final : public juce::Component,
+                           private juce::Timer
 {
 public:
     explicit SettingsView (AudioEngine& engine);
@@ -25,6 +27,15 @@ private:
     void updateSyncInputSetting();
     void updateSyncOutputSetting();
     void updateVirtualPortsSetting();
+    void updateRecordQuantizeSetting();
+    void updatePadModeSetting();
+    void updatePadChokeSetting();
+    void updateBufferAutoTuneSetting();
+    void updateRecorderCountSetting();
+    void updateMaxTakeSetting();
+    void refreshDiagnostics();
+    void exportDiagnostics();
+    void timerCallback() override;
 
     AudioEngine& audioEngine;
 
@@ -38,6 +49,23 @@ private:
     juce::Label syncOutputLabel { "syncOutputLabel", "SYNC OUTPUT DEVICE" };
     juce::ComboBox syncOutputBox;
     juce::ToggleButton virtualPortsToggle { "VIRTUAL PORTS" };
+    juce::Label recordQuantizeLabel { "recordQuantizeLabel", "RECORD QUANTIZE" };
+    juce::ComboBox recordQuantizeBox;
+    juce::ToggleButton padModeToggle { "MIDI PADS (NOTES 36-51)" };
+    juce::Label padChokeLabel { "padChokeLabel", "PAD CHOKE" };
+    juce::ComboBox padChokeBox;
+    juce::Label padLatencyLabel { "padLatencyLabel", "PAD LATENCY: --" };
+    juce::ToggleButton bufferAutoTuneToggle { "AUTO-TUNE BUFFER" };
+    juce::Label bufferAutoTuneStatusLabel { "bufferAutoTuneStatusLabel", "" };
+    juce::Label recorderCountLabel { "recorderCountLabel", "RECORDERS" };
+    juce::ComboBox recorderCountBox;
+    juce::Label maxTakeLabel { "maxTakeLabel", "MAX TAKE" };
+    juce::ComboBox maxTakeBox;
+    juce::Label diagnosticsSectionLabel { "diagnosticsSectionLabel", "CALLBACK DIAGNOSTICS" };
+    juce::TextEditor diagnosticsView;
+    juce::TextButton resetDiagnosticsButton { "RESET" };
+    juce::TextButton exportDiagnosticsButton { "EXPORT LOG" };
+    std::unique_ptr<juce::FileChooser> diagnosticsChooser;
 
     juce::Array<juce::MidiDeviceInfo> midiInputDevices;
     juce::Array<juce::MidiDeviceInfo> midiOutputDevices;
@@ -74,6 +102,7 @@ private:
     SettingsView settingsView;
     std::unique_ptr<juce::Component> liveModuleContainer;
     SliceStateStore stateStore;
+    SpeculativeSlicePool slicePool;
     PreviewChainPlayer previewChainPlayer;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
@@ -1,5 +1,6 @@
 #include "MainTabView.h"
 #include "AudioCacheStore.h"
+#include "EnergyMap.h"
 #include <cmath>
 
 namespace
@@ -8,6 +9,7 @@ namespace
     constexpr int kRowHeight = 28;
     constexpr int kRowSpacing = 10;
     constexpr int kSectionSpacing = 12;
+    constexpr double kExternalBpmHysteresis = 0.05;
 
     juce::Colour backgroundGrey()
     {
@@ -182,48 +184,56 @@ MainTabView::MainTabView (SliceStateStore& stateStoreToUse)
             updateStatusText ("Recaching input directory...");
             updateProgress (0.0f);
 
-            cacheWorker.enqueue ([this, selectedItem, isManualSingle]()
+            // runs while the UI stays up, so the cancel button can stop it
+            juce::Component::SafePointer<MainTabView> safeThis (this);
+            cacheToken = JobScheduler::makeToken();
+            cacheJob = JobScheduler::get().submit (JobScheduler::Priority::analysis, [this, safeThis, selectedItem, isManualSingle]()
             {
                 bool wasCancelled = false;
-                const double bpm = stateStore.getSnapshot().bpm;
                 const auto cacheData = AudioCacheStore::buildFromSource (
                     selectedItem,
                     ! isManualSingle,
-                    bpm,
                     &cancelCache,
-                    [this] (int current, int total)
+                    [safeThis] (int current, int total)
                     {
                         const bool hasTotal = total > 0;
                         const float progress = hasTotal
                                                    ? static_cast<float> (current) / static_cast<float> (total)
                                                    : 0.0f;
-                        juce::MessageManager::callAsync ([this, current, total, progress, hasTotal]()
+                        juce::MessageManager::callAsync ([safeThis, current, total, progress, hasTotal]()
                         {
+                            if (safeThis == nullptr)
+                                return;
+
                             if (hasTotal)
-                                updateStatusText ("Recaching: " + juce::String (current) + " of " + juce::String (total) + " files processed.");
+                                safeThis->updateStatusText ("Recaching: " + juce::String (current) + " of " + juce::String (total) + " files processed.");
                             else
-                                updateStatusText ("Recaching: " + juce::String (current) + " files processed.");
-                            updateProgress (progress);
+                                safeThis->updateStatusText ("Recaching: " + juce::String (current) + " files processed.");
+                            safeThis->updateProgress (progress);
                         });
                     },
                     &wasCancelled);
 
-                juce::MessageManager::callAsync ([this, cacheData, wasCancelled]()
+                juce::MessageManager::callAsync ([safeThis, cacheData, wasCancelled]()
                 {
-                    stateStore.setCacheData (cacheData);
+                    if (safeThis == nullptr)
+                        return;
+
+                    safeThis->stateStore.setCacheData (cacheData);
+                    EnergyMap::buildMissing (cacheData);
                     if (wasCancelled)
                     {
-                        updateStatusText ("Recache cancelled. Cached " + juce::String (cacheData.entries.size()) + " files so far.");
+                        safeThis->updateStatusText ("Recache cancelled. Cached " + juce::String (cacheData.entries.size()) + " files so far.");
                     }
                     else
                     {
                         AudioCacheStore::save (cacheData);
-                        updateStatusText ("Recached " + juce::String (cacheData.entries.size()) + " audio files.");
+                        safeThis->updateStatusText ("Recached " + juce::String (cacheData.entries.size()) + " audio files.");
                     }
-                    updateProgress (1.0f);
-                    setCachingState (false);
+                    safeThis->updateProgress (1.0f);
+                    safeThis->setCachingState (false);
                 });
-            });
+            }, cacheToken);
         });
     };
 
@@ -257,13 +267,21 @@ MainTabView::MainTabView (SliceStateStore& stateStoreToUse)
     addAndMakeVisible (samplesEight);
     addAndMakeVisible (samplesSixteen);
 
-    applySettingsSnapshot (stateStore.getSnapshot());
-    setCachingState (stateStore.getSnapshot().isCaching);
+    applySettingsSnapshot (*stateStore.getSnapshot());
+    setCachingState (stateStore.getSnapshot()->isCaching);
     updateSourceModeState();
 }
 
 MainTabView::~MainTabView()
 {
+    // the scan reads cancelCache, so it has to stop before the member goes;
+    // the token drops it if it has not started yet
+    cancelCache.store (true);
+    if (cacheToken != nullptr)
+        cacheToken->cancel();
+
+    JobScheduler::get().wait (cacheJob);
+
     setLookAndFeel (nullptr);
 }
 
@@ -386,9 +404,8 @@ void MainTabView::setSubdivisionToggleState (int subdivisionSteps)
 void MainTabView::setSubdivisionFromUi (int subdivisionSteps)
 {
     const auto snapshot = stateStore.getSnapshot();
-    const double newBpm = bpmValue.getText().getDoubleValue();
 
-    int samples = snapshot.sampleCountSetting;
+    int samples = snapshot->sampleCountSetting;
     if (samplesFour.getToggleState())
         samples = 4;
     else if (samplesEight.getToggleState())
@@ -396,26 +413,43 @@ void MainTabView::setSubdivisionFromUi (int subdivisionSteps)
     else if (samplesSixteen.getToggleState())
         samples = 16;
 
-    const double safeBpm = newBpm > 0.0 ? newBpm : snapshot.bpm;
     const int subdivision = normalisedSubdivision (subdivisionSteps);
 
     setSubdivisionToggleState (subdivision);
+    applySliceSettings (bpmFromLabel (*snapshot), subdivision, samples);
+}
 
-    stateStore.setSliceSettings (safeBpm,
-                                 subdivision,
-                                 samples,
-                                 snapshot.transientDetectionEnabled);
-    bpmValue.setText (juce::String (safeBpm, 1), juce::dontSendNotification);
+// the label shows one decimal, so the exact BPM is kept unless the text was
+// edited to something else
+double MainTabView::bpmFromLabel (const SliceStateStore::SliceStateSnapshot& snapshot) const
+{
+    const auto text = bpmValue.getText();
+    if (text == juce::String (snapshot.bpm, 1))
+        return snapshot.bpm;
+
+    const double editedBpm = text.getDoubleValue();
+    return editedBpm > 0.0 ? editedBpm : snapshot.bpm;
+}
+
+// every BPM change comes through here, edited or followed from a clock, so
+// MIDI sync and the saved state always see it
+void MainTabView::applySliceSettings (double bpm, int subdivisionSteps, int sampleCountSetting)
+{
+    stateStore.setSliceSettings (bpm,
+                                 subdivisionSteps,
+                                 sampleCountSetting,
+                                 stateStore.getSnapshot()->transientDetectionEnabled);
+    bpmValue.setText (juce::String (bpm, 1), juce::dontSendNotification);
 
     if (bpmChangedCallback)
-        bpmChangedCallback (safeBpm);
+        bpmChangedCallback (bpm);
 }
 
 void MainTabView::updateSliceSettingsFromUi()
 {
     const auto snapshot = stateStore.getSnapshot();
 
-    int subdivision = snapshot.subdivisionSteps;
+    int subdivision = snapshot->subdivisionSteps;
     if (subdivHalfBar.getToggleState())
         subdivision = 8;
     else if (subdivQuarterBar.getToggleState())
@@ -485,7 +519,7 @@ void MainTabView::setCachingState (bool cachingState)
     subdivEighthNote.setEnabled (enabled);
     subdivSixteenthNote.setEnabled (enabled);
     subdivRandom.setEnabled (enabled);
-    bpmValue.setEnabled (enabled);
+    bpmValue.setEnabled (enabled && ! followingExternalBpm);
     samplesFour.setEnabled (enabled);
     samplesEight.setEnabled (enabled);
     samplesSixteen.setEnabled (enabled);
@@ -499,6 +533,25 @@ void MainTabView::setLiveModeSelected (bool isLive)
     updateSourceModeState();
 }
 
+void MainTabView::setExternalBpm (std::optional<double> bpm)
+{
+    const bool following = bpm.has_value();
+    if (following != followingExternalBpm)
+    {
+        followingExternalBpm = following;
+        bpmValue.setEnabled (! following && ! isCaching.load());
+    }
+
+    if (! following)
+        return;
+
+    const auto snapshot = stateStore.getSnapshot();
+    if (std::abs (*bpm - snapshot->bpm) < kExternalBpmHysteresis)
+        return;
+
+    applySliceSettings (*bpm, snapshot->subdivisionSteps, snapshot->sampleCountSetting);
+}
+
 void MainTabView::setProgress (float progress)
 {
     if (progressCallback)
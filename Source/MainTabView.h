@@ -2,8 +2,9 @@
 
 #include <JuceHeader.h>
 #include <atomic>
+#include <optional>
+#include "JobScheduler.h"
 #include "SliceStateStore.h"
-#include "BackgroundWorker.h"
 
 class MainTabView final : public juce::Component
 {
@@ -19,6 +20,7 @@ public:
     void setBpmChangedCallback (std::function<void(double)> callback);
     void setProgress (float progress);
     void setLiveModeSelected (bool isLive);
+    void setExternalBpm (std::optional<double> bpm);
 
 private:
     static constexpr float kFontSize = 11.0f;
@@ -47,6 +49,8 @@ private:
     void applySettingsSnapshot (const SliceStateStore::SliceStateSnapshot& snapshot);
     void setSubdivisionToggleState (int subdivisionSteps);
     void setSubdivisionFromUi (int subdivisionSteps);
+    double bpmFromLabel (const SliceStateStore::SliceStateSnapshot& snapshot) const;
+    void applySliceSettings (double bpm, int subdivisionSteps, int sampleCountSetting);
     void updateSliceSettingsFromUi();
     void updateStatusText (const juce::String& text);
     void updateProgress (float progress);
@@ -81,9 +85,11 @@ private:
     std::function<void(const juce::String&)> statusTextCallback;
     std::function<void(float)> progressCallback;
     std::function<void(double)> bpmChangedCallback;
-    BackgroundWorker cacheWorker;
+    JobScheduler::JobHandle cacheJob;
+    JobScheduler::Token cacheToken;
     std::atomic<bool> isCaching { false };
     std::atomic<bool> cancelCache { false };
+    bool followingExternalBpm = false;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainTabView)
 };
@@ -0,0 +1,246 @@
+#include "MidiClockFollower.h"
+#include <cmath>
+
+namespace
+{
+    constexpr double kPulsesPerQuarterNote = 24.0;
+    constexpr double kMinPeriodMs = 60000.0 / (300.0 * kPulsesPerQuarterNote);
+    constexpr double kMaxPeriodMs = 60000.0 / (20.0 * kPulsesPerQuarterNote);
+
+    // loop gain once acquired; lower rejects more transport jitter
+    constexpr double kTrackingAlpha = 0.05;
+    constexpr int kLockTicks = 24;
+    constexpr double kDropoutPeriods = 4.0;
+}
+
+double MidiClockFollower::Estimate::getBeatPositionAt (double timeMs) const
+{
+    if (tickPeriodMs <= 0.0)
+        return 0.0;
+
+    const double ticks = static_cast<double> (tickIndex)
+                         + (timeMs - tickTimeMs) / tickPeriodMs;
+    return ticks / kPulsesPerQuarterNote;
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+MidiClockFollower::MidiClockFollower() {}
+
+// =====================================================
+// MIDI THREAD
+// =====================================================
+
+void MidiClockFollower::handleClock (double timestampMs)
+{
+    if (resetRequested.exchange (false))
+    {
+        hasFirstTick = false;
+        hasPeriod = false;
+        running = false;
+        tickIndex = -1;
+    }
+
+    if (! hasFirstTick)
+    {
+        hasFirstTick = true;
+        hasPeriod = false;
+        filteredTickMs = timestampMs;
+        ticksSinceAcquire = 0;
+        ++tickIndex;
+        publish();
+        return;
+    }
+
+    if (! hasPeriod)
+    {
+        const double interval = timestampMs - filteredTickMs;
+        if (interval < kMinPeriodMs * 0.5 || interval > kMaxPeriodMs * 2.0)
+        {
+            filteredTickMs = timestampMs;
+            ++tickIndex;
+            return;
+        }
+
+        periodMs = juce::jlimit (kMinPeriodMs, kMaxPeriodMs, interval);
+        filteredTickMs = timestampMs;
+        hasPeriod = true;
+        ticksSinceAcquire = 1;
+        ++tickIndex;
+        publish();
+        return;
+    }
+
+    // a dropout means the phase is unknown; carry the tick count and reacquire
+    const double gap = timestampMs - filteredTickMs;
+    if (gap > periodMs * kDropoutPeriods)
+    {
+        tickIndex += juce::jmax<juce::int64> (1, static_cast<juce::int64> (std::llround (gap / periodMs)));
+        filteredTickMs = timestampMs;
+        ticksSinceAcquire = 0;
+        hasPeriod = false;
+        publish();
+        return;
+    }
+
+    const double alpha = juce::jmax (kTrackingAlpha,
+                                     1.0 / static_cast<double> (ticksSinceAcquire + 1));
+    const double beta = alpha * alpha / (2.0 - alpha);
+
+    const double predicted = filteredTickMs + periodMs;
+    const double error = timestampMs - predicted;
+
+    filteredTickMs = predicted + alpha * error;
+    periodMs = juce::jlimit (kMinPeriodMs, kMaxPeriodMs, periodMs + beta * error);
+    ++tickIndex;
+    ++ticksSinceAcquire;
+
+    publish();
+}
+
+void MidiClockFollower::handleStart()
+{
+    // the first clock after a start is beat zero
+    running = true;
+    tickIndex = -1;
+    publish();
+}
+
+void MidiClockFollower::handleStop()
+{
+    running = false;
+    publish();
+}
+
+void MidiClockFollower::publish()
+{
+    const auto start = sequence.load();
+    sequence.store (start + 1);
+
+    publishedTickMs.store (filteredTickMs);
+    publishedPeriodMs.store (hasPeriod ? periodMs : 0.0);
+    publishedTickIndex.store (tickIndex);
+    publishedLocked.store (hasPeriod && ticksSinceAcquire >= kLockTicks);
+    publishedRunning.store (running);
+
+    sequence.store (start + 2);
+}
+
+// =====================================================
+// ANY THREAD
+// =====================================================
+
+void MidiClockFollower::reset()
+{
+    resetRequested.store (true);
+}
+
+MidiClockFollower::Estimate MidiClockFollower::getEstimate (double nowMs) const
+{
+    Estimate estimate;
+    if (resetRequested.load())
+        return estimate;
+
+    for (;;)
+    {
+        const auto before = sequence.load();
+        if ((before & 1u) != 0)
+            continue;
+
+        estimate.tickTimeMs = publishedTickMs.load();
+        estimate.tickPeriodMs = publishedPeriodMs.load();
+        estimate.tickIndex = publishedTickIndex.load();
+        estimate.locked = publishedLocked.load();
+        estimate.transportRunning = publishedRunning.load();
+
+        if (sequence.load() == before)
+            break;
+    }
+
+    if (estimate.tickPeriodMs > 0.0)
+        estimate.bpm = 60000.0 / (estimate.tickPeriodMs * kPulsesPerQuarterNote);
+
+    if (nowMs - estimate.tickTimeMs > estimate.tickPeriodMs * kDropoutPeriods)
+        estimate.locked = false;
+
+    return estimate;
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class MidiClockFollowerTests final : public juce::UnitTest
+{
+public:
+    MidiClockFollowerTests() : juce::UnitTest ("MidiClockFollower", "Slicebot") {}
+
+    void runTest() override
+    {
+        beginTest ("a jittery clock is followed with sub-millisecond phase error");
+        {
+            const auto result = follow ({ 120.0 }, 1.0);
+            expectWithinAbsoluteError (result.bpm, 120.0, 0.05);
+            expectLessThan (result.maxPhaseErrorMs, 1.0);
+        }
+
+        beginTest ("a tempo change is followed back to sub-millisecond phase error");
+        {
+            const auto result = follow ({ 120.0, 133.0 }, 1.0);
+            expectWithinAbsoluteError (result.bpm, 133.0, 0.05);
+            expectLessThan (result.maxPhaseErrorMs, 1.0);
+        }
+    }
+
+private:
+    static constexpr int kTicksPerTempo = 2400;
+    static constexpr int kSettleTicks = 480;
+
+    struct Result
+    {
+        double bpm = 0.0;
+        double maxPhaseErrorMs = 0.0; // over the last tempo, once settled
+    };
+
+    // clock ticks at each tempo in turn, each sent up to jitterMs late; the
+    // phase error is how far the estimate puts the true tick time from its beat
+    static Result follow (std::initializer_list<double> tempos, double jitterMs)
+    {
+        MidiClockFollower follower;
+        juce::Random random (0x5eed);
+        follower.handleStart();
+
+        Result result;
+        double tickMs = 1000.0;
+        juce::int64 tick = 0;
+        int tempoIndex = 0;
+
+        for (const double bpm : tempos)
+        {
+            const double periodMs = 60000.0 / (bpm * kPulsesPerQuarterNote);
+            const bool last = ++tempoIndex == static_cast<int> (tempos.size());
+
+            for (int i = 0; i < kTicksPerTempo; ++i, ++tick, tickMs += periodMs)
+            {
+                follower.handleClock (tickMs + random.nextDouble() * jitterMs);
+                if (! last || i < kSettleTicks)
+                    continue;
+
+                const auto estimate = follower.getEstimate (tickMs);
+                const double beatError = estimate.getBeatPositionAt (tickMs) - static_cast<double> (tick) / kPulsesPerQuarterNote;
+                result.maxPhaseErrorMs = juce::jmax (result.maxPhaseErrorMs, std::abs (beatError) * 60000.0 / bpm);
+                result.bpm = estimate.bpm;
+            }
+        }
+
+        return result;
+    }
+};
+
+static MidiClockFollowerTests midiClockFollowerTests;
+
+#endif
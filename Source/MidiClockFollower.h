@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// Tracks tempo and phase of an incoming 24 PPQN clock with an alpha-beta
+// (steady-state Kalman) filter. Only the MIDI thread writes; readers get a
+// consistent copy through a sequence counter, so neither side blocks.
+class MidiClockFollower
+{
+public:
+    struct Estimate
+    {
+        bool locked = false;
+        bool transportRunning = false;
+        double bpm = 0.0;
+        double tickTimeMs = 0.0;
+        double tickPeriodMs = 0.0;
+        juce::int64 tickIndex = 0;
+
+        // beats since the last MIDI start, extrapolated to timeMs
+        double getBeatPositionAt (double timeMs) const;
+    };
+
+    MidiClockFollower();
+
+    // =====================================================
+    // MIDI THREAD
+    // =====================================================
+    void handleClock (double timestampMs);
+    void handleStart();
+    void handleStop();
+
+    // =====================================================
+    // ANY THREAD
+    // =====================================================
+    void reset();
+    Estimate getEstimate (double nowMs) const;
+
+private:
+    void publish();
+
+    // MIDI thread state
+    bool hasFirstTick = false;
+    bool hasPeriod = false;
+    bool running = false;
+    double filteredTickMs = 0.0;
+    double periodMs = 0.0;
+    juce::int64 tickIndex = -1;
+    int ticksSinceAcquire = 0;
+
+    std::atomic<bool> resetRequested { false };
+
+    std::atomic<juce::uint32> sequence { 0 };
+    std::atomic<double> publishedTickMs { 0.0 };
+    std::atomic<double> publishedPeriodMs { 0.0 };
+    std::atomic<juce::int64> publishedTickIndex { 0 };
+    std::atomic<bool> publishedLocked { false };
+    std::atomic<bool> publishedRunning { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiClockFollower)
+};
@@ -0,0 +1,348 @@
+#include "MidiClockScheduler.h"
+#include "BlockClock.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    constexpr double kMinBpm = 20.0;
+    constexpr double kMaxBpm = 300.0;
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+MidiClockScheduler::MidiClockScheduler() {}
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+void MidiClockScheduler::setBpm (double newBpm)
+{
+    bpm.store (juce::jlimit (kMinBpm, kMaxBpm, newBpm));
+}
+
+void MidiClockScheduler::requestStart()
+{
+    generation.fetch_add (1);
+    stopFinished.store (false);
+    pendingRequest.store (kRequestStart);
+}
+
+void MidiClockScheduler::requestStop (bool sendStopMessage)
+{
+    // a silent stop also invalidates anything still queued
+    if (! sendStopMessage)
+        generation.fetch_add (1);
+
+    stopFinished.store (! sendStopMessage);
+    pendingRequest.store (sendStopMessage ? kRequestStop : kRequestSilentStop);
+}
+
+bool MidiClockScheduler::isStopFinished() const
+{
+    return stopFinished.load();
+}
+
+MidiClockScheduler::JitterStats MidiClockScheduler::getJitterStats() const
+{
+    JitterStats stats;
+    stats.ticksSent = statsTicks.load();
+    stats.maxAbsErrorMs = statsMaxAbsErrorMs.load();
+
+    if (stats.ticksSent > 0)
+        stats.meanAbsErrorMs = statsSumAbsErrorMs.load() / stats.ticksSent;
+
+    const int intervals = statsIntervals.load();
+    if (intervals > 0)
+        stats.intervalStdDevMs = std::sqrt (statsSumIntervalErrorSq.load() / intervals);
+
+    const int gridIntervals = statsGridIntervals.load();
+    if (gridIntervals > 0)
+        stats.gridStdDevMs = std::sqrt (statsSumGridErrorSq.load() / gridIntervals);
+
+    stats.gridMaxErrorMs = statsGridMaxErrorMs.load();
+    return stats;
+}
+
+void MidiClockScheduler::resetJitterStats()
+{
+    statsResetRequested.store (true);
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void MidiClockScheduler::prepare (double newSampleRate, int newOutputLatencySamples)
+{
+    sampleRate = newSampleRate;
+    outputLatencySamples = juce::jmax (0, newOutputLatencySamples);
+}
+
+void MidiClockScheduler::processBlock (int numSamples, double blockStartMs)
+{
+    if (sampleRate <= 0.0 || numSamples <= 0)
+        return;
+
+    const double msPerSample = 1000.0 / sampleRate;
+    const double latencyMs = outputLatencySamples * msPerSample;
+
+    const int request = pendingRequest.exchange (kRequestNone);
+    if (request == kRequestStart)
+    {
+        activeGeneration = generation.load();
+        running = true;
+        samplesUntilNextTick = 0.0;
+        lastTickSpacingSamples = 0.0;
+        ticksEmitted = 0;
+        push (EventType::start, blockStartMs + latencyMs);
+    }
+    else if (request == kRequestStop)
+    {
+        // queued behind the ticks already scheduled, and sent when due
+        if (running)
+            push (EventType::stop, blockStartMs + latencyMs);
+        else
+            stopFinished.store (true);
+
+        running = false;
+    }
+    else if (request == kRequestSilentStop)
+    {
+        running = false;
+    }
+
+    if (! running)
+        return;
+
+    // fractional phase carries across blocks, so the tick grid never drifts
+    samplesPerTick =
+        sampleRate * 60.0 / (bpm.load() * static_cast<double> (kPulsesPerQuarterNote));
+
+    while (samplesUntilNextTick < static_cast<double> (numSamples))
+    {
+        push (EventType::clock,
+              blockStartMs + latencyMs + samplesUntilNextTick * msPerSample,
+              lastTickSpacingSamples * msPerSample);
+        samplesUntilNextTick += samplesPerTick;
+        lastTickSpacingSamples = samplesPerTick;
+        ++ticksEmitted;
+    }
+
+    samplesUntilNextTick -= static_cast<double> (numSamples);
+}
+
+bool MidiClockScheduler::getGridAtBlockStart (double& beatPosition, double& samplesPerBeat) const
+{
+    if (! running || samplesPerTick <= 0.0)
+        return false;
+
+    // the next tick to emit is ticksEmitted, samplesUntilNextTick from now
+    const double ticks = static_cast<double> (ticksEmitted) - samplesUntilNextTick / samplesPerTick;
+    beatPosition = ticks / static_cast<double> (kPulsesPerQuarterNote);
+    samplesPerBeat = samplesPerTick * static_cast<double> (kPulsesPerQuarterNote);
+    return true;
+}
+
+void MidiClockScheduler::push (EventType type, double dueMs, double intervalMs)
+{
+    const auto scope = fifo.write (1);
+    if (scope.blockSize1 > 0)
+        queue[static_cast<size_t> (scope.startIndex1)] = { type, dueMs, intervalMs, activeGeneration };
+    else if (scope.blockSize2 > 0)
+        queue[static_cast<size_t> (scope.startIndex2)] = { type, dueMs, intervalMs, activeGeneration };
+}
+
+// =====================================================
+// DISPATCH THREAD
+// =====================================================
+
+void MidiClockScheduler::dispatchDue (juce::MidiOutput& output, double nowMs)
+{
+    dispatchDue ([&output] (const juce::MidiMessage& message) { output.sendMessageNow (message); }, nowMs);
+}
+
+void MidiClockScheduler::dispatchDue (const std::function<void (const juce::MidiMessage&)>& send,
+                                      double nowMs)
+{
+    if (statsResetRequested.exchange (false))
+    {
+        statsTicks.store (0);
+        statsSumAbsErrorMs.store (0.0);
+        statsMaxAbsErrorMs.store (0.0);
+        statsSumIntervalErrorSq.store (0.0);
+        statsIntervals.store (0);
+        statsSumGridErrorSq.store (0.0);
+        statsGridMaxErrorMs.store (0.0);
+        statsGridIntervals.store (0);
+        lastTickSentMs = 0.0;
+    }
+
+    const int currentGeneration = generation.load();
+
+    while (fifo.getNumReady() > 0)
+    {
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        fifo.prepareToRead (1, start1, size1, start2, size2);
+        const auto& event = queue[static_cast<size_t> (size1 > 0 ? start1 : start2)];
+
+        if (event.generation == currentGeneration)
+        {
+            if (event.dueMs > nowMs)
+                return;
+
+            switch (event.type)
+            {
+                case EventType::clock:
+                    send (juce::MidiMessage::midiClock());
+                    break;
+                case EventType::start:
+                    send (juce::MidiMessage::midiStart());
+                    lastTickSentMs = 0.0;
+                    break;
+                case EventType::stop:
+                    send (juce::MidiMessage::midiStop());
+                    stopFinished.store (true);
+                    break;
+            }
+
+            if (event.type == EventType::clock)
+            {
+                const double sentMs = juce::Time::getMillisecondCounterHiRes();
+                const double absError = std::abs (sentMs - event.dueMs);
+                statsTicks.store (statsTicks.load() + 1);
+                statsSumAbsErrorMs.store (statsSumAbsErrorMs.load() + absError);
+                statsMaxAbsErrorMs.store (juce::jmax (statsMaxAbsErrorMs.load(), absError));
+
+                if (lastTickSentMs > 0.0)
+                {
+                    const double intervalError =
+                        (sentMs - lastTickSentMs) - (event.dueMs - lastTickDueMs);
+                    statsSumIntervalErrorSq.store (statsSumIntervalErrorSq.load()
+                                                   + intervalError * intervalError);
+                    statsIntervals.store (statsIntervals.load() + 1);
+                }
+
+                // the grid is judged on due times alone, so it shows what the
+                // block clock did independent of how promptly this thread ran
+                if (event.intervalMs > 0.0)
+                {
+                    const double gridError = std::abs ((event.dueMs - lastTickDueMs) - event.intervalMs);
+                    statsSumGridErrorSq.store (statsSumGridErrorSq.load() + gridError * gridError);
+                    statsGridMaxErrorMs.store (juce::jmax (statsGridMaxErrorMs.load(), gridError));
+                    statsGridIntervals.store (statsGridIntervals.load() + 1);
+                }
+
+                lastTickSentMs = sentMs;
+                lastTickDueMs = event.dueMs;
+            }
+        }
+
+        fifo.finishedRead (1);
+    }
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class MidiClockSchedulerTests final : public juce::UnitTest
+{
+public:
+    MidiClockSchedulerTests() : juce::UnitTest ("MidiClockScheduler", "Slicebot") {}
+
+    void runTest() override
+    {
+        beginTest ("the tick grid holds its spacing through callback jitter");
+        {
+            const auto stats = runClock (true);
+            expectGreaterThan (stats.ticksSent, 400);
+            expect (stats.isGridWithinTolerance(),
+                    "grid off by " + juce::String (stats.gridMaxErrorMs, 3) + " ms");
+        }
+
+        beginTest ("the grid check catches ticks timed from callback entry");
+        expect (! runClock (false).isGridWithinTolerance());
+
+        beginTest ("a stop goes out from the callback after the last tick");
+        {
+            constexpr double sampleRate = 48000.0;
+            constexpr int blockSize = 256;
+            const double periodMs = blockSize * 1000.0 / sampleRate;
+
+            MidiClockScheduler scheduler;
+            scheduler.prepare (sampleRate, 0);
+            scheduler.requestStart();
+
+            std::vector<juce::MidiMessage> sent;
+            const auto record = [&sent] (const juce::MidiMessage& message) { sent.push_back (message); };
+
+            for (int block = 0; block < 8; ++block)
+                scheduler.processBlock (blockSize, block * periodMs);
+
+            scheduler.requestStop (true);
+            expect (! scheduler.isStopFinished());
+
+            // nothing goes out before the block that carries the stop is due
+            const double stopBlockMs = 8 * periodMs;
+            scheduler.processBlock (blockSize, stopBlockMs);
+            scheduler.dispatchDue (record, stopBlockMs - 0.001);
+            expect (! scheduler.isStopFinished());
+            expect (! sent.empty() && ! sent.back().isMidiStop());
+
+            scheduler.dispatchDue (record, stopBlockMs);
+            expect (scheduler.isStopFinished());
+            expect (sent.back().isMidiStop());
+            expect (sent.front().isMidiStart());
+
+            // a stop with nothing running finishes in the next block
+            scheduler.requestStop (true);
+            scheduler.processBlock (blockSize, stopBlockMs + periodMs);
+            expect (scheduler.isStopFinished());
+        }
+    }
+
+private:
+    // ten seconds of 120 BPM in 256-sample blocks, each callback up to 3 ms late
+    static MidiClockScheduler::JitterStats runClock (bool throughBlockClock)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 256;
+        constexpr int numBlocks = static_cast<int> (10.0 * sampleRate / blockSize);
+
+        MidiClockScheduler scheduler;
+        scheduler.prepare (sampleRate, blockSize);
+        scheduler.setBpm (120.0);
+        scheduler.resetJitterStats();
+        scheduler.requestStart();
+
+        BlockClock clock;
+        clock.prepare (sampleRate);
+
+        juce::Random random (1);
+        const double periodMs = blockSize * 1000.0 / sampleRate;
+        const auto ignore = [] (const juce::MidiMessage&) {};
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const double callbackMs = 1000.0 + block * periodMs + 3.0 * random.nextDouble();
+            const double blockStartMs = throughBlockClock ? clock.advance (blockSize, callbackMs, nullptr)
+                                                          : callbackMs;
+
+            scheduler.processBlock (blockSize, blockStartMs);
+            scheduler.dispatchDue (ignore, std::numeric_limits<double>::max());
+        }
+
+        return scheduler.getJitterStats();
+    }
+};
+
+static MidiClockSchedulerTests midiClockSchedulerTests;
+
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <functional>
+
+// Derives 24 PPQN clock, start and stop from the audio callback's sample
+// position. The audio thread queues events with their due time (block time
+// plus output latency); a dispatch thread sends them when they fall due.
+class MidiClockScheduler
+{
+public:
+    static constexpr int kPulsesPerQuarterNote = 24;
+
+    // how far the scheduled tick grid may stray from the tempo's spacing
+    static constexpr double kGridToleranceMs = 0.1;
+
+    struct JitterStats
+    {
+        int ticksSent = 0;
+        double meanAbsErrorMs = 0.0;   // sent against due
+        double maxAbsErrorMs = 0.0;
+        double intervalStdDevMs = 0.0; // sent spacing against due spacing
+        double gridStdDevMs = 0.0;     // due spacing against the tempo's
+        double gridMaxErrorMs = 0.0;
+
+        bool isGridWithinTolerance() const { return gridMaxErrorMs <= kGridToleranceMs; }
+    };
+
+    MidiClockScheduler();
+
+    // =====================================================
+    // MESSAGE THREAD
+    // =====================================================
+    void setBpm (double bpm);
+    void requestStart();
+    void requestStop (bool sendStopMessage);
+
+    // any thread: the Stop last requested has been sent, or the clock was not
+    // running and there was nothing to stop
+    bool isStopFinished() const;
+
+    JitterStats getJitterStats() const;
+    void resetJitterStats();
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    void prepare (double sampleRate, int outputLatencySamples);
+    void processBlock (int numSamples, double blockStartMs);
+
+    // beat position at the start of the block about to be processed
+    bool getGridAtBlockStart (double& beatPosition, double& samplesPerBeat) const;
+
+    // =====================================================
+    // DISPATCH THREAD
+    // =====================================================
+    void dispatchDue (juce::MidiOutput& output, double nowMs);
+    void dispatchDue (const std::function<void (const juce::MidiMessage&)>& send, double nowMs);
+
+private:
+    enum class EventType
+    {
+        clock,
+        start,
+        stop
+    };
+
+    enum Request
+    {
+        kRequestNone = 0,
+        kRequestStart = 1,
+        kRequestStop = 2,
+        kRequestSilentStop = 3
+    };
+
+    struct ScheduledEvent
+    {
+        EventType type = EventType::clock;
+        double dueMs = 0.0;
+        double intervalMs = 0.0; // the tempo's spacing from the tick before; 0 after a start
+        int generation = 0;
+    };
+
+    static constexpr int kQueueSize = 1024;
+
+    void push (EventType type, double dueMs, double intervalMs = 0.0);
+
+    juce::AbstractFifo fifo { kQueueSize };
+    std::array<ScheduledEvent, kQueueSize> queue;
+
+    std::atomic<double> bpm { 120.0 };
+    std::atomic<int> pendingRequest { kRequestNone };
+    std::atomic<int> generation { 0 };
+    std::atomic<bool> stopFinished { false };
+
+    // audio thread
+    double sampleRate = 0.0;
+    int outputLatencySamples = 0;
+    bool running = false;
+    double samplesUntilNextTick = 0.0;
+    double samplesPerTick = 0.0;
+    double lastTickSpacingSamples = 0.0;
+    juce::int64 ticksEmitted = 0;
+    int activeGeneration = 0;
+
+    // dispatch thread
+    double lastTickSentMs = 0.0;
+    double lastTickDueMs = 0.0;
+    std::atomic<int> statsTicks { 0 };
+    std::atomic<double> statsSumAbsErrorMs { 0.0 };
+    std::atomic<double> statsMaxAbsErrorMs { 0.0 };
+    std::atomic<double> statsSumIntervalErrorSq { 0.0 };
+    std::atomic<int> statsIntervals { 0 };
+    std::atomic<double> statsSumGridErrorSq { 0.0 };
+    std::atomic<double> statsGridMaxErrorMs { 0.0 };
+    std::atomic<int> statsGridIntervals { 0 };
+    std::atomic<bool> statsResetRequested { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiClockScheduler)
+};
@@ -4,16 +4,18 @@
 #include <unordered_map>
 
 #include "AudioFileIO.h"
-#include "BackgroundWorker.h"
+#include "EnergyMap.h"
 #include "ExportOrchestrator.h"
+#include "JobScheduler.h"
 #include "PreviewChainOrchestrator.h"
 #include "SliceInfrastructure.h"
+#include "SliceRandom.h"
+#include "SpeculativeSlicePool.h"
 #include "AudioEngine.h"
 #include "RecordingBus.h"
 #include "RecordingModule.h"
 
 namespace {
-    constexpr double kTargetSampleRate = 44100.0;
     const juce::Array<int> kAllowedSubdivisionsSteps = { 8, 4, 2, 1 };
     constexpr int kPachinkoStutterCountMin = 2;
     constexpr int kPachinkoStutterCountMax = 8;
@@ -37,10 +39,10 @@ namespace {
         return 60.0 / resolvedBpm (bpm);
     }
 
-    int barWindowFrames (double bpm)
+    int barWindowFrames (double bpm, double sampleRate)
     {
         const double seconds = secondsPerBeat (bpm) * 4.0;
-        return static_cast<int> (std::lround (seconds * kTargetSampleRate));
+        return static_cast<int> (std::lround (seconds * sampleRate));
     }
 
     double subdivisionToQuarterNotes (int subdivisionSteps)
@@ -74,11 +76,10 @@ namespace {
         return kAllowedSubdivisionsSteps[index];
     }
 
-    std::vector<int> buildRandomSubdivisions (int count)
+    std::vector<int> buildRandomSubdivisions (int count, juce::Random& random)
     {
         std::vector<int> subdivisions;
         subdivisions.reserve (static_cast<std::size_t> (count));
-        juce::Random random;
         for (int i = 0; i < count; ++i)
             subdivisions.push_back (randomSubdivision (random));
         return subdivisions;
@@ -87,8 +88,9 @@ namespace {
     struct SlicingSources
     {
         SliceStateStore::SourceMode sourceMode = SliceStateStore::SourceMode::multi;
-        juce::Array<AudioCacheStore::CacheEntry> cacheEntries;
+        std::shared_ptr<const SliceStateStore::CandidateSet> candidates;
         std::vector<juce::File> liveFiles;
+        std::vector<int> liveRecorders; // recorder index of each liveFiles entry
         juce::File manualFile;
         juce::String emptyReason;
 
@@ -98,7 +100,7 @@ namespace {
             {
                 case SliceStateStore::SourceMode::multi:
                 case SliceStateStore::SourceMode::singleRandom:
-                    return ! cacheEntries.isEmpty();
+                    return candidates != nullptr && ! candidates->isEmpty();
                 case SliceStateStore::SourceMode::singleManual:
                     return manualFile.existsAsFile();
                 case SliceStateStore::SourceMode::live:
@@ -119,11 +121,7 @@ namespace {
             case SliceStateStore::SourceMode::multi:
             case SliceStateStore::SourceMode::singleRandom:
             {
-                for (const auto& entry : snapshot.cacheData.entries)
-                {
-                    if (entry.isCandidate)
-                        sources.cacheEntries.add (entry);
-                }
+                sources.candidates = snapshot.candidates;
                 break;
             }
             case SliceStateStore::SourceMode::singleManual:
@@ -142,7 +140,7 @@ namespace {
                 }
 
                 bool anySelected = false;
-                for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+                for (int index = 0; index < audioEngine->getNumRecorders(); ++index)
                 {
                     if (! audioEngine->isRecorderIncludeInGenerationEnabled (index))
                         continue;
@@ -150,7 +148,10 @@ namespace {
                     anySelected = true;
                     const auto recorderFile = RecordingModule::getRecorderFile (index);
                     if (recorderFile.existsAsFile())
+                    {
                         sources.liveFiles.push_back (recorderFile);
+                        sources.liveRecorders.push_back (index);
+                    }
                 }
 
                 if (sources.liveFiles.empty())
@@ -178,7 +179,7 @@ namespace {
         }
 
         bool anySelected = false;
-        for (int index = 0; index < RecordingBus::kNumRecorders; ++index)
+        for (int index = 0; index < audioEngine->getNumRecorders(); ++index)
         {
             if (! audioEngine->isRecorderIncludeInGenerationEnabled (index))
                 continue;
@@ -186,7 +187,10 @@ namespace {
             anySelected = true;
             const auto recorderFile = RecordingModule::getRecorderFile (index);
             if (recorderFile.existsAsFile())
+            {
                 sources.liveFiles.push_back (recorderFile);
+                sources.liveRecorders.push_back (index);
+            }
         }
 
         if (sources.liveFiles.empty())
@@ -207,23 +211,32 @@ namespace {
         const juce::String reason = sources.emptyReason.isNotEmpty()
                                         ? sources.emptyReason
                                         : "No LIVE recorders are available for slicing.";
-        juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,
-                                               "No LIVE sources",
-                                               reason);
+        // regenerating checks from a scheduler worker
+        juce::MessageManager::callAsync ([reason]
+        {
+            juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,
+                                                   "No LIVE sources",
+                                                   reason);
+        });
         return true;
     }
 
-    int subdivisionToFrameCount (double bpm, int subdivisionSteps)
+    int subdivisionToFrameCount (double bpm, int subdivisionSteps, double sampleRate)
     {
         const double quarterNotes = subdivisionToQuarterNotes (subdivisionSteps);
         const double durationSeconds = secondsPerBeat (bpm) * (quarterNotes / 4.0);
-        return static_cast<int> (std::lround (durationSeconds * kTargetSampleRate));
+        return static_cast<int> (std::lround (durationSeconds * sampleRate));
+    }
+
+    int noGoZoneFrames (double bpm, double sampleRate)
+    {
+        return static_cast<int> (std::lround (AudioCacheStore::noGoZoneSeconds (bpm) * sampleRate));
     }
 
-    int noGoZoneFrames (double bpm)
+    // the draws for the slice at index's next reslice or regenerate
+    juce::Random recutRandom (const SliceStateStore::SliceInfo& sliceInfo, int index)
     {
-        const double seconds = std::ceil (secondsPerBeat (bpm) * 8.0);
-        return static_cast<int> (std::lround (seconds * kTargetSampleRate));
+        return SliceRandom::makeRandom (sliceInfo.kitSeed, SliceRandom::Purpose::slice, index, sliceInfo.recutCount + 1);
     }
 
     juce::File getPreviewTempFolder()
@@ -332,9 +345,10 @@ namespace {
     }
 }
 
-MutationOrchestrator::MutationOrchestrator (SliceStateStore& store, AudioEngine* engine)
+MutationOrchestrator::MutationOrchestrator (SliceStateStore& store, AudioEngine* engine, SpeculativeSlicePool* pool)
     : stateStore (store),
-      audioEngine (engine)
+      audioEngine (engine),
+      slicePool (pool)
 {
 }
 
@@ -361,24 +375,23 @@ bool MutationOrchestrator::requestResliceSingle (int index)
 
     const auto snapshot = stateStore.getSnapshot();
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&]
     {
         const auto snapshot = stateStore.getSnapshot();
-        if (index < 0 || index >= static_cast<int> (snapshot.sliceInfos.size()))
+        if (index < 0 || index >= static_cast<int> (snapshot->sliceInfos.size()))
             return;
 
-        auto sliceInfos = snapshot.sliceInfos;
-        auto previewSnippetURLs = snapshot.previewSnippetURLs;
-        auto sliceVolumeSettings = snapshot.sliceVolumeSettings;
-        const double bpm = snapshot.bpm;
-        const int subdivisionSteps = resolvedSubdivision (snapshot.subdivisionSteps);
-        const bool transientDetectEnabled = snapshot.transientDetectionEnabled;
+        auto sliceInfos = snapshot->sliceInfos;
+        auto previewSnippetURLs = snapshot->previewSnippetURLs;
+        auto sliceVolumeSettings = snapshot->sliceVolumeSettings;
+        const double bpm = snapshot->bpm;
+        const int subdivisionSteps = resolvedSubdivision (snapshot->subdivisionSteps);
+        const bool transientDetectEnabled = snapshot->transientDetectionEnabled;
 
-        const bool layeringMode = snapshot.layeringMode;
-        const int sampleCount = snapshot.sampleCountSetting;
+        const bool layeringMode = snapshot->layeringMode;
+        const int sampleCount = snapshot->sampleCountSetting;
         if (layeringMode)
         {
             if (sampleCount <= 0 || static_cast<int> (sliceInfos.size()) != sampleCount * 2)
@@ -389,27 +402,27 @@ bool MutationOrchestrator::requestResliceSingle (int index)
         const int leftIndex = logicalIndex;
         const int rightIndex = layeringMode ? logicalIndex + sampleCount : -1;
 
-        juce::Random& random = juce::Random::getSystemRandom();
-
         auto resliceIndex = [&] (int targetIndex)
         {
             const auto& sliceInfo = sliceInfos[static_cast<std::size_t> (targetIndex)];
+            auto random = recutRandom (sliceInfo, targetIndex);
             const juce::File sourceFile = sliceInfo.fileURL;
 
             AudioFileIO audioFileIO;
+            const double sampleRate = audioFileIO.getTargetSampleRate();
             juce::String formatDescription;
             int fileDurationFrames = 0;
             if (! audioFileIO.getFileDurationFrames (sourceFile, fileDurationFrames, formatDescription))
                 return false;
 
-            const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps);
+            const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps, sampleRate);
             const juce::File outputFile = previewSnippetURLs[static_cast<std::size_t> (targetIndex)];
-            const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpm));
+            const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpm, sampleRate));
             int startFrame = 0;
 
             if (transientDetectEnabled)
             {
-                const int windowFrames = barWindowFrames (bpm);
+                const int windowFrames = barWindowFrames (bpm, sampleRate);
                 if (windowFrames <= 0 || windowFrames > fileDurationFrames)
                     return false;
 
@@ -427,7 +440,8 @@ bool MutationOrchestrator::requestResliceSingle (int index)
 
                 const auto refined = refinedStartFromWindow (detectionAudio.buffer,
                                                              windowStart,
-                                                             transientDetectEnabled);
+                                                             transientDetectEnabled,
+                                                             detectionAudio.sampleRate);
                 if (! refined.has_value())
                     return false;
                 startFrame = refined.value();
@@ -463,22 +477,17 @@ bool MutationOrchestrator::requestResliceSingle (int index)
             SliceStateStore::SliceInfo updatedInfo = sliceInfo;
             updatedInfo.startFrame = startFrame;
             updatedInfo.snippetFrameCount = snippetFrameCount;
-            updatedInfo.sourceMode = snapshot.sourceMode;
-            updatedInfo.bpm = snapshot.bpm;
-            updatedInfo.transientDetectionEnabled = snapshot.transientDetectionEnabled;
-            updatedInfo.sourcePath = snapshot.cacheData.sourcePath;
-            updatedInfo.sourceIsDirectory = snapshot.cacheData.isDirectorySource;
-            updatedInfo.candidatePaths.clear();
-            if (snapshot.sourceMode == SliceStateStore::SourceMode::multi
-                || snapshot.sourceMode == SliceStateStore::SourceMode::singleRandom)
-            {
-                updatedInfo.candidatePaths.reserve (static_cast<std::size_t> (snapshot.cacheData.entries.size()));
-                for (const auto& entry : snapshot.cacheData.entries)
-                {
-                    if (entry.isCandidate)
-                        updatedInfo.candidatePaths.push_back (entry.path);
-                }
-            }
+            updatedInfo.sampleRate = sampleRate;
+            updatedInfo.sourceMode = snapshot->sourceMode;
+            updatedInfo.bpm = snapshot->bpm;
+            updatedInfo.transientDetectionEnabled = snapshot->transientDetectionEnabled;
+            updatedInfo.sourcePath = snapshot->cacheData->sourcePath;
+            updatedInfo.sourceIsDirectory = snapshot->cacheData->isDirectorySource;
+            updatedInfo.recutCount = sliceInfo.recutCount + 1;
+            updatedInfo.candidates = nullptr;
+            if (snapshot->sourceMode == SliceStateStore::SourceMode::multi
+                || snapshot->sourceMode == SliceStateStore::SourceMode::singleRandom)
+                updatedInfo.candidates = snapshot->candidates;
             sliceInfos[static_cast<std::size_t> (targetIndex)] = updatedInfo;
             return true;
         };
@@ -512,23 +521,22 @@ bool MutationOrchestrator::requestResliceAll()
 
     const auto snapshot = stateStore.getSnapshot();
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&, snapshot]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&, snapshot]
     {
-        auto sliceInfos = snapshot.sliceInfos;
-        auto previewSnippetURLs = snapshot.previewSnippetURLs;
-        auto sliceVolumeSettings = snapshot.sliceVolumeSettings;
-        const double bpm = snapshot.bpm;
-        const int subdivisionSteps = resolvedSubdivision (snapshot.subdivisionSteps);
-        const bool transientDetectEnabled = snapshot.transientDetectionEnabled;
+        auto sliceInfos = snapshot->sliceInfos;
+        auto previewSnippetURLs = snapshot->previewSnippetURLs;
+        auto sliceVolumeSettings = snapshot->sliceVolumeSettings;
+        const double bpm = snapshot->bpm;
+        const int subdivisionSteps = resolvedSubdivision (snapshot->subdivisionSteps);
+        const bool transientDetectEnabled = snapshot->transientDetectionEnabled;
 
         if (sliceInfos.empty())
             return;
 
-        const bool layeringMode = snapshot.layeringMode;
-        const int sampleCount = snapshot.sampleCountSetting;
+        const bool layeringMode = snapshot->layeringMode;
+        const int sampleCount = snapshot->sampleCountSetting;
         if (layeringMode)
         {
             if (sampleCount <= 0 || static_cast<int> (sliceInfos.size()) != sampleCount * 2)
@@ -536,7 +544,7 @@ bool MutationOrchestrator::requestResliceAll()
         }
 
         AudioFileIO audioFileIO;
-        juce::Random& random = juce::Random::getSystemRandom();
+        const double sampleRate = audioFileIO.getTargetSampleRate();
 
         const int loopCount = layeringMode ? sampleCount : static_cast<int> (sliceInfos.size());
         for (int logicalIndex = 0; logicalIndex < loopCount; ++logicalIndex)
@@ -547,6 +555,7 @@ bool MutationOrchestrator::requestResliceAll()
             auto resliceIndex = [&] (int targetIndex)
             {
                 const auto& sliceInfo = sliceInfos[static_cast<std::size_t> (targetIndex)];
+                auto random = recutRandom (sliceInfo, targetIndex);
                 const juce::File sourceFile = sliceInfo.fileURL;
 
                 juce::String formatDescription;
@@ -555,14 +564,14 @@ bool MutationOrchestrator::requestResliceAll()
                 if (! audioFileIO.getFileDurationFrames (sourceFile, fileDurationFrames, formatDescription))
                     return false;
 
-                const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps);
+                const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps, sampleRate);
                 const juce::File outputFile = previewSnippetURLs[static_cast<std::size_t> (targetIndex)];
-                const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpm));
+                const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpm, sampleRate));
                 int startFrame = 0;
 
                 if (transientDetectEnabled)
                 {
-                    const int windowFrames = barWindowFrames (bpm);
+                    const int windowFrames = barWindowFrames (bpm, sampleRate);
                     if (windowFrames <= 0 || windowFrames > fileDurationFrames)
                         return false;
 
@@ -580,7 +589,8 @@ bool MutationOrchestrator::requestResliceAll()
 
                     const auto refined = refinedStartFromWindow (detectionAudio.buffer,
                                                                  windowStart,
-                                                                 transientDetectEnabled);
+                                                                 transientDetectEnabled,
+                                                                 detectionAudio.sampleRate);
                     if (! refined.has_value())
                         return false;
                     startFrame = refined.value();
@@ -616,22 +626,17 @@ bool MutationOrchestrator::requestResliceAll()
                 SliceStateStore::SliceInfo updatedInfo = sliceInfo;
                 updatedInfo.startFrame = startFrame;
                 updatedInfo.snippetFrameCount = snippetFrameCount;
-                updatedInfo.sourceMode = snapshot.sourceMode;
-                updatedInfo.bpm = snapshot.bpm;
-                updatedInfo.transientDetectionEnabled = snapshot.transientDetectionEnabled;
-                updatedInfo.sourcePath = snapshot.cacheData.sourcePath;
-                updatedInfo.sourceIsDirectory = snapshot.cacheData.isDirectorySource;
-                updatedInfo.candidatePaths.clear();
-                if (snapshot.sourceMode == SliceStateStore::SourceMode::multi
-                    || snapshot.sourceMode == SliceStateStore::SourceMode::singleRandom)
-                {
-                    updatedInfo.candidatePaths.reserve (static_cast<std::size_t> (snapshot.cacheData.entries.size()));
-                    for (const auto& entry : snapshot.cacheData.entries)
-                    {
-                        if (entry.isCandidate)
-                            updatedInfo.candidatePaths.push_back (entry.path);
-                    }
-                }
+                updatedInfo.sampleRate = sampleRate;
+                updatedInfo.sourceMode = snapshot->sourceMode;
+                updatedInfo.bpm = snapshot->bpm;
+                updatedInfo.transientDetectionEnabled = snapshot->transientDetectionEnabled;
+                updatedInfo.sourcePath = snapshot->cacheData->sourcePath;
+                updatedInfo.sourceIsDirectory = snapshot->cacheData->isDirectorySource;
+                updatedInfo.recutCount = sliceInfo.recutCount + 1;
+                updatedInfo.candidates = nullptr;
+                if (snapshot->sourceMode == SliceStateStore::SourceMode::multi
+                    || snapshot->sourceMode == SliceStateStore::SourceMode::singleRandom)
+                    updatedInfo.candidates = snapshot->candidates;
                 sliceInfos[static_cast<std::size_t> (targetIndex)] = updatedInfo;
                 return true;
             };
@@ -662,344 +667,409 @@ bool MutationOrchestrator::requestSliceAll()
         return false;
 
     const auto snapshot = stateStore.getSnapshot();
-    const auto sources = getCurrentSlicingSources (snapshot, audioEngine);
+    const auto sources = getCurrentSlicingSources (*snapshot, audioEngine);
     if (warnIfMissingLiveSources (sources))
         return false;
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&, snapshot, sources]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&, snapshot]
     {
-
-        const bool layeringMode = snapshot.layeringMode;
-        const int sampleCount = snapshot.sampleCountSetting;
-        const int targetCount = layeringMode ? sampleCount * 2 : sampleCount;
-        if (targetCount <= 0)
+        const auto previewTempFolder = getPreviewTempFolder();
+        if (previewTempFolder == juce::File())
             return;
 
-        std::vector<SliceStateStore::SliceInfo> sliceInfos;
-        std::vector<juce::File> previewSnippetURLs;
-        std::vector<SliceStateStore::SliceVolumeSetting> sliceVolumeSettings;
-        sliceInfos.reserve (static_cast<std::size_t> (targetCount));
-        previewSnippetURLs.reserve (static_cast<std::size_t> (targetCount));
-        sliceVolumeSettings.reserve (static_cast<std::size_t> (targetCount));
+        const int kitNumber = snapshot->kitNumber + 1;
+        const auto kitSeed = SliceRandom::kitSeed (snapshot->sessionSeed, kitNumber);
 
-        const double bpm = snapshot.bpm;
-        const int defaultSubdivision = resolvedSubdivision (snapshot.subdivisionSteps);
+        // a set cut ahead with these settings only has to be moved into place
+        std::optional<SliceSet> sliceSet;
+        if (slicePool != nullptr)
+            sliceSet = slicePool->takeSliceSet (*snapshot, previewTempFolder);
 
-        std::vector<int> subdivisions;
-        if (snapshot.randomSubdivisionEnabled)
+        if (! sliceSet.has_value())
         {
-            if (layeringMode)
-            {
-                auto baseSubdivisions = buildRandomSubdivisions (sampleCount);
-                subdivisions.reserve (baseSubdivisions.size() * 2);
-                subdivisions.insert (subdivisions.end(), baseSubdivisions.begin(), baseSubdivisions.end());
-                subdivisions.insert (subdivisions.end(), baseSubdivisions.begin(), baseSubdivisions.end());
-            }
-            else
-            {
-                subdivisions = buildRandomSubdivisions (targetCount);
-            }
+            previewTempFolder.deleteRecursively();
+            previewTempFolder.createDirectory();
+            sliceSet = cutSliceSet (*snapshot, previewTempFolder, kitSeed, {});
         }
 
-        auto subdivisionForIndex = [&] (int index)
-        {
-            if (! subdivisions.empty())
-                return subdivisions[static_cast<std::size_t> (index)];
-            return defaultSubdivision;
-        };
+        if (! sliceSet.has_value())
+            return;
 
-        juce::Random& random = juce::Random::getSystemRandom();
-        juce::Array<AudioCacheStore::CacheEntry> availableEntries;
-        std::vector<juce::File> liveFiles;
+        stateStore.setAlignedSlices (std::move (sliceSet->sliceInfos),
+                                     std::move (sliceSet->previewSnippetURLs),
+                                     std::move (sliceSet->sliceVolumeSettings));
+        stateStore.setLayeringState (snapshot->layeringMode, snapshot->sampleCountSetting);
+        stateStore.setKitNumber (kitNumber);
+        juce::Logger::writeToLog ("Slice All: kit " + juce::String (kitNumber)
+                                  + " of session seed " + juce::String (snapshot->sessionSeed)
+                                  + ", kit seed " + juce::String (kitSeed));
 
-        const auto previewTempFolder = getPreviewTempFolder();
-        if (previewTempFolder == juce::File())
-            return;
+        PreviewChainOrchestrator previewChain (stateStore);
+        rebuildOk = previewChain.rebuildPreviewChain();
+        if (rebuildOk)
+            clearStutterUndoBackup();
+    });
 
-        previewTempFolder.deleteRecursively();
-        previewTempFolder.createDirectory();
+    return rebuildOk;
+}
 
-        switch (snapshot.sourceMode)
+std::optional<MutationOrchestrator::SliceSet> MutationOrchestrator::cutSliceSet (const SliceStateStore::SliceStateSnapshot& snapshot,
+                                                                                const juce::File& folder,
+                                                                                juce::int64 kitSeed,
+                                                                                const std::function<bool()>& shouldStop) const
+{
+    const auto sources = getCurrentSlicingSources (snapshot, audioEngine);
+    const bool layeringMode = snapshot.layeringMode;
+    const int sampleCount = snapshot.sampleCountSetting;
+    const int targetCount = layeringMode ? sampleCount * 2 : sampleCount;
+    if (targetCount <= 0)
+        return std::nullopt;
+
+    std::vector<SliceStateStore::SliceInfo> sliceInfos;
+    std::vector<juce::File> previewSnippetURLs;
+    std::vector<SliceStateStore::SliceVolumeSetting> sliceVolumeSettings;
+    sliceInfos.reserve (static_cast<std::size_t> (targetCount));
+    previewSnippetURLs.reserve (static_cast<std::size_t> (targetCount));
+    sliceVolumeSettings.reserve (static_cast<std::size_t> (targetCount));
+
+    const double bpm = snapshot.bpm;
+    const int defaultSubdivision = resolvedSubdivision (snapshot.subdivisionSteps);
+
+    // what the kit as a whole draws; each slice has its own stream below
+    auto kitRandom = SliceRandom::makeRandom (kitSeed, SliceRandom::Purpose::kit, 0);
+
+    std::vector<int> subdivisions;
+    if (snapshot.randomSubdivisionEnabled)
+    {
+        if (layeringMode)
         {
-            case SliceStateStore::SourceMode::multi:
-            {
-                availableEntries = sources.cacheEntries;
-                break;
-            }
-            case SliceStateStore::SourceMode::singleRandom:
-            {
-                availableEntries = sources.cacheEntries;
-                if (! availableEntries.isEmpty())
-                {
-                    const int selectedIndex = random.nextInt (availableEntries.size());
-                    const auto selected = availableEntries[selectedIndex];
-                    availableEntries.clear();
-                    availableEntries.add (selected);
-                }
-                break;
-            }
-            case SliceStateStore::SourceMode::singleManual:
-            {
-                if (! snapshot.sourceFile.existsAsFile())
-                    return;
-                break;
-            }
-            case SliceStateStore::SourceMode::live:
-            {
-                liveFiles = sources.liveFiles;
-                break;
-            }
+            auto baseSubdivisions = buildRandomSubdivisions (sampleCount, kitRandom);
+            subdivisions.reserve (baseSubdivisions.size() * 2);
+            subdivisions.insert (subdivisions.end(), baseSubdivisions.begin(), baseSubdivisions.end());
+            subdivisions.insert (subdivisions.end(), baseSubdivisions.begin(), baseSubdivisions.end());
         }
+        else
+        {
+            subdivisions = buildRandomSubdivisions (targetCount, kitRandom);
+        }
+    }
 
-        if (snapshot.sourceMode == SliceStateStore::SourceMode::live)
+    auto subdivisionForIndex = [&] (int index)
+    {
+        if (! subdivisions.empty())
+            return subdivisions[static_cast<std::size_t> (index)];
+        return defaultSubdivision;
+    };
+
+    std::shared_ptr<const SliceStateStore::CandidateSet> candidates;
+    int firstCandidate = 0;
+    int candidateCount = 0;
+    std::vector<juce::File> liveFiles;
+    std::vector<std::shared_ptr<const LiveTakeAnalyzer::TakeAnalysis>> liveAnalyses;
+
+    switch (snapshot.sourceMode)
+    {
+        case SliceStateStore::SourceMode::multi:
         {
-            if (liveFiles.empty())
-                return;
+            candidates = sources.candidates;
+            candidateCount = candidates != nullptr ? candidates->size() : 0;
+            break;
+        }
+        case SliceStateStore::SourceMode::singleRandom:
+        {
+            candidates = sources.candidates;
+            if (candidates != nullptr && ! candidates->isEmpty())
+            {
+                firstCandidate = kitRandom.nextInt (candidates->size());
+                candidateCount = 1;
+            }
+            break;
         }
-        else if (snapshot.sourceMode == SliceStateStore::SourceMode::singleManual)
+        case SliceStateStore::SourceMode::singleManual:
         {
             if (! snapshot.sourceFile.existsAsFile())
-                return;
+                return std::nullopt;
+            break;
         }
-        else
+        case SliceStateStore::SourceMode::live:
         {
-            if (availableEntries.isEmpty())
-                return;
+            liveFiles = sources.liveFiles;
+
+            // taken once per pass; a take that grows afterwards simply
+            // outruns its analysis and falls back to reading the file
+            if (audioEngine != nullptr)
+            {
+                for (const int recorder : sources.liveRecorders)
+                    liveAnalyses.push_back (audioEngine->getRecorderTakeAnalysis (recorder));
+            }
+            break;
         }
+    }
 
-        AudioFileIO audioFileIO;
-        struct CachedAudio
-        {
-            AudioFileIO::ConvertedAudio converted;
-            int durationFrames = 0;
-        };
-        std::unordered_map<std::string, CachedAudio> fullFileCache;
-        const bool enableFullFileCache =
-            snapshot.sourceMode == SliceStateStore::SourceMode::singleManual
-            || snapshot.sourceMode == SliceStateStore::SourceMode::singleRandom;
-        const int entryCount = availableEntries.size();
-        int lastStartFrame = -1;
-
-        for (int index = 0; index < targetCount; ++index)
+    if (snapshot.sourceMode == SliceStateStore::SourceMode::live)
+    {
+        if (liveFiles.empty())
+            return std::nullopt;
+    }
+    else if (snapshot.sourceMode == SliceStateStore::SourceMode::singleManual)
+    {
+        if (! snapshot.sourceFile.existsAsFile())
+            return std::nullopt;
+    }
+    else
+    {
+        if (candidateCount <= 0)
+            return std::nullopt;
+    }
+
+    AudioFileIO audioFileIO;
+    const double sampleRate = audioFileIO.getTargetSampleRate();
+    struct CachedAudio
+    {
+        AudioFileIO::ConvertedAudio converted;
+        int durationFrames = 0;
+    };
+    std::unordered_map<std::string, CachedAudio> fullFileCache;
+    const bool enableFullFileCache =
+        snapshot.sourceMode == SliceStateStore::SourceMode::singleManual
+        || snapshot.sourceMode == SliceStateStore::SourceMode::singleRandom;
+    int lastStartFrame = -1;
+
+    for (int index = 0; index < targetCount; ++index)
+    {
+        if (shouldStop && shouldStop())
+            return std::nullopt;
+
+        auto random = SliceRandom::makeRandom (kitSeed, SliceRandom::Purpose::slice, index);
+        bool added = false;
+        for (int attempt = 0; attempt < 5 && ! added; ++attempt)
         {
-            bool added = false;
-            for (int attempt = 0; attempt < 5 && ! added; ++attempt)
+            juce::File sourceFile;
+            std::shared_ptr<const LiveTakeAnalyzer::TakeAnalysis> liveAnalysis;
+            if (snapshot.sourceMode == SliceStateStore::SourceMode::singleManual)
             {
-                juce::File sourceFile;
-                if (snapshot.sourceMode == SliceStateStore::SourceMode::singleManual)
-                {
-                    sourceFile = snapshot.sourceFile;
-                }
-                else if (snapshot.sourceMode == SliceStateStore::SourceMode::live)
-                {
-                    if (liveFiles.empty())
-                        return;
-                    sourceFile = liveFiles[static_cast<std::size_t> (random.nextInt (static_cast<int> (liveFiles.size())))];
-                }
-                else
-                {
-                    const int entryIndex = random.nextInt (entryCount);
-                    const auto& entry = availableEntries.getReference (entryIndex);
-                    sourceFile = juce::File (entry.path);
-                }
+                sourceFile = snapshot.sourceFile;
+            }
+            else if (snapshot.sourceMode == SliceStateStore::SourceMode::live)
+            {
+                if (liveFiles.empty())
+                    return std::nullopt;
+                const auto liveIndex = static_cast<std::size_t> (random.nextInt (static_cast<int> (liveFiles.size())));
+                sourceFile = liveFiles[liveIndex];
+                if (liveIndex < liveAnalyses.size())
+                    liveAnalysis = liveAnalyses[liveIndex];
+            }
+            else
+            {
+                const int candidate = snapshot.sourceMode == SliceStateStore::SourceMode::singleRandom
+                                          ? firstCandidate
+                                          : candidates->sample (random);
+                sourceFile = juce::File (candidates->getPath (candidate));
+            }
 
-                if (! sourceFile.existsAsFile())
-                    continue;
+            if (! sourceFile.existsAsFile())
+                continue;
 
-                juce::String formatDescription;
+            juce::String formatDescription;
 
-                int fileDurationFrames = 0;
-                const std::string cacheKey = sourceFile.getFullPathName().toStdString();
-                CachedAudio* cachedAudio = nullptr;
+            int fileDurationFrames = 0;
+            const std::string cacheKey = sourceFile.getFullPathName().toStdString();
+            CachedAudio* cachedAudio = nullptr;
 
-                if (enableFullFileCache)
+            if (enableFullFileCache)
+            {
+                auto [it, inserted] = fullFileCache.try_emplace (cacheKey);
+                if (inserted)
                 {
-                    auto [it, inserted] = fullFileCache.try_emplace (cacheKey);
-                    if (inserted)
+                    if (! audioFileIO.readToMonoBuffer (sourceFile, it->second.converted, formatDescription))
                     {
-                        if (! audioFileIO.readToMonoBuffer (sourceFile, it->second.converted, formatDescription))
-                        {
-                            fullFileCache.erase (it);
-                        }
-                        else
-                        {
-                            it->second.durationFrames = it->second.converted.buffer.getNumSamples();
-                        }
+                        fullFileCache.erase (it);
                     }
-
-                    auto found = fullFileCache.find (cacheKey);
-                    if (found != fullFileCache.end())
+                    else
                     {
-                        cachedAudio = &found->second;
-                        fileDurationFrames = cachedAudio->durationFrames;
+                        it->second.durationFrames = it->second.converted.buffer.getNumSamples();
                     }
                 }
 
-                if (cachedAudio == nullptr)
+                auto found = fullFileCache.find (cacheKey);
+                if (found != fullFileCache.end())
                 {
-                    if (! audioFileIO.getFileDurationFrames (sourceFile, fileDurationFrames, formatDescription))
-                        continue;
+                    cachedAudio = &found->second;
+                    fileDurationFrames = cachedAudio->durationFrames;
                 }
+            }
 
-                if (fileDurationFrames <= 0)
+            if (cachedAudio == nullptr)
+            {
+                if (! audioFileIO.getFileDurationFrames (sourceFile, fileDurationFrames, formatDescription))
                     continue;
+            }
 
-                const int subdivisionSteps = subdivisionForIndex (index);
-                const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps);
-                if (snippetFrameCount <= 0)
-                    continue;
+            if (fileDurationFrames <= 0)
+                continue;
+
+            const int subdivisionSteps = subdivisionForIndex (index);
+            const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps, sampleRate);
+            if (snippetFrameCount <= 0)
+                continue;
 
-                const juce::File outputFile = previewTempFolder.getChildFile ("slice_" + juce::String (index) + ".wav");
+            const juce::File outputFile = folder.getChildFile ("slice_" + juce::String (index) + ".wav");
 
-                const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpm));
-                int startFrame = 0;
+            const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpm, sampleRate));
+            int startFrame = 0;
+
+            // recorder takes change under us; only library files keep a map
+            const auto energyMap = snapshot.sourceMode != SliceStateStore::SourceMode::live
+                                       ? EnergyMap::findForFile (sourceFile)
+                                       : nullptr;
 
-                if (snapshot.transientDetectionEnabled)
+            if (snapshot.transientDetectionEnabled)
+            {
+                bool foundStart = false;
+                for (int retry = 0; retry <= kTransientRepeatRetryCount; ++retry)
                 {
-                    bool foundStart = false;
-                    for (int retry = 0; retry <= kTransientRepeatRetryCount; ++retry)
+                    const int windowFrames = barWindowFrames (bpm, sampleRate);
+                    if (windowFrames <= 0 || windowFrames > fileDurationFrames)
+                        break;
+
+                    const auto refined = [&]() -> std::optional<int>
                     {
-                        const int windowFrames = barWindowFrames (bpm);
-                        if (windowFrames <= 0 || windowFrames > fileDurationFrames)
-                            break;
+                        // onsets found while recording spare reading the take,
+                        // once the analysis covers all of it
+                        if (liveAnalysis != nullptr)
+                        {
+                            if (const auto aligned = onsetAlignedStart (*liveAnalysis,
+                                                                        random,
+                                                                        maxCandidateStart,
+                                                                        windowFrames,
+                                                                        fileDurationFrames,
+                                                                        snippetFrameCount,
+                                                                        sampleRate))
+                                return aligned;
+                        }
 
-                        const auto refined = [&]() -> std::optional<int>
+                        if (cachedAudio != nullptr)
                         {
-                            if (cachedAudio != nullptr)
-                            {
-                                return refinedStart (cachedAudio->converted.buffer,
-                                                     random,
-                                                     maxCandidateStart,
-                                                     windowFrames,
-                                                     snapshot.transientDetectionEnabled);
-                            }
-
-                            const int maxWindowStart = fileDurationFrames - windowFrames;
-                            const int cappedCandidateStart = juce::jlimit (0, maxWindowStart, maxCandidateStart);
-                            const int windowStart = random.nextInt (cappedCandidateStart + 1);
-
-                            AudioFileIO::ConvertedAudio detectionAudio;
-                            if (! audioFileIO.readToMonoBufferSegment (sourceFile,
-                                                                       windowStart,
-                                                                       windowFrames,
-                                                                       detectionAudio,
-                                                                       formatDescription))
-                                return std::nullopt;
-
-                            return refinedStartFromWindow (detectionAudio.buffer,
-                                                           windowStart,
-                                                           snapshot.transientDetectionEnabled);
-                        }();
-
-                        if (! refined.has_value())
-                            continue;
-                        const int candidateStart = refined.value();
-                        if (candidateStart == lastStartFrame)
-                            continue;
-                        startFrame = candidateStart;
-                        foundStart = true;
-                        break;
-                    }
-                    if (! foundStart)
-                        continue;
+                            return refinedStart (cachedAudio->converted.buffer,
+                                                 random,
+                                                 maxCandidateStart,
+                                                 windowFrames,
+                                                 snapshot.transientDetectionEnabled,
+                                                 cachedAudio->converted.sampleRate);
+                        }
 
-                    if (startFrame + snippetFrameCount > fileDurationFrames)
-                        continue;
+                        const int maxWindowStart = fileDurationFrames - windowFrames;
+                        const int cappedCandidateStart = juce::jlimit (0, maxWindowStart, maxCandidateStart);
+                        const int windowStart = EnergyMap::randomStart (energyMap.get(), random, cappedCandidateStart, sampleRate);
 
-                    AudioFileIO::ConvertedAudio sliceAudio;
-                    if (cachedAudio != nullptr)
-                    {
-                        if (startFrame + snippetFrameCount > cachedAudio->converted.buffer.getNumSamples())
-                            continue;
-                        sliceAudio.sampleRate = cachedAudio->converted.sampleRate;
-                        sliceAudio.buffer = juce::AudioBuffer<float> (1, snippetFrameCount);
-                        sliceAudio.buffer.copyFrom (0, 0, cachedAudio->converted.buffer, 0, startFrame, snippetFrameCount);
-                    }
-                    else if (! audioFileIO.readToMonoBufferSegment (sourceFile,
-                                                                   startFrame,
-                                                                   snippetFrameCount,
-                                                                   sliceAudio,
+                        AudioFileIO::ConvertedAudio detectionAudio;
+                        if (! audioFileIO.readToMonoBufferSegment (sourceFile,
+                                                                   windowStart,
+                                                                   windowFrames,
+                                                                   detectionAudio,
                                                                    formatDescription))
-                    {
-                        continue;
-                    }
+                            return std::nullopt;
 
-                    if (! audioFileIO.writeMonoWav16 (outputFile, sliceAudio))
+                        return refinedStartFromWindow (detectionAudio.buffer,
+                                                       windowStart,
+                                                       snapshot.transientDetectionEnabled,
+                                                       detectionAudio.sampleRate);
+                    }();
+
+                    if (! refined.has_value())
                         continue;
+                    const int candidateStart = refined.value();
+                    if (candidateStart == lastStartFrame)
+                        continue;
+                    startFrame = candidateStart;
+                    foundStart = true;
+                    break;
                 }
-                else
+                if (! foundStart)
+                    continue;
+
+                if (startFrame + snippetFrameCount > fileDurationFrames)
+                    continue;
+
+                AudioFileIO::ConvertedAudio sliceAudio;
+                if (cachedAudio != nullptr)
                 {
-                    startFrame = random.nextInt (maxCandidateStart + 1);
-                    if (startFrame + snippetFrameCount > fileDurationFrames)
+                    if (startFrame + snippetFrameCount > cachedAudio->converted.buffer.getNumSamples())
                         continue;
+                    sliceAudio.sampleRate = cachedAudio->converted.sampleRate;
+                    sliceAudio.buffer = juce::AudioBuffer<float> (1, snippetFrameCount);
+                    sliceAudio.buffer.copyFrom (0, 0, cachedAudio->converted.buffer, 0, startFrame, snippetFrameCount);
+                }
+                else if (! audioFileIO.readToMonoBufferSegment (sourceFile,
+                                                               startFrame,
+                                                               snippetFrameCount,
+                                                               sliceAudio,
+                                                               formatDescription))
+                {
+                    continue;
+                }
 
-                    AudioFileIO::ConvertedAudio sliceAudio;
-                    if (cachedAudio != nullptr)
-                    {
-                        if (startFrame + snippetFrameCount > cachedAudio->converted.buffer.getNumSamples())
-                            continue;
-                        sliceAudio.sampleRate = cachedAudio->converted.sampleRate;
-                        sliceAudio.buffer = juce::AudioBuffer<float> (1, snippetFrameCount);
-                        sliceAudio.buffer.copyFrom (0, 0, cachedAudio->converted.buffer, 0, startFrame, snippetFrameCount);
-                    }
-                    else if (! audioFileIO.readToMonoBufferSegment (sourceFile,
-                                                                   startFrame,
-                                                                   snippetFrameCount,
-                                                                   sliceAudio,
-                                                                   formatDescription))
-                    {
-                        continue;
-                    }
+                if (! audioFileIO.writeMonoWav16 (outputFile, sliceAudio))
+                    continue;
+            }
+            else
+            {
+                startFrame = EnergyMap::randomStart (energyMap.get(), random, maxCandidateStart, sampleRate);
+                if (startFrame + snippetFrameCount > fileDurationFrames)
+                    continue;
 
-                    if (! audioFileIO.writeMonoWav16 (outputFile, sliceAudio))
+                AudioFileIO::ConvertedAudio sliceAudio;
+                if (cachedAudio != nullptr)
+                {
+                    if (startFrame + snippetFrameCount > cachedAudio->converted.buffer.getNumSamples())
                         continue;
+                    sliceAudio.sampleRate = cachedAudio->converted.sampleRate;
+                    sliceAudio.buffer = juce::AudioBuffer<float> (1, snippetFrameCount);
+                    sliceAudio.buffer.copyFrom (0, 0, cachedAudio->converted.buffer, 0, startFrame, snippetFrameCount);
                 }
-
-                SliceStateStore::SliceInfo info;
-                info.fileURL = sourceFile;
-                info.startFrame = startFrame;
-                info.subdivisionSteps = subdivisionSteps;
-                info.snippetFrameCount = snippetFrameCount;
-                info.sourceMode = snapshot.sourceMode;
-                info.bpm = snapshot.bpm;
-                info.transientDetectionEnabled = snapshot.transientDetectionEnabled;
-                info.sourcePath = snapshot.cacheData.sourcePath;
-                info.sourceIsDirectory = snapshot.cacheData.isDirectorySource;
-                info.candidatePaths.clear();
-                if (snapshot.sourceMode == SliceStateStore::SourceMode::multi
-                    || snapshot.sourceMode == SliceStateStore::SourceMode::singleRandom)
+                else if (! audioFileIO.readToMonoBufferSegment (sourceFile,
+                                                               startFrame,
+                                                               snippetFrameCount,
+                                                               sliceAudio,
+                                                               formatDescription))
                 {
-                    info.candidatePaths.reserve (static_cast<std::size_t> (sources.cacheEntries.size()));
-                    for (const auto& entry : sources.cacheEntries)
-                        info.candidatePaths.push_back (entry.path);
+                    continue;
                 }
 
-                sliceInfos.push_back (info);
-                previewSnippetURLs.push_back (outputFile);
-                sliceVolumeSettings.push_back ({ 0.75f, false });
-                lastStartFrame = startFrame;
-                added = true;
+                if (! audioFileIO.writeMonoWav16 (outputFile, sliceAudio))
+                    continue;
             }
 
-            if (! added)
-                return;
-        }
+            SliceStateStore::SliceInfo info;
+            info.fileURL = sourceFile;
+            info.startFrame = startFrame;
+            info.subdivisionSteps = subdivisionSteps;
+            info.snippetFrameCount = snippetFrameCount;
+            info.sampleRate = sampleRate;
+            info.sourceMode = snapshot.sourceMode;
+            info.bpm = snapshot.bpm;
+            info.transientDetectionEnabled = snapshot.transientDetectionEnabled;
+            info.sourcePath = snapshot.cacheData->sourcePath;
+            info.sourceIsDirectory = snapshot.cacheData->isDirectorySource;
+            info.kitSeed = kitSeed;
+            if (snapshot.sourceMode == SliceStateStore::SourceMode::multi
+                || snapshot.sourceMode == SliceStateStore::SourceMode::singleRandom)
+                info.candidates = snapshot.candidates;
 
-        stateStore.setAlignedSlices (std::move (sliceInfos),
-                                     std::move (previewSnippetURLs),
-                                     std::move (sliceVolumeSettings));
-        stateStore.setLayeringState (layeringMode, sampleCount);
+            sliceInfos.push_back (info);
+            previewSnippetURLs.push_back (outputFile);
+            sliceVolumeSettings.push_back ({ 0.75f, false });
+            lastStartFrame = startFrame;
+            added = true;
+        }
 
-        PreviewChainOrchestrator previewChain (stateStore);
-        rebuildOk = previewChain.rebuildPreviewChain();
-        if (rebuildOk)
-            clearStutterUndoBackup();
-    });
+        if (! added)
+            return std::nullopt;
+    }
 
-    return rebuildOk;
+    return SliceSet { std::move (sliceInfos), std::move (previewSnippetURLs), std::move (sliceVolumeSettings) };
 }
 
 bool MutationOrchestrator::requestRegenerateSingle (int index)
@@ -1015,23 +1085,20 @@ bool MutationOrchestrator::requestRegenerateSingle (int index)
 
     const auto snapshot = stateStore.getSnapshot();
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&]
     {
         const auto snapshot = stateStore.getSnapshot();
-        if (index < 0 || index >= static_cast<int> (snapshot.sliceInfos.size()))
+        if (index < 0 || index >= static_cast<int> (snapshot->sliceInfos.size()))
             return;
 
-        auto sliceInfos = snapshot.sliceInfos;
-        auto previewSnippetURLs = snapshot.previewSnippetURLs;
-        auto sliceVolumeSettings = snapshot.sliceVolumeSettings;
-        const double bpm = snapshot.bpm;
-        const int subdivisionSteps = resolvedSubdivision (snapshot.subdivisionSteps);
+        auto sliceInfos = snapshot->sliceInfos;
+        auto previewSnippetURLs = snapshot->previewSnippetURLs;
+        auto sliceVolumeSettings = snapshot->sliceVolumeSettings;
 
-        const bool layeringMode = snapshot.layeringMode;
-        const int sampleCount = snapshot.sampleCountSetting;
+        const bool layeringMode = snapshot->layeringMode;
+        const int sampleCount = snapshot->sampleCountSetting;
         if (layeringMode)
         {
             if (sampleCount <= 0 || static_cast<int> (sliceInfos.size()) != sampleCount * 2)
@@ -1044,172 +1111,197 @@ bool MutationOrchestrator::requestRegenerateSingle (int index)
 
         auto regenerateIndex = [&] (int targetIndex)
         {
-            const auto& sliceInfo = sliceInfos[static_cast<std::size_t> (targetIndex)];
-            const auto sourceModeToUse = sliceInfo.sourceMode;
-            const double bpmToUse = sliceInfo.bpm > 0.0 ? sliceInfo.bpm : bpm;
-            const bool transientDetectEnabled = sliceInfo.transientDetectionEnabled;
-            const int subdivisionToUse = sliceInfo.subdivisionSteps > 0 ? sliceInfo.subdivisionSteps : subdivisionSteps;
-            const int snippetFrameCount = subdivisionToFrameCount (bpmToUse, subdivisionToUse);
-            if (snippetFrameCount <= 0)
-                return false;
+            auto& sliceInfo = sliceInfos[static_cast<std::size_t> (targetIndex)];
+            const auto& outputFile = previewSnippetURLs[static_cast<std::size_t> (targetIndex)];
 
-            std::optional<SlicingSources> liveSources;
-            if (sourceModeToUse == SliceStateStore::SourceMode::live)
-            {
-                liveSources = getLiveSources (audioEngine);
-                if (warnIfMissingLiveSources (*liveSources))
-                    return false;
-            }
+            std::optional<SliceStateStore::SliceInfo> replacement;
+            if (slicePool != nullptr)
+                replacement = slicePool->takeReplacement (targetIndex, sliceInfo, outputFile);
 
-            std::vector<juce::String> candidatePaths = sliceInfo.candidatePaths;
-            if (candidatePaths.empty()
-                && (sourceModeToUse == SliceStateStore::SourceMode::multi
-                    || sourceModeToUse == SliceStateStore::SourceMode::singleRandom))
-            {
-                candidatePaths.reserve (static_cast<std::size_t> (snapshot.cacheData.entries.size()));
-                for (const auto& entry : snapshot.cacheData.entries)
-                {
-                    if (entry.isCandidate)
-                        candidatePaths.push_back (entry.path);
-                }
-            }
+            if (! replacement.has_value())
+                replacement = cutReplacement (sliceInfo, targetIndex, *snapshot, outputFile, {});
 
-            if (sourceModeToUse == SliceStateStore::SourceMode::live
-                && (! liveSources.has_value() || liveSources->liveFiles.empty()))
-                return false;
-            if (sourceModeToUse == SliceStateStore::SourceMode::singleManual && ! sliceInfo.fileURL.existsAsFile())
-                return false;
-            if (sourceModeToUse != SliceStateStore::SourceMode::live
-                && sourceModeToUse != SliceStateStore::SourceMode::singleManual
-                && candidatePaths.empty())
-            {
+            if (! replacement.has_value())
                 return false;
-            }
 
-            juce::Random& random = juce::Random::getSystemRandom();
-            const juce::File outputFile = previewSnippetURLs[static_cast<std::size_t> (targetIndex)];
+            sliceInfo = std::move (*replacement);
+            return true;
+        };
 
-            for (int attempt = 0; attempt < kRegenerateRetryLimit; ++attempt)
-            {
-                juce::File sourceFile;
-                if (sourceModeToUse == SliceStateStore::SourceMode::live)
-                {
-                    sourceFile = liveSources->liveFiles[static_cast<std::size_t> (
-                        random.nextInt (static_cast<int> (liveSources->liveFiles.size())))];
-                }
-                else if (sourceModeToUse == SliceStateStore::SourceMode::singleManual)
-                {
-                    sourceFile = sliceInfo.fileURL;
-                }
-                else if (! candidatePaths.empty())
-                {
-                    const int entryIndex = random.nextInt (static_cast<int> (candidatePaths.size()));
-                    sourceFile = juce::File (candidatePaths[static_cast<std::size_t> (entryIndex)]);
-                }
+        if (! regenerateIndex (leftIndex))
+            return;
 
-                if (! sourceFile.existsAsFile())
-                    continue;
+        if (layeringMode && rightIndex >= 0)
+        {
+            if (! regenerateIndex (rightIndex))
+                return;
+        }
 
-                juce::String formatDescription;
+        stateStore.setAlignedSlices (std::move (sliceInfos),
+                                     std::move (previewSnippetURLs),
+                                     std::move (sliceVolumeSettings));
+        clearStutterUndoBackup();
+        rebuildOk = true;
+    });
 
-                AudioFileIO audioFileIO;
-                int fileDurationFrames = 0;
-                if (! audioFileIO.getFileDurationFrames (sourceFile, fileDurationFrames, formatDescription))
-                    continue;
+    return rebuildOk;
+}
 
-                if (fileDurationFrames <= 0)
-                    continue;
+std::optional<SliceStateStore::SliceInfo> MutationOrchestrator::cutReplacement (const SliceStateStore::SliceInfo& sliceInfo,
+                                                                                int index,
+                                                                                const SliceStateStore::SliceStateSnapshot& snapshot,
+                                                                                const juce::File& outputFile,
+                                                                                const std::function<bool()>& shouldStop) const
+{
+    auto random = recutRandom (sliceInfo, index);
+
+    const auto sourceModeToUse = sliceInfo.sourceMode;
+    const double bpmToUse = sliceInfo.bpm > 0.0 ? sliceInfo.bpm : snapshot.bpm;
+    const bool transientDetectEnabled = sliceInfo.transientDetectionEnabled;
+    const int subdivisionToUse = sliceInfo.subdivisionSteps > 0 ? sliceInfo.subdivisionSteps
+                                                                 : resolvedSubdivision (snapshot.subdivisionSteps);
+    AudioFileIO audioFileIO;
+    const double sampleRate = audioFileIO.getTargetSampleRate();
+    const int snippetFrameCount = subdivisionToFrameCount (bpmToUse, subdivisionToUse, sampleRate);
+    if (snippetFrameCount <= 0)
+        return std::nullopt;
+
+    std::optional<SlicingSources> liveSources;
+    if (sourceModeToUse == SliceStateStore::SourceMode::live)
+    {
+        liveSources = getLiveSources (audioEngine);
+        if (warnIfMissingLiveSources (*liveSources))
+            return std::nullopt;
+    }
 
-                const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpmToUse));
-                int startFrame = 0;
+    auto candidates = sliceInfo.candidates;
+    if ((candidates == nullptr || candidates->isEmpty())
+        && (sourceModeToUse == SliceStateStore::SourceMode::multi
+            || sourceModeToUse == SliceStateStore::SourceMode::singleRandom))
+        candidates = snapshot.candidates;
+
+    if (sourceModeToUse == SliceStateStore::SourceMode::live
+        && (! liveSources.has_value() || liveSources->liveFiles.empty()))
+        return std::nullopt;
+    if (sourceModeToUse == SliceStateStore::SourceMode::singleManual && ! sliceInfo.fileURL.existsAsFile())
+        return std::nullopt;
+    if (sourceModeToUse != SliceStateStore::SourceMode::live
+        && sourceModeToUse != SliceStateStore::SourceMode::singleManual
+        && (candidates == nullptr || candidates->isEmpty()))
+    {
+        return std::nullopt;
+    }
 
-                if (transientDetectEnabled)
-                {
-                    bool foundStart = false;
-                    for (int retry = 0; retry <= kTransientRepeatRetryCount; ++retry)
-                    {
-                        const int windowFrames = barWindowFrames (bpmToUse);
-                        if (windowFrames <= 0 || windowFrames > fileDurationFrames)
-                            break;
+    for (int attempt = 0; attempt < kRegenerateRetryLimit; ++attempt)
+    {
+        if (shouldStop && shouldStop())
+            return std::nullopt;
 
-                        const int maxWindowStart = fileDurationFrames - windowFrames;
-                        const int cappedCandidateStart = juce::jlimit (0, maxWindowStart, maxCandidateStart);
-                        const int windowStart = random.nextInt (cappedCandidateStart + 1);
+        juce::File sourceFile;
+        if (sourceModeToUse == SliceStateStore::SourceMode::live)
+        {
+            sourceFile = liveSources->liveFiles[static_cast<std::size_t> (
+                random.nextInt (static_cast<int> (liveSources->liveFiles.size())))];
+        }
+        else if (sourceModeToUse == SliceStateStore::SourceMode::singleManual)
+        {
+            sourceFile = sliceInfo.fileURL;
+        }
+        else if (candidates != nullptr && ! candidates->isEmpty())
+        {
+            sourceFile = juce::File (candidates->getPath (candidates->sample (random)));
+        }
 
-                        AudioFileIO::ConvertedAudio detectionAudio;
-                        if (! audioFileIO.readToMonoBufferSegment (sourceFile,
-                                                                   windowStart,
-                                                                   windowFrames,
-                                                                   detectionAudio,
-                                                                   formatDescription))
-                            continue;
+        if (! sourceFile.existsAsFile())
+            continue;
 
-                        const auto refined = refinedStartFromWindow (detectionAudio.buffer,
-                                                                     windowStart,
-                                                                     transientDetectEnabled);
-                        if (! refined.has_value())
-                            continue;
+        juce::String formatDescription;
 
-                        startFrame = refined.value();
-                        foundStart = true;
-                        break;
-                    }
+        int fileDurationFrames = 0;
+        if (! audioFileIO.getFileDurationFrames (sourceFile, fileDurationFrames, formatDescription))
+            continue;
 
-                    if (! foundStart)
-                        continue;
-                }
-                else
-                {
-                    startFrame = random.nextInt (maxCandidateStart + 1);
-                }
+        if (fileDurationFrames <= 0)
+            continue;
 
-                if (startFrame + snippetFrameCount > fileDurationFrames)
-                    continue;
-                if (startFrame == sliceInfo.startFrame && fileDurationFrames > snippetFrameCount)
-                    continue;
+        const int maxCandidateStart = juce::jmax (0, fileDurationFrames - noGoZoneFrames (bpmToUse, sampleRate));
+        int startFrame = 0;
 
-                AudioFileIO::ConvertedAudio sliceAudio;
+        const auto energyMap = sourceModeToUse != SliceStateStore::SourceMode::live
+                                   ? EnergyMap::findForFile (sourceFile)
+                                   : nullptr;
+
+        if (transientDetectEnabled)
+        {
+            bool foundStart = false;
+            for (int retry = 0; retry <= kTransientRepeatRetryCount; ++retry)
+            {
+                const int windowFrames = barWindowFrames (bpmToUse, sampleRate);
+                if (windowFrames <= 0 || windowFrames > fileDurationFrames)
+                    break;
+
+                const int maxWindowStart = fileDurationFrames - windowFrames;
+                const int cappedCandidateStart = juce::jlimit (0, maxWindowStart, maxCandidateStart);
+                const int windowStart = EnergyMap::randomStart (energyMap.get(), random, cappedCandidateStart, sampleRate);
+
+                AudioFileIO::ConvertedAudio detectionAudio;
                 if (! audioFileIO.readToMonoBufferSegment (sourceFile,
-                                                           startFrame,
-                                                           snippetFrameCount,
-                                                           sliceAudio,
+                                                           windowStart,
+                                                           windowFrames,
+                                                           detectionAudio,
                                                            formatDescription))
                     continue;
-                if (sliceInfo.isReversed)
-                    reverseMonoBuffer (sliceAudio.buffer);
 
-                if (! audioFileIO.writeMonoWav16 (outputFile, sliceAudio))
+                const auto refined = refinedStartFromWindow (detectionAudio.buffer,
+                                                             windowStart,
+                                                             transientDetectEnabled,
+                                                             detectionAudio.sampleRate);
+                if (! refined.has_value())
                     continue;
 
-                SliceStateStore::SliceInfo updatedInfo = sliceInfo;
-                updatedInfo.fileURL = sourceFile;
-                updatedInfo.startFrame = startFrame;
-                updatedInfo.snippetFrameCount = snippetFrameCount;
-                updatedInfo.subdivisionSteps = subdivisionToUse;
-                sliceInfos[static_cast<std::size_t> (targetIndex)] = updatedInfo;
-                return true;
+                startFrame = refined.value();
+                foundStart = true;
+                break;
             }
 
-            return false;
-        };
-
-        if (! regenerateIndex (leftIndex))
-            return;
-
-        if (layeringMode && rightIndex >= 0)
+            if (! foundStart)
+                continue;
+        }
+        else
         {
-            if (! regenerateIndex (rightIndex))
-                return;
+            startFrame = EnergyMap::randomStart (energyMap.get(), random, maxCandidateStart, sampleRate);
         }
 
-        stateStore.setAlignedSlices (std::move (sliceInfos),
-                                     std::move (previewSnippetURLs),
-                                     std::move (sliceVolumeSettings));
-        clearStutterUndoBackup();
-        rebuildOk = true;
-    });
+        if (startFrame + snippetFrameCount > fileDurationFrames)
+            continue;
+        if (startFrame == AudioFileIO::rescaleFrames (sliceInfo.startFrame, sliceInfo.sampleRate, sampleRate)
+            && fileDurationFrames > snippetFrameCount)
+            continue;
+
+        AudioFileIO::ConvertedAudio sliceAudio;
+        if (! audioFileIO.readToMonoBufferSegment (sourceFile,
+                                                   startFrame,
+                                                   snippetFrameCount,
+                                                   sliceAudio,
+                                                   formatDescription))
+            continue;
+        if (sliceInfo.isReversed)
+            reverseMonoBuffer (sliceAudio.buffer);
+
+        if (! audioFileIO.writeMonoWav16 (outputFile, sliceAudio))
+            continue;
+
+        SliceStateStore::SliceInfo updatedInfo = sliceInfo;
+        updatedInfo.fileURL = sourceFile;
+        updatedInfo.startFrame = startFrame;
+        updatedInfo.snippetFrameCount = snippetFrameCount;
+        updatedInfo.sampleRate = sampleRate;
+        updatedInfo.subdivisionSteps = subdivisionToUse;
+        updatedInfo.recutCount = sliceInfo.recutCount + 1;
+        return updatedInfo;
+    }
 
-    return rebuildOk;
+    return std::nullopt;
 }
 
 bool MutationOrchestrator::requestRegenerateAll()
@@ -1222,23 +1314,22 @@ bool MutationOrchestrator::requestRegenerateAll()
 
     const auto snapshot = stateStore.getSnapshot();
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&]
     {
         const auto snapshot = stateStore.getSnapshot();
-        auto sliceInfos = snapshot.sliceInfos;
-        auto previewSnippetURLs = snapshot.previewSnippetURLs;
-        auto sliceVolumeSettings = snapshot.sliceVolumeSettings;
-        const double bpm = snapshot.bpm;
-        const int defaultSubdivision = resolvedSubdivision (snapshot.subdivisionSteps);
+        auto sliceInfos = snapshot->sliceInfos;
+        auto previewSnippetURLs = snapshot->previewSnippetURLs;
+        auto sliceVolumeSettings = snapshot->sliceVolumeSettings;
+        const double bpm = snapshot->bpm;
+        const int defaultSubdivision = resolvedSubdivision (snapshot->subdivisionSteps);
 
         if (sliceInfos.empty())
             return;
 
-        const bool layeringMode = snapshot.layeringMode;
-        const int sampleCount = snapshot.sampleCountSetting;
+        const bool layeringMode = snapshot->layeringMode;
+        const int sampleCount = snapshot->sampleCountSetting;
         if (layeringMode)
         {
             if (sampleCount <= 0 || static_cast<int> (sliceInfos.size()) != sampleCount * 2)
@@ -1246,7 +1337,7 @@ bool MutationOrchestrator::requestRegenerateAll()
         }
 
         AudioFileIO audioFileIO;
-        juce::Random random;
+        const double sampleRate = audioFileIO.getTargetSampleRate();
 
         const int loopCount = layeringMode ? sampleCount : static_cast<int> (sliceInfos.size());
         for (int logicalIndex = 0; logicalIndex < loopCount; ++logicalIndex)
@@ -1257,11 +1348,12 @@ bool MutationOrchestrator::requestRegenerateAll()
             auto regenerateIndex = [&] (int targetIndex)
             {
                 const auto& sliceInfo = sliceInfos[static_cast<std::size_t> (targetIndex)];
+                auto random = recutRandom (sliceInfo, targetIndex);
                 const juce::File sourceFile = sliceInfo.fileURL;
-                const int startFrame = sliceInfo.startFrame;
+                const int startFrame = AudioFileIO::rescaleFrames (sliceInfo.startFrame, sliceInfo.sampleRate, sampleRate);
                 const int subdivisionSteps =
-                    snapshot.randomSubdivisionEnabled ? randomSubdivision (random) : defaultSubdivision;
-                const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps);
+                    snapshot->randomSubdivisionEnabled ? randomSubdivision (random) : defaultSubdivision;
+                const int snippetFrameCount = subdivisionToFrameCount (bpm, subdivisionSteps, sampleRate);
 
                 juce::String formatDescription;
 
@@ -1282,8 +1374,11 @@ bool MutationOrchestrator::requestRegenerateAll()
                     return false;
 
                 SliceStateStore::SliceInfo updatedInfo = sliceInfo;
+                updatedInfo.startFrame = startFrame;
                 updatedInfo.snippetFrameCount = snippetFrameCount;
+                updatedInfo.sampleRate = sampleRate;
                 updatedInfo.subdivisionSteps = subdivisionSteps;
+                updatedInfo.recutCount = sliceInfo.recutCount + 1;
                 sliceInfos[static_cast<std::size_t> (targetIndex)] = updatedInfo;
 
                 return true;
@@ -1323,16 +1418,15 @@ bool MutationOrchestrator::requestStutterSingle (int index)
     if (! validateAlignment())
         return false;
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&]
     {
         const auto snapshot = stateStore.getSnapshot();
-        if (index < 0 || index >= static_cast<int> (snapshot.previewSnippetURLs.size()))
+        if (index < 0 || index >= static_cast<int> (snapshot->previewSnippetURLs.size()))
             return;
 
-        const juce::File targetFile = snapshot.previewSnippetURLs[static_cast<std::size_t> (index)];
+        const juce::File targetFile = snapshot->previewSnippetURLs[static_cast<std::size_t> (index)];
         if (! targetFile.existsAsFile())
             return;
 
@@ -1351,11 +1445,11 @@ bool MutationOrchestrator::requestStutterSingle (int index)
             return;
 
         const auto stuttered = buildStutteredBuffer (converted.buffer,
-                                                     snapshot.stutterCount,
-                                                     snapshot.stutterVolumeReductionStep,
-                                                     snapshot.stutterPitchShiftSemitones,
-                                                     snapshot.stutterTruncateEnabled,
-                                                     snapshot.stutterStartFraction);
+                                                     snapshot->stutterCount,
+                                                     snapshot->stutterVolumeReductionStep,
+                                                     snapshot->stutterPitchShiftSemitones,
+                                                     snapshot->stutterTruncateEnabled,
+                                                     snapshot->stutterStartFraction);
 
         AudioFileIO::ConvertedAudio outputAudio;
         outputAudio.buffer = stuttered;
@@ -1382,24 +1476,23 @@ bool MutationOrchestrator::requestStutterUndo (int index)
     if (! validateAlignment())
         return false;
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&]
     {
         const auto snapshot = stateStore.getSnapshot();
-        if (index < 0 || index >= static_cast<int> (snapshot.previewSnippetURLs.size()))
+        if (index < 0 || index >= static_cast<int> (snapshot->previewSnippetURLs.size()))
             return;
 
-        const auto backupIt = snapshot.stutterUndoBackup.find (index);
-        if (backupIt == snapshot.stutterUndoBackup.end())
+        const auto backupIt = snapshot->stutterUndoBackup.find (index);
+        if (backupIt == snapshot->stutterUndoBackup.end())
             return;
 
         const juce::File backupFile = backupIt->second;
         if (! backupFile.existsAsFile())
             return;
 
-        const juce::File targetFile = snapshot.previewSnippetURLs[static_cast<std::size_t> (index)];
+        const juce::File targetFile = snapshot->previewSnippetURLs[static_cast<std::size_t> (index)];
         if (! backupFile.copyFileTo (targetFile))
             return;
 
@@ -1418,13 +1511,12 @@ bool MutationOrchestrator::requestPachinkoStutterAll()
     if (! validateAlignment())
         return false;
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&]
     {
         const auto snapshot = stateStore.getSnapshot();
-        auto previewSnippetURLs = snapshot.previewSnippetURLs;
+        auto previewSnippetURLs = snapshot->previewSnippetURLs;
         if (previewSnippetURLs.empty())
             return;
 
@@ -1490,16 +1582,15 @@ bool MutationOrchestrator::requestPachinkoReverseAll()
     if (! validateAlignment())
         return false;
 
-    BackgroundWorker worker;
     bool rebuildOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::slicing, [&]
     {
         const auto snapshot = stateStore.getSnapshot();
-        if (snapshot.manualReverseEnabled)
+        if (snapshot->manualReverseEnabled)
             return;
 
-        auto previewSnippetURLs = snapshot.previewSnippetURLs;
+        auto previewSnippetURLs = snapshot->previewSnippetURLs;
         if (previewSnippetURLs.empty())
             return;
 
@@ -1546,10 +1637,9 @@ bool MutationOrchestrator::requestExportSlices (const std::optional<SliceStateSt
     if (! validateAlignment())
         return false;
 
-    BackgroundWorker worker;
     bool exportOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::exporting, [&]
     {
         ExportOrchestrator exporter (stateStore);
         exportOk = exporter.exportSlices (overrideSettings);
@@ -1563,10 +1653,9 @@ bool MutationOrchestrator::requestExportFullChainWithoutVolume (const std::optio
     if (! guardMutation())
         return false;
 
-    BackgroundWorker worker;
     bool exportOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::exporting, [&]
     {
         ExportOrchestrator exporter (stateStore);
         exportOk = exporter.exportFullChainWithoutVolume (overrideSettings);
@@ -1583,10 +1672,9 @@ bool MutationOrchestrator::requestExportFullChainWithVolume (const std::optional
     if (! validateAlignment())
         return false;
 
-    BackgroundWorker worker;
     bool exportOk = false;
 
-    worker.enqueue ([&]
+    JobScheduler::get().run (JobScheduler::Priority::exporting, [&]
     {
         ExportOrchestrator exporter (stateStore);
         exportOk = exporter.exportFullChainWithVolume (overrideSettings);
@@ -1607,7 +1695,7 @@ bool MutationOrchestrator::hasStutterUndoBackup() const
         return true;
 
     const auto snapshot = stateStore.getSnapshot();
-    return ! snapshot.stutterUndoBackup.empty();
+    return ! snapshot->stutterUndoBackup.empty();
 }
 
 bool MutationOrchestrator::guardMutation() const
@@ -1624,13 +1712,13 @@ bool MutationOrchestrator::validateIndex (int index) const
         return false;
 
     const auto snapshot = stateStore.getSnapshot();
-    return index < static_cast<int> (snapshot.sliceInfos.size());
+    return index < static_cast<int> (snapshot->sliceInfos.size());
 }
 
 bool MutationOrchestrator::validateAlignment() const
 {
     const auto snapshot = stateStore.getSnapshot();
-    const std::size_t size = snapshot.sliceInfos.size();
-    return snapshot.previewSnippetURLs.size() == size
-        && snapshot.sliceVolumeSettings.size() == size;
+    const std::size_t size = snapshot->sliceInfos.size();
+    return snapshot->previewSnippetURLs.size() == size
+        && snapshot->sliceVolumeSettings.size() == size;
 }
@@ -1,15 +1,27 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <functional>
 #include <optional>
 #include "SliceStateStore.h"
 
 class AudioEngine;
+class SpeculativeSlicePool;
 
 class MutationOrchestrator
 {
 public:
-    explicit MutationOrchestrator (SliceStateStore& stateStore, AudioEngine* engine = nullptr);
+    struct SliceSet
+    {
+        std::vector<SliceStateStore::SliceInfo> sliceInfos;
+        std::vector<juce::File> previewSnippetURLs;
+        std::vector<SliceStateStore::SliceVolumeSetting> sliceVolumeSettings;
+    };
+
+    // with a pool, Slice All and regenerate take what it has cut ahead
+    explicit MutationOrchestrator (SliceStateStore& stateStore,
+                                   AudioEngine* engine = nullptr,
+                                   SpeculativeSlicePool* slicePool = nullptr);
 
     void setCaching (bool caching);
     bool isCaching() const;
@@ -30,6 +42,28 @@ public:
     void clearStutterUndoBackup();
     bool hasStutterUndoBackup() const;
 
+    // =====================================================
+    // CUTTING (ANY THREAD)
+    // =====================================================
+    // These write audio files but publish nothing. shouldStop, if set, is
+    // polled between files.
+
+    // the kit Slice All cuts from kitSeed with the snapshot's settings,
+    // written to folder as slice_<index>.wav; the same seed, settings and
+    // sources always cut the same kit
+    std::optional<SliceSet> cutSliceSet (const SliceStateStore::SliceStateSnapshot& snapshot,
+                                         const juce::File& folder,
+                                         juce::int64 kitSeed,
+                                         const std::function<bool()>& shouldStop) const;
+
+    // what regenerating the slice at index would replace it with, written to
+    // outputFile; drawn from the next step of the slice's stream
+    std::optional<SliceStateStore::SliceInfo> cutReplacement (const SliceStateStore::SliceInfo& sliceInfo,
+                                                              int index,
+                                                              const SliceStateStore::SliceStateSnapshot& snapshot,
+                                                              const juce::File& outputFile,
+                                                              const std::function<bool()>& shouldStop) const;
+
 private:
     bool guardMutation() const;
     bool validateIndex (int index) const;
@@ -37,6 +71,7 @@ private:
 
     SliceStateStore& stateStore;
     AudioEngine* audioEngine = nullptr;
+    SpeculativeSlicePool* slicePool = nullptr;
     std::atomic<bool> caching { false };
     juce::File stutterUndoBackup;
 
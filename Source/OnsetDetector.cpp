@@ -0,0 +1,498 @@
+#include "OnsetDetector.h"
+#include "SampleSum.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr double kHopSeconds = 0.005;
+    constexpr double kMinOnsetGapSeconds = 0.03;
+    constexpr float kFloorDb = -100.0f;
+    constexpr float kGateDb = -60.0f;        // quieter hops never hold an onset
+    constexpr float kMinRiseDb = 6.0f;
+    constexpr float kAdaptiveScale = 1.5f;   // times the mean of the recent flux
+    constexpr float kAttackFraction = 0.25f; // of the hop's peak squared difference
+    constexpr float kBacktrackRiseDb = 1.5f;
+    constexpr float kBacktrackRiseFraction = 0.1f; // of the whole rise, so a noise floor's wobble is not an attack
+    constexpr float kCompetingLevelDb = 24.0f;
+    constexpr int kNoOnset = std::numeric_limits<int>::min() / 2;
+
+    // the attack starts at the first sample that carries a fair share of the
+    // hop's high-frequency energy
+    int attackOffset (const float* squaredDiff, int numSamples)
+    {
+        const float attackLevel = kAttackFraction * juce::FloatVectorOperations::findMaximum (squaredDiff, numSamples);
+        const auto attack = std::find_if (squaredDiff, squaredDiff + numSamples,
+                                          [attackLevel] (float value) { return value >= attackLevel; });
+        return static_cast<int> (attack - squaredDiff);
+    }
+}
+
+OnsetDetector::OnsetDetector (double sampleRate)
+    : hopSamples (juce::jmax (2, juce::roundToInt (sampleRate * kHopSeconds))),
+      minOnsetGapFrames (juce::jmax (1, juce::roundToInt (sampleRate * kMinOnsetGapSeconds))),
+      hop (static_cast<size_t> (hopSamples)),
+      hopDiff (static_cast<size_t> (hopSamples))
+{
+    reset();
+}
+
+void OnsetDetector::reset()
+{
+    hopFill = 0;
+    hopStartFrame = 0;
+    lastSample = 0.0f;
+    historyCount = 0;
+    previousFlux = 0.0f;
+    recentWrite = 0;
+    recentCount = 0;
+    hasPending = false;
+    lastOnsetFrame = kNoOnset;
+}
+
+void OnsetDetector::process (const float* samples, int numSamples, std::vector<Onset>& onsets)
+{
+    while (numSamples > 0)
+    {
+        // whole hops are analysed in place
+        if (hopFill == 0 && numSamples >= hopSamples)
+        {
+            finishHop (samples, hopSamples, onsets);
+            samples += hopSamples;
+            numSamples -= hopSamples;
+            continue;
+        }
+
+        const int count = juce::jmin (numSamples, hopSamples - hopFill);
+        juce::FloatVectorOperations::copy (hop.data() + hopFill, samples, count);
+        hopFill += count;
+        samples += count;
+        numSamples -= count;
+
+        if (hopFill == hopSamples)
+            finishHop (hop.data(), hopFill, onsets);
+    }
+}
+
+void OnsetDetector::flush (std::vector<Onset>& onsets)
+{
+    if (hopFill > 0)
+        finishHop (hop.data(), hopFill, onsets);
+
+    if (hasPending && pending.frame - lastOnsetFrame >= minOnsetGapFrames)
+        onsets.push_back (pending);
+
+    hasPending = false;
+}
+
+void OnsetDetector::finishHop (const float* samples, int numSamples, std::vector<Onset>& onsets)
+{
+    float* diff = hopDiff.data();
+
+    diff[0] = samples[0] - lastSample;
+    juce::FloatVectorOperations::subtract (diff + 1, samples + 1, samples, numSamples - 1);
+    juce::FloatVectorOperations::multiply (diff, diff, numSamples);
+    lastSample = samples[numSamples - 1];
+
+    const float meanSquare = sumOfSamples (diff, numSamples) / static_cast<float> (numSamples);
+    const HopRecord current { hopStartFrame + attackOffset (diff, numSamples),
+                              juce::Decibels::gainToDecibels (std::sqrt (meanSquare), kFloorDb) };
+
+    // the rise is measured from the quietest of the last few hops, so a slow
+    // attack counts as much as a sharp one. The first hop only sets the
+    // baseline: audio that starts mid-note has not risen from anything.
+    float flux = 0.0f;
+    int lowest = 0;
+    if (historyCount > 0 && current.db > kGateDb)
+    {
+        for (int i = 1; i < historyCount; ++i)
+        {
+            if (history[static_cast<size_t> (i)].db <= history[static_cast<size_t> (lowest)].db)
+                lowest = i;
+        }
+
+        flux = juce::jmax (0.0f, current.db - history[static_cast<size_t> (lowest)].db);
+    }
+
+    // the pending hop rose more than both its neighbours
+    if (hasPending)
+    {
+        if (flux < pending.strength && pending.frame - lastOnsetFrame >= minOnsetGapFrames)
+        {
+            onsets.push_back (pending);
+            lastOnsetFrame = pending.frame;
+        }
+
+        hasPending = false;
+    }
+
+    float threshold = kMinRiseDb;
+    if (recentCount > 0)
+        threshold = juce::jmax (threshold, kAdaptiveScale * sumOfSamples (recentFlux.data(), recentCount) / static_cast<float> (recentCount));
+
+    if (flux >= threshold && flux >= previousFlux)
+    {
+        // the attack began in the first hop of the unbroken run clear of the
+        // baseline that leads into this one; a hop the noise lifted for a
+        // moment is not part of it
+        int attackFrame = current.attackFrame;
+        const float clearDb = history[static_cast<size_t> (lowest)].db
+                             + juce::jmax (kBacktrackRiseDb, kBacktrackRiseFraction * flux);
+        for (int i = historyCount - 1; i > lowest; --i)
+        {
+            if (history[static_cast<size_t> (i)].db < clearDb)
+                break;
+
+            attackFrame = history[static_cast<size_t> (i)].attackFrame;
+        }
+
+        pending = { attackFrame, flux, current.db };
+        hasPending = true;
+    }
+
+    recentFlux[static_cast<size_t> (recentWrite)] = flux;
+    recentWrite = (recentWrite + 1) % static_cast<int> (recentFlux.size());
+    recentCount = juce::jmin (recentCount + 1, static_cast<int> (recentFlux.size()));
+
+    if (historyCount == kBaselineHops)
+        std::move (history.begin() + 1, history.end(), history.begin());
+    else
+        ++historyCount;
+
+    history[static_cast<size_t> (historyCount - 1)] = current;
+    previousFlux = flux;
+    hopStartFrame += numSamples;
+    hopFill = 0;
+}
+
+std::optional<int> OnsetDetector::findStrongestOnset (const float* samples, int numSamples, double sampleRate)
+{
+    if (samples == nullptr || numSamples <= 0 || sampleRate <= 0.0)
+        return std::nullopt;
+
+    OnsetDetector detector (sampleRate);
+    std::vector<Onset> onsets;
+    detector.process (samples, numSamples, onsets);
+    detector.flush (onsets);
+
+    if (onsets.empty())
+        return std::nullopt;
+
+    float loudestDb = kFloorDb;
+    for (const auto& onset : onsets)
+        loudestDb = juce::jmax (loudestDb, onset.levelDb);
+
+    const Onset* best = nullptr;
+    for (const auto& onset : onsets)
+    {
+        if (onset.levelDb < loudestDb - kCompetingLevelDb)
+            continue;
+
+        if (best == nullptr || onset.strength > best->strength)
+            best = &onset;
+    }
+
+    return best->frame;
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+#include <JuceHeader.h>
+#include "SliceInfrastructure.h"
+
+// Plants attacks at known frames in quiet noise and checks they are found,
+// whatever the block size. Then scores the detector on labelled recordings:
+// every audio file in the folder named by SLICEBOT_ONSET_CORPUS that has a
+// .onsets file beside it, holding one onset time in seconds at the start of
+// each line (the layout of the public onset datasets, and of an Audacity
+// label track export). The recordings are skipped when the variable is unset.
+class OnsetDetectorTests final : public juce::UnitTest
+{
+public:
+    OnsetDetectorTests() : juce::UnitTest ("OnsetDetector", "Slicebot") {}
+
+    void runTest() override
+    {
+        checkPlantedAttacks();
+        checkLabelledRecordings();
+    }
+
+private:
+    static constexpr double kToleranceSeconds = 0.05; // the usual onset evaluation window
+    static constexpr double kWindowSeconds = 2.0;     // one bar at 120 BPM
+    static constexpr int kBlockSize = 512;
+
+    static constexpr double kPlantedSampleRate = 48000.0;
+    static constexpr double kPlantedSeconds = 8.0;
+    static constexpr double kPlantedSpacingSeconds = 0.25;
+    static constexpr double kPlantedToleranceSeconds = 0.005; // one hop
+
+    struct Totals
+    {
+        int files = 0;
+        int labelled = 0;
+        int detected = 0;
+        int matched = 0;
+        int windows = 0;
+        int onsetPickHits = 0;
+        int loudestPickHits = 0;
+        int streamMismatches = 0;
+        double audioSeconds = 0.0;
+        double detectSeconds = 0.0;
+        double pickedAudioSeconds = 0.0;
+        double onsetPickSeconds = 0.0;
+        double loudestPickSeconds = 0.0;
+    };
+
+    static double secondsSince (juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    static std::vector<OnsetDetector::Onset> detectInBlocks (const float* samples, int numSamples,
+                                                             double sampleRate, int blockSize)
+    {
+        std::vector<OnsetDetector::Onset> onsets;
+        OnsetDetector detector (sampleRate);
+        for (int offset = 0; offset < numSamples; offset += blockSize)
+            detector.process (samples + offset, juce::jmin (blockSize, numSamples - offset), onsets);
+        detector.flush (onsets);
+        return onsets;
+    }
+
+    static bool sameOnsets (const std::vector<OnsetDetector::Onset>& a, const std::vector<OnsetDetector::Onset>& b)
+    {
+        return std::equal (a.begin(), a.end(), b.begin(), b.end(), [] (const auto& x, const auto& y)
+        {
+            return x.frame == y.frame && x.strength == y.strength && x.levelDb == y.levelDb;
+        });
+    }
+
+    // the slicer's pick over bar-long windows, timed against the loudest
+    // sample search it replaced
+    static void pickInWindows (const float* samples, int numSamples, double sampleRate, Totals& totals)
+    {
+        const int windowFrames = juce::roundToInt (kWindowSeconds * sampleRate);
+
+        totals.pickedAudioSeconds += (numSamples / windowFrames) * kWindowSeconds;
+
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        for (int start = 0; start + windowFrames <= numSamples; start += windowFrames)
+            juce::ignoreUnused (OnsetDetector::findStrongestOnset (samples + start, windowFrames, sampleRate));
+        totals.onsetPickSeconds += secondsSince (startTicks);
+
+        startTicks = juce::Time::getHighResolutionTicks();
+        int sink = 0;
+        for (int start = 0; start + windowFrames <= numSamples; start += windowFrames)
+            sink += loudestSampleIndex (samples + start, windowFrames);
+        totals.loudestPickSeconds += secondsSince (startTicks);
+        juce::ignoreUnused (sink);
+    }
+
+    static juce::String pickTimings (const Totals& totals)
+    {
+        return "per bar window: strongest onset " + juce::String (totals.pickedAudioSeconds / juce::jmax (1.0e-9, totals.onsetPickSeconds), 0)
+               + "x realtime, loudest sample " + juce::String (totals.pickedAudioSeconds / juce::jmax (1.0e-9, totals.loudestPickSeconds), 0)
+               + "x realtime";
+    }
+
+    // decaying noise bursts and short clicks, alternately, at uneven frames
+    // over a noise floor near -60 dB
+    void checkPlantedAttacks()
+    {
+        beginTest ("planted attacks");
+
+        const double sampleRate = kPlantedSampleRate;
+        const int numSamples = juce::roundToInt (kPlantedSeconds * sampleRate);
+        const int spacingFrames = juce::roundToInt (kPlantedSpacingSeconds * sampleRate);
+        const int burstFrames = juce::roundToInt (0.05 * sampleRate);
+        const int toleranceFrames = juce::roundToInt (kPlantedToleranceSeconds * sampleRate);
+
+        juce::Random random (4711);
+        std::vector<float> audio (static_cast<size_t> (numSamples));
+        for (auto& sample : audio)
+            sample = 0.001f * (2.0f * random.nextFloat() - 1.0f);
+
+        std::vector<int> planted;
+        for (int start = spacingFrames / 2; start + spacingFrames <= numSamples; start += spacingFrames)
+        {
+            const int frame = start + random.nextInt (spacingFrames / 4);
+            const float gain = 0.2f + 0.6f * random.nextFloat();
+            planted.push_back (frame);
+
+            if (planted.size() % 2 == 0)
+            {
+                for (int i = 0; i < 3; ++i)
+                    audio[static_cast<size_t> (frame + i)] += i % 2 == 0 ? gain : -gain;
+                continue;
+            }
+
+            for (int i = 0; i < burstFrames; ++i)
+            {
+                const float envelope = gain * std::exp (-5.0f * static_cast<float> (i) / static_cast<float> (burstFrames));
+                audio[static_cast<size_t> (frame + i)] += envelope * (2.0f * random.nextFloat() - 1.0f);
+            }
+        }
+
+        const float* samples = audio.data();
+        const auto whole = detectInBlocks (samples, numSamples, sampleRate, numSamples);
+
+        expectEquals (static_cast<int> (whole.size()), static_cast<int> (planted.size()), "one onset per planted attack");
+        for (size_t i = 0; i < juce::jmin (whole.size(), planted.size()); ++i)
+            expectLessOrEqual (std::abs (whole[i].frame - planted[i]), toleranceFrames,
+                               "onset " + juce::String (static_cast<int> (i)) + " lands on its attack");
+
+        for (const int blockSize : { 1, 7, 64, 441, kBlockSize, 4096 })
+            expect (sameOnsets (whole, detectInBlocks (samples, numSamples, sampleRate, blockSize)),
+                    "blocks of " + juce::String (blockSize) + " find the same onsets as one buffer");
+
+        Totals totals;
+        pickInWindows (samples, numSamples, sampleRate, totals);
+        logMessage (pickTimings (totals));
+    }
+
+    void checkLabelledRecordings()
+    {
+        beginTest ("labelled recordings");
+
+        const auto folderPath = juce::SystemStats::getEnvironmentVariable ("SLICEBOT_ONSET_CORPUS", {});
+        if (folderPath.isEmpty() || ! juce::File (folderPath).isDirectory())
+        {
+            logMessage ("SLICEBOT_ONSET_CORPUS names no folder; skipped");
+            return;
+        }
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        Totals totals;
+        for (const auto& file : juce::File (folderPath).findChildFiles (juce::File::findFiles, false,
+                                                                        formatManager.getWildcardForAllFormats()))
+        {
+            const auto labelFile = file.withFileExtension (".onsets");
+            if (! labelFile.existsAsFile())
+                continue;
+
+            std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+            if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0)
+                continue;
+
+            score (*reader, readLabels (labelFile, reader->sampleRate), totals);
+            ++totals.files;
+        }
+
+        if (totals.files == 0)
+        {
+            logMessage ("no labelled recordings in " + folderPath);
+            return;
+        }
+
+        const double precision = totals.detected > 0 ? static_cast<double> (totals.matched) / totals.detected : 0.0;
+        const double recall = totals.labelled > 0 ? static_cast<double> (totals.matched) / totals.labelled : 0.0;
+        const double fMeasure = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+
+        logMessage (juce::String (totals.files) + " files, " + juce::String (totals.labelled) + " labelled onsets; streamed detection"
+                    + " precision " + juce::String (precision, 3) + ", recall " + juce::String (recall, 3)
+                    + ", F " + juce::String (fMeasure, 3) + " within " + juce::String (kToleranceSeconds * 1000.0, 0) + " ms");
+        logMessage ("bar windows: strongest onset " + juce::String (totals.onsetPickHits)
+                    + ", loudest sample " + juce::String (totals.loudestPickHits)
+                    + " of " + juce::String (totals.windows) + " on a labelled onset; "
+                    + juce::String (totals.audioSeconds / juce::jmax (1.0e-9, totals.detectSeconds), 0) + "x realtime");
+
+        logMessage (pickTimings (totals));
+
+        expectEquals (totals.streamMismatches, 0, "streamed blocks find the same onsets as one buffer");
+        expectGreaterOrEqual (totals.onsetPickHits, totals.loudestPickHits,
+                              "the strongest onset starts slices on attacks at least as often as the loudest sample");
+    }
+
+    static std::vector<int> readLabels (const juce::File& labelFile, double sampleRate)
+    {
+        std::vector<int> frames;
+        for (const auto& line : juce::StringArray::fromLines (labelFile.loadFileAsString()))
+        {
+            const auto time = line.trim().upToFirstOccurrenceOf ("\t", false, false)
+                                         .upToFirstOccurrenceOf (" ", false, false);
+            if (time.isNotEmpty())
+                frames.push_back (juce::roundToInt (time.getDoubleValue() * sampleRate));
+        }
+
+        std::sort (frames.begin(), frames.end());
+        return frames;
+    }
+
+    static bool nearLabel (const std::vector<int>& labels, int frame, int toleranceFrames)
+    {
+        const auto next = std::lower_bound (labels.begin(), labels.end(), frame - toleranceFrames);
+        return next != labels.end() && *next <= frame + toleranceFrames;
+    }
+
+    void score (juce::AudioFormatReader& reader, const std::vector<int>& labels, Totals& totals)
+    {
+        const double sampleRate = reader.sampleRate;
+        const int numSamples = static_cast<int> (reader.lengthInSamples);
+        const int toleranceFrames = juce::roundToInt (kToleranceSeconds * sampleRate);
+
+        // the slicer analyses channel 0, so score that
+        juce::AudioBuffer<float> audio (static_cast<int> (reader.numChannels), numSamples);
+        reader.read (&audio, 0, numSamples, 0, true, true);
+        const float* samples = audio.getReadPointer (0);
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        const auto whole = detectInBlocks (samples, numSamples, sampleRate, numSamples);
+        totals.detectSeconds += secondsSince (startTicks);
+        totals.audioSeconds += numSamples / sampleRate;
+
+        if (! sameOnsets (whole, detectInBlocks (samples, numSamples, sampleRate, kBlockSize)))
+            ++totals.streamMismatches;
+
+        pickInWindows (samples, numSamples, sampleRate, totals);
+
+        // each label matches at most one detection
+        std::vector<bool> used (labels.size(), false);
+        for (const auto& onset : whole)
+        {
+            for (size_t i = 0; i < labels.size(); ++i)
+            {
+                if (! used[i] && std::abs (labels[i] - onset.frame) <= toleranceFrames)
+                {
+                    used[i] = true;
+                    ++totals.matched;
+                    break;
+                }
+            }
+        }
+
+        totals.labelled += static_cast<int> (labels.size());
+        totals.detected += static_cast<int> (whole.size());
+
+        // the slicer's pick: one start per bar-long window
+        const int windowFrames = juce::roundToInt (kWindowSeconds * sampleRate);
+        for (int start = 0; start + windowFrames <= numSamples; start += windowFrames)
+        {
+            if (! nearLabel (labels, start + windowFrames / 2, windowFrames / 2))
+                continue;
+
+            ++totals.windows;
+
+            const int loudest = start + loudestSampleIndex (samples + start, windowFrames);
+            const auto strongest = OnsetDetector::findStrongestOnset (samples + start, windowFrames, sampleRate);
+            const int picked = strongest.has_value() ? start + *strongest : loudest;
+
+            if (nearLabel (labels, loudest, toleranceFrames))
+                ++totals.loudestPickHits;
+
+            if (nearLabel (labels, picked, toleranceFrames))
+                ++totals.onsetPickHits;
+        }
+    }
+};
+
+static OnsetDetectorTests onsetDetectorTests;
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <optional>
+#include <vector>
+
+// Finds note attacks in mono audio from the rise of its high-frequency energy
+// (the first difference of the signal, so energy is weighted by frequency the
+// way an HFC measure is) over the last few 5 ms hops. Peaks in that flux which
+// clear an adaptive threshold are onsets. Audio can be streamed in
+// blocks of any size; each hop is processed with vector operations.
+class OnsetDetector
+{
+public:
+    struct Onset
+    {
+        int frame = 0;         // first sample of the attack, counted from reset
+        float strength = 0.0f; // dB rise over the quietest of the preceding hops
+        float levelDb = 0.0f;  // high-frequency energy of the hop holding the attack
+    };
+
+    explicit OnsetDetector (double sampleRate);
+
+    void reset();
+
+    // an onset is reported once the hop after it has been seen, so reports
+    // trail the input by up to two hops
+    void process (const float* samples, int numSamples, std::vector<Onset>& onsets);
+
+    // end of input: analyses the partial hop and reports what is still pending
+    void flush (std::vector<Onset>& onsets);
+
+    // the strongest onset among those not far quieter than the loudest one;
+    // nullopt when the audio has none (a held note, silence)
+    static std::optional<int> findStrongestOnset (const float* samples, int numSamples, double sampleRate);
+
+private:
+    static constexpr int kBaselineHops = 8;
+
+    struct HopRecord
+    {
+        int attackFrame = 0;
+        float db = 0.0f;
+    };
+
+    void finishHop (const float* samples, int numSamples, std::vector<Onset>& onsets);
+
+    const int hopSamples;
+    const int minOnsetGapFrames;
+
+    std::vector<float> hop;
+    std::vector<float> hopDiff;
+    int hopFill = 0;
+    int hopStartFrame = 0;
+    float lastSample = 0.0f;
+
+    std::array<HopRecord, kBaselineHops> history {}; // oldest first
+    int historyCount = 0;
+    float previousFlux = 0.0f;
+    std::array<float, 16> recentFlux {};
+    int recentWrite = 0;
+    int recentCount = 0;
+
+    bool hasPending = false;
+    Onset pending;
+    int lastOnsetFrame = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OnsetDetector)
+};
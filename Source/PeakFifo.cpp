@@ -0,0 +1,58 @@
+#include "PeakFifo.h"
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void PeakFifo::prepare (int newSamplesPerPeak)
+{
+    samplesPerPeak = juce::jmax (1, newSamplesPerPeak);
+    pendingSamples = 0;
+    pending = {};
+}
+
+void PeakFifo::push (const float* const* channels, int numChannels, int numSamples)
+{
+    int offset = 0;
+    while (offset < numSamples && numChannels > 0)
+    {
+        const int count = juce::jmin (numSamples - offset, samplesPerPeak - pendingSamples);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax (channels[ch] + offset, count);
+            pending.min = juce::jmin (pending.min, range.getStart());
+            pending.max = juce::jmax (pending.max, range.getEnd());
+        }
+
+        pendingSamples += count;
+        offset += count;
+
+        if (pendingSamples < samplesPerPeak)
+            break;
+
+        const auto scope = fifo.write (1);
+        if (scope.blockSize1 > 0)
+            peaks[static_cast<size_t> (scope.startIndex1)] = pending;
+        else if (scope.blockSize2 > 0)
+            peaks[static_cast<size_t> (scope.startIndex2)] = pending;
+
+        pending = {};
+        pendingSamples = 0;
+    }
+}
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+int PeakFifo::pop (Peak* dest, int maxPeaks)
+{
+    const auto scope = fifo.read (juce::jmin (maxPeaks, fifo.getNumReady()));
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        dest[i] = peaks[static_cast<size_t> (scope.startIndex1 + i)];
+    for (int i = 0; i < scope.blockSize2; ++i)
+        dest[scope.blockSize1 + i] = peaks[static_cast<size_t> (scope.startIndex2 + i)];
+
+    return scope.blockSize1 + scope.blockSize2;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+
+// Decimated min/max pairs of a recorder's input, handed from the audio
+// thread to its view. Each pair covers a fixed number of samples, so the view
+// can draw a scrolling waveform without ever touching the recording buffer.
+class PeakFifo
+{
+public:
+    static constexpr int kCapacity = 1024;
+
+    struct Peak
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+    };
+
+    PeakFifo() = default;
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    // prepare is called while the device is stopped
+    void prepare (int samplesPerPeak);
+
+    // a full FIFO means nobody is draining it; the pair is dropped
+    void push (const float* const* channels, int numChannels, int numSamples);
+
+    // =====================================================
+    // MESSAGE THREAD
+    // =====================================================
+    int pop (Peak* dest, int maxPeaks);
+
+private:
+    juce::AbstractFifo fifo { kCapacity };
+    std::array<Peak, kCapacity> peaks {};
+
+    // audio thread
+    int samplesPerPeak = 1;
+    int pendingSamples = 0;
+    Peak pending;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PeakFifo)
+};
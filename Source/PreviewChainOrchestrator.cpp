@@ -79,7 +79,7 @@ namespace
 
         AudioFileIO::ConvertedAudio chainAudio;
         chainAudio.buffer = std::move (chainBuffer);
-        chainAudio.sampleRate = 44100.0;
+        chainAudio.sampleRate = audioFileIO.getTargetSampleRate();
 
         return audioFileIO.writeMonoWav16 (chainFile, chainAudio);
     }
@@ -93,15 +93,15 @@ PreviewChainOrchestrator::PreviewChainOrchestrator (SliceStateStore& store)
 bool PreviewChainOrchestrator::rebuildPreviewChain() const
 {
     const auto snapshot = stateStore.getSnapshot();
-    if (snapshot.previewSnippetURLs.empty())
+    if (snapshot->previewSnippetURLs.empty())
         return false;
 
-    auto previewSnippetURLs = snapshot.previewSnippetURLs;
-    auto sliceVolumeSettings = snapshot.sliceVolumeSettings;
+    auto previewSnippetURLs = snapshot->previewSnippetURLs;
+    auto sliceVolumeSettings = snapshot->sliceVolumeSettings;
 
-    const bool layeringMode = snapshot.layeringMode;
-    const int sampleCount = snapshot.sampleCount;
-    const SliceStateStore::MergeMode mergeMode = snapshot.mergeMode;
+    const bool layeringMode = snapshot->layeringMode;
+    const int sampleCount = snapshot->sampleCount;
+    const SliceStateStore::MergeMode mergeMode = snapshot->mergeMode;
 
     if (layeringMode)
     {
@@ -201,7 +201,7 @@ bool PreviewChainOrchestrator::rebuildPreviewChain() const
 
             AudioFileIO::ConvertedAudio mergedAudio;
             mergedAudio.buffer = std::move (mergedBuffer);
-            mergedAudio.sampleRate = 44100.0;
+            mergedAudio.sampleRate = leftAudio.sampleRate;
 
             if (! audioFileIO.writeMonoWav16 (mergedFile, mergedAudio))
                 return false;
@@ -209,7 +209,7 @@ bool PreviewChainOrchestrator::rebuildPreviewChain() const
             previewSnippetURLs[static_cast<std::size_t> (i)] = mergedFile;
         }
 
-        stateStore.setAlignedSlices (snapshot.sliceInfos,
+        stateStore.setAlignedSlices (snapshot->sliceInfos,
                                      previewSnippetURLs,
                                      sliceVolumeSettings);
     }
@@ -233,17 +233,17 @@ bool PreviewChainOrchestrator::rebuildLoopChainWithVolume() const
         return false;
 
     const auto snapshot = stateStore.getSnapshot();
-    if (snapshot.previewSnippetURLs.empty())
+    if (snapshot->previewSnippetURLs.empty())
         return false;
 
-    const int chainCount = snapshot.layeringMode
-                               ? snapshot.sampleCount
-                               : static_cast<int> (snapshot.previewSnippetURLs.size());
+    const int chainCount = snapshot->layeringMode
+                               ? snapshot->sampleCount
+                               : static_cast<int> (snapshot->previewSnippetURLs.size());
     const juce::File loopChainFile =
-        snapshot.previewSnippetURLs.front().getSiblingFile ("loop_chain.wav");
+        snapshot->previewSnippetURLs.front().getSiblingFile ("loop_chain.wav");
 
-    if (! buildChainFile (snapshot.previewSnippetURLs,
-                          snapshot.sliceVolumeSettings,
+    if (! buildChainFile (snapshot->previewSnippetURLs,
+                          snapshot->sliceVolumeSettings,
                           chainCount,
                           true,
                           loopChainFile))
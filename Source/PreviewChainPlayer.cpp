@@ -1,14 +1,25 @@
 #include "PreviewChainPlayer.h"
+#include "AudioEngine.h"
+#include <algorithm>
 
-PreviewChainPlayer::PreviewChainPlayer (juce::AudioDeviceManager& deviceManagerToUse)
-    : deviceManager (deviceManagerToUse)
+namespace
+{
+    constexpr std::size_t kMaxCachedSamples = 64;
+}
+
+PreviewChainPlayer::PreviewChainPlayer (AudioEngine& audioEngineToUse)
+    : audioEngine (audioEngineToUse)
 {
     formatManager.registerBasicFormats();
-    transportSource.setLooping (isLoopEnabled);
 }
 
 PreviewChainPlayer::~PreviewChainPlayer()
 {
+    // a preload job only touches its own buffers, and its result is
+    // dropped once this player is gone
+    if (preloadToken != nullptr)
+        preloadToken->cancel();
+
     stopPlayback();
 }
 
@@ -26,42 +37,99 @@ bool PreviewChainPlayer::startPlayback (const juce::File& previewChainFile, bool
 
     isLoopEnabled = shouldLoop;
 
-    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (previewChainFile));
-    if (reader == nullptr)
+    auto sample = loadSample (previewChainFile);
+    if (sample == nullptr)
         return false;
 
-    readerSource = std::make_unique<juce::AudioFormatReaderSource> (reader.release(), true);
-    readerSource->setLooping (isLoopEnabled);
-    transportSource.setSource (readerSource.get(), 0, nullptr, readerSource->getAudioFormatReader()->sampleRate);
-    transportSource.setLooping (isLoopEnabled);
-
-    sourcePlayer.setSource (&transportSource);
-    deviceManager.addAudioCallback (&sourcePlayer);
-    transportSource.start();
-    isPlayingFlag = true;
+    SliceVoicePool::TriggerParams params;
+    params.loop = isLoopEnabled;
+    activeVoiceTag = audioEngine.getSliceVoicePool().trigger (sample, params);
 
-    return true;
+    return activeVoiceTag > 0;
 }
 
 void PreviewChainPlayer::stopPlayback()
 {
-    if (! isPlayingFlag && readerSource == nullptr)
+    if (activeVoiceTag <= 0)
         return;
 
-    transportSource.stop();
-    transportSource.setSource (nullptr);
-    sourcePlayer.setSource (nullptr);
-    deviceManager.removeAudioCallback (&sourcePlayer);
-    readerSource.reset();
-    isPlayingFlag = false;
+    audioEngine.getSliceVoicePool().stopVoice (activeVoiceTag);
+    activeVoiceTag = -1;
 }
 
 void PreviewChainPlayer::setLooping (bool shouldLoop)
 {
     isLoopEnabled = shouldLoop;
-    transportSource.setLooping (isLoopEnabled);
-    if (readerSource != nullptr)
-        readerSource->setLooping (isLoopEnabled);
+    if (activeVoiceTag > 0)
+        audioEngine.getSliceVoicePool().setVoiceLooping (activeVoiceTag, isLoopEnabled);
+}
+
+void PreviewChainPlayer::preload (const std::vector<juce::File>& files)
+{
+    if (preloadToken != nullptr)
+        preloadToken->cancel();
+
+    preloadFiles = files;
+    const int generation = ++preloadGeneration;
+
+    std::vector<juce::File> toDecode;
+    for (const auto& file : files)
+    {
+        if (file.existsAsFile() && findCached (file) == nullptr)
+            toDecode.push_back (file);
+    }
+
+    if (toDecode.empty())
+    {
+        finishPreload (generation, {});
+        return;
+    }
+
+    preloadToken = JobScheduler::makeToken();
+    juce::WeakReference<PreviewChainPlayer> weakThis (this);
+
+    // interactive: the user is about to click or play these
+    auto decodeAll = [weakThis, generation, toDecode, token = preloadToken]()
+    {
+        juce::AudioFormatManager manager;
+        manager.registerBasicFormats();
+
+        auto decoded = std::make_shared<std::vector<DecodedFile>>();
+        for (const auto& file : toDecode)
+        {
+            if (token->isCancelled())
+                return;
+
+            DecodedFile result;
+            if (decode (manager, file, result))
+                decoded->push_back (std::move (result));
+        }
+
+        juce::MessageManager::callAsync ([weakThis, generation, decoded]
+        {
+            if (auto* player = weakThis.get())
+                player->finishPreload (generation, std::move (*decoded));
+        });
+    };
+
+    JobScheduler::get().submit (JobScheduler::Priority::interactive, std::move (decodeAll), preloadToken);
+}
+
+// message thread: the pool's samples are only ever created here
+void PreviewChainPlayer::finishPreload (int generation, std::vector<DecodedFile>&& decoded)
+{
+    for (auto& file : decoded)
+        addToCache (std::move (file));
+
+    if (generation != preloadGeneration)
+        return;
+
+    auto& pool = audioEngine.getSliceVoicePool();
+    for (int pad = 0; pad < SliceVoicePool::kNumPads; ++pad)
+    {
+        const auto index = static_cast<std::size_t> (pad);
+        pool.setPadSample (pad, index < preloadFiles.size() ? findCached (preloadFiles[index]) : nullptr);
+    }
 }
 
 bool PreviewChainPlayer::isLooping() const
@@ -71,5 +139,70 @@ bool PreviewChainPlayer::isLooping() const
 
 bool PreviewChainPlayer::isPlaying() const
 {
-    return isPlayingFlag;
+    return audioEngine.getSliceVoicePool().isVoicePlaying (activeVoiceTag);
+}
+
+// A click on a file the preload has not reached yet still decodes here.
+SliceVoicePool::Sample::Ptr PreviewChainPlayer::loadSample (const juce::File& file)
+{
+    if (! file.existsAsFile())
+        return nullptr;
+
+    if (auto cached = findCached (file))
+        return cached;
+
+    DecodedFile decoded;
+    if (! decode (formatManager, file, decoded))
+        return nullptr;
+
+    return addToCache (std::move (decoded));
+}
+
+SliceVoicePool::Sample::Ptr PreviewChainPlayer::findCached (const juce::File& file)
+{
+    const auto cached = sampleCache.find (file.getFullPathName());
+    if (cached == sampleCache.end()
+        || cached->second.lastModified != file.getLastModificationTime()
+        || cached->second.sizeBytes != file.getSize())
+    {
+        return nullptr;
+    }
+
+    cached->second.lastUse = ++cacheUseCount;
+    return cached->second.sample;
+}
+
+SliceVoicePool::Sample::Ptr PreviewChainPlayer::addToCache (DecodedFile&& decoded)
+{
+    const auto key = decoded.file.getFullPathName();
+
+    // a full cache drops the sample used longest ago
+    if (sampleCache.size() >= kMaxCachedSamples && sampleCache.find (key) == sampleCache.end())
+    {
+        const auto oldest = std::min_element (sampleCache.begin(), sampleCache.end(), [] (const auto& a, const auto& b)
+        {
+            return a.second.lastUse < b.second.lastUse;
+        });
+        sampleCache.erase (oldest);
+    }
+
+    auto sample = audioEngine.getSliceVoicePool().createSample (std::move (decoded.audio), decoded.sampleRate);
+    sampleCache[key] = { decoded.lastModified, decoded.sizeBytes, sample, ++cacheUseCount };
+    return sample;
+}
+
+bool PreviewChainPlayer::decode (juce::AudioFormatManager& manager, const juce::File& file, DecodedFile& result)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader (manager.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return false;
+
+    result.file = file;
+    result.lastModified = file.getLastModificationTime();
+    result.sizeBytes = file.getSize();
+    result.sampleRate = reader->sampleRate;
+    result.audio.setSize (static_cast<int> (reader->numChannels),
+                          static_cast<int> (reader->lengthInSamples));
+    reader->read (&result.audio, 0, result.audio.getNumSamples(), 0, true, true);
+    return true;
 }
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <map>
+#include <vector>
+#include "JobScheduler.h"
+#include "SliceVoicePool.h"
+
+class AudioEngine;
 
 class PreviewChainPlayer final
 {
 public:
-    explicit PreviewChainPlayer (juce::AudioDeviceManager& deviceManagerToUse);
+    explicit PreviewChainPlayer (AudioEngine& audioEngineToUse);
     ~PreviewChainPlayer();
 
     bool startPlayback (const juce::File& previewChainFile);
@@ -13,17 +19,51 @@ public:
     void stopPlayback();
     void setLooping (bool shouldLoop);
 
+    // reads files into memory ahead of the first click, decoding on the
+    // scheduler; file N becomes MIDI pad N once they are in. A newer call
+    // replaces one still decoding.
+    void preload (const std::vector<juce::File>& files);
+
     bool isLooping() const;
     bool isPlaying() const;
 
 private:
-    juce::AudioDeviceManager& deviceManager;
+    struct CachedSample
+    {
+        juce::Time lastModified;
+        juce::int64 sizeBytes = 0;
+        SliceVoicePool::Sample::Ptr sample;
+        juce::uint64 lastUse = 0; // cacheUseCount when last found or added
+    };
+
+    struct DecodedFile
+    {
+        juce::File file;
+        juce::Time lastModified;
+        juce::int64 sizeBytes = 0;
+        juce::AudioBuffer<float> audio;
+        double sampleRate = 0.0;
+    };
+
+    SliceVoicePool::Sample::Ptr loadSample (const juce::File& file);
+    SliceVoicePool::Sample::Ptr findCached (const juce::File& file);
+    SliceVoicePool::Sample::Ptr addToCache (DecodedFile&& decoded);
+    void finishPreload (int generation, std::vector<DecodedFile>&& decoded);
+
+    // any thread
+    static bool decode (juce::AudioFormatManager& manager, const juce::File& file, DecodedFile& result);
+
+    AudioEngine& audioEngine;
     juce::AudioFormatManager formatManager;
-    juce::AudioTransportSource transportSource;
-    juce::AudioSourcePlayer sourcePlayer;
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    std::map<juce::String, CachedSample> sampleCache;
+    juce::uint64 cacheUseCount = 0;
+    int activeVoiceTag = -1;
     bool isLoopEnabled = false;
-    bool isPlayingFlag = false;
 
+    std::vector<juce::File> preloadFiles;
+    int preloadGeneration = 0;
+    JobScheduler::Token preloadToken;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (PreviewChainPlayer)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreviewChainPlayer)
 };
@@ -1,11 +1,34 @@
 #include "RecordingBus.h"
-#include <cmath>
+
+namespace
+{
+    constexpr double kWaveformSecondsPerPeak = 0.05;
+}
 
 // =====================================================
 // CONSTRUCTION
 // =====================================================
 
-RecordingBus::RecordingBus() {}
+RecordingBus::RecordingBus (int numRecordersToUse)
+    : numRecorders (juce::jlimit (1, kMaxRecorders, numRecordersToUse)),
+      recorders (static_cast<size_t> (numRecorders)),
+      blockChannelCounts (static_cast<size_t> (numRecorders), 0),
+      blockInputs (static_cast<size_t> (numRecorders * kMaxRecorderChannels), nullptr),
+      meters (static_cast<size_t> (numRecorders)),
+      waveformPeaks (static_cast<size_t> (numRecorders)),
+      takeAnalyzer (numRecorders)
+{
+    std::vector<RecordingModule*> modules;
+    for (auto& slot : recorders)
+        modules.push_back (&slot.recorder);
+
+    roomKeeper = std::make_unique<TakeRoomKeeper> (std::move (modules));
+}
+
+int RecordingBus::getNumRecorders() const
+{
+    return numRecorders;
+}
 
 // =====================================================
 // LIFECYCLE
@@ -17,11 +40,33 @@ void RecordingBus::prepare (double sampleRate, int bufferSize)
     this->bufferSize = bufferSize;
 
     // CRITICAL: ensure writers exist
-    for (int i = 0; i < kNumRecorders; ++i)
-    {
+    for (int i = 0; i < numRecorders; ++i)
         recorders[i].recorder.prepareDevice (sampleRate, i);
-        recorders[i].inputBuffer.setSize (1, bufferSize, false, false, true);
-        recorders[i].playbackBuffer.setSize (1, bufferSize, false, false, true);
+
+    inputScratch.setSize (numRecorders * kMaxRecorderChannels, bufferSize, false, false, true);
+    playbackScratch.setSize (numRecorders * kMaxRecorderChannels, bufferSize, false, false, true);
+
+    routing.prepare (sampleRate, bufferSize);
+
+    for (auto& meter : meters)
+        meter.prepare (sampleRate, bufferSize, kMaxRecorderChannels);
+
+    for (auto& peaks : waveformPeaks)
+        peaks.prepare (juce::roundToInt (sampleRate * kWaveformSecondsPerPeak));
+
+    takeAnalyzer.prepare (sampleRate);
+
+    // rings hold seconds, so a new sample rate needs a new ring; one that is
+    // being read by a commit is left alone until the next restart
+    for (int i = 0; i < numRecorders; ++i)
+    {
+        auto& slot = recorders[i];
+        if (! slot.captureEnabled || slot.captureCommitting.load())
+            continue;
+
+        const int capacity = static_cast<int> (kCaptureRingSeconds * sampleRate);
+        if (slot.captureRing == nullptr || slot.captureRing->getCapacity() != capacity)
+            slot.captureRing = createCaptureRing (i);
     }
 }
 
@@ -31,7 +76,10 @@ void RecordingBus::prepare (double sampleRate, int bufferSize)
 
 void RecordingBus::armRecorder (int index)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
+        return;
+
+    if (recorders[index].captureCommitting.load())
         return;
 
     if (hasLatchedRecorders())
@@ -40,30 +88,41 @@ void RecordingBus::armRecorder (int index)
     }
     else
     {
-        recorders[index].armed = true;
-        recorders[index].recordStartMs = juce::Time::getMillisecondCounterHiRes();
-        recorders[index].recorder.arm();
+        auto& slot = recorders[index];
+        if (! slot.recorder.arm())
+            return;
+
+        slot.recordStartMs = juce::Time::getMillisecondCounterHiRes();
+        slot.armed = true;
     }
 }
 
-RecordingModule::StopResult
-RecordingBus::confirmStopRecorder (int index)
+void RecordingBus::confirmStopRecorder (int index, StopHandler onStopped)
 {
-    if (index < 0 || index >= kNumRecorders)
-        return RecordingModule::StopResult::Kept;
-
-    auto& slot = recorders[index];
-
-    if (! slot.armed)
-        return RecordingModule::StopResult::Kept;
+    // a latched start still pending counts, so the stop cancels it
+    if (index < 0 || index >= numRecorders || ! isRecorderArmed (index))
+    {
+        if (onStopped != nullptr)
+            onStopped (RecordingModule::StopResult::Kept);
+        return;
+    }
 
     if (hasLatchedRecorders())
     {
-        return stopLatchedRecorders();
+        stopLatchedRecorders (std::move (onStopped));
+        return;
     }
 
+    auto& slot = recorders[index];
     slot.armed = false;
-    return slot.recorder.confirmStop();
+    const auto result = slot.recorder.confirmStop();
+    if (result == RecordingModule::StopResult::DeletedTooShort)
+        takeAnalyzer.invalidateFrom (index, slot.recorder.getTotalSamples());
+    else
+        takeAnalyzer.finishTake (index, slot.recorder.getTotalSamples());
+
+    if (onStopped != nullptr)
+        onStopped (result);
 }
 
 void RecordingBus::cancelStopRecorder (int)
@@ -72,10 +131,11 @@ void RecordingBus::cancelStopRecorder (int)
 
 void RecordingBus::clearRecorder (int index)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
     recorders[index].recorder.clear();
+    takeAnalyzer.invalidateFrom (index, 0);
     recorders[index].armed = false;
     recorders[index].playing = false;
     recorders[index].playbackPosition = 0;
@@ -96,47 +156,58 @@ bool RecordingBus::hasLatchedRecorders() const
     return false;
 }
 
+// Latched start and stop are only requested here; the audio thread picks
+// the target sample and applies it to every latched slot in the same block.
 void RecordingBus::armLatchedRecorders()
 {
-    const double startMs = juce::Time::getMillisecondCounterHiRes();
-    for (auto& slot : recorders)
-    {
-        if (! slot.latchEnabled)
-            continue;
-
-        slot.armed = true;
-        slot.recordStartMs = startMs;
-        slot.recorder.arm();
-    }
+    latchQueue.request (LatchQueue::Command::start);
 }
 
-RecordingModule::StopResult RecordingBus::stopLatchedRecorders()
+// The result is only known once finaliseLatchedStop has committed the takes.
+void RecordingBus::stopLatchedRecorders (StopHandler onStopped)
 {
-    RecordingModule::StopResult result = RecordingModule::StopResult::Kept;
-    for (auto& slot : recorders)
-    {
-        if (! slot.latchEnabled)
-            continue;
+    if (onStopped != nullptr)
+        latchedStopHandlers.push_back (std::move (onStopped));
 
-        slot.armed = false;
-        const auto stopResult = slot.recorder.confirmStop();
-        if (stopResult == RecordingModule::StopResult::DeletedTooShort)
-            result = stopResult;
-    }
-    return result;
+    // with no device to reach the stop nothing is recording; it completes now
+    if (! latchQueue.request (LatchQueue::Command::stop))
+        finaliseLatchedStop();
 }
 
 bool RecordingBus::isRecorderArmed (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return false;
 
-    return recorders[index].armed;
+    const auto& slot = recorders[index];
+    return slot.armed.load() || (slot.latchEnabled && latchQueue.isStartPending());
+}
+
+void RecordingBus::releaseIdleTakes (const juce::CriticalSection& callbackLock)
+{
+    for (int index = 0; index < numRecorders; ++index)
+    {
+        auto& slot = recorders[index];
+        if (! isRecorderArmed (index) && ! slot.awaitingFinalise && ! slot.captureCommitting.load())
+            slot.recorder.releaseUnusedTake (callbackLock);
+    }
+}
+
+void RecordingBus::setMaxTakeSeconds (double seconds)
+{
+    for (auto& slot : recorders)
+        slot.recorder.setMaxTakeSeconds (seconds);
+}
+
+double RecordingBus::getMaxTakeSeconds() const
+{
+    return recorders.empty() ? RecordingModule::kMaxTakeSeconds
+                             : recorders.front().recorder.getMaxTakeSeconds();
 }
 
 void RecordingBus::setRecorderLatchEnabled (int index, bool enabled)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
     recorders[index].latchEnabled = enabled;
@@ -144,7 +215,7 @@ void RecordingBus::setRecorderLatchEnabled (int index, bool enabled)
 
 bool RecordingBus::isRecorderLatchEnabled (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return false;
 
     return recorders[index].latchEnabled;
@@ -152,15 +223,16 @@ bool RecordingBus::isRecorderLatchEnabled (int index) const
 
 void RecordingBus::setRecorderRecordArmEnabled (int index, bool enabled)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
     recorders[index].recordArmEnabled = enabled;
+    updateMonitorRouting (index);
 }
 
 bool RecordingBus::isRecorderRecordArmEnabled (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return false;
 
     return recorders[index].recordArmEnabled;
@@ -168,7 +240,7 @@ bool RecordingBus::isRecorderRecordArmEnabled (int index) const
 
 bool RecordingBus::startPlayback (int index)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return false;
 
     auto& slot = recorders[index];
@@ -185,7 +257,7 @@ bool RecordingBus::startPlayback (int index)
 
 void RecordingBus::stopPlayback (int index)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
     recorders[index].playing = false;
@@ -193,7 +265,7 @@ void RecordingBus::stopPlayback (int index)
 
 bool RecordingBus::isRecorderPlaying (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return false;
 
     return recorders[index].playing;
@@ -202,7 +274,7 @@ bool RecordingBus::isRecorderPlaying (int index) const
 bool RecordingBus::startLatchedPlayback()
 {
     bool started = false;
-    for (int i = 0; i < kNumRecorders; ++i)
+    for (int i = 0; i < numRecorders; ++i)
     {
         if (! recorders[i].latchEnabled)
             continue;
@@ -226,7 +298,7 @@ void RecordingBus::stopLatchedPlayback()
 
 double RecordingBus::getRecorderPlaybackProgress (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return 0.0;
 
     const auto& slot = recorders[index];
@@ -240,7 +312,7 @@ double RecordingBus::getRecorderPlaybackProgress (int index) const
 
 void RecordingBus::seekRecorderPlayback (int index, double progress)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
     auto& slot = recorders[index];
@@ -255,7 +327,7 @@ void RecordingBus::seekRecorderPlayback (int index, double progress)
 
 double RecordingBus::getRecorderRecordStartMs (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return 0.0;
 
     return recorders[index].recordStartMs;
@@ -263,7 +335,7 @@ double RecordingBus::getRecorderRecordStartMs (int index) const
 
 int RecordingBus::getRecorderTotalSamples (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return 0;
 
     return recorders[index].recorder.getTotalSamples();
@@ -271,7 +343,7 @@ int RecordingBus::getRecorderTotalSamples (int index) const
 
 int RecordingBus::getRecorderMaxSamples (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return 0;
 
     return recorders[index].recorder.getMaxSamples();
@@ -279,57 +351,252 @@ int RecordingBus::getRecorderMaxSamples (int index) const
 
 void RecordingBus::setRecorderInputGainDb (int index, float gainDb)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
     auto& slot = recorders[index];
     slot.inputGainDb = gainDb;
-    slot.inputGainLinear = juce::Decibels::decibelsToGain (gainDb);
+    routing.setInputGain (index, juce::Decibels::decibelsToGain (gainDb));
 }
 
 float RecordingBus::getRecorderInputGainDb (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return 0.0f;
 
     return recorders[index].inputGainDb;
 }
 
-float RecordingBus::getRecorderRms (int index) const
+LevelMeter::Reading RecordingBus::getRecorderMeterReading (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
-        return 0.0f;
+    if (index < 0 || index >= numRecorders)
+        return {};
 
-    return recorders[index].rms;
+    return meters[index].getReading();
 }
 
-float RecordingBus::getRecorderPeak (int index) const
+int RecordingBus::popRecorderWaveformPeaks (int index, PeakFifo::Peak* dest, int maxPeaks)
 {
-    if (index < 0 || index >= kNumRecorders)
-        return 0.0f;
+    if (index < 0 || index >= numRecorders)
+        return 0;
+
+    return waveformPeaks[index].pop (dest, maxPeaks);
+}
+
+std::shared_ptr<const LiveTakeAnalyzer::TakeAnalysis> RecordingBus::getRecorderTakeAnalysis (int index) const
+{
+    return takeAnalyzer.getAnalysis (index);
+}
+
+// =====================================================
+// SCHEDULED LATCH
+// =====================================================
+
+bool RecordingBus::hasLatchRequests() const
+{
+    return latchQueue.hasRequests();
+}
+
+void RecordingBus::scheduleLatchRequests (juce::int64 targetSample)
+{
+    latchQueue.scheduleRequests (targetSample);
+}
+
+bool RecordingBus::takeCompletedLatchedStop()
+{
+    return latchQueue.takeCompletedStop();
+}
+
+juce::int64 RecordingBus::getSamplePosition() const
+{
+    return samplePosition.load();
+}
+
+void RecordingBus::finaliseLatchedStop()
+{
+    auto result = RecordingModule::StopResult::Kept;
+
+    for (int index = 0; index < numRecorders; ++index)
+    {
+        auto& slot = recorders[index];
+        if (! slot.awaitingFinalise)
+            continue;
+
+        slot.awaitingFinalise = false;
+        if (slot.recorder.confirmStop() == RecordingModule::StopResult::DeletedTooShort)
+        {
+            takeAnalyzer.invalidateFrom (index, slot.recorder.getTotalSamples());
+            result = RecordingModule::StopResult::DeletedTooShort;
+        }
+        else
+        {
+            takeAnalyzer.finishTake (index, slot.recorder.getTotalSamples());
+        }
+    }
+
+    // a start queued behind the stop may be scheduled from now on
+    latchQueue.stopFinalised();
+
+    // a handler may request another stop, which queues for the next finalise
+    auto handlers = std::move (latchedStopHandlers);
+    latchedStopHandlers.clear();
 
-    return recorders[index].peak;
+    for (auto& handler : handlers)
+        handler (result);
 }
 
 // =====================================================
 // ROUTING
 // =====================================================
 
-void RecordingBus::setRecorderInputBufferIndex (int index, int bufferIndex)
+void RecordingBus::setRecorderInputBufferIndices (int index, const juce::Array<int>& bufferIndices)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
-    recorders[index].bufferIndex = bufferIndex;
+    routing.setInputChannels (index, bufferIndices);
+}
+
+bool RecordingBus::setRecorderNumChannels (int index, int numChannels, const juce::CriticalSection& callbackLock)
+{
+    if (index < 0 || index >= numRecorders)
+        return false;
+
+    auto& slot = recorders[index];
+    if (slot.armed || slot.playing || slot.captureCommitting.load())
+        return false;
+
+    slot.recorder.setNumChannels (juce::jlimit (1, kMaxRecorderChannels, numChannels), index, callbackLock);
+    slot.playbackPosition = 0;
+
+    if (slot.captureEnabled)
+    {
+        auto replacement = createCaptureRing (index);
+        const juce::ScopedLock sl (callbackLock);
+        std::swap (slot.captureRing, replacement);
+    }
+
+    return true;
+}
+
+int RecordingBus::getRecorderNumChannels (int index) const
+{
+    if (index < 0 || index >= numRecorders)
+        return 1;
+
+    return recorders[index].recorder.getNumChannels();
 }
 
 void RecordingBus::setRecorderMonitoringEnabled (int index, bool enabled)
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return;
 
     recorders[index].monitoringEnabled = enabled;
     recorders[index].recorder.setMonitoringEnabled (enabled);
+    updateMonitorRouting (index);
+}
+
+void RecordingBus::updateMonitorRouting (int index)
+{
+    const auto& slot = recorders[index];
+    routing.setMonitorGain (index, slot.monitoringEnabled && slot.recordArmEnabled ? 1.0f : 0.0f);
+}
+
+// =====================================================
+// RETROSPECTIVE CAPTURE
+// =====================================================
+
+bool RecordingBus::setRecorderCaptureEnabled (int index, bool enabled, const juce::CriticalSection& callbackLock)
+{
+    if (index < 0 || index >= numRecorders)
+        return false;
+
+    auto& slot = recorders[index];
+    if (slot.captureCommitting.load())
+        return false;
+
+    if (slot.captureEnabled == enabled)
+        return true;
+
+    std::unique_ptr<CaptureRing> replacement;
+    if (enabled)
+        replacement = createCaptureRing (index);
+
+    const juce::ScopedLock sl (callbackLock);
+    slot.captureEnabled = enabled;
+    std::swap (slot.captureRing, replacement);
+    return true;
+}
+
+bool RecordingBus::isRecorderCaptureEnabled (int index) const
+{
+    if (index < 0 || index >= numRecorders)
+        return false;
+
+    return recorders[index].captureEnabled;
+}
+
+bool RecordingBus::beginCaptureCommit (int index, double seconds)
+{
+    if (index < 0 || index >= numRecorders)
+        return false;
+
+    auto& slot = recorders[index];
+    if (slot.captureRing == nullptr || sampleRate <= 0.0)
+        return false;
+
+    if (slot.captureCommitting.exchange (true))
+        return false;
+
+    // checked after the flag is up, so a latched start cannot slip in between
+    if (isRecorderArmed (index))
+    {
+        slot.captureCommitting.store (false);
+        return false;
+    }
+
+    slot.pendingCaptureSamples = static_cast<int> (seconds * sampleRate);
+    return true;
+}
+
+bool RecordingBus::isCaptureCommitInProgress (int index) const
+{
+    if (index < 0 || index >= numRecorders)
+        return false;
+
+    return recorders[index].captureCommitting.load();
+}
+
+bool RecordingBus::commitCapturedHistory (int index)
+{
+    if (index < 0 || index >= numRecorders)
+        return false;
+
+    auto& slot = recorders[index];
+    if (! slot.captureCommitting.load())
+        return false;
+
+    // the ring keeps being written during the copy; only the writer's own
+    // progress is shared with the audio thread
+    // the appended pass never goes through the analyser
+    takeAnalyzer.invalidateFrom (index, slot.recorder.getTotalSamples());
+
+    juce::AudioBuffer<float> history;
+    const int numSamples = slot.captureRing->copyLatest (history, slot.pendingCaptureSamples);
+    const bool kept = slot.recorder.appendTake (history, numSamples);
+
+    slot.captureCommitting.store (false);
+    return kept;
+}
+
+std::unique_ptr<CaptureRing> RecordingBus::createCaptureRing (int index) const
+{
+    if (sampleRate <= 0.0)
+        return nullptr;
+
+    return std::make_unique<CaptureRing> (recorders[index].recorder.getNumChannels(),
+                                          static_cast<int> (kCaptureRingSeconds * sampleRate));
 }
 
 // =====================================================
@@ -338,7 +605,7 @@ void RecordingBus::setRecorderMonitoringEnabled (int index, bool enabled)
 
 double RecordingBus::getRecorderCurrentPassSeconds (int index) const
 {
-    if (index < 0 || index >= kNumRecorders)
+    if (index < 0 || index >= numRecorders)
         return 0.0;
 
     return recorders[index].recorder.getCurrentPassSeconds();
@@ -348,87 +615,163 @@ double RecordingBus::getRecorderCurrentPassSeconds (int index) const
 // AUDIO
 // =====================================================
 
-void RecordingBus::processAudioBlock (const float* const* input,
-                                      int numInputChannels,
-                                      float* const* output,
-                                      int numOutputChannels,
-                                      int numSamples)
+void RecordingBus::routeInputs (const float* const* input,
+                                int numInputChannels,
+                                float* const* output,
+                                int numOutputChannels,
+                                int numSamples)
 {
     for (int ch = 0; ch < numOutputChannels; ++ch)
         juce::FloatVectorOperations::clear (output[ch], numSamples);
 
-    for (auto& slot : recorders)
+    // resolve every recorder's input through the routing matrix before any
+    // of them is metered, written or mixed
+    routing.beginBlock();
+
+    for (int index = 0; index < numRecorders; ++index)
     {
-        slot.rms = 0.0f;
-        slot.peak = 0.0f;
+        const int offset = index * kMaxRecorderChannels;
+        blockChannelCounts[index] = routing.processInput (index,
+                                                          input,
+                                                          numInputChannels,
+                                                          inputScratch.getArrayOfWritePointers() + offset,
+                                                          blockInputs.data() + offset,
+                                                          numSamples);
+    }
+}
 
-        const int buf = slot.bufferIndex;
-        const bool hasInput = buf >= 0 && buf < numInputChannels;
-        const float* src = hasInput ? input[buf] : nullptr;
+void RecordingBus::processAudioBlock (float* const* output,
+                                      int numOutputChannels,
+                                      int numSamples)
+{
+    const juce::int64 blockStart = samplePosition.load();
+    const auto latchEvents = latchQueue.getBlockEvents (blockStart, numSamples);
+    const int latchStartOffset = latchEvents.startOffset;
+    const int latchStopOffset = latchEvents.stopOffset;
+
+    // writing and mixing run as separate passes over the bank, after the
+    // meters have had theirs
+    for (int index = 0; index < numRecorders; ++index)
+    {
+        auto& slot = recorders[index];
+        const auto* sources = blockInputs.data() + index * kMaxRecorderChannels;
+        const int numChannels = blockChannelCounts[index];
+
+        int writeFrom = 0;
+        int writeTo = numSamples;
+
+        // a recorder whose take could not be reserved stays unarmed
+        if (slot.latchEnabled && latchStartOffset >= 0 && ! slot.captureCommitting.load()
+            && slot.recorder.arm())
+        {
+            slot.recordStartMs = juce::Time::getMillisecondCounterHiRes()
+                                 + (sampleRate > 0.0 ? latchStartOffset * 1000.0 / sampleRate : 0.0);
+            slot.armed = true;
+            writeFrom = latchStartOffset;
+        }
 
-        const float gain = slot.inputGainLinear;
-        const bool hasGain = gain != 1.0f;
+        const bool stopsThisBlock = slot.latchEnabled && slot.armed.load() && latchStopOffset >= 0;
+        if (stopsThisBlock)
+            writeTo = latchStopOffset;
 
-        const float* meterSrc = src;
-        if (hasInput && hasGain)
+        if (slot.armed && numChannels > 0 && writeTo > writeFrom)
         {
-            auto* scratch = slot.inputBuffer.getWritePointer (0);
-            for (int i = 0; i < numSamples; ++i)
-                scratch[i] = src[i] * gain;
-            meterSrc = scratch;
+            const float* channels[kMaxRecorderChannels];
+            for (int ch = 0; ch < numChannels; ++ch)
+                channels[ch] = sources[ch] + writeFrom;
+
+            const int takeFrame = slot.recorder.getTotalSamples();
+            slot.recorder.process (channels, numChannels, writeTo - writeFrom);
+            waveformPeaks[index].push (channels, numChannels, writeTo - writeFrom);
+
+            // a full writer keeps only part of the block
+            const int written = slot.recorder.getTotalSamples() - takeFrame;
+            takeAnalyzer.push (index, takeFrame, channels, numChannels, written);
         }
 
-        if (hasInput)
+        if (slot.captureRing != nullptr && numChannels > 0)
+            slot.captureRing->write (sources, numChannels, numSamples);
+
+        if (stopsThisBlock)
         {
-            float rmsSum = 0.0f;
-            float peak = 0.0f;
-            for (int i = 0; i < numSamples; ++i)
-            {
-                const float v = std::abs (meterSrc[i]);
-                peak = juce::jmax (peak, v);
-                rmsSum += v * v;
-            }
-            slot.peak = peak;
-            if (numSamples > 0)
-                slot.rms = std::sqrt (rmsSum / numSamples);
+            slot.armed = false;
+            slot.awaitingFinalise = true;
         }
+    }
+
+    for (int index = 0; index < numRecorders; ++index)
+    {
+        if (blockChannelCounts[index] > 0)
+            routing.mixToOutputs (index,
+                                  blockInputs.data() + index * kMaxRecorderChannels,
+                                  blockChannelCounts[index],
+                                  output,
+                                  numOutputChannels,
+                                  numSamples);
+    }
+
+    processPlayback (output, numOutputChannels, numSamples);
+
+    latchQueue.completeBlock (latchEvents);
+
+    samplePosition.store (blockStart + numSamples);
+}
+
+void RecordingBus::processMeters (int numSamples)
+{
+    for (int index = 0; index < numRecorders; ++index)
+    {
+        // one meter per recorder: loudest peak, power averaged over channels
+        const int numChannels = blockChannelCounts[index];
+        if (numChannels > 0)
+            meters[index].process (blockInputs.data() + index * kMaxRecorderChannels, numChannels, numSamples);
+        else
+            meters[index].clear();
+    }
+}
 
-        if (slot.armed && hasInput)
-            slot.recorder.process (meterSrc, numSamples);
+void RecordingBus::processPlayback (float* const* output, int numOutputChannels, int numSamples)
+{
+    for (int index = 0; index < numRecorders; ++index)
+    {
+        auto& slot = recorders[index];
+        if (! slot.playing)
+            continue;
 
-        if (slot.monitoringEnabled && slot.recordArmEnabled && hasInput)
+        auto* const* playBuffers = playbackScratch.getArrayOfWritePointers() + index * kMaxRecorderChannels;
+        const int numChannels = slot.recorder.getNumChannels();
+        const int readSamples =
+            slot.recorder.readPlaybackSamples (playBuffers,
+                                               numChannels,
+                                               static_cast<int> (slot.playbackPosition),
+                                               numSamples);
+        if (readSamples <= 0)
         {
-            for (int out = 0; out < numOutputChannels; ++out)
-                juce::FloatVectorOperations::add (
-                    output[out], meterSrc, numSamples);
+            slot.playing = false;
+            continue;
         }
 
-        if (slot.playing)
+        if (readSamples < numSamples)
         {
-            auto* playBuffer = slot.playbackBuffer.getWritePointer (0);
-            const int readSamples =
-                slot.recorder.readPlaybackSamples (playBuffer,
-                                                   static_cast<int> (slot.playbackPosition),
-                                                   numSamples);
-            if (readSamples <= 0)
-            {
-                slot.playing = false;
-            }
-            else
-            {
-                if (readSamples < numSamples)
-                    juce::FloatVectorOperations::clear (playBuffer + readSamples,
-                                                        numSamples - readSamples);
-
-                slot.playbackPosition += readSamples;
-                const int totalSamples = slot.recorder.getTotalSamples();
-                if (slot.playbackPosition >= totalSamples)
-                    slot.playing = false;
-
-                for (int out = 0; out < numOutputChannels; ++out)
-                    juce::FloatVectorOperations::add (
-                        output[out], playBuffer, numSamples);
-            }
+            for (int ch = 0; ch < numChannels; ++ch)
+                juce::FloatVectorOperations::clear (playBuffers[ch] + readSamples,
+                                                    numSamples - readSamples);
         }
+
+        slot.playbackPosition += readSamples;
+        const int totalSamples = slot.recorder.getTotalSamples();
+        if (slot.playbackPosition >= totalSamples)
+            slot.playing = false;
+
+        routing.mixPlayback (index, playBuffers, numChannels, output, numOutputChannels, numSamples);
     }
 }
+
+void RecordingBus::mixSliceVoices (const float* const* voices,
+                                   int numVoiceChannels,
+                                   float* const* output,
+                                   int numOutputChannels,
+                                   int numSamples)
+{
+    routing.mixVoices (voices, numVoiceChannels, output, numOutputChannels, numSamples);
+}
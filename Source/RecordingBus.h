@@ -1,16 +1,36 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
-#include <array>
-
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "CaptureRing.h"
+#include "LatchQueue.h"
+#include "LevelMeter.h"
+#include "LiveTakeAnalyzer.h"
+#include "PeakFifo.h"
 #include "RecordingModule.h"
+#include "RoutingMatrix.h"
+#include "TakeRoomKeeper.h"
 
 class RecordingBus
 {
 public:
-    static constexpr int kNumRecorders = 4;
+    static constexpr int kDefaultNumRecorders = 4;
+    static constexpr int kMaxRecorders = RoutingMatrix::kMaxRecorders;
+    static constexpr int kMaxRecorderChannels = RoutingMatrix::kMaxRecorderChannels;
+    static constexpr double kCaptureRingSeconds = 60.0;
+
+    // message thread, once the stop has been committed and the take kept or deleted
+    using StopHandler = std::function<void (RecordingModule::StopResult)>;
+
+    // the recorder count is fixed for the bus's lifetime so nothing is
+    // resized once the device is running
+    explicit RecordingBus (int numRecorders);
 
-    RecordingBus();
+    int getNumRecorders() const;
 
     // =====================================================
     // DEVICE LIFECYCLE
@@ -20,16 +40,31 @@ public:
     // =====================================================
     // RECORD CONTROL
     // =====================================================
+    // message thread: arms into the room the TakeRoomKeeper keeps ahead of
+    // each take, so nothing is allocated between the press and the arm
     void armRecorder (int index);
-    RecordingModule::StopResult confirmStopRecorder (int index);
+
+    // a latched stop completes once the audio thread reaches the stop
+    // sample, so the result always comes back through the handler
+    void confirmStopRecorder (int index, StopHandler onStopped = {});
     void cancelStopRecorder (int index);
     void clearRecorder (int index);
 
     bool hasLatchedRecorders() const;
     void armLatchedRecorders();
-    RecordingModule::StopResult stopLatchedRecorders();
+    void stopLatchedRecorders (StopHandler onStopped = {});
 
     bool isRecorderArmed (int index) const;
+
+    // message thread: recorders neither armed, waiting on a latched start
+    // nor committing a capture give back the room their take does not use,
+    // down to the headroom kept ahead of it
+    void releaseIdleTakes (const juce::CriticalSection& callbackLock);
+
+    // message thread: the longest pass any recorder may record from now on
+    void setMaxTakeSeconds (double seconds);
+    double getMaxTakeSeconds() const;
+
     void setRecorderLatchEnabled (int index, bool enabled);
     bool isRecorderLatchEnabled (int index) const;
     void setRecorderRecordArmEnabled (int index, bool enabled);
@@ -49,15 +84,55 @@ public:
 
     void setRecorderInputGainDb (int index, float gainDb);
     float getRecorderInputGainDb (int index) const;
-    float getRecorderRms (int index) const;
-    float getRecorderPeak (int index) const;
+    LevelMeter::Reading getRecorderMeterReading (int index) const;
+
+    // message thread, single consumer per recorder: min/max pairs of what
+    // the recorder has written since the last call
+    int popRecorderWaveformPeaks (int index, PeakFifo::Peak* dest, int maxPeaks);
+
+    // onsets and silence found in the take so far; it may trail the take by
+    // a few blocks, and frames past analysedFrames are not covered
+    std::shared_ptr<const LiveTakeAnalyzer::TakeAnalysis> getRecorderTakeAnalysis (int index) const;
+
+    // =====================================================
+    // SCHEDULED LATCH (AUDIO THREAD unless noted)
+    // =====================================================
+    bool hasLatchRequests() const;
+    void scheduleLatchRequests (juce::int64 targetSample);
+    bool takeCompletedLatchedStop();
+    juce::int64 getSamplePosition() const;
+
+    // message thread, once the audio thread has passed the stop sample
+    void finaliseLatchedStop();
 
     // =====================================================
-    // ROUTING
+    // ROUTING (MESSAGE THREAD)
     // =====================================================
-    void setRecorderInputBufferIndex (int index, int bufferIndex);
+    void setRecorderInputBufferIndices (int index, const juce::Array<int>& bufferIndices);
     void setRecorderMonitoringEnabled (int index, bool enabled);
 
+    // refused while the recorder is recording or playing
+    bool setRecorderNumChannels (int index, int numChannels, const juce::CriticalSection& callbackLock);
+    int getRecorderNumChannels (int index) const;
+
+    // =====================================================
+    // RETROSPECTIVE CAPTURE
+    // =====================================================
+    // message thread; the ring is built outside the lock and only swapped
+    // under it. Refused while a capture is being committed.
+    bool setRecorderCaptureEnabled (int index, bool enabled, const juce::CriticalSection& callbackLock);
+    bool isRecorderCaptureEnabled (int index) const;
+
+    // message thread: reserves the recorder for a commit, refused while it is
+    // armed, has no ring or is already committing. Arming stays blocked until
+    // commitCapturedHistory returns.
+    bool beginCaptureCommit (int index, double seconds);
+    bool isCaptureCommitInProgress (int index) const;
+
+    // background thread: appends the reserved span of the ring to the take
+    // as a new pass and saves it, then releases the recorder
+    bool commitCapturedHistory (int index);
+
     // =====================================================
     // TIMING
     // =====================================================
@@ -66,18 +141,36 @@ public:
     // =====================================================
     // AUDIO
     // =====================================================
-    void processAudioBlock (const float* const* input,
-                            int numInputChannels,
-                            float* const* output,
+    // clears the outputs and resolves each recorder's gained input for
+    // processMeters, then processAudioBlock, which records, monitors and
+    // plays back
+    void routeInputs (const float* const* input,
+                      int numInputChannels,
+                      float* const* output,
+                      int numOutputChannels,
+                      int numSamples);
+
+    // every recorder's meter over its gained input; kept out of
+    // processAudioBlock so the callback times it as its own stage
+    void processMeters (int numSamples);
+
+    void processAudioBlock (float* const* output,
                             int numOutputChannels,
                             int numSamples);
 
+    // after processAudioBlock: the slice voices reach the outputs through
+    // the same matrix as the recorders
+    void mixSliceVoices (const float* const* voices,
+                         int numVoiceChannels,
+                         float* const* output,
+                         int numOutputChannels,
+                         int numSamples);
+
 private:
     struct RecorderSlot
     {
         RecordingModule recorder;
-        int  bufferIndex       = -1;
-        bool armed             = false;
+        std::atomic<bool> armed { false }; // set only once the recorder has armed
         bool monitoringEnabled = false;
         bool latchEnabled      = false;
         bool recordArmEnabled  = true;
@@ -85,19 +178,42 @@ private:
         bool playing = false;
         juce::int64 playbackPosition = 0;
         double recordStartMs = 0.0;
+        bool awaitingFinalise = false;
 
         float inputGainDb = 0.0f;
-        float inputGainLinear = 1.0f;
-        float rms = 0.0f;
-        float peak = 0.0f;
 
-        juce::AudioBuffer<float> inputBuffer;
-        juce::AudioBuffer<float> playbackBuffer;
+        bool captureEnabled = false;
+        std::unique_ptr<CaptureRing> captureRing;
+        std::atomic<bool> captureCommitting { false };
+        int pendingCaptureSamples = 0;
     };
 
-    std::array<RecorderSlot, kNumRecorders> recorders;
+    void updateMonitorRouting (int index);
+    std::unique_ptr<CaptureRing> createCaptureRing (int index) const;
+    void processPlayback (float* const* output, int numOutputChannels, int numSamples);
+
+    const int numRecorders;
+    std::vector<RecorderSlot> recorders;
+    RoutingMatrix routing;
+
+    // per-callback state, one entry per recorder or, for the channel
+    // arrays and scratch buffers, kMaxRecorderChannels entries per recorder
+    std::vector<int> blockChannelCounts;
+    std::vector<const float*> blockInputs;
+    std::vector<LevelMeter> meters;
+    std::vector<PeakFifo> waveformPeaks;
+    LiveTakeAnalyzer takeAnalyzer;
+    juce::AudioBuffer<float> inputScratch;
+    juce::AudioBuffer<float> playbackScratch;
     double sampleRate = 0.0;
     int bufferSize = 0;
 
+    LatchQueue latchQueue;
+    std::atomic<juce::int64> samplePosition { 0 };
+    std::vector<StopHandler> latchedStopHandlers; // message thread
+
+    // last, so it stops before the recorders it tops up are destroyed
+    std::unique_ptr<TakeRoomKeeper> roomKeeper;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RecordingBus)
 };
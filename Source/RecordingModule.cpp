@@ -19,34 +19,119 @@ void RecordingModule::prepareDevice (double sr,
 {
     sampleRate = sr;
 
-    const int maxSamples =
-        static_cast<int> (kMaxSeconds * sampleRate);
-
     if (! writer)
     {
-        auto file = getRecorderFile (recorderIndex);
-
-        writer = std::make_unique<RecordingWriter> (
-            maxSamples,
-            1,
-            sampleRate,
-            file);
-        writer->loadFromDisk();
+        auto created = createWriter (recorderIndex, numChannels);
+
+        const juce::ScopedLock rl (roomLock);
+        writer = std::move (created);
     }
     else
     {
         // 🔒 PRESERVE BUFFER — only update device-dependent info
         writer->setSampleRate (sampleRate);
+
+        if (! armed)
+            writer->setMaxSamples (getTakeLimitSamples());
     }
+
+    keepRoomAhead();
 }
 
-void RecordingModule::arm()
+void RecordingModule::setNumChannels (int channels,
+                                      int recorderIndex,
+                                      const juce::CriticalSection& callbackLock)
 {
-    if (! writer || writer->isFull())
+    if (channels == numChannels)
         return;
 
+    // without a device the writer is created by prepareDevice instead
+    std::unique_ptr<RecordingWriter> replacement;
+    if (sampleRate > 0.0)
+        replacement = createWriter (recorderIndex, channels);
+
+    {
+        const juce::ScopedLock rl (roomLock);
+        const juce::ScopedLock sl (callbackLock);
+        numChannels = channels;
+        armed = false;
+        std::swap (writer, replacement);
+    }
+
+    keepRoomAhead();
+}
+
+void RecordingModule::setMaxTakeSeconds (double seconds)
+{
+    maxTakeSeconds = juce::jlimit (kMinTakeSeconds, kMaxTakeSeconds, seconds);
+
+    if (writer && ! armed)
+        writer->setMaxSamples (getTakeLimitSamples());
+}
+
+double RecordingModule::getMaxTakeSeconds() const
+{
+    return maxTakeSeconds;
+}
+
+void RecordingModule::keepRoomAhead()
+{
+    const juce::ScopedLock rl (roomLock);
+    if (! writer)
+        return;
+
+    const int ahead = kHeadroomChunks * RecordingWriter::kChunkSamples;
+    writer->reserve (juce::jmin (writer->getMaxSamples(), writer->getTotalSamples() + ahead));
+}
+
+// the chunks leave under the callback lock, so a latched arm on the audio
+// thread cannot start writing into them, and are freed after it
+void RecordingModule::releaseUnusedTake (const juce::CriticalSection& callbackLock)
+{
+    std::vector<std::unique_ptr<RecordingWriter::Chunk>> unused;
+
+    {
+        const juce::ScopedLock rl (roomLock);
+        const juce::ScopedLock sl (callbackLock);
+        if (! writer || armed)
+            return;
+
+        const int ahead = kHeadroomChunks * RecordingWriter::kChunkSamples;
+        unused = writer->releaseRoomBeyond (writer->getTotalSamples() + ahead);
+    }
+}
+
+int RecordingModule::getNumChannels() const
+{
+    return numChannels;
+}
+
+// Holds only the take on disk; prepareDevice and setNumChannels add the
+// headroom. A take longer than the current limit is loaded whole and simply full.
+std::unique_ptr<RecordingWriter> RecordingModule::createWriter (int recorderIndex, int channels) const
+{
+    auto newWriter = std::make_unique<RecordingWriter> (
+        getTakeLimitSamples(),
+        channels,
+        sampleRate,
+        getRecorderFile (recorderIndex));
+    newWriter->loadFromDisk (static_cast<int> (kMaxTakeSeconds * sampleRate));
+    return newWriter;
+}
+
+int RecordingModule::getTakeLimitSamples() const
+{
+    return static_cast<int> (maxTakeSeconds * sampleRate);
+}
+
+bool RecordingModule::arm()
+{
+    if (! writer || writer->isFull() || writer->getCapacity() <= writer->getTotalSamples())
+        return false;
+
     armed = true;
     writer->beginPass();
+    return true;
 }
 
 RecordingModule::StopResult RecordingModule::confirmStop()
@@ -94,14 +179,36 @@ bool RecordingModule::isMonitoringEnabled() const
     return monitoringEnabled;
 }
 
-void RecordingModule::process (const float* input,
+void RecordingModule::process (const float* const* input,
+                               int channels,
                                int numSamples)
 {
     if (! armed || ! writer)
         return;
 
-    const float* inputs[1] = { input };
-    writer->write (inputs, 1, numSamples);
+    writer->write (input, channels, numSamples);
+}
+
+bool RecordingModule::appendTake (const juce::AudioBuffer<float>& audio,
+                                  int numSamples)
+{
+    if (! writer || writer->isFull() || numSamples <= 0)
+        return false;
+
+    // only the reserve holds the room lock; the save can take a while
+    {
+        const juce::ScopedLock rl (roomLock);
+        writer->reserve (juce::jmin (writer->getMaxSamples(), writer->getTotalSamples() + numSamples));
+    }
+
+    // playback only reads up to the published end, so the take grows in place
+    writer->beginPass();
+    writer->write (audio.getArrayOfReadPointers(), audio.getNumChannels(), numSamples);
+    writer->commitPass();
+    const bool saved = writer->writeToDisk();
+
+    keepRoomAhead();
+    return saved;
 }
 
 double RecordingModule::getCurrentPassSeconds() const
@@ -133,14 +240,15 @@ double RecordingModule::getSampleRate() const
     return sampleRate;
 }
 
-int RecordingModule::readPlaybackSamples (float* dest,
+int RecordingModule::readPlaybackSamples (float* const* dest,
+                                          int channels,
                                           int startSample,
                                           int numSamples) const
 {
     if (! writer)
         return 0;
 
-    return writer->readSamples (dest, startSample, numSamples);
+    return writer->readSamples (dest, channels, startSample, numSamples);
 }
 
 void RecordingModule::clear()
@@ -150,3 +258,85 @@ void RecordingModule::clear()
 
     armed = false;
 }
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class RecordingModuleTests final : public juce::UnitTest
+{
+public:
+    RecordingModuleTests() : juce::UnitTest ("RecordingModule", "Slicebot") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numRecorders = 32;
+        constexpr int blockSize = 64;
+
+        // indices past any real recorder, so no take is loaded from disk
+        constexpr int firstIndex = 1000;
+
+        juce::CriticalSection callbackLock;
+        std::vector<std::unique_ptr<RecordingModule>> modules;
+        for (int i = 0; i < numRecorders; ++i)
+        {
+            modules.push_back (std::make_unique<RecordingModule>());
+            modules.back()->setNumChannels (2, firstIndex + i, callbackLock);
+            modules.back()->prepareDevice (sampleRate, firstIndex + i);
+        }
+
+        beginTest ("32 recorders arm within one 64-sample block");
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            int armedCount = 0;
+            for (auto& module : modules)
+                armedCount += module->arm() ? 1 : 0;
+            const double seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+            expectEquals (armedCount, numRecorders);
+            logMessage ("arming " + juce::String (numRecorders) + " recorders took "
+                        + juce::String (seconds * 1000.0, 3) + " ms, budget "
+                        + juce::String (blockSize * 1000.0 / sampleRate, 3) + " ms");
+            expect (seconds < blockSize / sampleRate);
+        }
+
+        beginTest ("a pass grows past its headroom without dropping audio");
+        {
+            juce::AudioBuffer<float> block (2, blockSize);
+            block.clear();
+
+            // the room keeper's rounds, every 20 ms of audio
+            const int blocksPerRound = static_cast<int> (0.02 * sampleRate) / blockSize;
+            const int numBlocks = 4 * RecordingWriter::kChunkSamples / blockSize;
+
+            auto& module = *modules.front();
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                if (i % blocksPerRound == 0)
+                    module.keepRoomAhead();
+
+                module.process (block.getArrayOfReadPointers(), 2, blockSize);
+            }
+
+            expectEquals (module.getTotalSamples(), numBlocks * blockSize);
+        }
+
+        // every pass is under the minimum length, so nothing is saved
+        for (auto& module : modules)
+        {
+            expect (module->confirmStop() == StopResult::DeletedTooShort);
+            module->releaseUnusedTake (callbackLock);
+            expectEquals (module->getTotalSamples(), 0);
+        }
+    }
+
+private:
+    using StopResult = RecordingModule::StopResult;
+};
+
+static RecordingModuleTests recordingModuleTests;
+
+#endif
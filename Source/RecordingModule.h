@@ -12,6 +12,10 @@ public:
         DeletedTooShort
     };
 
+    // the longest take a recorder can be set to hold, and the shortest
+    static constexpr double kMaxTakeSeconds = 600.0;
+    static constexpr double kMinTakeSeconds = 60.0;
+
     RecordingModule();
 
     static juce::File getRecorderFile (int recorderIndex);
@@ -20,8 +24,31 @@ public:
     void prepareDevice (double sampleRate,
                         int recorderIndex);
 
-    // recording lifecycle
-    void arm();
+    // channel count of the take; the new writer is built before the lock is
+    // taken and the old one is freed after it is released, so the audio
+    // callback is only held off for the pointer swap
+    void setNumChannels (int numChannels,
+                         int recorderIndex,
+                         const juce::CriticalSection& callbackLock);
+    int getNumChannels() const;
+
+    // message thread: the limit applies to the next pass; an armed writer
+    // keeps the room it was given
+    void setMaxTakeSeconds (double seconds);
+    double getMaxTakeSeconds() const;
+
+    // any thread but the audio thread: keeps kHeadroomChunks of room ready
+    // past the end of the take, up to the take limit. The TakeRoomKeeper
+    // calls it while a pass grows, so arming never has to allocate.
+    void keepRoomAhead();
+
+    // message thread, while the recorder is not armed: gives back the room
+    // the last pass did not use, down to the headroom again
+    void releaseUnusedTake (const juce::CriticalSection& callbackLock);
+
+    // recording lifecycle; arming records into the room already kept ahead
+    // and fails only when there is none
+    bool arm();
     StopResult confirmStop();
     void cancelStopRequest();
     bool isArmed() const;
@@ -29,24 +56,42 @@ public:
     void setMonitoringEnabled (bool enabled);
     bool isMonitoringEnabled() const;
 
-    void process (const float* input,
+    // planar input, one pointer per channel
+    void process (const float* const* input,
+                  int numChannels,
                   int numSamples);
 
+    // appends audio captured elsewhere as one committed pass and saves the
+    // take; runs off the audio thread while the recorder cannot be armed,
+    // growing the take in place
+    bool appendTake (const juce::AudioBuffer<float>& audio,
+                     int numSamples);
+
     double getCurrentPassSeconds() const;
     int getTotalSamples() const;
     int getMaxSamples() const;
     double getSampleRate() const;
 
-    int readPlaybackSamples (float* dest,
+    int readPlaybackSamples (float* const* dest,
+                             int numChannels,
                              int startSample,
                              int numSamples) const;
     void clear();
 
 private:
     static constexpr double kMinSeconds = 25.0;
-    static constexpr int    kMaxSeconds = 600;
+    static constexpr int kHeadroomChunks = 2;
+
+    std::unique_ptr<RecordingWriter> createWriter (int recorderIndex, int channels) const;
+    int getTakeLimitSamples() const;
 
+    // held while the writer is replaced or its room changes, so the room
+    // keeper never reaches a writer that is being freed; the audio thread
+    // never takes it
+    juce::CriticalSection roomLock;
     std::unique_ptr<RecordingWriter> writer;
+    int numChannels = 1;
+    double maxTakeSeconds = kMaxTakeSeconds;
 
     double sampleRate = 0.0;
     bool armed = false;
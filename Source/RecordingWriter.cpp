@@ -5,12 +5,12 @@ RecordingWriter::RecordingWriter (int maxSamplesIn,
                                   int numChannels,
                                   double initialSampleRate,
                                   const juce::File& targetFile)
-    : buffer (numChannels, maxSamplesIn),
+    : chunks (static_cast<size_t> (kMaxChunks)),
+      numTakeChannels (numChannels),
       file (targetFile),
       sampleRate (initialSampleRate),
-      maxSamples (maxSamplesIn)
+      maxSamples (juce::jmin (maxSamplesIn, kMaxChunks * kChunkSamples))
 {
-    buffer.clear();
 }
 
 void RecordingWriter::setSampleRate (double newSampleRate)
@@ -20,7 +20,6 @@ void RecordingWriter::setSampleRate (double newSampleRate)
 
 void RecordingWriter::clear()
 {
-    buffer.clear();
     writeHead = 0;
     passStart = 0;
 }
@@ -60,6 +59,45 @@ int RecordingWriter::getMaxSamples() const
     return maxSamples;
 }
 
+int RecordingWriter::getCapacity() const
+{
+    return numChunks.load() * kChunkSamples;
+}
+
+void RecordingWriter::setMaxSamples (int newMaxSamples)
+{
+    maxSamples = juce::jmin (newMaxSamples, kMaxChunks * kChunkSamples);
+}
+
+void RecordingWriter::reserve (int samples)
+{
+    const int wanted = juce::jmin (kMaxChunks, (samples + kChunkSamples - 1) / kChunkSamples);
+
+    // the chunk is in its slot before the audio thread can see the count
+    for (int index = numChunks.load(); index < wanted; ++index)
+    {
+        chunks[static_cast<size_t> (index)] = std::make_unique<Chunk> (numTakeChannels, kChunkSamples);
+        numChunks = index + 1;
+    }
+}
+
+std::vector<std::unique_ptr<RecordingWriter::Chunk>> RecordingWriter::releaseRoomBeyond (int samples)
+{
+    const int kept = juce::jlimit (0, kMaxChunks, (samples + kChunkSamples - 1) / kChunkSamples);
+
+    std::vector<std::unique_ptr<Chunk>> released;
+    for (int index = kept; index < numChunks.load(); ++index)
+        released.push_back (std::move (chunks[static_cast<size_t> (index)]));
+
+    numChunks = juce::jmin (kept, numChunks.load());
+    return released;
+}
+
+int RecordingWriter::getNumChannels() const
+{
+    return numTakeChannels;
+}
+
 void RecordingWriter::write (const float* const* input,
                              int numChannels,
                              int numSamples)
@@ -67,16 +105,27 @@ void RecordingWriter::write (const float* const* input,
     if (isFull())
         return;
 
-    const int remaining = maxSamples - writeHead;
-    const int toWrite   = juce::jmin (remaining, numSamples);
+    // a writer out of room drops the block rather than grow on this thread
+    const int end     = juce::jmin (maxSamples.load(), getCapacity());
+    const int toWrite = juce::jmin (end - writeHead, numSamples);
+
+    const int channelsToWrite = juce::jmin (numChannels, numTakeChannels);
+    int head = writeHead;
 
-    for (int ch = 0; ch < numChannels; ++ch)
-        buffer.copyFrom (ch,
-                         writeHead,
-                         input[ch],
-                         toWrite);
+    for (int done = 0; done < toWrite;)
+    {
+        auto& chunk = *chunks[static_cast<size_t> (head / kChunkSamples)];
+        const int offset = head % kChunkSamples;
+        const int count  = juce::jmin (toWrite - done, kChunkSamples - offset);
 
-    writeHead += toWrite;
+        for (int ch = 0; ch < channelsToWrite; ++ch)
+            chunk.copyFrom (ch, offset, input[ch] + done, count);
+
+        head += count;
+        done += count;
+    }
+
+    writeHead = head;
 }
 
 bool RecordingWriter::writeToDisk()
@@ -98,7 +147,7 @@ bool RecordingWriter::writeToDisk()
     auto writer = std::unique_ptr<juce::AudioFormatWriter> (
         format.createWriterFor (stream.release(),
                                 sampleRate,
-                                buffer.getNumChannels(),
+                                numTakeChannels,
                                 24,
                                 {},
                                 0));
@@ -107,12 +156,17 @@ bool RecordingWriter::writeToDisk()
     if (! writer)
         return false;
 
-    return writer->writeFromAudioSampleBuffer (buffer,
-                                               0,
-                                               writeHead);
+    for (int start = 0; start < writeHead; start += kChunkSamples)
+    {
+        const auto& chunk = *chunks[static_cast<size_t> (start / kChunkSamples)];
+        if (! writer->writeFromAudioSampleBuffer (chunk, 0, juce::jmin (kChunkSamples, writeHead - start)))
+            return false;
+    }
+
+    return true;
 }
 
-bool RecordingWriter::loadFromDisk()
+bool RecordingWriter::loadFromDisk (int maxSamplesToLoad)
 {
     if (! file.existsAsFile())
         return false;
@@ -127,17 +181,24 @@ bool RecordingWriter::loadFromDisk()
         return false;
 
     const juce::int64 totalSamples = juce::jmin<juce::int64> (reader->lengthInSamples,
-                                                              static_cast<juce::int64> (maxSamples));
+                                                              static_cast<juce::int64> (maxSamplesToLoad));
+
+    const int loaded = static_cast<int> (totalSamples);
+    reserve (loaded);
 
-    buffer.clear();
-    reader->read (&buffer, 0, static_cast<int> (totalSamples), 0, true, true);
+    for (int start = 0; start < loaded; start += kChunkSamples)
+    {
+        auto* chunk = chunks[static_cast<size_t> (start / kChunkSamples)].get();
+        reader->read (chunk, 0, juce::jmin (kChunkSamples, loaded - start), start, true, true);
+    }
 
-    writeHead = static_cast<int> (totalSamples);
+    writeHead = loaded;
     passStart = writeHead;
     return true;
 }
 
-int RecordingWriter::readSamples (float* dest,
+int RecordingWriter::readSamples (float* const* dest,
+                                  int numChannels,
                                   int startSample,
                                   int numSamples) const
 {
@@ -150,7 +211,23 @@ int RecordingWriter::readSamples (float* dest,
     if (toRead <= 0)
         return 0;
 
-    auto* src = buffer.getReadPointer (0, startSample);
-    std::memcpy (dest, src, static_cast<size_t> (toRead) * sizeof (float));
+    const int channelsToRead = juce::jmin (numChannels, numTakeChannels);
+    int position = startSample;
+
+    for (int done = 0; done < toRead;)
+    {
+        const auto& chunk = *chunks[static_cast<size_t> (position / kChunkSamples)];
+        const int offset = position % kChunkSamples;
+        const int count  = juce::jmin (toRead - done, kChunkSamples - offset);
+
+        for (int ch = 0; ch < channelsToRead; ++ch)
+            std::memcpy (dest[ch] + done,
+                         chunk.getReadPointer (ch, offset),
+                         static_cast<size_t> (count) * sizeof (float));
+
+        position += count;
+        done += count;
+    }
+
     return toRead;
 }
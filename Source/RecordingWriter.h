@@ -2,10 +2,25 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 
+// Holds one recorder's take in memory, in fixed-size chunks. Room only ever
+// covers what the take holds plus what has been reserved ahead of it, so an
+// idle recorder costs the length of its take rather than the longest one.
+// Chunks are added off the audio thread while the take is being written and
+// never move once added, so a pass can grow without copying or stalling.
 class RecordingWriter
 {
 public:
+    using Chunk = juce::AudioBuffer<float>;
+
+    // about 1.4 s at 48 kHz; enough slots for the longest take at 192 kHz
+    static constexpr int kChunkSamples = 1 << 16;
+    static constexpr int kMaxChunks = 2048;
+
+    // starts with no room; loadFromDisk or reserve provide it
     RecordingWriter (int maxSamples,
                      int numChannels,
                      double initialSampleRate,
@@ -23,29 +38,50 @@ public:
     int  getTotalSamples() const;
     int  getPassSamples() const;
     int  getMaxSamples() const;
+    int  getCapacity() const;
+    int  getNumChannels() const;
+
+    // the longest the take may grow; only changed while nothing is written
+    void setMaxSamples (int newMaxSamples);
+
+    // never on the audio thread, and from one thread at a time: adds chunks
+    // until there is room for samples. The audio thread may keep writing
+    // into the chunks it already has.
+    void reserve (int samples);
+
+    // under the callback lock while nothing is written: hands back the
+    // chunks past the one holding samples, to be freed outside the lock
+    std::vector<std::unique_ptr<Chunk>> releaseRoomBeyond (int samples);
 
     void write (const float* const* input,
                 int numChannels,
                 int numSamples);
 
     bool writeToDisk();
-    bool loadFromDisk();
+    // reads at most maxSamplesToLoad, and sizes the buffer to what it read
+    bool loadFromDisk (int maxSamplesToLoad);
 
-    int readSamples (float* dest,
+    // planar: one destination per channel, up to getNumChannels()
+    int readSamples (float* const* dest,
+                     int numChannels,
                      int startSample,
                      int numSamples) const;
 
     void clear();
 
 private:
-    juce::AudioBuffer<float> buffer;
+    // kMaxChunks slots, filled in order; only the first numChunks are used
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::atomic<int> numChunks { 0 };
+    const int numTakeChannels;
     juce::File file;
 
     double sampleRate = 0.0;
 
-    int writeHead = 0;
+    // published last, so a reader never sees samples that are still being written
+    std::atomic<int> writeHead { 0 };
     int passStart = 0;
-    int maxSamples = 0;
+    std::atomic<int> maxSamples { 0 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RecordingWriter)
 };
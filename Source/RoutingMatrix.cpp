@@ -0,0 +1,283 @@
+#include "RoutingMatrix.h"
+
+namespace
+{
+    constexpr double kGainRampSeconds = 0.02;
+
+    // gains is a per-sample ramp, or nullptr for a constant gain
+    void applyGain (const float* gains, float constantGain,
+                    const float* source, float* dest, int numSamples, bool accumulate)
+    {
+        if (gains != nullptr)
+        {
+            if (accumulate)
+                juce::FloatVectorOperations::addWithMultiply (dest, source, gains, numSamples);
+            else
+                juce::FloatVectorOperations::multiply (dest, source, gains, numSamples);
+        }
+        else if (! accumulate)
+        {
+            juce::FloatVectorOperations::copyWithMultiply (dest, source, constantGain, numSamples);
+        }
+        else if (constantGain == 1.0f)
+        {
+            juce::FloatVectorOperations::add (dest, source, numSamples);
+        }
+        else
+        {
+            juce::FloatVectorOperations::addWithMultiply (dest, source, constantGain, numSamples);
+        }
+    }
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+RoutingMatrix::RoutingMatrix()
+{
+    for (auto& channels : editLayout.inputChannels)
+        channels.fill (-1);
+    editLayout.numChannels.fill (1);
+    editLayout.inputGain.fill (1.0f);
+    for (auto& row : editLayout.outputGain)
+        row.fill (0.0f);
+    for (auto& row : editLayout.playbackGain)
+        row.fill (1.0f);
+    editLayout.voiceGain.fill (1.0f);
+
+    slots.fill (editLayout);
+
+    for (auto& gain : inputGains)
+        gain.setCurrentAndTargetValue (1.0f);
+}
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+void RoutingMatrix::setInputChannels (int recorder, const juce::Array<int>& bufferIndices)
+{
+    if (recorder < 0 || recorder >= kMaxRecorders)
+        return;
+
+    const int count = juce::jlimit (1, kMaxRecorderChannels, bufferIndices.size());
+    auto& channels = editLayout.inputChannels[recorder];
+    channels.fill (-1);
+    for (int ch = 0; ch < juce::jmin (count, bufferIndices.size()); ++ch)
+        channels[ch] = bufferIndices[ch];
+
+    editLayout.numChannels[recorder] = count;
+    publish();
+}
+
+void RoutingMatrix::setInputGain (int recorder, float gain)
+{
+    if (recorder < 0 || recorder >= kMaxRecorders)
+        return;
+
+    editLayout.inputGain[recorder] = gain;
+    publish();
+}
+
+void RoutingMatrix::setMonitorGain (int recorder, float gain)
+{
+    if (recorder < 0 || recorder >= kMaxRecorders)
+        return;
+
+    editLayout.outputGain[recorder].fill (gain);
+    publish();
+}
+
+void RoutingMatrix::publish()
+{
+    slots[static_cast<size_t> (backSlot)] = editLayout;
+    backSlot = sharedSlot.exchange (backSlot | kDirtyFlag) & kSlotMask;
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void RoutingMatrix::prepare (double sampleRate, int maxBlockSize)
+{
+    rampScratch.setSize (2, juce::jmax (1, maxBlockSize), false, false, true);
+    auto* ramp = rampScratch.getWritePointer (0);
+    for (int i = 0; i < rampScratch.getNumSamples(); ++i)
+        ramp[i] = static_cast<float> (i + 1);
+
+    takeLatestLayout();
+
+    // a restarted device starts from the current layout without ramping
+    const auto& layout = slots[static_cast<size_t> (frontSlot)];
+    for (int r = 0; r < kMaxRecorders; ++r)
+    {
+        inputGains[r].reset (sampleRate, kGainRampSeconds);
+        inputGains[r].setCurrentAndTargetValue (layout.inputGain[r]);
+
+        for (int out = 0; out < kMaxOutputs; ++out)
+        {
+            outputGains[r][out].reset (sampleRate, kGainRampSeconds);
+            outputGains[r][out].setCurrentAndTargetValue (layout.outputGain[r][out]);
+            playbackGains[r][out].reset (sampleRate, kGainRampSeconds);
+            playbackGains[r][out].setCurrentAndTargetValue (layout.playbackGain[r][out]);
+        }
+    }
+
+    for (int out = 0; out < kMaxOutputs; ++out)
+    {
+        voiceGains[out].reset (sampleRate, kGainRampSeconds);
+        voiceGains[out].setCurrentAndTargetValue (layout.voiceGain[out]);
+    }
+}
+
+void RoutingMatrix::beginBlock()
+{
+    takeLatestLayout();
+}
+
+void RoutingMatrix::takeLatestLayout()
+{
+    if ((sharedSlot.load() & kDirtyFlag) == 0)
+        return;
+
+    frontSlot = sharedSlot.exchange (frontSlot) & kSlotMask;
+
+    const auto& layout = slots[static_cast<size_t> (frontSlot)];
+    for (int r = 0; r < kMaxRecorders; ++r)
+    {
+        inputGains[r].setTargetValue (layout.inputGain[r]);
+        for (int out = 0; out < kMaxOutputs; ++out)
+        {
+            outputGains[r][out].setTargetValue (layout.outputGain[r][out]);
+            playbackGains[r][out].setTargetValue (layout.playbackGain[r][out]);
+        }
+    }
+
+    for (int out = 0; out < kMaxOutputs; ++out)
+        voiceGains[out].setTargetValue (layout.voiceGain[out]);
+}
+
+int RoutingMatrix::processInput (int recorder,
+                                 const float* const* input,
+                                 int numInputChannels,
+                                 float* const* scratch,
+                                 const float** sources,
+                                 int numSamples)
+{
+    if (recorder < 0 || recorder >= kMaxRecorders)
+        return 0;
+
+    const auto& layout = slots[static_cast<size_t> (frontSlot)];
+    const auto& channels = layout.inputChannels[recorder];
+    const int numChannels = layout.numChannels[recorder];
+
+    if (channels[0] < 0 || channels[0] >= numInputChannels)
+        return 0;
+
+    // a channel whose input is missing doubles the first one
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const int bufferIndex = channels[ch];
+        sources[ch] = bufferIndex >= 0 && bufferIndex < numInputChannels ? input[bufferIndex]
+                                                                         : input[channels[0]];
+    }
+
+    auto& gain = inputGains[recorder];
+    if (! gain.isSmoothing() && gain.getTargetValue() == 1.0f)
+        return numChannels;
+
+    float constantGain = 1.0f;
+    const float* gains = nextGainBlock (gain, numSamples, constantGain);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        applyGain (gains, constantGain, sources[ch], scratch[ch], numSamples, false);
+        sources[ch] = scratch[ch];
+    }
+
+    return numChannels;
+}
+
+void RoutingMatrix::mixToOutputs (int recorder,
+                                  const float* const* sources,
+                                  int numSources,
+                                  float* const* output,
+                                  int numOutputChannels,
+                                  int numSamples)
+{
+    if (recorder < 0 || recorder >= kMaxRecorders)
+        return;
+
+    mixRow (outputGains[recorder], sources, numSources, output, numOutputChannels, numSamples);
+}
+
+void RoutingMatrix::mixPlayback (int recorder,
+                                 const float* const* sources,
+                                 int numSources,
+                                 float* const* output,
+                                 int numOutputChannels,
+                                 int numSamples)
+{
+    if (recorder < 0 || recorder >= kMaxRecorders)
+        return;
+
+    mixRow (playbackGains[recorder], sources, numSources, output, numOutputChannels, numSamples);
+}
+
+void RoutingMatrix::mixVoices (const float* const* sources,
+                               int numSources,
+                               float* const* output,
+                               int numOutputChannels,
+                               int numSamples)
+{
+    mixRow (voiceGains, sources, numSources, output, numOutputChannels, numSamples);
+}
+
+void RoutingMatrix::mixRow (std::array<Gain, kMaxOutputs>& row,
+                            const float* const* sources,
+                            int numSources,
+                            float* const* output,
+                            int numOutputChannels,
+                            int numSamples)
+{
+    if (numSources <= 0)
+        return;
+
+    const int numOutputs = juce::jmin (numOutputChannels, kMaxOutputs);
+    for (int out = 0; out < numOutputs; ++out)
+    {
+        auto& gain = row[out];
+        if (! gain.isSmoothing() && gain.getTargetValue() == 0.0f)
+            continue;
+
+        float constantGain = 1.0f;
+        const float* gains = nextGainBlock (gain, numSamples, constantGain);
+        applyGain (gains, constantGain, sources[out % numSources], output[out], numSamples, true);
+    }
+}
+
+const float* RoutingMatrix::nextGainBlock (Gain& gain, int numSamples, float& constantGain)
+{
+    if (! gain.isSmoothing())
+    {
+        constantGain = gain.getTargetValue();
+        return nullptr;
+    }
+
+    // oversized blocks jump straight to the next step instead of ramping
+    if (numSamples > rampScratch.getNumSamples())
+    {
+        constantGain = gain.skip (numSamples);
+        return nullptr;
+    }
+
+    // linear ramp across the block, built from the 1..n index table
+    const float start = gain.getCurrentValue();
+    const float end = gain.skip (numSamples);
+    auto* ramp = rampScratch.getWritePointer (1);
+    juce::FloatVectorOperations::copyWithMultiply (ramp, rampScratch.getReadPointer (0),
+                                                   (end - start) / static_cast<float> (numSamples),
+                                                   numSamples);
+    juce::FloatVectorOperations::add (ramp, start, numSamples);
+    return ramp;
+}
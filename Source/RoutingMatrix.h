@@ -0,0 +1,110 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+// Recorder routing for RecordingBus: which device inputs feed each recorder's
+// channels, its input gain, and how much of its monitoring, its playback and
+// the slice voices reach every output. The
+// message thread edits a private copy and publishes it through a triple
+// buffer; the audio thread picks up the newest layout at the start of a block
+// and ramps each cell towards it, so a config change never blocks or clicks.
+class RoutingMatrix
+{
+public:
+    static constexpr int kMaxRecorders = 32;
+    static constexpr int kMaxRecorderChannels = 8;
+    static constexpr int kMaxOutputs = 64;
+
+    RoutingMatrix();
+
+    // =====================================================
+    // MESSAGE THREAD
+    // =====================================================
+    // one device buffer index per recorder channel, -1 where unavailable
+    void setInputChannels (int recorder, const juce::Array<int>& bufferIndices);
+    void setInputGain (int recorder, float gain);
+    void setMonitorGain (int recorder, float gain);
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    // prepare is called while the device is stopped
+    void prepare (double sampleRate, int maxBlockSize);
+    void beginBlock();
+
+    // fills sources with the gained input of each recorder channel (the
+    // device buffer itself or the matching scratch channel) and returns the
+    // channel count, or 0 when the recorder has no input this block
+    int processInput (int recorder,
+                      const float* const* input,
+                      int numInputChannels,
+                      float* const* scratch,
+                      const float** sources,
+                      int numSamples);
+
+    // output n takes source channel n % numSources in all three
+    void mixToOutputs (int recorder,
+                       const float* const* sources,
+                       int numSources,
+                       float* const* output,
+                       int numOutputChannels,
+                       int numSamples);
+
+    void mixPlayback (int recorder,
+                      const float* const* sources,
+                      int numSources,
+                      float* const* output,
+                      int numOutputChannels,
+                      int numSamples);
+
+    void mixVoices (const float* const* sources,
+                    int numSources,
+                    float* const* output,
+                    int numOutputChannels,
+                    int numSamples);
+
+private:
+    using Gain = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear>;
+
+    struct Layout
+    {
+        std::array<std::array<int, kMaxRecorderChannels>, kMaxRecorders> inputChannels;
+        std::array<int, kMaxRecorders> numChannels;
+        std::array<float, kMaxRecorders> inputGain;
+        std::array<std::array<float, kMaxOutputs>, kMaxRecorders> outputGain;
+        std::array<std::array<float, kMaxOutputs>, kMaxRecorders> playbackGain;
+        std::array<float, kMaxOutputs> voiceGain;
+    };
+
+    static constexpr int kSlotMask = 3;
+    static constexpr int kDirtyFlag = 4;
+
+    void publish();
+    void takeLatestLayout();
+    const float* nextGainBlock (Gain& gain, int numSamples, float& constantGain);
+    void mixRow (std::array<Gain, kMaxOutputs>& row,
+                 const float* const* sources,
+                 int numSources,
+                 float* const* output,
+                 int numOutputChannels,
+                 int numSamples);
+
+    // message thread
+    Layout editLayout;
+    int backSlot = 0;
+
+    std::array<Layout, 3> slots;
+    std::atomic<int> sharedSlot { 1 };
+
+    // audio thread
+    int frontSlot = 2;
+    std::array<Gain, kMaxRecorders> inputGains;
+    std::array<std::array<Gain, kMaxOutputs>, kMaxRecorders> outputGains;
+    std::array<std::array<Gain, kMaxOutputs>, kMaxRecorders> playbackGains;
+    std::array<Gain, kMaxOutputs> voiceGains;
+    juce::AudioBuffer<float> rampScratch; // channel 0: 1..n, channel 1: per-sample gain
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RoutingMatrix)
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+// Summing a block of samples for the meters and the onset detector. Four
+// independent partial sums keep the loop free of a serial dependency, so
+// the compiler can keep the adds in vector registers.
+inline float sumOfSamples (const float* samples, int numSamples)
+{
+    float lanes[4] = {};
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        lanes[0] += samples[i];
+        lanes[1] += samples[i + 1];
+        lanes[2] += samples[i + 2];
+        lanes[3] += samples[i + 3];
+    }
+
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < numSamples; ++i)
+        sum += samples[i];
+
+    return sum;
+}
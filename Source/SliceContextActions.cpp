@@ -65,7 +65,7 @@ namespace
                                    const juce::File& previewFile,
                                    bool shouldReverse)
     {
-        AudioFileIO audioFileIO;
+        AudioFileIO audioFileIO (sliceInfo.sampleRate);
         AudioFileIO::ConvertedAudio sliceAudio;
         juce::String formatDescription;
         bool loaded = false;
@@ -141,15 +141,16 @@ SliceContextActionResult handleSliceContextAction (SliceContextAction action,
                                                    int index,
                                                    SliceStateStore& stateStore,
                                                    SliceContextState& contextState,
-                                                   AudioEngine& audioEngine)
+                                                   AudioEngine& audioEngine,
+                                                   SpeculativeSlicePool* slicePool)
 {
     const auto snapshot = stateStore.getSnapshot();
-    if (! isValidSliceIndex (index, snapshot.sliceInfos))
+    if (! isValidSliceIndex (index, snapshot->sliceInfos))
         return makeResult ("Slice index out of range.");
 
-    auto sliceInfos = snapshot.sliceInfos;
-    auto previewSnippetURLs = snapshot.previewSnippetURLs;
-    auto sliceVolumeSettings = snapshot.sliceVolumeSettings;
+    auto sliceInfos = snapshot->sliceInfos;
+    auto previewSnippetURLs = snapshot->previewSnippetURLs;
+    auto sliceVolumeSettings = snapshot->sliceVolumeSettings;
 
     auto& sliceInfo = sliceInfos[static_cast<std::size_t> (index)];
     const bool isLocked = sliceInfo.isLocked;
@@ -184,7 +185,7 @@ SliceContextActionResult handleSliceContextAction (SliceContextAction action,
                                          std::move (sliceVolumeSettings));
             clearPendingAction (contextState);
             {
-                const auto& previewFile = snapshot.previewSnippetURLs[static_cast<std::size_t> (index)];
+                const auto& previewFile = snapshot->previewSnippetURLs[static_cast<std::size_t> (index)];
                 bool ok = true;
                 if (sliceInfo.isDeleted)
                     ok = writeSilentPreview (sliceInfo, previewFile);
@@ -208,7 +209,7 @@ SliceContextActionResult handleSliceContextAction (SliceContextAction action,
             clearPendingAction (contextState);
             if (! sliceInfo.isDeleted)
             {
-                const auto& previewFile = snapshot.previewSnippetURLs[static_cast<std::size_t> (index)];
+                const auto& previewFile = snapshot->previewSnippetURLs[static_cast<std::size_t> (index)];
                 if (! rebuildPreviewFromSource (sliceInfo, previewFile, sliceInfo.isReversed))
                     return makeResult (sliceLabel + "reverse failed.");
                 if (! rebuildPreviewChain (stateStore))
@@ -220,13 +221,13 @@ SliceContextActionResult handleSliceContextAction (SliceContextAction action,
             if (isLocked)
                 return makeResult (sliceLabel + "is locked.");
             clearPendingAction (contextState);
-            MutationOrchestrator orchestrator (stateStore, &audioEngine);
+            MutationOrchestrator orchestrator (stateStore, &audioEngine, slicePool);
             bool ok = orchestrator.requestRegenerateSingle (index);
             if (! ok)
                 return makeResult (sliceLabel + "regen failed.");
             if (sliceInfo.isDeleted)
             {
-                const auto& previewFile = snapshot.previewSnippetURLs[static_cast<std::size_t> (index)];
+                const auto& previewFile = snapshot->previewSnippetURLs[static_cast<std::size_t> (index)];
                 if (! writeSilentPreview (sliceInfo, previewFile))
                     return makeResult (sliceLabel + "regen failed.");
             }
@@ -276,7 +277,7 @@ SliceContextTargetResult handleSliceContextTargetSelection (int targetIndex,
         return result;
 
     const auto snapshot = stateStore.getSnapshot();
-    if (! isValidSliceIndex (targetIndex, snapshot.sliceInfos))
+    if (! isValidSliceIndex (targetIndex, snapshot->sliceInfos))
     {
         result.didHandle = true;
         result.actionResult = makeResult ("Slice index out of range.");
@@ -285,7 +286,7 @@ SliceContextTargetResult handleSliceContextTargetSelection (int targetIndex,
     }
 
     const int sourceIndex = contextState.pendingSourceSliceIndex;
-    if (! isValidSliceIndex (sourceIndex, snapshot.sliceInfos))
+    if (! isValidSliceIndex (sourceIndex, snapshot->sliceInfos))
     {
         result.didHandle = true;
         result.actionResult = makeResult ("Source slice invalid.");
@@ -302,9 +303,9 @@ SliceContextTargetResult handleSliceContextTargetSelection (int targetIndex,
         return result;
     }
 
-    auto sliceInfos = snapshot.sliceInfos;
-    auto previewSnippetURLs = snapshot.previewSnippetURLs;
-    auto sliceVolumeSettings = snapshot.sliceVolumeSettings;
+    auto sliceInfos = snapshot->sliceInfos;
+    auto previewSnippetURLs = snapshot->previewSnippetURLs;
+    auto sliceVolumeSettings = snapshot->sliceVolumeSettings;
 
     const auto& sourceInfo = sliceInfos[static_cast<std::size_t> (sourceIndex)];
     const auto& targetInfo = sliceInfos[static_cast<std::size_t> (targetIndex)];
@@ -4,6 +4,7 @@
 
 class AudioEngine;
 class SliceStateStore;
+class SpeculativeSlicePool;
 struct SliceContextState;
 
 enum class SliceContextAction
@@ -32,7 +33,8 @@ SliceContextActionResult handleSliceContextAction (SliceContextAction action,
                                                    int index,
                                                    SliceStateStore& stateStore,
                                                    SliceContextState& contextState,
-                                                   AudioEngine& audioEngine);
+                                                   AudioEngine& audioEngine,
+                                                   SpeculativeSlicePool* slicePool = nullptr);
 
 SliceContextTargetResult handleSliceContextTargetSelection (int targetIndex,
                                                             SliceStateStore& stateStore,
@@ -1,16 +1,45 @@
 #include "SliceInfrastructure.h"
+#include "OnsetDetector.h"
 
 namespace
 {
-    constexpr double kTargetSampleRate = 44100.0;
     constexpr double kPreTransientOffsetSeconds = 0.005;
+
+    // a window without a clear attack (a held note, a drone) falls back to
+    // its loudest sample
+    int transientIndexInWindow (const float* samples, int numSamples, double sampleRate)
+    {
+        if (const auto onset = OnsetDetector::findStrongestOnset (samples, numSamples, sampleRate))
+            return *onset;
+
+        return loudestSampleIndex (samples, numSamples);
+    }
+}
+
+int loudestSampleIndex (const float* samples, int numSamples)
+{
+    int maxIndex = 0;
+    float maxValue = 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float value = std::abs (samples[i]);
+        if (value > maxValue)
+        {
+            maxValue = value;
+            maxIndex = i;
+        }
+    }
+
+    return maxIndex;
 }
 
 std::optional<int> refinedStart (const juce::AudioBuffer<float>& input,
                                  juce::Random& random,
                                  int maxCandidateStart,
                                  int windowFrames,
-                                 bool transientDetectEnabled)
+                                 bool transientDetectEnabled,
+                                 double sampleRate)
 {
     if (! transientDetectEnabled)
         return std::nullopt;
@@ -29,22 +58,9 @@ std::optional<int> refinedStart (const juce::AudioBuffer<float>& input,
     if (windowStart < 0 || windowStart + windowFrames > totalSamples)
         return std::nullopt;
 
-    const float* samples = input.getReadPointer (0);
-    int maxIndex = 0;
-    float maxValue = 0.0f;
-
-    for (int i = 0; i < windowFrames; ++i)
-    {
-        const float value = std::abs (samples[windowStart + i]);
-        if (value > maxValue)
-        {
-            maxValue = value;
-            maxIndex = i;
-        }
-    }
-
-    const int transientFrame = windowStart + maxIndex;
-    const int offsetFrames = static_cast<int> (std::lround (kPreTransientOffsetSeconds * kTargetSampleRate));
+    const float* samples = input.getReadPointer (0, windowStart);
+    const int transientFrame = windowStart + transientIndexInWindow (samples, windowFrames, sampleRate);
+    const int offsetFrames = static_cast<int> (std::lround (kPreTransientOffsetSeconds * sampleRate));
     const int startFrame = juce::jmax (0, transientFrame - offsetFrames);
 
     return startFrame;
@@ -52,7 +68,8 @@ std::optional<int> refinedStart (const juce::AudioBuffer<float>& input,
 
 std::optional<int> refinedStartFromWindow (const juce::AudioBuffer<float>& windowBuffer,
                                            int windowStartFrame,
-                                           bool transientDetectEnabled)
+                                           bool transientDetectEnabled,
+                                           double sampleRate)
 {
     if (! transientDetectEnabled)
         return std::nullopt;
@@ -62,24 +79,58 @@ std::optional<int> refinedStartFromWindow (const juce::AudioBuffer<float>& windo
         return std::nullopt;
 
     const float* samples = windowBuffer.getReadPointer (0);
-    int maxIndex = 0;
-    float maxValue = 0.0f;
+    const int transientFrame = windowStartFrame + transientIndexInWindow (samples, totalSamples, sampleRate);
+    const int offsetFrames = static_cast<int> (std::lround (kPreTransientOffsetSeconds * sampleRate));
+    const int startFrame = juce::jmax (0, transientFrame - offsetFrames);
+
+    return startFrame;
+}
+
+std::optional<int> onsetAlignedStart (const LiveTakeAnalyzer::TakeAnalysis& analysis,
+                                      juce::Random& random,
+                                      int maxCandidateStart,
+                                      int windowFrames,
+                                      int totalFrames,
+                                      int snippetFrames,
+                                      double sampleRate)
+{
+    if (windowFrames <= 0 || totalFrames <= 0 || windowFrames > totalFrames)
+        return std::nullopt;
+
+    if (analysis.sampleRate <= 0.0 || sampleRate <= 0.0 || analysis.getAnalysedFramesAt (sampleRate) < totalFrames)
+        return std::nullopt;
+
+    // the analysis counts take frames at the device rate
+    const double toTake = analysis.sampleRate / sampleRate;
+    const auto toFile = [&] (int takeFrame) { return static_cast<int> (std::lround (takeFrame / toTake)); };
+    const int snippetTakeFrames = static_cast<int> (std::lround (snippetFrames * toTake));
+
+    const int maxWindowStart = totalFrames - windowFrames;
+    const int cappedCandidateStart = juce::jlimit (0, maxWindowStart, maxCandidateStart);
+    const int windowStart = random.nextInt (cappedCandidateStart + 1);
+    const int windowEnd = windowStart + windowFrames;
 
-    for (int i = 0; i < totalSamples; ++i)
+    const auto first = std::lower_bound (analysis.onsets.begin(), analysis.onsets.end(), windowStart,
+                                         [&] (const LiveTakeAnalyzer::Onset& onset, int frame) { return toFile (onset.frame) < frame; });
+
+    const LiveTakeAnalyzer::Onset* best = nullptr;
+    for (auto it = first; it != analysis.onsets.end() && toFile (it->frame) < windowEnd; ++it)
     {
-        const float value = std::abs (samples[i]);
-        if (value > maxValue)
-        {
-            maxValue = value;
-            maxIndex = i;
-        }
+        if (best != nullptr && it->strength <= best->strength)
+            continue;
+
+        const juce::Range<int> snippet (it->frame, juce::jmin (analysis.analysedFrames, it->frame + snippetTakeFrames));
+        if (analysis.countSilentFrames (snippet) * 2 > snippet.getLength())
+            continue;
+
+        best = &*it;
     }
 
-    const int transientFrame = windowStartFrame + maxIndex;
-    const int offsetFrames = static_cast<int> (std::lround (kPreTransientOffsetSeconds * kTargetSampleRate));
-    const int startFrame = juce::jmax (0, transientFrame - offsetFrames);
+    if (best == nullptr)
+        return std::nullopt;
 
-    return startFrame;
+    const int offsetFrames = static_cast<int> (std::lround (kPreTransientOffsetSeconds * sampleRate));
+    return juce::jmax (0, toFile (best->frame) - offsetFrames);
 }
 
 juce::AudioBuffer<float> mergeSlices (const juce::AudioBuffer<float>& leftSlice,
@@ -3,6 +3,7 @@
 #include <JuceHeader.h>
 #include <optional>
 #include "AudioFileIO.h"
+#include "LiveTakeAnalyzer.h"
 #include "SliceStateStore.h"
 
 struct SliceProcessingFlags
@@ -17,15 +18,35 @@ struct SliceProcessingFlags
 
 // Pairing invariant (dormant): leftIndex = i, rightIndex = i + sampleCount.
 
+// refinedStart and refinedStartFromWindow start a snippet just before the
+// strongest onset in the window (see OnsetDetector).
 std::optional<int> refinedStart (const juce::AudioBuffer<float>& input,
                                  juce::Random& random,
                                  int maxCandidateStart,
                                  int windowFrames,
-                                 bool transientDetectEnabled);
+                                 bool transientDetectEnabled,
+                                 double sampleRate);
 
 std::optional<int> refinedStartFromWindow (const juce::AudioBuffer<float>& windowBuffer,
                                            int windowStartFrame,
-                                           bool transientDetectEnabled);
+                                           bool transientDetectEnabled,
+                                           double sampleRate);
+
+// LIVE takes: picks a window the same way as refinedStart, then the strongest
+// onset the recorder's analyser found in it whose snippet is not mostly silent.
+// Frames are at sampleRate, the rate the take's file is read at; nullopt
+// unless the analysis covers all totalFrames of it.
+std::optional<int> onsetAlignedStart (const LiveTakeAnalyzer::TakeAnalysis& analysis,
+                                      juce::Random& random,
+                                      int maxCandidateStart,
+                                      int windowFrames,
+                                      int totalFrames,
+                                      int snippetFrames,
+                                      double sampleRate);
+
+// index of the largest |x|; the transient pick before onset detection, still
+// used for windows that have no onset
+int loudestSampleIndex (const float* samples, int numSamples);
 
 juce::AudioBuffer<float> mergeSlices (const juce::AudioBuffer<float>& leftSlice,
                                       const juce::AudioBuffer<float>& rightSlice,
@@ -0,0 +1,170 @@
+#include "SliceRandom.h"
+
+#include <atomic>
+#include <limits>
+
+namespace
+{
+    // Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"
+    constexpr std::uint32_t kPhiloxMultiplier0 = 0xD2511F53u;
+    constexpr std::uint32_t kPhiloxMultiplier1 = 0xCD9E8D57u;
+    constexpr std::uint32_t kPhiloxWeyl0 = 0x9E3779B9u;
+    constexpr std::uint32_t kPhiloxWeyl1 = 0xBB67AE85u;
+    constexpr int kPhiloxRounds = 10;
+
+    struct KnownAnswer
+    {
+        SliceRandom::Block counter;
+        std::uint64_t key;
+        SliceRandom::Block expected;
+    };
+
+    // Random123's kat_vectors for philox4x32_10; the key words are
+    // { low 32 bits, high 32 bits } of ours
+    constexpr KnownAnswer kKnownAnswers[] {
+        { { 0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u }, 0x0000000000000000ull,
+          { 0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u } },
+        { { 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu }, 0xffffffffffffffffull,
+          { 0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu } },
+        { { 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u }, 0x299f31d0a4093822ull,
+          { 0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u } }
+    };
+
+    void mulHiLo (std::uint32_t a, std::uint32_t b, std::uint32_t& hi, std::uint32_t& lo)
+    {
+        const auto product = static_cast<std::uint64_t> (a) * b;
+        hi = static_cast<std::uint32_t> (product >> 32);
+        lo = static_cast<std::uint32_t> (product);
+    }
+
+    juce::int64 toSeed (const SliceRandom::Block& block)
+    {
+        return static_cast<juce::int64> ((static_cast<std::uint64_t> (block[1]) << 32) | block[0]);
+    }
+
+    // the clock only has to differ between runs; philox spreads it
+    juce::int64 drawSessionSeed()
+    {
+        const auto ticks = static_cast<std::uint64_t> (juce::Time::getHighResolutionTicks());
+        return toSeed (SliceRandom::philox ({ static_cast<std::uint32_t> (SliceRandom::Purpose::session), 0, 0, 0 }, ticks));
+    }
+
+    std::atomic<juce::int64> sessionSeed { drawSessionSeed() };
+}
+
+SliceRandom::Block SliceRandom::philox (Block counter, std::uint64_t key)
+{
+    auto key0 = static_cast<std::uint32_t> (key);
+    auto key1 = static_cast<std::uint32_t> (key >> 32);
+
+    for (int round = 0; round < kPhiloxRounds; ++round)
+    {
+        std::uint32_t hi0, lo0, hi1, lo1;
+        mulHiLo (kPhiloxMultiplier0, counter[0], hi0, lo0);
+        mulHiLo (kPhiloxMultiplier1, counter[2], hi1, lo1);
+
+        counter = { hi1 ^ counter[1] ^ key0, lo1, hi0 ^ counter[3] ^ key1, lo0 };
+
+        key0 += kPhiloxWeyl0;
+        key1 += kPhiloxWeyl1;
+    }
+
+    return counter;
+}
+
+bool SliceRandom::passesKnownAnswers()
+{
+    for (const auto& answer : kKnownAnswers)
+    {
+        if (philox (answer.counter, answer.key) != answer.expected)
+            return false;
+    }
+
+    return true;
+}
+
+juce::int64 SliceRandom::getSessionSeed()
+{
+    return sessionSeed.load();
+}
+
+void SliceRandom::setSessionSeed (juce::int64 seed)
+{
+    sessionSeed.store (seed);
+}
+
+std::optional<juce::int64> SliceRandom::parseSeed (const juce::String& text)
+{
+    const bool negative = text.startsWithChar ('-');
+    const auto digits = negative ? text.substring (1) : text;
+    if (digits.isEmpty() || ! digits.containsOnly ("0123456789"))
+        return std::nullopt;
+
+    // getLargeIntValue wraps out-of-range numbers, so the magnitude is
+    // accumulated here and checked against the int64 limits
+    const auto limit = static_cast<std::uint64_t> (std::numeric_limits<juce::int64>::max()) + (negative ? 1u : 0u);
+    std::uint64_t magnitude = 0;
+    for (int i = 0; i < digits.length(); ++i)
+    {
+        const auto digit = static_cast<std::uint64_t> (digits[i] - '0');
+        if (magnitude > (limit - digit) / 10)
+            return std::nullopt;
+
+        magnitude = magnitude * 10 + digit;
+    }
+
+    return negative ? static_cast<juce::int64> (0 - magnitude) : static_cast<juce::int64> (magnitude);
+}
+
+juce::int64 SliceRandom::kitSeed (juce::int64 seedOfSession, int kitNumber)
+{
+    return toSeed (philox ({ static_cast<std::uint32_t> (Purpose::session), static_cast<std::uint32_t> (kitNumber), 0, 0 },
+                           static_cast<std::uint64_t> (seedOfSession)));
+}
+
+juce::Random SliceRandom::makeRandom (juce::int64 seed, Purpose purpose, int index, int counter)
+{
+    const auto block = philox ({ static_cast<std::uint32_t> (purpose),
+                                 static_cast<std::uint32_t> (index),
+                                 static_cast<std::uint32_t> (counter),
+                                 0 },
+                               static_cast<std::uint64_t> (seed));
+
+    // juce::Random keeps 48 bits of its seed; the block's first two words
+    // give it those, so a stream's draws are fixed from its first one
+    return juce::Random (toSeed (block));
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class SliceRandomTests final : public juce::UnitTest
+{
+public:
+    SliceRandomTests() : juce::UnitTest ("SliceRandom", "Slicebot") {}
+
+    void runTest() override
+    {
+        beginTest ("philox matches the Random123 known answers");
+        expect (SliceRandom::passesKnownAnswers());
+
+        beginTest ("seeds parse back as logged");
+        for (const auto seed : { juce::int64 { 0 }, juce::int64 { 42 }, juce::int64 { -7 },
+                                 std::numeric_limits<juce::int64>::max(), std::numeric_limits<juce::int64>::min() })
+        {
+            const auto parsed = SliceRandom::parseSeed (juce::String (seed));
+            expect (parsed.has_value() && *parsed == seed, juce::String (seed));
+        }
+
+        beginTest ("anything else is refused");
+        for (const auto* text : { "", "-", "abc", "12abc", "1.5", " 12", "9223372036854775808", "-9223372036854775809" })
+            expect (! SliceRandom::parseSeed (text).has_value(), text);
+    }
+};
+
+static SliceRandomTests sliceRandomTests;
+
+#endif
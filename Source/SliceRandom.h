@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cstdint>
+#include <optional>
+
+// Counter-based random streams for slicing. Every stream is Philox4x32-10
+// keyed by a seed and addressed by (purpose, slice index, counter), so what a
+// slice draws depends only on those numbers, never on which thread cut it or
+// what was cut before it.
+//
+// A session seed yields one kit seed per Slice All; a kit's slices are
+// streams of its seed, and each reslice or regenerate of a slice moves its
+// counter on by one. The same seeds, sources and settings cut the same audio.
+class SliceRandom
+{
+public:
+    enum class Purpose : std::uint32_t
+    {
+        kit,   // draws shared by a whole kit: subdivisions, the single-random source
+        slice, // one slice position's cuts
+        session
+    };
+
+    using Block = std::array<std::uint32_t, 4>;
+
+    // one Philox4x32-10 block
+    static Block philox (Block counter, std::uint64_t key);
+
+    // whether philox reproduces the Random123 known-answer vectors; a
+    // build that does not would cut different kits from the same seeds
+    static bool passesKnownAnswers();
+
+    // the seed this session's kits come from: drawn at startup unless the
+    // command line sets one
+    static juce::int64 getSessionSeed();
+    static void setSessionSeed (juce::int64 seed);
+
+    // a decimal seed as the log prints one; nullopt for anything else,
+    // including a number outside the int64 range
+    static std::optional<juce::int64> parseSeed (const juce::String& text);
+
+    static juce::int64 kitSeed (juce::int64 sessionSeed, int kitNumber);
+
+    static juce::Random makeRandom (juce::int64 seed, Purpose purpose, int index, int counter = 0);
+};
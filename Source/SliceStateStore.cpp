@@ -1,40 +1,61 @@
 #include "SliceStateStore.h"
+#include "SliceRandom.h"
+#include <numeric>
 
-SliceStateStore::SliceStateSnapshot SliceStateStore::getSnapshot() const
-{
-    const juce::ScopedLock lock (stateLock);
-    return SliceStateSnapshot { sourceDirectory,
-                                sourceFile,
-                                cacheData,
-                                sourceMode,
-                                bpm,
-                                subdivisionSteps,
-                                sampleCountSetting,
-                                randomSubdivisionEnabled,
-                                transientDetectionEnabled,
-                                isCachingState,
-                                sliceInfos,
-                                previewSnippetURLs,
-                                sliceVolumeSettings,
-                                previewChainURL,
-                                layeringMode,
-                                sampleCount,
-                                mergeMode,
-                                manualReverseEnabled,
-                                exportSettingsLocked,
-                                exportSettings,
-                                stutterCount,
-                                stutterVolumeReductionStep,
-                                stutterPitchShiftSemitones,
-                                stutterTruncateEnabled,
-                                stutterStartFraction,
-                                stutterUndoBackup };
+int SliceStateStore::CandidateSet::size() const
+{
+    return cacheData != nullptr ? cacheData->entries.size() - firstRank : 0;
+}
+
+bool SliceStateStore::CandidateSet::isEmpty() const
+{
+    return size() <= 0;
+}
+
+juce::String SliceStateStore::CandidateSet::getPath (int index) const
+{
+    return cacheData->entries.getPath (cacheData->entries.entryAtDurationRank (firstRank + index));
+}
+
+int SliceStateStore::CandidateSet::sample (juce::Random& random) const
+{
+    const int column = random.nextInt (size());
+    if (aliasThresholds.empty())
+        return column;
+
+    const auto i = static_cast<std::size_t> (column);
+    return random.nextFloat() < aliasThresholds[i] ? column : aliases[i];
+}
+
+SliceStateStore::SliceStateStore()
+{
+    auto initial = std::make_shared<SliceStateSnapshot>();
+    initial->sessionSeed = SliceRandom::getSessionSeed();
+    state = std::move (initial);
+}
+
+SliceStateStore::Snapshot SliceStateStore::getSnapshot() const
+{
+    return std::atomic_load (&state);
+}
+
+void SliceStateStore::update (const std::function<void (SliceStateSnapshot&)>& change)
+{
+    const juce::ScopedLock lock (writeLock);
+    auto next = std::make_shared<SliceStateSnapshot> (*std::atomic_load (&state));
+    change (*next);
+    std::atomic_store (&state, Snapshot (std::move (next)));
 }
 
 void SliceStateStore::setCacheData (AudioCacheStore::CacheData newCacheData)
 {
-    const juce::ScopedLock lock (stateLock);
-    cacheData = std::move (newCacheData);
+    auto shared = std::make_shared<const AudioCacheStore::CacheData> (std::move (newCacheData));
+
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.candidates = makeCandidates (shared, nextCacheGeneration++, next.bpm);
+        next.cacheData = std::move (shared);
+    });
 }
 
 void SliceStateStore::setSliceSettings (double newBpm,
@@ -42,35 +63,41 @@ void SliceStateStore::setSliceSettings (double newBpm,
                                         int newSampleCountSetting,
                                         bool newTransientDetectionEnabled)
 {
-    const juce::ScopedLock lock (stateLock);
-    bpm = newBpm;
-    subdivisionSteps = newSubdivisionSteps;
-    sampleCountSetting = newSampleCountSetting;
-    transientDetectionEnabled = newTransientDetectionEnabled;
+    update ([&] (SliceStateSnapshot& next)
+    {
+        // the cutoff and the no-go zone move with the BPM in steps; between
+        // them the set and its alias table stay, and the cache is never touched
+        const int firstRank = next.cacheData->entries.countShorterThan (AudioCacheStore::minCandidateDurationSeconds (newBpm));
+        const bool cutoffsMoved = firstRank != next.candidates->firstRank
+                                  || AudioCacheStore::noGoZoneSeconds (newBpm) != next.candidates->noGoZoneSeconds;
+        if (newBpm != next.bpm && cutoffsMoved)
+            next.candidates = makeCandidates (next.cacheData, next.candidates->generation, newBpm);
+
+        next.bpm = newBpm;
+        next.subdivisionSteps = newSubdivisionSteps;
+        next.sampleCountSetting = newSampleCountSetting;
+        next.transientDetectionEnabled = newTransientDetectionEnabled;
+    });
 }
 
 void SliceStateStore::setSourceMode (SourceMode newMode)
 {
-    const juce::ScopedLock lock (stateLock);
-    sourceMode = newMode;
+    update ([&] (SliceStateSnapshot& next) { next.sourceMode = newMode; });
 }
 
 void SliceStateStore::setRandomSubdivisionEnabled (bool enabled)
 {
-    const juce::ScopedLock lock (stateLock);
-    randomSubdivisionEnabled = enabled;
+    update ([&] (SliceStateSnapshot& next) { next.randomSubdivisionEnabled = enabled; });
 }
 
 void SliceStateStore::setCaching (bool cachingState)
 {
-    const juce::ScopedLock lock (stateLock);
-    isCachingState = cachingState;
+    update ([&] (SliceStateSnapshot& next) { next.isCaching = cachingState; });
 }
 
 bool SliceStateStore::isCaching() const
 {
-    const juce::ScopedLock lock (stateLock);
-    return isCachingState;
+    return getSnapshot()->isCaching;
 }
 
 void SliceStateStore::setAlignedSlices (std::vector<SliceInfo> newSliceInfos,
@@ -79,10 +106,12 @@ void SliceStateStore::setAlignedSlices (std::vector<SliceInfo> newSliceInfos,
 {
     enforceAlignmentOrAssert (newSliceInfos, newPreviewSnippetURLs, newSliceVolumeSettings);
 
-    const juce::ScopedLock lock (stateLock);
-    sliceInfos = std::move (newSliceInfos);
-    previewSnippetURLs = std::move (newPreviewSnippetURLs);
-    sliceVolumeSettings = std::move (newSliceVolumeSettings);
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.sliceInfos = std::move (newSliceInfos);
+        next.previewSnippetURLs = std::move (newPreviewSnippetURLs);
+        next.sliceVolumeSettings = std::move (newSliceVolumeSettings);
+    });
 }
 
 void SliceStateStore::replaceAllState (std::vector<SliceInfo> newSliceInfos,
@@ -92,62 +121,73 @@ void SliceStateStore::replaceAllState (std::vector<SliceInfo> newSliceInfos,
 {
     enforceAlignmentOrAssert (newSliceInfos, newPreviewSnippetURLs, newSliceVolumeSettings);
 
-    const juce::ScopedLock lock (stateLock);
-    sliceInfos = std::move (newSliceInfos);
-    previewSnippetURLs = std::move (newPreviewSnippetURLs);
-    sliceVolumeSettings = std::move (newSliceVolumeSettings);
-    previewChainURL = std::move (newPreviewChainURL);
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.sliceInfos = std::move (newSliceInfos);
+        next.previewSnippetURLs = std::move (newPreviewSnippetURLs);
+        next.sliceVolumeSettings = std::move (newSliceVolumeSettings);
+        next.previewChainURL = std::move (newPreviewChainURL);
+    });
 }
 
 void SliceStateStore::setPreviewChainURL (juce::File newPreviewChainURL)
 {
-    const juce::ScopedLock lock (stateLock);
-    previewChainURL = std::move (newPreviewChainURL);
+    update ([&] (SliceStateSnapshot& next) { next.previewChainURL = std::move (newPreviewChainURL); });
 }
 
 void SliceStateStore::setSourceDirectory (juce::File newSourceDirectory)
 {
-    const juce::ScopedLock lock (stateLock);
-    sourceDirectory = std::move (newSourceDirectory);
-    sourceFile = juce::File();
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.sourceDirectory = std::move (newSourceDirectory);
+        next.sourceFile = juce::File();
+    });
 }
 
 void SliceStateStore::setSourceFile (juce::File newSourceFile)
 {
-    const juce::ScopedLock lock (stateLock);
-    sourceFile = std::move (newSourceFile);
-    sourceDirectory = juce::File();
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.sourceFile = std::move (newSourceFile);
+        next.sourceDirectory = juce::File();
+    });
 }
 
 void SliceStateStore::setLayeringState (bool newLayeringMode, int newSampleCount)
 {
-    const juce::ScopedLock lock (stateLock);
-    layeringMode = newLayeringMode;
-    sampleCount = newSampleCount;
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.layeringMode = newLayeringMode;
+        next.sampleCount = newSampleCount;
+    });
+}
+
+void SliceStateStore::setKitNumber (int newKitNumber)
+{
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.kitNumber = newKitNumber;
+    });
 }
 
 void SliceStateStore::setMergeMode (MergeMode newMergeMode)
 {
-    const juce::ScopedLock lock (stateLock);
-    mergeMode = newMergeMode;
+    update ([&] (SliceStateSnapshot& next) { next.mergeMode = newMergeMode; });
 }
 
 void SliceStateStore::setManualReverseEnabled (bool newManualReverseEnabled)
 {
-    const juce::ScopedLock lock (stateLock);
-    manualReverseEnabled = newManualReverseEnabled;
+    update ([&] (SliceStateSnapshot& next) { next.manualReverseEnabled = newManualReverseEnabled; });
 }
 
 void SliceStateStore::setExportSettingsLocked (bool newExportSettingsLocked)
 {
-    const juce::ScopedLock lock (stateLock);
-    exportSettingsLocked = newExportSettingsLocked;
+    update ([&] (SliceStateSnapshot& next) { next.exportSettingsLocked = newExportSettingsLocked; });
 }
 
 void SliceStateStore::setExportSettings (ExportSettings newExportSettings)
 {
-    const juce::ScopedLock lock (stateLock);
-    exportSettings = std::move (newExportSettings);
+    update ([&] (SliceStateSnapshot& next) { next.exportSettings = std::move (newExportSettings); });
 }
 
 void SliceStateStore::setStutterSettings (int newStutterCount,
@@ -156,24 +196,88 @@ void SliceStateStore::setStutterSettings (int newStutterCount,
                                           bool newStutterTruncateEnabled,
                                           float newStutterStartFraction)
 {
-    const juce::ScopedLock lock (stateLock);
-    stutterCount = newStutterCount;
-    stutterVolumeReductionStep = newStutterVolumeReductionStep;
-    stutterPitchShiftSemitones = newStutterPitchShiftSemitones;
-    stutterTruncateEnabled = newStutterTruncateEnabled;
-    stutterStartFraction = newStutterStartFraction;
+    update ([&] (SliceStateSnapshot& next)
+    {
+        next.stutterCount = newStutterCount;
+        next.stutterVolumeReductionStep = newStutterVolumeReductionStep;
+        next.stutterPitchShiftSemitones = newStutterPitchShiftSemitones;
+        next.stutterTruncateEnabled = newStutterTruncateEnabled;
+        next.stutterStartFraction = newStutterStartFraction;
+    });
 }
 
 void SliceStateStore::clearStutterUndoBackup()
 {
-    const juce::ScopedLock lock (stateLock);
-    stutterUndoBackup.clear();
+    update ([] (SliceStateSnapshot& next) { next.stutterUndoBackup.clear(); });
 }
 
 void SliceStateStore::setStutterUndoBackupEntry (int index, juce::File originalSnippet)
 {
-    const juce::ScopedLock lock (stateLock);
-    stutterUndoBackup[index] = std::move (originalSnippet);
+    update ([&] (SliceStateSnapshot& next) { next.stutterUndoBackup[index] = std::move (originalSnippet); });
+}
+
+std::shared_ptr<const SliceStateStore::CandidateSet>
+SliceStateStore::makeCandidates (std::shared_ptr<const AudioCacheStore::CacheData> cacheData,
+                                 juce::uint64 generation,
+                                 double bpm)
+{
+    auto candidates = std::make_shared<CandidateSet>();
+    candidates->generation = generation;
+    candidates->firstRank = cacheData->entries.countShorterThan (AudioCacheStore::minCandidateDurationSeconds (bpm));
+    candidates->cacheData = std::move (cacheData);
+
+    const int count = candidates->size();
+    const double noGoZone = AudioCacheStore::noGoZoneSeconds (bpm);
+    candidates->noGoZoneSeconds = noGoZone;
+    const auto& entries = candidates->cacheData->entries;
+
+    std::vector<double> weights (static_cast<std::size_t> (juce::jmax (0, count)));
+    double totalWeight = 0.0;
+    for (int i = 0; i < count; ++i)
+    {
+        const double usable = entries.getDurationSeconds (entries.entryAtDurationRank (candidates->firstRank + i)) - noGoZone;
+        weights[static_cast<std::size_t> (i)] = juce::jmax (0.0, usable);
+        totalWeight += weights[static_cast<std::size_t> (i)];
+    }
+
+    if (count == 0 || totalWeight <= 0.0)
+        return candidates;
+
+    // Vose's method: split the scaled weights into columns under 1 and over
+    // 1, then let each short column borrow the rest of its height from a tall one
+    candidates->aliasThresholds.assign (static_cast<std::size_t> (count), 1.0f);
+    candidates->aliases.resize (static_cast<std::size_t> (count));
+    std::iota (candidates->aliases.begin(), candidates->aliases.end(), 0);
+
+    std::vector<int> small;
+    std::vector<int> large;
+    for (int i = 0; i < count; ++i)
+    {
+        auto& weight = weights[static_cast<std::size_t> (i)];
+        weight *= count / totalWeight;
+        (weight < 1.0 ? small : large).push_back (i);
+    }
+
+    while (! small.empty() && ! large.empty())
+    {
+        const int shortColumn = small.back();
+        small.pop_back();
+        const int tallColumn = large.back();
+
+        candidates->aliasThresholds[static_cast<std::size_t> (shortColumn)] = static_cast<float> (weights[static_cast<std::size_t> (shortColumn)]);
+        candidates->aliases[static_cast<std::size_t> (shortColumn)] = tallColumn;
+
+        auto& tallWeight = weights[static_cast<std::size_t> (tallColumn)];
+        tallWeight -= 1.0 - weights[static_cast<std::size_t> (shortColumn)];
+        if (tallWeight < 1.0)
+        {
+            large.pop_back();
+            small.push_back (tallColumn);
+        }
+    }
+
+    // whatever is left is 1 up to rounding and keeps its default threshold
+    return candidates;
 }
 
 void SliceStateStore::enforceAlignmentOrAssert (const std::vector<SliceInfo>& newSliceInfos,
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <functional>
+#include <memory>
 #include <vector>
 #include "AudioCacheStore.h"
 
@@ -25,21 +27,48 @@ public:
         pachinko
     };
 
+    // The entries of one cache generation that are long enough at one BPM:
+    // a cutoff into the cache's duration index, shared by every slice cut
+    // from it. A slice keeps its set across recaches and BPM changes, so
+    // regenerating draws from the pool it came from.
+    struct CandidateSet
+    {
+        juce::uint64 generation = 0;
+        std::shared_ptr<const AudioCacheStore::CacheData> cacheData;
+        int firstRank = 0; // duration ranks [firstRank, entries.size()) qualify
+        double noGoZoneSeconds = 0.0; // taken off every file's weight
+
+        // alias table weighted by the seconds a slice can start in, so a
+        // long file is drawn as often as its extra material warrants
+        std::vector<float> aliasThresholds;
+        std::vector<int> aliases;
+
+        int size() const;
+        bool isEmpty() const;
+        juce::String getPath (int index) const;
+
+        // O(1) draw of an index into the set; uniform if no file has room
+        int sample (juce::Random& random) const;
+    };
+
     struct SliceInfo
     {
         juce::File fileURL;
         int startFrame = 0;
         int subdivisionSteps = 0;
         int snippetFrameCount = 0;
+        double sampleRate = 44100.0; // rate startFrame and snippetFrameCount are counted at
         SourceMode sourceMode = SourceMode::multi;
         double bpm = 128.0;
         bool transientDetectionEnabled = true;
         juce::String sourcePath;
         bool sourceIsDirectory = false;
-        std::vector<juce::String> candidatePaths;
+        std::shared_ptr<const CandidateSet> candidates; // null outside multi / singleRandom
         bool isLocked = false;
         bool isDeleted = false;
         bool isReversed = false;
+        juce::int64 kitSeed = 0; // see SliceRandom
+        int recutCount = 0;      // reslices and regenerates since the kit was cut
     };
 
     struct SliceVolumeSetting
@@ -57,11 +86,14 @@ public:
         int sliceExportRetryCount = 3;
     };
 
+    // Published versions are immutable. The cache is shared between
+    // versions, so replacing a setting does not copy its entries.
     struct SliceStateSnapshot
     {
         juce::File sourceDirectory;
         juce::File sourceFile;
-        AudioCacheStore::CacheData cacheData;
+        std::shared_ptr<const AudioCacheStore::CacheData> cacheData = std::make_shared<const AudioCacheStore::CacheData>();
+        std::shared_ptr<const CandidateSet> candidates = std::make_shared<const CandidateSet>();
         SourceMode sourceMode = SourceMode::multi;
         double bpm = 128.0;
         int subdivisionSteps = 4;
@@ -69,6 +101,8 @@ public:
         bool randomSubdivisionEnabled = false;
         bool transientDetectionEnabled = true;
         bool isCaching = false;
+        juce::int64 sessionSeed = 0;
+        int kitNumber = 0; // kits cut so far; the next Slice All cuts kitNumber + 1
         std::vector<SliceInfo> sliceInfos;
         std::vector<juce::File> previewSnippetURLs;
         std::vector<SliceVolumeSetting> sliceVolumeSettings;
@@ -87,9 +121,13 @@ public:
         std::map<int, juce::File> stutterUndoBackup;
     };
 
-    SliceStateStore() = default;
+    using Snapshot = std::shared_ptr<const SliceStateSnapshot>;
 
-    SliceStateSnapshot getSnapshot() const;
+    SliceStateStore();
+
+    // lock-free; the returned version never changes, later writes publish a
+    // new one
+    Snapshot getSnapshot() const;
 
     void setCacheData (AudioCacheStore::CacheData newCacheData);
     void setSliceSettings (double newBpm,
@@ -114,6 +152,7 @@ public:
     void setSourceDirectory (juce::File newSourceDirectory);
     void setSourceFile (juce::File newSourceFile);
     void setLayeringState (bool newLayeringMode, int newSampleCount);
+    void setKitNumber (int newKitNumber);
     void setMergeMode (MergeMode newMergeMode);
     void setManualReverseEnabled (bool newManualReverseEnabled);
     void setExportSettingsLocked (bool newExportSettingsLocked);
@@ -131,33 +170,17 @@ private:
                                    const std::vector<juce::File>& newPreviewSnippetURLs,
                                    const std::vector<SliceVolumeSetting>& newSliceVolumeSettings) const;
 
-    mutable juce::CriticalSection stateLock;
-    juce::File sourceDirectory;
-    juce::File sourceFile;
-    AudioCacheStore::CacheData cacheData;
-    SourceMode sourceMode = SourceMode::multi;
-    double bpm = 128.0;
-    int subdivisionSteps = 4;
-    int sampleCountSetting = 16;
-    bool randomSubdivisionEnabled = false;
-    bool transientDetectionEnabled = true;
-    bool isCachingState = false;
-    std::vector<SliceInfo> sliceInfos;
-    std::vector<juce::File> previewSnippetURLs;
-    std::vector<SliceVolumeSetting> sliceVolumeSettings;
-    juce::File previewChainURL;
-    bool layeringMode = false;
-    int sampleCount = 0;
-    MergeMode mergeMode = MergeMode::none;
-    bool manualReverseEnabled = false;
-    bool exportSettingsLocked = false;
-    ExportSettings exportSettings;
-    int stutterCount = 4;
-    float stutterVolumeReductionStep = 0.2f;
-    float stutterPitchShiftSemitones = 1.0f;
-    bool stutterTruncateEnabled = false;
-    float stutterStartFraction = 0.0f;
-    std::map<int, juce::File> stutterUndoBackup;
+    // copies the current version, applies change and publishes the copy;
+    // writers are serialised, readers never wait
+    void update (const std::function<void (SliceStateSnapshot&)>& change);
+
+    static std::shared_ptr<const CandidateSet> makeCandidates (std::shared_ptr<const AudioCacheStore::CacheData> cacheData,
+                                                               juce::uint64 generation,
+                                                               double bpm);
+
+    juce::CriticalSection writeLock;
+    juce::uint64 nextCacheGeneration = 1; // guarded by writeLock
+    Snapshot state; // accessed through std::atomic_load / std::atomic_store
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SliceStateStore)
 };
@@ -0,0 +1,583 @@
+#include "SliceVoicePool.h"
+
+// =====================================================
+// SAMPLE
+// =====================================================
+
+SliceVoicePool::Sample::Sample (juce::AudioBuffer<float>&& audio, double sourceSampleRate)
+    : buffer (std::move (audio)),
+      sampleRate (sourceSampleRate)
+{
+}
+
+const juce::AudioBuffer<float>& SliceVoicePool::Sample::getBuffer() const
+{
+    return buffer;
+}
+
+double SliceVoicePool::Sample::getSampleRate() const
+{
+    return sampleRate;
+}
+
+// =====================================================
+// CONSTRUCTION
+// =====================================================
+
+SliceVoicePool::SliceVoicePool()
+{
+    for (auto& tag : voiceTags)
+        tag.store (0);
+}
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+SliceVoicePool::Sample::Ptr SliceVoicePool::createSample (juce::AudioBuffer<float>&& audio,
+                                                          double sourceSampleRate)
+{
+    // drop samples nobody else references any more (no voice, no queued command)
+    for (int i = loadedSamples.size(); --i >= 0;)
+    {
+        if (loadedSamples.getObjectPointerUnchecked (i)->getReferenceCount() == 1)
+            loadedSamples.remove (i);
+    }
+
+    Sample::Ptr sample = new Sample (std::move (audio), sourceSampleRate);
+    loadedSamples.add (sample);
+    return sample;
+}
+
+int SliceVoicePool::trigger (Sample::Ptr sample, const TriggerParams& params)
+{
+    if (sample == nullptr || sample->getBuffer().getNumSamples() == 0)
+        return -1;
+
+    Command command;
+    command.type = CommandType::trigger;
+    command.sample = std::move (sample);
+    command.params = params;
+    command.tag = nextTag++;
+
+    const int tag = command.tag;
+    return post (std::move (command)) ? tag : -1;
+}
+
+void SliceVoicePool::stopVoice (int tag)
+{
+    Command command;
+    command.type = CommandType::stop;
+    command.tag = tag;
+    post (std::move (command));
+}
+
+void SliceVoicePool::stopAll()
+{
+    Command command;
+    command.type = CommandType::stopAll;
+    post (std::move (command));
+}
+
+void SliceVoicePool::setVoiceLooping (int tag, bool shouldLoop)
+{
+    Command command;
+    command.type = CommandType::setLoop;
+    command.tag = tag;
+    command.params.loop = shouldLoop;
+    post (std::move (command));
+}
+
+bool SliceVoicePool::isVoicePlaying (int tag) const
+{
+    if (tag <= 0)
+        return false;
+
+    if (tag > lastConsumedTag.load())
+        return true;
+
+    for (const auto& voiceTag : voiceTags)
+    {
+        if (voiceTag.load() == tag)
+            return true;
+    }
+
+    return false;
+}
+
+void SliceVoicePool::setPadSample (int padIndex, Sample::Ptr sample)
+{
+    if (padIndex < 0 || padIndex >= kNumPads)
+        return;
+
+    Command command;
+    command.type = CommandType::setPad;
+    command.sample = std::move (sample);
+    command.padIndex = padIndex;
+    post (std::move (command));
+}
+
+void SliceVoicePool::setPadChokeGroup (int padIndex, int chokeGroup)
+{
+    if (padIndex < 0 || padIndex >= kNumPads)
+        return;
+
+    Command command;
+    command.type = CommandType::setPadChoke;
+    command.padIndex = padIndex;
+    command.params.chokeGroup = chokeGroup;
+    post (std::move (command));
+}
+
+SliceVoicePool::LatencyStats SliceVoicePool::getPadLatencyStats() const
+{
+    LatencyStats stats;
+    stats.notes = latencyNotes.load();
+    stats.lastMs = latencyLastMs.load();
+    stats.maxMs = latencyMaxMs.load();
+
+    if (stats.notes > 0)
+        stats.meanMs = latencySumMs.load() / stats.notes;
+
+    return stats;
+}
+
+bool SliceVoicePool::post (Command&& command)
+{
+    const auto scope = fifo.write (1);
+    if (scope.blockSize1 > 0)
+    {
+        commands[static_cast<size_t> (scope.startIndex1)] = std::move (command);
+        return true;
+    }
+
+    if (scope.blockSize2 > 0)
+    {
+        commands[static_cast<size_t> (scope.startIndex2)] = std::move (command);
+        return true;
+    }
+
+    return false;
+}
+
+// =====================================================
+// MIDI THREAD
+// =====================================================
+
+bool SliceVoicePool::triggerPad (int padIndex, float gain, double timestampMs)
+{
+    if (padIndex < 0 || padIndex >= kNumPads)
+        return false;
+
+    const auto scope = padFifo.write (1);
+    if (scope.blockSize1 > 0)
+    {
+        padTriggers[static_cast<size_t> (scope.startIndex1)] = { padIndex, gain, timestampMs };
+        return true;
+    }
+
+    if (scope.blockSize2 > 0)
+    {
+        padTriggers[static_cast<size_t> (scope.startIndex2)] = { padIndex, gain, timestampMs };
+        return true;
+    }
+
+    return false;
+}
+
+// =====================================================
+// AUDIO THREAD
+// =====================================================
+
+void SliceVoicePool::prepare (double deviceSampleRate, int newBlockSize, int newOutputLatencySamples)
+{
+    sampleRate = deviceSampleRate;
+    blockSize = juce::jmax (0, newBlockSize);
+    outputLatencySamples = juce::jmax (0, newOutputLatencySamples);
+    numPendingPads = 0;
+}
+
+void SliceVoicePool::render (float* const* output,
+                             int numOutputChannels,
+                             int numSamples,
+                             double blockStartMs,
+                             double presentationDelayMs)
+{
+    const int ready = fifo.getNumReady();
+    if (ready > 0)
+    {
+        const auto scope = fifo.read (ready);
+        for (int i = 0; i < scope.blockSize1; ++i)
+            handleCommand (commands[static_cast<size_t> (scope.startIndex1 + i)]);
+        for (int i = 0; i < scope.blockSize2; ++i)
+            handleCommand (commands[static_cast<size_t> (scope.startIndex2 + i)]);
+    }
+
+    if (numOutputChannels <= 0 || numSamples <= 0)
+        return;
+
+    schedulePads (numSamples, blockStartMs);
+
+    for (auto& voice : voices)
+    {
+        if (voice.sample == nullptr)
+            continue;
+
+        int start = voice.startDelay;
+        voice.startDelay = 0;
+
+        if (voice.noteTimestampMs >= 0.0)
+            recordLatency (voice, start, blockStartMs, presentationDelayMs);
+
+        // a choke that lands mid-block lets the voice play up to that sample
+        if (voice.releaseAt >= 0)
+        {
+            if (voice.releaseAt > start)
+                renderVoice (voice, output, numOutputChannels, start, voice.releaseAt - start);
+
+            start = juce::jmax (start, voice.releaseAt);
+            voice.releaseAt = -1;
+
+            if (voice.sample == nullptr)
+                continue;
+
+            releaseVoice (voice);
+        }
+
+        if (start < numSamples)
+            renderVoice (voice, output, numOutputChannels, start, numSamples - start);
+    }
+}
+
+void SliceVoicePool::schedulePads (int numSamples, double blockStartMs)
+{
+    if (sampleRate <= 0.0)
+        return;
+
+    const int ready = padFifo.getNumReady();
+    if (ready > 0)
+    {
+        const auto scope = padFifo.read (ready);
+        for (int i = 0; i < scope.blockSize1 + scope.blockSize2; ++i)
+        {
+            const int slot = i < scope.blockSize1 ? scope.startIndex1 + i
+                                                  : scope.startIndex2 + (i - scope.blockSize1);
+            if (numPendingPads < kMaxPendingPads)
+                pendingPads[static_cast<size_t> (numPendingPads++)] = padTriggers[static_cast<size_t> (slot)];
+        }
+    }
+
+    // A note can only be heard from the block after the one it arrived in, so
+    // each lands a block after its timestamp, on its own sample within the
+    // block rather than the block edge. Block times follow the device clock,
+    // so the spacing between notes survives callback jitter.
+    const double msPerSample = 1000.0 / sampleRate;
+    const double scheduleDelayMs = blockSize * msPerSample;
+
+    int kept = 0;
+    for (int i = 0; i < numPendingPads; ++i)
+    {
+        const auto pending = pendingPads[static_cast<size_t> (i)];
+        const double offset = (pending.timestampMs + scheduleDelayMs - blockStartMs) / msPerSample;
+
+        if (offset >= static_cast<double> (numSamples))
+        {
+            pendingPads[static_cast<size_t> (kept++)] = pending;
+            continue;
+        }
+
+        const auto& pad = pads[static_cast<size_t> (pending.padIndex)];
+        if (pad.sample == nullptr)
+            continue;
+
+        const int startDelay = juce::jlimit (0, numSamples - 1, static_cast<int> (offset));
+
+        TriggerParams params;
+        params.gain = pending.gain;
+        params.chokeGroup = pad.chokeGroup;
+
+        if (auto* voice = startVoice (pad.sample, params, 0, startDelay))
+            voice->noteTimestampMs = pending.timestampMs;
+    }
+
+    numPendingPads = kept;
+}
+
+// Taken when the voice's first sample is mixed, so a note that was stolen
+// before it sounded is never counted: from the driver's note timestamp to
+// that sample's time at the output, by the device's timestamps when it
+// gives them.
+void SliceVoicePool::recordLatency (Voice& voice, int startSample, double blockStartMs, double presentationDelayMs)
+{
+    const double msPerSample = 1000.0 / sampleRate;
+    const double outputDelayMs = presentationDelayMs >= 0.0 ? presentationDelayMs
+                                                            : outputLatencySamples * msPerSample;
+
+    const double latencyMs = blockStartMs + startSample * msPerSample + outputDelayMs - voice.noteTimestampMs;
+    voice.noteTimestampMs = -1.0;
+
+    latencyNotes.store (latencyNotes.load() + 1);
+    latencyLastMs.store (latencyMs);
+    latencySumMs.store (latencySumMs.load() + latencyMs);
+    latencyMaxMs.store (juce::jmax (latencyMaxMs.load(), latencyMs));
+}
+
+void SliceVoicePool::handleCommand (Command& command)
+{
+    switch (command.type)
+    {
+        case CommandType::trigger:
+            startVoice (command.sample, command.params, command.tag, 0);
+            lastConsumedTag.store (command.tag);
+            break;
+
+        case CommandType::stop:
+            for (auto& voice : voices)
+            {
+                if (voice.sample != nullptr && voice.tag == command.tag)
+                    releaseVoice (voice);
+            }
+            break;
+
+        case CommandType::stopAll:
+            for (auto& voice : voices)
+            {
+                if (voice.sample != nullptr)
+                    releaseVoice (voice);
+            }
+            break;
+
+        case CommandType::setLoop:
+            for (auto& voice : voices)
+            {
+                if (voice.sample != nullptr && voice.tag == command.tag)
+                    voice.params.loop = command.params.loop;
+            }
+            break;
+
+        case CommandType::setPad:
+            std::swap (pads[static_cast<size_t> (command.padIndex)].sample, command.sample);
+            break;
+
+        case CommandType::setPadChoke:
+            pads[static_cast<size_t> (command.padIndex)].chokeGroup = command.params.chokeGroup;
+            break;
+    }
+
+    // the pool still owns the sample (or the pad's previous one), so this never frees it here
+    command.sample = nullptr;
+}
+
+SliceVoicePool::Voice* SliceVoicePool::startVoice (const Sample::Ptr& sample,
+                                                   const TriggerParams& params,
+                                                   int tag,
+                                                   int startDelay)
+{
+    Voice* target = nullptr;
+    Voice* oldest = nullptr;
+
+    for (auto& voice : voices)
+    {
+        if (params.chokeGroup >= 0
+            && voice.sample != nullptr
+            && voice.params.chokeGroup == params.chokeGroup
+            && voice.releaseRemaining < 0)
+        {
+            if (startDelay > 0)
+                voice.releaseAt = juce::jmax (voice.releaseAt, startDelay);
+            else
+                releaseVoice (voice);
+        }
+
+        if (target == nullptr && voice.sample == nullptr)
+            target = &voice;
+
+        if (voice.sample != nullptr
+            && (oldest == nullptr || voice.startOrder < oldest->startOrder))
+            oldest = &voice;
+    }
+
+    if (target == nullptr)
+        target = oldest;
+
+    if (target == nullptr)
+        return nullptr;
+
+    const auto index = static_cast<size_t> (target - voices.data());
+
+    target->sample = sample;
+    target->params = params;
+    target->tag = tag;
+    target->position = 0.0;
+    target->releaseRemaining = -1;
+    target->startDelay = startDelay;
+    target->releaseAt = -1;
+    target->startOrder = ++startCounter;
+    target->noteTimestampMs = -1.0;
+
+    const double sourceRate = target->sample->getSampleRate();
+    target->increment = (sampleRate > 0.0 && sourceRate > 0.0) ? sourceRate / sampleRate : 1.0;
+
+    voiceTags[index].store (tag);
+    return target;
+}
+
+void SliceVoicePool::releaseVoice (Voice& voice)
+{
+    if (voice.releaseRemaining < 0)
+        voice.releaseRemaining = kReleaseSamples;
+}
+
+void SliceVoicePool::freeVoice (Voice& voice)
+{
+    const auto index = static_cast<size_t> (&voice - voices.data());
+    voice.sample = nullptr;
+    voice.tag = 0;
+    voiceTags[index].store (0);
+}
+
+void SliceVoicePool::renderVoice (Voice& voice,
+                                  float* const* output,
+                                  int numOutputChannels,
+                                  int startSample,
+                                  int numSamples)
+{
+    const auto& buffer = voice.sample->getBuffer();
+    const int length = buffer.getNumSamples();
+    const int lastSourceChannel = buffer.getNumChannels() - 1;
+
+    // unity rate without a release ramp is a straight vector add
+    if (voice.increment == 1.0 && voice.releaseRemaining < 0)
+    {
+        int done = 0;
+        while (done < numSamples)
+        {
+            int position = static_cast<int> (voice.position);
+            if (position >= length)
+            {
+                if (! voice.params.loop)
+                {
+                    freeVoice (voice);
+                    return;
+                }
+
+                voice.position = 0.0;
+                position = 0;
+            }
+
+            const int chunk = juce::jmin (numSamples - done, length - position);
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+            {
+                juce::FloatVectorOperations::addWithMultiply (
+                    output[ch] + startSample + done,
+                    buffer.getReadPointer (juce::jmin (ch, lastSourceChannel), position),
+                    voice.params.gain,
+                    chunk);
+            }
+
+            voice.position += chunk;
+            done += chunk;
+        }
+        return;
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (voice.position >= length)
+        {
+            if (! voice.params.loop)
+            {
+                freeVoice (voice);
+                return;
+            }
+
+            voice.position -= length;
+        }
+
+        float envelope = voice.params.gain;
+        if (voice.releaseRemaining >= 0)
+        {
+            if (voice.releaseRemaining == 0)
+            {
+                freeVoice (voice);
+                return;
+            }
+
+            envelope *= static_cast<float> (voice.releaseRemaining) / static_cast<float> (kReleaseSamples);
+            --voice.releaseRemaining;
+        }
+
+        const int index = static_cast<int> (voice.position);
+        const int nextIndex = index + 1 < length ? index + 1 : (voice.params.loop ? 0 : index);
+        const float fraction = static_cast<float> (voice.position - index);
+
+        for (int ch = 0; ch < numOutputChannels; ++ch)
+        {
+            const float* src = buffer.getReadPointer (juce::jmin (ch, lastSourceChannel));
+            const float value = src[index] + fraction * (src[nextIndex] - src[index]);
+            output[ch][startSample + i] += value * envelope;
+        }
+
+        voice.position += voice.increment;
+    }
+}
+
+// =====================================================
+// CHECKS
+// =====================================================
+
+#if JUCE_DEBUG
+
+class SliceVoicePoolTests final : public juce::UnitTest
+{
+public:
+    SliceVoicePoolTests() : juce::UnitTest ("SliceVoicePool", "Slicebot") {}
+
+    void runTest() override
+    {
+        beginTest ("a pad note sounds on its own sample, one block after its timestamp");
+
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 256;
+        constexpr double periodMs = blockSize * 1000.0 / sampleRate;
+        constexpr double firstBlockMs = 1000.0;
+
+        SliceVoicePool pool;
+        pool.prepare (sampleRate, blockSize, 0);
+
+        juce::AudioBuffer<float> audio (1, 1000);
+        audio.clear();
+        audio.setSample (0, 0, 1.0f);
+        pool.setPadSample (0, pool.createSample (std::move (audio), sampleRate));
+
+        // halfway through the second block's span
+        const double noteMs = firstBlockMs + 1.5 * periodMs;
+        juce::AudioBuffer<float> output (1, blockSize);
+        int heardAt = -1;
+
+        for (int block = 0; block < 4; ++block)
+        {
+            if (block == 2)
+                pool.triggerPad (0, 1.0f, noteMs);
+
+            output.clear();
+            pool.render (output.getArrayOfWritePointers(), 1, blockSize, firstBlockMs + block * periodMs, 0.0);
+
+            for (int i = 0; i < blockSize && heardAt < 0; ++i)
+            {
+                if (output.getSample (0, i) != 0.0f)
+                    heardAt = block * blockSize + i;
+            }
+        }
+
+        expectEquals (heardAt, 2 * blockSize + blockSize / 2);
+
+        const auto stats = pool.getPadLatencyStats();
+        expectEquals (stats.notes, 1);
+        expectWithinAbsoluteError (stats.lastMs, periodMs, 0.05);
+    }
+};
+
+static SliceVoicePoolTests sliceVoicePoolTests;
+
+#endif
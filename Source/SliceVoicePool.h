@@ -0,0 +1,168 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// Fixed pool of sample voices mixed inside AudioEngine's callback. The
+// message thread loads audio into Sample objects and posts commands through
+// a lock-free FIFO; nothing is allocated or freed on the audio thread.
+class SliceVoicePool
+{
+public:
+    static constexpr int kMaxVoices = 32;
+    static constexpr int kNumPads = 16;
+
+    class Sample final : public juce::ReferenceCountedObject
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<Sample>;
+
+        Sample (juce::AudioBuffer<float>&& audio, double sourceSampleRate);
+
+        const juce::AudioBuffer<float>& getBuffer() const;
+        double getSampleRate() const;
+
+    private:
+        juce::AudioBuffer<float> buffer;
+        double sampleRate = 0.0;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Sample)
+    };
+
+    struct TriggerParams
+    {
+        float gain = 1.0f;
+        bool loop = false;
+        int chokeGroup = -1;
+    };
+
+    struct LatencyStats
+    {
+        int notes = 0;
+        double lastMs = 0.0;
+        double meanMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+    SliceVoicePool();
+
+    // =====================================================
+    // MESSAGE THREAD
+    // =====================================================
+    Sample::Ptr createSample (juce::AudioBuffer<float>&& audio, double sourceSampleRate);
+    int trigger (Sample::Ptr sample, const TriggerParams& params);
+    void stopVoice (int tag);
+    void stopAll();
+    void setVoiceLooping (int tag, bool shouldLoop);
+    bool isVoicePlaying (int tag) const;
+
+    void setPadSample (int padIndex, Sample::Ptr sample);
+    void setPadChokeGroup (int padIndex, int chokeGroup);
+    LatencyStats getPadLatencyStats() const;
+
+    // =====================================================
+    // MIDI THREAD
+    // =====================================================
+    bool triggerPad (int padIndex, float gain, double timestampMs);
+
+    // =====================================================
+    // AUDIO THREAD
+    // =====================================================
+    void prepare (double deviceSampleRate, int blockSize, int outputLatencySamples);
+
+    // presentationDelayMs is the device's own measure of how far ahead of the
+    // callback this block is heard, or negative to use the reported latency
+    void render (float* const* output, int numOutputChannels, int numSamples,
+                 double blockStartMs, double presentationDelayMs = -1.0);
+
+private:
+    enum class CommandType
+    {
+        trigger,
+        stop,
+        stopAll,
+        setLoop,
+        setPad,
+        setPadChoke
+    };
+
+    struct Command
+    {
+        CommandType type = CommandType::trigger;
+        Sample::Ptr sample;
+        TriggerParams params;
+        int tag = 0;
+        int padIndex = -1;
+    };
+
+    struct PadTrigger
+    {
+        int padIndex = 0;
+        float gain = 1.0f;
+        double timestampMs = 0.0;
+    };
+
+    struct Pad
+    {
+        Sample::Ptr sample;
+        int chokeGroup = -1;
+    };
+
+    struct Voice
+    {
+        Sample::Ptr sample;
+        TriggerParams params;
+        int tag = 0;
+        double position = 0.0;
+        double increment = 1.0;
+        int releaseRemaining = -1;
+        int startDelay = 0;
+        int releaseAt = -1;
+        juce::uint32 startOrder = 0;
+        double noteTimestampMs = -1.0; // a pad note not yet heard
+    };
+
+    static constexpr int kQueueSize = 256;
+    static constexpr int kMaxPendingPads = 64;
+    static constexpr int kReleaseSamples = 64;
+
+    bool post (Command&& command);
+    void handleCommand (Command& command);
+    Voice* startVoice (const Sample::Ptr& sample, const TriggerParams& params, int tag, int startDelay);
+    void releaseVoice (Voice& voice);
+    void renderVoice (Voice& voice, float* const* output, int numOutputChannels,
+                      int startSample, int numSamples);
+    void freeVoice (Voice& voice);
+    void schedulePads (int numSamples, double blockStartMs);
+    void recordLatency (Voice& voice, int startSample, double blockStartMs, double presentationDelayMs);
+
+    juce::AbstractFifo fifo { kQueueSize };
+    std::array<Command, kQueueSize> commands;
+
+    juce::AbstractFifo padFifo { kQueueSize };
+    std::array<PadTrigger, kQueueSize> padTriggers;
+
+    // message thread keeps every sample alive until only it holds a reference
+    juce::ReferenceCountedArray<Sample> loadedSamples;
+    int nextTag = 1;
+
+    // audio thread
+    std::array<Voice, kMaxVoices> voices;
+    std::array<std::atomic<int>, kMaxVoices> voiceTags {};
+    std::atomic<int> lastConsumedTag { 0 };
+    std::array<Pad, kNumPads> pads;
+    std::array<PadTrigger, kMaxPendingPads> pendingPads;
+    int numPendingPads = 0;
+    double sampleRate = 0.0;
+    int blockSize = 0;
+    int outputLatencySamples = 0;
+    juce::uint32 startCounter = 0;
+
+    std::atomic<int> latencyNotes { 0 };
+    std::atomic<double> latencyLastMs { 0.0 };
+    std::atomic<double> latencySumMs { 0.0 };
+    std::atomic<double> latencyMaxMs { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SliceVoicePool)
+};
@@ -0,0 +1,351 @@
+#include "SpeculativeSlicePool.h"
+#include "EnergyMap.h"
+#include "SliceRandom.h"
+
+namespace
+{
+    constexpr int kPollMs = 250;
+    constexpr double kSettleMs = 1000.0; // how long the settings must hold before anything is cut for them
+
+    // everything Slice All reads from the snapshot
+    bool cutsAlike (const SliceStateStore::SliceStateSnapshot& a, const SliceStateStore::SliceStateSnapshot& b)
+    {
+        return a.sourceMode == b.sourceMode
+            && a.sourceFile == b.sourceFile
+            && a.cacheData == b.cacheData
+            && a.candidates == b.candidates
+            && juce::approximatelyEqual (a.bpm, b.bpm)
+            && a.subdivisionSteps == b.subdivisionSteps
+            && a.sampleCountSetting == b.sampleCountSetting
+            && a.randomSubdivisionEnabled == b.randomSubdivisionEnabled
+            && a.transientDetectionEnabled == b.transientDetectionEnabled
+            && a.layeringMode == b.layeringMode
+            && a.sessionSeed == b.sessionSeed
+            && a.kitNumber == b.kitNumber;
+    }
+
+    // everything regenerating reads from the slice it replaces
+    bool cutsAlike (const SliceStateStore::SliceInfo& a, const SliceStateStore::SliceInfo& b)
+    {
+        if (a.sourceMode == SliceStateStore::SourceMode::singleManual && a.fileURL != b.fileURL)
+            return false;
+
+        return a.sourceMode == b.sourceMode
+            && a.candidates == b.candidates
+            && juce::approximatelyEqual (a.bpm, b.bpm)
+            && a.subdivisionSteps == b.subdivisionSteps
+            && a.transientDetectionEnabled == b.transientDetectionEnabled
+            && a.isReversed == b.isReversed
+            && a.kitSeed == b.kitSeed;
+    }
+}
+
+SpeculativeSlicePool::SpeculativeSlicePool (SliceStateStore& store)
+    : stateStore (store),
+      poolFolder (juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("AudioSnippetSpeculation"))
+{
+    // whatever an earlier run left was cut for settings that are gone
+    poolFolder.deleteRecursively();
+    poolFolder.createDirectory();
+
+    startTimer (kPollMs);
+}
+
+SpeculativeSlicePool::~SpeculativeSlicePool()
+{
+    stopTimer();
+
+    // a running cut writes into the pool folder
+    if (refillToken != nullptr)
+        refillToken->cancel();
+
+    JobScheduler::get().wait (refillJob);
+    poolFolder.deleteRecursively();
+}
+
+// =====================================================
+// ANY THREAD
+// =====================================================
+
+std::optional<MutationOrchestrator::SliceSet> SpeculativeSlicePool::takeSliceSet (const SliceStateStore::SliceStateSnapshot& snapshot,
+                                                                                 const juce::File& folder)
+{
+    std::optional<PooledSet> taken;
+    {
+        const juce::ScopedLock sl (poolLock);
+        if (! sliceSet.has_value() || ! cutsAlike (*sliceSet->cutFrom, snapshot)
+            || sliceSet->mapGeneration != EnergyMap::getGeneration())
+            return std::nullopt;
+
+        taken = std::move (sliceSet);
+        sliceSet.reset();
+        idleAt = nullptr;
+    }
+
+    folder.deleteRecursively();
+    if (! taken->folder.moveFileTo (folder))
+    {
+        taken->folder.deleteRecursively();
+        return std::nullopt;
+    }
+
+    for (auto& previewSnippetURL : taken->slices.previewSnippetURLs)
+        previewSnippetURL = folder.getChildFile (previewSnippetURL.getFileName());
+
+    return std::move (taken->slices);
+}
+
+std::optional<SliceStateStore::SliceInfo> SpeculativeSlicePool::takeReplacement (int index,
+                                                                                const SliceStateStore::SliceInfo& sliceInfo,
+                                                                                const juce::File& outputFile)
+{
+    std::optional<PooledReplacement> taken;
+    {
+        const juce::ScopedLock sl (poolLock);
+        if (index < 0 || index >= static_cast<int> (replacementSlots.size()))
+            return std::nullopt;
+
+        auto& slot = replacementSlots[static_cast<std::size_t> (index)];
+        if (slot.ready.empty() || ! cutsAlike (slot.cutFor, sliceInfo)
+            || slot.ready.front().sliceInfo.recutCount != sliceInfo.recutCount + 1
+            || slot.ready.front().mapGeneration != EnergyMap::getGeneration())
+            return std::nullopt;
+
+        taken = std::move (slot.ready.front());
+        slot.ready.erase (slot.ready.begin());
+        idleAt = nullptr;
+    }
+
+    if (! taken->file.moveFileTo (outputFile))
+    {
+        taken->file.deleteFile();
+        return std::nullopt;
+    }
+
+    // only what the cut chose; lock, volume and the rest stay as they are now
+    auto updatedInfo = sliceInfo;
+    updatedInfo.fileURL = taken->sliceInfo.fileURL;
+    updatedInfo.startFrame = taken->sliceInfo.startFrame;
+    updatedInfo.snippetFrameCount = taken->sliceInfo.snippetFrameCount;
+    updatedInfo.sampleRate = taken->sliceInfo.sampleRate;
+    updatedInfo.subdivisionSteps = taken->sliceInfo.subdivisionSteps;
+    updatedInfo.recutCount = taken->sliceInfo.recutCount;
+    return updatedInfo;
+}
+
+// =====================================================
+// MESSAGE THREAD
+// =====================================================
+
+void SpeculativeSlicePool::timerCallback()
+{
+    const auto snapshot = stateStore.getSnapshot();
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    const int mapGeneration = EnergyMap::getGeneration();
+
+    if (settledFrom == nullptr || ! cutsAlike (*settledFrom, *snapshot) || settledMapGeneration != mapGeneration)
+    {
+        settledFrom = snapshot;
+        settledMapGeneration = mapGeneration;
+        settingsChangedMs = nowMs;
+
+        // what is being cut is for settings that are gone
+        if (refillToken != nullptr)
+            refillToken->cancel();
+    }
+
+    if (nowMs - settingsChangedMs < kSettleMs || ! JobScheduler::get().isFinished (refillJob))
+        return;
+
+    if (snapshot->isCaching || snapshot->sourceMode == SliceStateStore::SourceMode::live)
+        return;
+
+    {
+        const juce::ScopedLock sl (poolLock);
+        if (idleAt == snapshot && idleMapGeneration == mapGeneration)
+            return;
+    }
+
+    if (refillToken == nullptr || refillToken->isCancelled())
+        refillToken = JobScheduler::makeToken();
+
+    const auto token = refillToken;
+    refillJob = JobScheduler::get().submit (JobScheduler::Priority::analysis, [this, snapshot, token]
+    {
+        refill (snapshot, token);
+    }, token);
+}
+
+// =====================================================
+// REFILL JOBS
+// =====================================================
+
+void SpeculativeSlicePool::refill (const SliceStateStore::Snapshot& snapshot, const JobScheduler::Token& token)
+{
+    const int mapGeneration = EnergyMap::getGeneration();
+    discardStale (*snapshot, mapGeneration);
+
+    // the set first: Slice All replaces every slice at once
+    if (refillSliceSet (snapshot, token, mapGeneration) || refillReplacement (snapshot, token, mapGeneration))
+        return;
+
+    const juce::ScopedLock sl (poolLock);
+    idleAt = snapshot;
+    idleMapGeneration = mapGeneration;
+}
+
+void SpeculativeSlicePool::discardStale (const SliceStateStore::SliceStateSnapshot& snapshot, int mapGeneration)
+{
+    const juce::ScopedLock sl (poolLock);
+
+    if (sliceSet.has_value() && (! cutsAlike (*sliceSet->cutFrom, snapshot) || sliceSet->mapGeneration != mapGeneration))
+    {
+        sliceSet->folder.deleteRecursively();
+        sliceSet.reset();
+    }
+
+    const auto& sliceInfos = snapshot.sliceInfos;
+    for (std::size_t index = 0; index < replacementSlots.size(); ++index)
+    {
+        auto& slot = replacementSlots[index];
+
+        // a slice recut some other way has moved past what is ready for it
+        if (index < sliceInfos.size() && cutsAlike (slot.cutFor, sliceInfos[index])
+            && (slot.ready.empty() || (slot.ready.front().sliceInfo.recutCount == sliceInfos[index].recutCount + 1
+                                       && slot.ready.front().mapGeneration == mapGeneration)))
+            continue;
+
+        for (const auto& replacement : slot.ready)
+            replacement.file.deleteFile();
+
+        slot.ready.clear();
+        slot.unusable = false;
+        if (index < sliceInfos.size())
+            slot.cutFor = sliceInfos[index];
+    }
+
+    while (replacementSlots.size() < sliceInfos.size())
+        replacementSlots.push_back ({ sliceInfos[replacementSlots.size()], {}, false });
+
+    replacementSlots.resize (sliceInfos.size());
+}
+
+bool SpeculativeSlicePool::refillSliceSet (const SliceStateStore::Snapshot& snapshot, const JobScheduler::Token& token,
+                                           int mapGeneration)
+{
+    {
+        const juce::ScopedLock sl (poolLock);
+        if (sliceSet.has_value())
+            return false;
+    }
+
+    if (unusableSettings != nullptr && cutsAlike (*unusableSettings, *snapshot))
+        return false;
+
+    const auto folder = nextPoolFile ("set_", {});
+    folder.createDirectory();
+
+    // the seed the next Slice All will use, so the set is the one it would cut
+    const auto kitSeed = SliceRandom::kitSeed (snapshot->sessionSeed, snapshot->kitNumber + 1);
+
+    MutationOrchestrator orchestrator (stateStore);
+    auto slices = orchestrator.cutSliceSet (*snapshot, folder, kitSeed, [this, &snapshot, &token]
+    {
+        return token->isCancelled() || ! cutsAlike (*stateStore.getSnapshot(), *snapshot);
+    });
+
+    // a map built during the cut may have moved some of its picks
+    const bool settingsChanged = ! cutsAlike (*stateStore.getSnapshot(), *snapshot)
+                                 || EnergyMap::getGeneration() != mapGeneration;
+    if (! slices.has_value() || settingsChanged)
+    {
+        folder.deleteRecursively();
+        if (! slices.has_value() && ! settingsChanged && ! token->isCancelled())
+            unusableSettings = snapshot;
+
+        return settingsChanged;
+    }
+
+    const juce::ScopedLock sl (poolLock);
+    sliceSet = PooledSet { snapshot, folder, std::move (*slices), mapGeneration };
+    return true;
+}
+
+bool SpeculativeSlicePool::refillReplacement (const SliceStateStore::Snapshot& snapshot, const JobScheduler::Token& token,
+                                              int mapGeneration)
+{
+    int index = -1;
+    SliceStateStore::SliceInfo cutFrom; // the slice as it will be when the last ready one is taken
+    {
+        const juce::ScopedLock sl (poolLock);
+
+        // the slot with the fewest ready, so every slice has one before any has two
+        const auto numSlots = juce::jmin (replacementSlots.size(), snapshot->sliceInfos.size());
+        for (std::size_t i = 0; i < numSlots; ++i)
+        {
+            const auto& slot = replacementSlots[i];
+            const auto& sliceInfo = snapshot->sliceInfos[i];
+            if (slot.unusable
+                || sliceInfo.isLocked
+                || sliceInfo.isDeleted
+                || sliceInfo.sourceMode == SliceStateStore::SourceMode::live
+                || static_cast<int> (slot.ready.size()) >= kReplacementsPerSlice)
+                continue;
+
+            if (index < 0 || slot.ready.size() < replacementSlots[static_cast<std::size_t> (index)].ready.size())
+                index = static_cast<int> (i);
+        }
+
+        if (index < 0)
+            return false;
+
+        const auto& slot = replacementSlots[static_cast<std::size_t> (index)];
+        cutFrom = slot.ready.empty() ? snapshot->sliceInfos[static_cast<std::size_t> (index)]
+                                     : slot.ready.back().sliceInfo;
+    }
+
+    const auto file = nextPoolFile ("replacement_", ".wav");
+
+    MutationOrchestrator orchestrator (stateStore);
+    auto replacement = orchestrator.cutReplacement (cutFrom, index, *snapshot, file, [&token]
+    {
+        return token->isCancelled();
+    });
+
+    const auto current = stateStore.getSnapshot();
+
+    const juce::ScopedLock sl (poolLock);
+    if (index >= static_cast<int> (replacementSlots.size())
+        || index >= static_cast<int> (current->sliceInfos.size())
+        || ! cutsAlike (replacementSlots[static_cast<std::size_t> (index)].cutFor, cutFrom)
+        || EnergyMap::getGeneration() != mapGeneration)
+    {
+        file.deleteFile();
+        return true;
+    }
+
+    // ready ones must follow on from the slice one step at a time
+    auto& slot = replacementSlots[static_cast<std::size_t> (index)];
+    const int nextRecut = (slot.ready.empty() ? current->sliceInfos[static_cast<std::size_t> (index)].recutCount
+                                              : slot.ready.back().sliceInfo.recutCount) + 1;
+    if (replacement.has_value() && replacement->recutCount != nextRecut)
+    {
+        file.deleteFile();
+        return true;
+    }
+
+    if (! replacement.has_value())
+    {
+        file.deleteFile();
+        slot.unusable = ! token->isCancelled();
+        return true;
+    }
+
+    slot.ready.push_back ({ std::move (*replacement), file, mapGeneration });
+    return true;
+}
+
+juce::File SpeculativeSlicePool::nextPoolFile (const juce::String& prefix, const juce::String& suffix)
+{
+    return poolFolder.getChildFile (prefix + juce::String (nextFileId++) + suffix);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <optional>
+#include <vector>
+#include "JobScheduler.h"
+#include "MutationOrchestrator.h"
+#include "SliceStateStore.h"
+
+// Cuts the next Slice All set, and a few regenerate replacements for every
+// current slice, so those actions only have to move finished files into
+// place. Each cut is one analysis job on the shared scheduler, and none is
+// started until the settings it depends on (BPM, subdivision, source mode,
+// source, cache) have held still for a moment, so dragging a control does
+// not cut a set per step. Whatever no longer matches the settings it was
+// cut with is thrown away and cut again. So is whatever was cut before the
+// last energy map was built, since a pick would now land elsewhere; while
+// maps keep arriving nothing is cut, as if the settings were moving. LIVE
+// takes change as they are recorded, so nothing is cut ahead for them.
+class SpeculativeSlicePool final : private juce::Timer
+{
+public:
+    explicit SpeculativeSlicePool (SliceStateStore& stateStore);
+    ~SpeculativeSlicePool() override;
+
+    // =====================================================
+    // ANY THREAD
+    // =====================================================
+    // moves a set cut with the snapshot's settings to folder, replacing it;
+    // nullopt if none is ready
+    std::optional<MutationOrchestrator::SliceSet> takeSliceSet (const SliceStateStore::SliceStateSnapshot& snapshot,
+                                                                const juce::File& folder);
+
+    // moves a replacement cut for the slice at index over outputFile and
+    // returns sliceInfo updated to it; nullopt if none is ready
+    std::optional<SliceStateStore::SliceInfo> takeReplacement (int index,
+                                                               const SliceStateStore::SliceInfo& sliceInfo,
+                                                               const juce::File& outputFile);
+
+private:
+    static constexpr int kReplacementsPerSlice = 2;
+
+    struct PooledSet
+    {
+        SliceStateStore::Snapshot cutFrom;
+        juce::File folder;
+        MutationOrchestrator::SliceSet slices;
+        int mapGeneration = 0; // EnergyMap::getGeneration() before the cut
+    };
+
+    struct PooledReplacement
+    {
+        SliceStateStore::SliceInfo sliceInfo;
+        juce::File file;
+        int mapGeneration = 0;
+    };
+
+    // replacements for one slice position, cut for the slice as it was;
+    // ready holds the next steps of the slice's stream, in order
+    struct ReplacementSlot
+    {
+        SliceStateStore::SliceInfo cutFor;
+        std::vector<PooledReplacement> ready;
+        bool unusable = false; // the last attempt found nothing to cut
+    };
+
+    // message thread
+    void timerCallback() override;
+
+    // refill job; cuts at most one set or replacement
+    void refill (const SliceStateStore::Snapshot& snapshot, const JobScheduler::Token& token);
+    void discardStale (const SliceStateStore::SliceStateSnapshot& snapshot, int mapGeneration);
+    bool refillSliceSet (const SliceStateStore::Snapshot& snapshot, const JobScheduler::Token& token, int mapGeneration);
+    bool refillReplacement (const SliceStateStore::Snapshot& snapshot, const JobScheduler::Token& token, int mapGeneration);
+    juce::File nextPoolFile (const juce::String& prefix, const juce::String& suffix);
+
+    SliceStateStore& stateStore;
+    const juce::File poolFolder;
+
+    // message thread only
+    SliceStateStore::Snapshot settledFrom;  // the settings the timer last saw change
+    int settledMapGeneration = 0;
+    double settingsChangedMs = 0.0;
+    JobScheduler::Token refillToken;        // cancelled when the settings change
+    JobScheduler::JobHandle refillJob;
+
+    // refill jobs only; they run one at a time
+    int nextFileId = 0;
+    SliceStateStore::Snapshot unusableSettings; // the last snapshot no set could be cut from
+
+    juce::CriticalSection poolLock;
+    std::optional<PooledSet> sliceSet;
+    std::vector<ReplacementSlot> replacementSlots;
+    SliceStateStore::Snapshot idleAt; // the last snapshot a refill found nothing to cut for
+    int idleMapGeneration = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpeculativeSlicePool)
+};
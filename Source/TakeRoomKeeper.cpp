@@ -0,0 +1,29 @@
+#include "TakeRoomKeeper.h"
+
+namespace
+{
+    constexpr int kPollIntervalMs = 20;
+}
+
+TakeRoomKeeper::TakeRoomKeeper (std::vector<RecordingModule*> recordersToKeep)
+    : juce::Thread ("TakeRoomKeeper"),
+      recorders (std::move (recordersToKeep))
+{
+    startThread();
+}
+
+TakeRoomKeeper::~TakeRoomKeeper()
+{
+    stopThread (2000);
+}
+
+void TakeRoomKeeper::run()
+{
+    while (! threadShouldExit())
+    {
+        for (auto* recorder : recorders)
+            recorder->keepRoomAhead();
+
+        wait (kPollIntervalMs);
+    }
+}
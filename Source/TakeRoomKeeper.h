@@ -0,0 +1,28 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+#include "RecordingModule.h"
+
+// Keeps every recorder's room ahead of its take, so a pass grows in chunks
+// allocated here rather than on arming or on the audio thread. At 192 kHz a
+// recorder's headroom still lasts several hundred milliseconds, far longer
+// than the 20 ms this thread sleeps between rounds.
+//
+// Like the LiveTakeAnalyzer it stays outside the JobScheduler, where a top-up
+// could wait behind a recache batch while the headroom runs out.
+class TakeRoomKeeper final : private juce::Thread
+{
+public:
+    // the recorders must outlive the keeper
+    explicit TakeRoomKeeper (std::vector<RecordingModule*> recordersToKeep);
+    ~TakeRoomKeeper() override;
+
+private:
+    void run() override;
+
+    const std::vector<RecordingModule*> recorders;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TakeRoomKeeper)
+};